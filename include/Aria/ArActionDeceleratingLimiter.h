@@ -27,6 +27,9 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArAction.h"
 
+class ArRangeDevice;
+class ArLocalCostmap;
+
 /// Action to limit the forwards motion of the robot based on range sensor readings
 /**
    This action uses the robot's range sensors (e.g. sonar, laser) to find a 
@@ -88,7 +91,15 @@ public:
   // sets if we should stop rotation too if this action has stopped the robot
   void setStopRotationToo(bool stopRotationToo)
     { myStopRotationToo = stopRotationToo; }
+  /// Checks @a costmap instead of the lasers and sonar that go into it (NULL to go back)
+  void setCostmap(ArLocalCostmap *costmap) { myCostmap = costmap; }
+  /// Gets the costmap checked for obstacles, if there is one
+  ArLocalCostmap *getCostmap() const { return myCostmap; }
 protected:
+  // checks the costmap and the range devices it doesn't cover if there
+  // is one, otherwise all the range devices
+  double checkBox(double x1, double y1, double x2, double y2,
+		  ArPose *readingPos, const ArRangeDevice **rangeDevice);
   bool myLastStopped;
   LimiterType myType;
   double myClearance;
@@ -103,6 +114,7 @@ protected:
   bool myUseEStop;
   bool myUseLocationDependentDevices;
   bool myStopRotationToo;
+  ArLocalCostmap *myCostmap;
 
 //unused?  double myDecelerateDistance;
   ArActionDesired myDesired;
@@ -28,6 +28,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArAction.h"
 
 class ArRangeDevice;
+class ArLocalCostmap;
 
 /// Action to limit the forwards motion of the robot based on range sensor readings.
 /**
@@ -60,7 +61,15 @@ public:
   bool getStopped() const { return myLastStopped; } 
   ArPose getLastSensorReadingPos() const { return myLastSensorReadingPos; } 
   const ArRangeDevice* getLastSensorReadingDevice() const { return myLastSensorReadingDev; } 
+  /// Checks @a costmap instead of the lasers and sonar that go into it (NULL to go back)
+  void setCostmap(ArLocalCostmap *costmap) { myCostmap = costmap; }
+  /// Gets the costmap checked for obstacles, if there is one
+  ArLocalCostmap *getCostmap() const { return myCostmap; }
 protected:
+  // checks the costmap and the range devices it doesn't cover if there
+  // is one, otherwise all the range devices
+  double checkBox(double x1, double y1, double x2, double y2,
+		  ArPose *readingPos, const ArRangeDevice **rangeDevice);
   bool myLastStopped;
   double myStopDist;
   double mySlowDist;
@@ -69,6 +78,7 @@ protected:
   ArActionDesired myDesired;
   ArPose myLastSensorReadingPos;
   const ArRangeDevice *myLastSensorReadingDev;
+  ArLocalCostmap *myCostmap;
 };
 
 #endif // ARACTIONSPEEDLIMITER_H
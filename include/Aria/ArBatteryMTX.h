@@ -31,6 +31,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArRobotPacket.h"
 #include "Aria/ArRobotConnector.h"
 
+class ArDeviceReactor;
 
 
 // Packets are in the format of 
@@ -89,6 +90,11 @@ public:
 
   AREXPORT bool blockingConnect(bool sendTracking, bool recvTracking);
   AREXPORT bool disconnect();
+  /// Reads the battery from @a reactor's thread instead of its own thread
+  /// (must be called before connecting)
+  void setDeviceReactor(ArDeviceReactor *reactor) { myReactor = reactor; }
+  /// Gets the reactor the battery is read from (NULL if it has its own thread)
+  ArDeviceReactor *getDeviceReactor() { return myReactor; }
   bool isConnected() { return myIsConnected; }
   bool isTryingToConnect() 
     { 
@@ -384,6 +390,8 @@ protected:
 
   void batterySetName(const char *name);
   virtual void * runThread(void *arg);
+  void startReading();
+  void reactorRead();
 		
 
 	bool getSystemInfo();
@@ -554,6 +562,8 @@ enum Sizes {
   ArFunctorC<ArBatteryMTX> mySensorInterpTask;
   ArRetFunctorC<bool, ArBatteryMTX> myAriaExitCB;
 
+  ArDeviceReactor *myReactor;
+  ArFunctorC<ArBatteryMTX> myReactorReadCB;
 };
 
 
@@ -0,0 +1,83 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARCHECKSUM_H
+#define ARCHECKSUM_H
+
+#ifndef ARIA_WRAPPER
+
+#include "Aria/ariaTypedefs.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/// Checksums and CRCs used by the device protocols
+/**
+   These are the checksums that the packet receivers check on every
+   packet they get, so they're done a block at a time instead of a byte
+   at a time: the CRCs with slicing-by-8 tables, and the word sum and
+   XOR with SSE2 or AVX2 when the processor has them.  Which of those
+   is used is picked when first needed (see getImplementation()); a
+   plain scalar version is always there as the fallback, and gives the
+   same answers.
+
+   @internal
+**/
+class ArChecksum
+{
+public:
+  /// Sum of big-endian 16 bit words (the robot packet checksum)
+  AREXPORT static uint16_t wordSumBE(const unsigned char *data, size_t len);
+  /// XOR of all the bytes
+  AREXPORT static unsigned char xorFold(const unsigned char *data, size_t len);
+  /// CRC-16 with the CCITT polynomial (0x1021), most significant bit first
+  AREXPORT static uint16_t crc16CCITT(const unsigned char *data, size_t len,
+				      uint16_t crc = 0xffff);
+  /// The CRC used by the SICK LMS2xx
+  AREXPORT static uint16_t crc16LMS2xx(const unsigned char *data, 
+				       size_t len);
+
+  /// Ways the word sum and XOR can be computed
+  enum Implementation 
+  {
+    SCALAR, ///< A word or byte at a time
+    SSE2, ///< 16 bytes at a time
+    AVX2 ///< 32 bytes at a time
+  };
+  /// Gets which implementation the word sum and XOR are using
+  AREXPORT static Implementation getImplementation();
+  /// Makes the word sum and XOR use @a impl (for tests and benchmarks)
+  AREXPORT static bool setImplementation(Implementation impl);
+  /// Sees if @a impl can be used on this build and processor
+  AREXPORT static bool isSupported(Implementation impl);
+  /// Gets the name of an implementation
+  AREXPORT static const char *getImplementationName(Implementation impl);
+
+  /// CRC-16 (CCITT) a byte at a time, for comparing against crc16CCITT()
+  AREXPORT static uint16_t crc16CCITTBytewise(const unsigned char *data, 
+					      size_t len,
+					      uint16_t crc = 0xffff);
+};
+
+#endif // not ARIA_WRAPPER
+#endif // ARCHECKSUM_H
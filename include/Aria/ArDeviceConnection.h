@@ -25,9 +25,13 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #define ARDEVICECONNECTION_H
 
 #include <string>
+#include <vector>
+#include <deque>
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ariaUtil.h"
 #include "Aria/ArBasePacket.h"
+#include "Aria/ArDeviceConnectionStats.h"
+#include "Aria/ArMutex.h"
 
 /// Base class for device connections
 /**
@@ -41,6 +45,15 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
    will try to connect to... the inherited classes also have an open which
    returns more detailed information about the open attempt, and which takes 
    the parameters for where to connect
+
+   Packet receivers should normally read through the read-ahead buffer
+   (readBuffered(), peekBuffered(), consumeReadAhead(), scanReadAhead()),
+   rather than calling read() directly one byte at a time.  Each call to
+   fillReadAhead() transfers as many bytes as are available from the
+   device (one system call in the common case), and the receiver then
+   frames packets out of memory.  Don't mix direct read() calls with
+   buffered reads on the same connection, since any bytes already in
+   the read-ahead buffer would be skipped by read().
 */
 class ArDeviceConnection
 {
@@ -135,6 +148,15 @@ class ArDeviceConnection
   /// sees if timestamping is really going on or not
   /** @return true if real timestamping is happening, false otherwise */
   AREXPORT virtual bool isTimeStamping() = 0;
+  /// Gets a file descriptor that becomes readable when there is data to read
+  /**
+     This is so that many connections can be waited on at once (see
+     ArDeviceReactor), only connections that are backed by a file
+     descriptor have one.
+     @return the file descriptor, or -1 if the connection isn't open or
+     doesn't have one
+  */
+  AREXPORT virtual int getPollFD() { return -1; }
 
   /// Gets the port name
   AREXPORT const char *getPortName() const;
@@ -157,6 +179,66 @@ class ArDeviceConnection
   AREXPORT void debugEndPacket(bool goodPacket, int type = 0);
   /// Makes all device connections so that they'll dump data
   AREXPORT static bool debugShouldLog(bool shouldLog);
+
+#ifndef ARIA_WRAPPER
+  /// Gets the counters and timing histograms for data read from this connection
+  const ArDeviceConnectionStats *getIOStats() const { return &myIOStats; }
+#endif
+  /// Sets the I/O statistics back to 0
+  AREXPORT void resetIOStats();
+  /// Logs the I/O statistics
+  AREXPORT void logIOStats(ArLog::LogLevel level = ArLog::Normal);
+  /// Notifies the device connection that a good packet of @a size bytes is at the front of the read-ahead buffer
+  AREXPORT void ioStatsGoodPacket(unsigned int size);
+  /// Notifies the device connection that a bad packet was read
+  AREXPORT void ioStatsBadPacket(bool badChecksum);
+  /// Notifies the device connection that @a bytesSkipped bytes were skipped to find the start of a packet
+  AREXPORT void ioStatsResync(unsigned int bytesSkipped);
+
+  /// Starts saving everything read from the device (with when it was read) to a capture file
+  AREXPORT bool startRecording(const char *fileName);
+  /// Stops saving data read from the device
+  AREXPORT void stopRecording();
+  /// Sees if data read from the device is being saved
+  AREXPORT bool isRecording();
+
+  /// Reads data through the read-ahead buffer
+  AREXPORT int readBuffered(const char *data, unsigned int size,
+			    unsigned int msWait = 0);
+  /// Reads whatever is available from the device into the read-ahead buffer
+  AREXPORT int fillReadAhead(unsigned int msWait = 0);
+  /// Makes sure at least @a size bytes are in the read-ahead buffer, waiting up to @a msWait ms
+  AREXPORT unsigned int peekBuffered(unsigned int size, unsigned int msWait = 0);
+  /// Finds @a delim in the read-ahead buffer, reading more data for up to @a msWait ms
+  AREXPORT int scanBufferedFor(char delim, unsigned int msWait = 0,
+			       unsigned int startIndex = 0);
+  /// Finds any of the characters in @a delims in the read-ahead buffer, reading more data for up to @a msWait ms
+  AREXPORT int scanBufferedForAny(const char *delims, unsigned int msWait = 0,
+				  unsigned int startIndex = 0);
+  /// Finds @a delim in the read-ahead buffer, without reading more data
+  AREXPORT int scanReadAhead(char delim, unsigned int startIndex = 0) const;
+  /// Finds any of the characters in @a delims in the read-ahead buffer, without reading more data
+  AREXPORT int scanReadAheadAny(const char *delims, 
+				unsigned int startIndex = 0) const;
+  /// Removes @a size bytes from the front of the read-ahead buffer
+  AREXPORT void consumeReadAhead(unsigned int size);
+  /// Discards everything in the read-ahead buffer
+  AREXPORT void clearReadAhead();
+  /// Gets the number of bytes waiting in the read-ahead buffer
+  unsigned int getReadAheadCount() const 
+    { return myReadAheadEnd - myReadAheadStart; }
+  /// Gets a pointer to the bytes waiting in the read-ahead buffer
+  /**
+     The pointer is only valid until the next call that reads, fills
+     or consumes (getReadAheadCount() bytes are valid).
+  **/
+  const char *getReadAheadData() const
+    { return myReadAheadBuf.data() + myReadAheadStart; }
+  /// Gets the time that the first (or @a index th) byte in the read-ahead buffer was read
+  AREXPORT ArTime getReadAheadTimeRead(unsigned int index = 0) const;
+  /// Gets how many times fillReadAhead() has called read() on this connection
+  unsigned long long getReadAheadReadCalls() const 
+    { return myIOStats.getReads(); }
  protected:
   /// Sets the port name
   AREXPORT void setPortName(const char *portName);
@@ -181,6 +263,47 @@ class ArDeviceConnection
   int myDCDebugTimesRead;
   long long myDCDebugNumGoodPackets;
   long long myDCDebugNumBadPackets;
+
+  /// Makes room at the end of the read-ahead buffer (compacting or growing it)
+  void makeReadAheadRoom();
+  /// Shared implementation of the scan methods
+  int internalScanReadAhead(const char *delims, size_t numDelims,
+			    unsigned int startIndex) const;
+  int internalScanBufferedFor(const char *delims, size_t numDelims,
+			      unsigned int msWait, unsigned int startIndex);
+  /// Bytes read from the device but not yet consumed are between start and end
+  std::vector<char> myReadAheadBuf;
+  unsigned int myReadAheadStart;
+  unsigned int myReadAheadEnd;
+  /// Total number of bytes ever consumed and received (stream offsets)
+  unsigned long long myReadAheadConsumed;
+  unsigned long long myReadAheadReceived;
+  /// Time that each chunk in the read-ahead buffer was read, by the
+  /// stream offset just past the end of that chunk
+  struct ReadAheadChunk 
+  {
+    unsigned long long end;
+    ArTime time;
+  };
+  std::deque<ReadAheadChunk> myReadAheadChunks;
+  ArDeviceConnectionStats myIOStats;
+  /// Time the first byte of the last good packet was read (only
+  /// touched by the reading thread)
+  ArTime myIOStatsLastPacketTime;
+  bool myIOStatsHaveLastPacket;
+
+  /// Saves data that was just read to the capture file, if recording
+  void recordData(const char *data, unsigned int size, ArTime timeRead);
+  /// The first bytes of a capture file (followed by the format version)
+  static const char ourCaptureMagic[8];
+  enum { CAPTURE_VERSION = 1 };
+  ArMutex myRecordMutex;
+  /// So the reading thread can check for recording without locking
+  std::atomic<bool> myRecording;
+  FILE *myRecordFile;
+  std::string myRecordFileName;
+  ArTime myRecordStartTime;
+  long long myRecordLastMSecs;
 };
 
 #endif
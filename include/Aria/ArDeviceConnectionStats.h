@@ -0,0 +1,136 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARDEVICECONNECTIONSTATS_H
+#define ARDEVICECONNECTIONSTATS_H
+
+#ifndef ARIA_WRAPPER
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArLog.h"
+#include "Aria/ArTimeHistogram.h"
+
+#include <atomic>
+
+/// Counters and timing histograms for the data coming in on a device connection
+/**
+   Each ArDeviceConnection keeps one of these (see
+   ArDeviceConnection::getIOStats()) so that the health of a link can be
+   watched all the time without turning on per-packet logging.  The
+   read counters are updated by the connection's read-ahead buffer, and
+   the packet counters by the packet receivers, through
+   ArDeviceConnection::ioStatsGoodPacket(),
+   ArDeviceConnection::ioStatsBadPacket() and
+   ArDeviceConnection::ioStatsResync().
+
+   Everything is kept in relaxed atomics, so updating the stats costs a
+   few uncontended increments per packet, and they can be read (or
+   reset) from any thread.
+
+   @internal
+**/
+class ArDeviceConnectionStats
+{
+public:
+  /// Constructor
+  AREXPORT ArDeviceConnectionStats();
+  ArDeviceConnectionStats(const ArDeviceConnectionStats &) = delete;
+  ArDeviceConnectionStats &operator=(const ArDeviceConnectionStats &) = delete;
+
+  /// Gets the number of bytes read from the device
+  unsigned long long getBytesRead() const 
+    { return myBytesRead.load(std::memory_order_relaxed); }
+  /// Gets the number of times the device was read (including reads that got nothing)
+  unsigned long long getReads() const 
+    { return myReads.load(std::memory_order_relaxed); }
+  /// Gets the number of good packets received
+  unsigned long long getGoodPackets() const 
+    { return myGoodPackets.load(std::memory_order_relaxed); }
+  /// Gets the number of bad packets received (including checksum failures)
+  unsigned long long getBadPackets() const 
+    { return myBadPackets.load(std::memory_order_relaxed); }
+  /// Gets the number of packets that failed their checksum
+  unsigned long long getChecksumFailures() const 
+    { return myChecksumFailures.load(std::memory_order_relaxed); }
+  /// Gets the number of times a receiver had to skip data to find the start of a packet
+  unsigned long long getResyncs() const 
+    { return myResyncs.load(std::memory_order_relaxed); }
+  /// Gets the number of bytes skipped while resyncing
+  unsigned long long getBytesSkipped() const 
+    { return myBytesSkipped.load(std::memory_order_relaxed); }
+
+  /// Gets the histogram of the time from the first to the last byte of each good packet
+  const ArTimeHistogram *getPacketSpan() const { return &myPacketSpan; }
+  /// Gets the histogram of the time between the starts of consecutive good packets
+  const ArTimeHistogram *getPacketInterval() const 
+    { return &myPacketInterval; }
+
+  /// Counts a read of the device that got @a bytes bytes (0 or -1 for nothing)
+  void addRead(int bytes)
+    {
+      myReads.fetch_add(1, std::memory_order_relaxed);
+      if (bytes > 0)
+	myBytesRead.fetch_add((unsigned long long) bytes, 
+			      std::memory_order_relaxed);
+    }
+  /// Counts a good packet, with its span and the interval since the last one (in ms, -1 if unknown)
+  void addGoodPacket(long long spanMSecs = -1, long long intervalMSecs = -1)
+    {
+      myGoodPackets.fetch_add(1, std::memory_order_relaxed);
+      if (spanMSecs >= 0)
+	myPacketSpan.add(spanMSecs);
+      if (intervalMSecs >= 0)
+	myPacketInterval.add(intervalMSecs);
+    }
+  /// Counts a bad packet
+  void addBadPacket(bool badChecksum)
+    {
+      myBadPackets.fetch_add(1, std::memory_order_relaxed);
+      if (badChecksum)
+	myChecksumFailures.fetch_add(1, std::memory_order_relaxed);
+    }
+  /// Counts a resync that skipped @a bytesSkipped bytes
+  void addResync(unsigned int bytesSkipped)
+    {
+      myResyncs.fetch_add(1, std::memory_order_relaxed);
+      myBytesSkipped.fetch_add(bytesSkipped, std::memory_order_relaxed);
+    }
+
+  /// Sets all the counters and histograms back to 0
+  AREXPORT void reset();
+  /// Logs the counters and histograms
+  AREXPORT void log(const char *name, ArLog::LogLevel level = ArLog::Normal) const;
+protected:
+  std::atomic<unsigned long long> myBytesRead;
+  std::atomic<unsigned long long> myReads;
+  std::atomic<unsigned long long> myGoodPackets;
+  std::atomic<unsigned long long> myBadPackets;
+  std::atomic<unsigned long long> myChecksumFailures;
+  std::atomic<unsigned long long> myResyncs;
+  std::atomic<unsigned long long> myBytesSkipped;
+  ArTimeHistogram myPacketSpan;
+  ArTimeHistogram myPacketInterval;
+};
+
+#endif // not ARIA_WRAPPER
+#endif // ARDEVICECONNECTIONSTATS_H
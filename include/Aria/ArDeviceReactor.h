@@ -0,0 +1,132 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARDEVICEREACTOR_H
+#define ARDEVICEREACTOR_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArASyncTask.h"
+#include "Aria/ArMutex.h"
+#include "Aria/ariaUtil.h"
+
+#include <map>
+#include <string>
+
+class ArDeviceConnection;
+
+/// Reads many device connections from one thread
+/**
+   Normally each device (laser, battery, sonar board...) runs its own
+   thread that sits in a blocking receivePacket() on its connection.  With
+   several devices on one robot that is a lot of threads that mostly wake up
+   to find nothing to do.  Instead a device can have its connection read by
+   an ArDeviceReactor, which waits on all of its connections at once (with
+   epoll).  When data arrives on a connection the reactor reads everything
+   that's available into the connection's read-ahead buffer (see
+   ArDeviceConnection::fillReadAhead()) and then invokes that device's
+   callback, which should take whatever complete packets are in the buffer
+   (for example with ArRobotPacketReceiver::receivePacket(0) and
+   ArRobotPacketReceiver::setPartialPacketTimeout(0)) and leave any partial
+   packet for next time.
+
+   Every callback is also invoked once a tick (see setTickMSecs()) whether or
+   not there was data, so devices can check for lost connections, and so
+   connections that can't be waited on (ArDeviceConnection::getPollFD()
+   returns a descriptor epoll can't use, like a plain file) still get read.
+   If a connection is closed and reopened it is waited on again at the next
+   tick.
+
+   The callbacks run in the reactor's thread, so they must not block, since
+   that would hold up every other device on the same reactor.  More than one
+   reactor can be used to spread devices over a few threads.  Devices that
+   support this have a setDeviceReactor() that must be called before they
+   connect; devices without a reactor still run their own thread.
+
+   The reactor thread is started by the first addConnection().  This is only
+   available on Linux, elsewhere addConnection() fails and devices should
+   fall back to their own threads.
+
+   @ingroup UtilityClasses
+**/
+class ArDeviceReactor : public ArASyncTask
+{
+public:
+  /// Constructor
+  AREXPORT ArDeviceReactor(const char *name = "ArDeviceReactor");
+  /// Destructor, stops the reactor thread
+  AREXPORT virtual ~ArDeviceReactor();
+
+  /// Starts reading @a conn and invoking @a readCB when there's data
+  AREXPORT bool addConnection(ArDeviceConnection *conn, ArFunctor *readCB,
+			      const char *name = NULL);
+  /// Stops reading @a conn
+  AREXPORT bool remConnection(ArDeviceConnection *conn);
+  /// Gets the number of connections being read
+  AREXPORT size_t getNumConnections();
+
+  /// Sets how often every callback is invoked even without data (msecs)
+  void setTickMSecs(int msecs) { myTickMSecs = msecs; }
+  /// Gets how often every callback is invoked even without data (msecs)
+  int getTickMSecs() const { return myTickMSecs; }
+
+  /// Gets the name of this reactor
+  const char *getName() const { return myName.c_str(); }
+  /// Gets the number of times the reactor thread woke up for data
+  unsigned long getNumWakeups() const { return myNumWakeups; }
+  /// Gets the number of times a callback was invoked because of data
+  unsigned long getNumDispatches() const { return myNumDispatches; }
+
+  /// Logs the connections being read
+  AREXPORT void log(ArLog::LogLevel level = ArLog::Normal);
+
+  AREXPORT virtual void *runThread(void *arg) override;
+protected:
+  struct Entry
+  {
+    ArFunctor *myReadCB;
+    std::string myName;
+    // the descriptor that's registered with epoll, -1 if none
+    int myFD;
+    // true if the descriptor can't be waited on so should be read every tick
+    bool myPollEveryTick;
+    // a descriptor that hung up, so we don't wait on it again
+    int myHungUpFD;
+    unsigned long myNumDispatches;
+  };
+  void dispatch(ArDeviceConnection *conn, Entry *entry, bool hungUp);
+  void registerFD(ArDeviceConnection *conn, Entry *entry);
+  void unregisterFD(ArDeviceConnection *conn, Entry *entry);
+  void refreshFD(ArDeviceConnection *conn, Entry *entry);
+  void tick();
+
+  std::string myName;
+  ArMutex myMutex;
+  std::map<ArDeviceConnection *, Entry> myEntries;
+  int myEpollFD;
+  int myTickMSecs;
+  ArTime myLastTick;
+  unsigned long myNumWakeups;
+  unsigned long myNumDispatches;
+};
+
+#endif // ARDEVICEREACTOR_H
@@ -52,6 +52,7 @@ class ArFileDeviceConnection: public ArDeviceConnection
   AREXPORT virtual const char *getOpenMessage(int err);
   AREXPORT virtual ArTime getTimeRead(int index);
   AREXPORT virtual bool isTimeStamping();
+  AREXPORT virtual int getPollFD() override;
 
   /// If >0 then only read at most this many bytes during read(), regardless of supplied size argument
   void setForceReadBufferSize(unsigned int s) { myForceReadBufferSize = s; }
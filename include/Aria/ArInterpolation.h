@@ -42,13 +42,18 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
     This class takes care of storing in readings of position vs time, and then
     interpolating between them to find where the robot was at a particular 
-    point in time.  It has two lists, one containing the times, and one 
-    containing the positions at those same times (per position), they must be 
-    walked through jointly to maintain cohesion.  The new entries are at the
-    front of the list, while the old ones are at the back.  
-    numberOfReadings and the setNumberOfReadings control the number of entries
-    in the list.  If a size is set that is smaller than the current size, then
-    the old ones are chopped off.
+    point in time.  The times and the positions at those times are kept in
+    two ring buffers that go together, oldest to newest, so finding the
+    readings around a time is a binary search.  Readings must be added in
+    order of their times; one added with a time before the newest
+    reading's replaces the readings newer than it.  numberOfReadings and
+    the setNumberOfReadings control the number of entries kept.  If a size
+    is set that is smaller than the current size, then the old ones are
+    chopped off.
+
+    getPoses() finds the positions at many times (such as at each reading
+    of a laser scan) locking only once, and goes on from where it found
+    the time before when the times are in order.
     
     This class now has a couple of variables for when it allows
     prediction (extrapolation beyond the most recently stored pose). They're set
@@ -72,6 +77,10 @@ public:
   /// Finds a position
   AREXPORT int getPose(ArTime timeStamp, ArPose *position, 
 		       ArPoseWithTime *lastData = NULL);
+  /// Finds the positions at many times
+  AREXPORT size_t getPoses(const std::vector<ArTime> &timeStamps,
+			   std::vector<ArPose> *positions,
+			   std::vector<int> *results = NULL);
   /// Sets the name
   AREXPORT void setName(const char *name);
   /// Gets the name
@@ -95,10 +104,24 @@ public:
   /// Empties the interpolated positions
   AREXPORT void reset();
 protected:
+  // where reading i (0 is the oldest) is in the ring buffers
+  size_t physicalIndex(size_t i) const 
+    { return myStart + i < mySize ? myStart + i : myStart + i - mySize; }
+  // the newest reading at or before timeStamp, searching readings from
+  // to to (not including to), or myCount if they are all after it
+  size_t findReading(const ArTime &timeStamp, size_t from, size_t to) const;
+  // findReading() for a time stamp that reading from is at or before
+  size_t findReadingFrom(const ArTime &timeStamp, size_t from) const;
+  // the position at timeStamp from the reading findReading() found
+  int poseFrom(size_t found, const ArTime &timeStamp, ArPose *position, 
+	       ArPoseWithTime *mostRecent);
   ArMutex myDataMutex;
   std::string myName;
-  std::list<ArTime> myTimes;
-  std::list<ArPose> myPoses;
+  std::vector<ArTime> myTimes;
+  std::vector<ArPose> myPoses;
+  // the oldest reading and how many there are
+  size_t myStart;
+  size_t myCount;
   size_t mySize;
   bool myLogPrediction;
   int myAllowedMSForPrediction;
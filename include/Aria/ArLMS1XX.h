@@ -27,7 +27,9 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArRobotPacket.h"
 #include "Aria/ArLaser.h"   
+#include "Aria/ArLaserRawReadings.h"
 #include "Aria/ArFunctor.h"
+#include "Aria/ArLogThrottle.h"
 
 #ifndef ARIA_WRAPPER
 /** @internal 
@@ -171,13 +173,12 @@ protected:
   enum State 
   {
     STARTING, ///< Looking for beginning
-    DATA, ///< Read the data in a big whack
-    REMAINDER ///< Have extra data from reading in data
+    DATA ///< Have the start, looking for the end in the read-ahead buffer
   };
   State myState;
   char myName[1024];
   unsigned int myNameLength;
-  char myReadBuf[100000];
+  /// How much of the read-ahead buffer has been scanned for the end of packet
   unsigned int myReadCount;
 	unsigned int myReadTimeout;
 
@@ -289,7 +290,8 @@ protected:
   int myNumberEncoders;
   int myNumChans16Bit;
   int myNumChans8Bit;
-  int myFirstReadings;
+  // the raw readings, myRawReadings is its list
+  ArLaserRawReadings myLaserReadings;
   int myYear;
   int myMonth;
   int myMonthDay;
@@ -304,6 +306,7 @@ protected:
 
   ArMutex myPacketsMutex;
   ArMutex myDataMutex;
+  ArLogThrottle mySensorInterpLogThrottle;
 
   std::list<ArLMS1XXPacket *> myPackets;
 
@@ -30,6 +30,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArLMS2xxPacketReceiver.h"
 #include "Aria/ArRobotPacket.h"
 #include "Aria/ArLaser.h"   
+#include "Aria/ArLaserRawReadings.h"
 #include "Aria/ArFunctor.h"
 #include "Aria/ArCondition.h"
 
@@ -169,23 +170,18 @@ protected:
   bool myStartConnect;
   bool myRunningOnRobot;
 
-  // range buffers to hold current range set and assembling range set
-  // TODO change to pointers to member lists ratherh than allocating in
-  // constructor.
-  // TODO chang eto list<ArSensorReading> rather than list of pointers
-  std::list<ArSensorReading *>::iterator myIter;
-  std::list<ArSensorReading *> *myAssembleReadings;
-  std::list<ArSensorReading *> *myCurrentReadings;
+  // range buffers to hold current range set and assembling range set,
+  // pointing at the two in myLaserReadings (myRawReadings is the current
+  // one's list)
+  ArLaserRawReadings myLaserReadings[2];
+  ArLaserRawReadings *myAssembleReadings;
+  ArLaserRawReadings *myCurrentReadings;
 
   bool myProcessImmediately;
   bool myInterpolation;
   // list of packets, so we can process them from the sensor callback
   std::list<ArLMS2xxPacket *> myPackets;
 
-  // these two are just for the sim packets
-  unsigned int myWhichReading;
-  unsigned int myTotalNumReadings;
-
   // some variables so we don't have to do a tedious if every time
   double myOffsetAmount;
   double myIncrementAmount;
@@ -26,6 +26,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArRangeDeviceThreaded.h"
+#include "Aria/ArRangeBufferGrid.h"
 
 class ArDeviceConnection;
 
@@ -684,6 +685,10 @@ protected:
   int myCumulativeCleanOffset;
   ArTime myCumulativeLastClean;
   std::set<int> myIgnoreReadings;
+  // where the cumulative readings are, so each reading only looks at
+  // the cumulative readings near it
+  ArRangeBufferGrid myCumulativeGrid;
+  std::vector<ArRangeBufferGrid::Reading> myCumulativeNearLine;
 
   unsigned int myAbsoluteMaxRange;
   bool myMaxRangeSet;
@@ -27,6 +27,8 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArLaser.h"
 #include "Aria/ArFunctor.h"
 
+#include <vector>
+
 class ArRobot;
 class ArConfig;
 
@@ -42,6 +44,16 @@ class ArConfig;
    probably should connect it too.  Then you should replace the
    original laser on ArRobot with this one, and replace the original
    laser as a range device too.
+
+   Each reading is checked against its neighbors (the readings next to
+   it within the angle spread) by the closest and furthest of them,
+   which are found for all of the readings with sliding windows, so
+   filtering a scan takes the same time however wide the angle spread
+   is.
+
+   Normally the readings are filtered in a sensor interpretation task
+   on the robot.  With setProcessImmediately() they are filtered as soon
+   as the base laser has processed them instead, in the same thread.
 **/
 class ArLaserFilter : public ArLaser
 {
@@ -79,6 +91,11 @@ public:
   
   /// Gets the base laser this is filtering
   ArLaser *getBaseLaser() { return myLaser; }
+
+  /// Sets whether to filter each scan as soon as the base laser has processed it
+  AREXPORT void setProcessImmediately(bool processImmediately);
+  /// Gets whether each scan is filtered as soon as the base laser has processed it
+  bool getProcessImmediately() const { return myProcessImmediately; }
 protected:
   AREXPORT int selfLockDevice();
   AREXPORT int selfTryLockDevice();
@@ -99,8 +116,32 @@ protected:
   
   // Callback to do the actual filtering
   void processReadings();
+  // Works out the first and last neighbor of each reading, if the
+  // angles or angle spread changed
+  void findNeighbors(size_t numReadings);
+  // Finds the closest and furthest neighbor of each reading
+  void findNeighborRanges(size_t numReadings);
 
   ArFunctorC<ArLaserFilter> myProcessCB;
+  bool myProcessImmediately;
+
+  // the ranges and sensor angles of the readings being filtered
+  std::vector<unsigned int> myRanges;
+  std::vector<double> myAngles;
+  // the first and last neighbor of each reading (the reading itself if
+  // it has none on that side), and the angles and spread they're for
+  std::vector<size_t> myFirstNeighbor;
+  std::vector<size_t> myLastNeighbor;
+  std::vector<double> myNeighborAngles;
+  double myNeighborAngleToCheck;
+  // whether the neighbors only move forward from one reading to the next
+  bool myNeighborsInOrder;
+  // the closest and furthest neighbor's range for each reading
+  std::vector<unsigned int> myMinNeighborRange;
+  std::vector<unsigned int> myMaxNeighborRange;
+  // the readings in the window, for findNeighborRanges()
+  std::vector<size_t> myWindowMin;
+  std::vector<size_t> myWindowMax;
 };
 
 #endif // ARLASERFILTER
@@ -0,0 +1,120 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARLASERFUSION_H
+#define ARLASERFUSION_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArRangeDevice.h"
+#include "Aria/ArRangeBufferGrid.h"
+#include "Aria/ArFunctor.h"
+
+#include <memory>
+#include <vector>
+
+class ArLaser;
+
+/// Merges the scans of all of a robot's lasers into one range device
+/**
+   Every robot cycle this takes the latest scan of each laser on the robot
+   (ArRobot::getLaserMap()), with ArRangeDevice::getLatestScan() so it
+   doesn't wait on the lasers' threads, and puts their readings into one
+   current buffer, leaving out each reading that is within the merge
+   distance (setMergeDist()) of one already in it.  So where the lasers
+   see the same obstacle it is only there once.  Each scan is placed where
+   the robot was when that laser took it, and moved along with any change
+   to the robot's encoder transform since (from ArRobot::moveTo() or
+   localization), so scans the lasers took at different times line up.
+   The lasers' cumulative buffers are merged the same way into this one's
+   cumulative buffer, whenever one of them changes.
+
+   It is started by adding it to the robot with ArRobot::addRangeDevice().
+   ArLaserFusion does not take the lasers out of the robot's range devices
+   itself, so after adding it you should do that with
+   ArRobot::remRangeDevice() for each laser (they stay in the robot's laser
+   map).  Until you do, the actions and
+   ArRobot::checkRangeDevicesCurrentPolar() and the like check every laser
+   reading twice, once in the laser and once in this: they find the same
+   closest reading, but do twice the work.  Transforms the robot applies
+   to this (ArRobot::moveTo()) are passed on to the lasers that aren't the
+   robot's range devices anymore, to keep their cumulative buffers right.
+
+   @ingroup OptionalClasses
+**/
+class ArLaserFusion : public ArRangeDevice
+{
+public:
+  /// Constructor
+  AREXPORT ArLaserFusion(double mergeDist = 50, 
+			 const char *name = "laserFusion");
+  /// Destructor
+  AREXPORT virtual ~ArLaserFusion();
+  /// Sets the robot pointer and attaches its process function
+  AREXPORT virtual void setRobot(ArRobot *robot) override;
+  /// Applies a transform to the buffers, and to lasers the robot doesn't transform
+  AREXPORT virtual void applyTransform(ArTransform trans, 
+				       bool doCumulative = true) override;
+  /// Sets how close (mm) a reading can be to another before it is left out
+  AREXPORT void setMergeDist(double mergeDist);
+  /// Gets how close (mm) a reading can be to another before it is left out
+  double getMergeDist() const { return myMergeDist; }
+  /// Merges the latest scans of the lasers (done every robot cycle)
+  AREXPORT void processReadings();
+  /// Gets the number of lasers with a scan in the current buffer
+  size_t getNumScans() const { return myNumScans; }
+  /// Gets the number of current readings left out because another was within the merge distance
+  size_t getNumCurrentMerged() const { return myNumCurrentMerged; }
+  /// Gets the number of cumulative readings left out because another was within the merge distance
+  size_t getNumCumulativeMerged() const { return myNumCumulativeMerged; }
+protected:
+  // adds a reading to a buffer unless another is within the merge distance
+  bool mergeReading(ArRangeBufferGrid *grid, ArRangeBuffer *buffer,
+		    double x, double y);
+  void mergeCurrent(const ArTransform &encoderTrans);
+  void mergeCumulative();
+
+  double myMergeDist;
+  double myMergeDistSquared;
+  ArRangeBufferGrid myCurrentGrid;
+  ArRangeBufferGrid myCumulativeGrid;
+
+  // the lasers as of the last merge, in the order of the robot's map
+  std::vector<ArLaser *> myLasers;
+  // each laser's latest scan (only held while merging) and which one it
+  // was, and the encoder transform when that scan was first seen
+  std::vector<std::shared_ptr<const ArRangeScan> > myScans;
+  std::vector<unsigned long> myScanCounts;
+  std::vector<ArTransform> myScanEncoderTrans;
+  // the change count of each laser's cumulative buffer at the last merge
+  std::vector<unsigned long> myCumulativeChangeCounts;
+  // the encoder transform at the last merge
+  ArTransform myEncoderTrans;
+
+  size_t myNumScans;
+  size_t myNumCurrentMerged;
+  size_t myNumCumulativeMerged;
+
+  ArFunctorC<ArLaserFusion> myProcessCB;
+};
+
+#endif // ARLASERFUSION_H
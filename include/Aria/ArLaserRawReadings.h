@@ -0,0 +1,113 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARLASERRAWREADINGS_H
+#define ARLASERRAWREADINGS_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArSensorReading.h"
+
+#include <list>
+#include <vector>
+
+/// The raw readings of a laser, kept in one block, with the direction of each beam worked out ahead of time
+/**
+   A laser driver tells this how its beams are laid out each scan with
+   setRays() (how many, where the sensor is, the angle of the first beam
+   and the angle between beams), which only works out the cos and sin of
+   each beam (and sets up the ArSensorReading for it) when that changes,
+   such as when the sensor position or flipped setting changes.  Then the
+   driver gives the range of each beam with setRange() and calls
+   project(), which works out where each of the readings is on the robot
+   and in global coordinates and puts it in its ArSensorReading, in one
+   pass.
+
+   The ArSensorReadings are in one std::vector, and getList() gives
+   pointers to them in a list for ArRangeDevice::myRawReadings (and so
+   ArRangeDevice::getRawReadings()).  The list is only rebuilt when the
+   number of beams changes.
+
+   @ingroup UtilityClasses
+**/
+class ArLaserRawReadings
+{
+public:
+  /// Constructor
+  AREXPORT ArLaserRawReadings();
+
+  /// Sets how the beams are laid out, only working them out again if it changed
+  AREXPORT bool setRays(size_t numReadings, double sensorX, double sensorY,
+			double startAngle, double increment);
+  /// Makes the next setRays() work out the beams again
+  /**
+     Call this after changing the sensor position of readings some other
+     way (such as ArSensorReading::resetSensorPosition()).
+  **/
+  void invalidate() { myValid = false; }
+  /// Gets the number of beams
+  size_t getNumReadings() const { return myReadings.size(); }
+  /// Gets the reading for beam @a i
+  ArSensorReading *getReading(size_t i) { return &myReadings[i]; }
+  /// Sets the range of beam @a i, for the next project()
+  void setRange(size_t i, unsigned int range, bool ignore = false,
+		int extraInt = 0)
+  {
+    myRanges[i] = range;
+    myIgnore[i] = ignore ? 1 : 0;
+    myExtraInts[i] = extraInt;
+  }
+  /// Projects the ranges of all of the beams into the readings
+  void project(const ArPose &robotPose, const ArPose &encoderPose,
+	       const ArTransform &trans, unsigned int counter,
+	       const ArTime &timeTaken)
+  {
+    project(0, myReadings.size(), robotPose, encoderPose, trans, counter,
+	    timeTaken);
+  }
+  /// Projects the ranges of @a count beams starting with @a first into the readings
+  AREXPORT void project(size_t first, size_t count,
+			const ArPose &robotPose, const ArPose &encoderPose,
+			const ArTransform &trans, unsigned int counter,
+			const ArTime &timeTaken);
+  /// Gets the readings, as ArRangeDevice keeps its raw readings
+  std::list<ArSensorReading *> *getList() { return &myList; }
+protected:
+  std::vector<ArSensorReading> myReadings;
+  std::list<ArSensorReading *> myList;
+  // the direction of each beam, the same as its reading's getSensorDX()
+  // and getSensorDY()
+  std::vector<double> myCos;
+  std::vector<double> mySin;
+  std::vector<unsigned int> myRanges;
+  // not vector<bool>, to keep setRange() and project() from packing bits
+  std::vector<unsigned char> myIgnore;
+  std::vector<int> myExtraInts;
+  // what the beams were last worked out for
+  bool myValid;
+  double mySensorX;
+  double mySensorY;
+  double myStartAngle;
+  double myIncrement;
+};
+
+#endif // ARLASERRAWREADINGS_H
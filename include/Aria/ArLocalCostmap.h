@@ -0,0 +1,188 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARLOCALCOSTMAP_H
+#define ARLOCALCOSTMAP_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ariaUtil.h"
+#include "Aria/ArRangeDevice.h"
+#include "Aria/ArFunctor.h"
+
+#include <map>
+#include <utility>
+#include <vector>
+
+/// A grid of the obstacles the lasers and sonar have seen recently around the robot
+/**
+   Keeps a square grid of cells (getCellSize() on a side, getSize() across)
+   centered on the robot, which rolls along with it: cells that fall off
+   one side are cleared and used for the other side.  Every robot cycle
+   each new laser scan (from the lasers in ArRobot::getLaserMap(), with
+   ArRangeDevice::getLatestScan()) and each new sonar reading goes into the
+   grid as a ray from where the sensor was to the reading.  The cell the
+   reading is in gets more costly, and the cells the ray passes through
+   before it get less costly, so obstacles that moved away are cleared
+   (all of a scan's rays clear before its readings go in).
+   Readings beyond the sensor's max range only clear.  A cell that hasn't
+   been hit for the decay time (setDecayMSecs()) is free again.
+
+   A cell is an obstacle while it has any cost left, so a cell hit a few
+   times takes more rays to clear than one hit once (see setCosts()).
+   getCost() and isObstacle() look a position up in
+   constant time, and closestInPolygon() and closestInBox() find the
+   closest obstacle in an area around the robot by going through only the
+   cells in it.  ArActionLimiterForwards and ArActionDeceleratingLimiter
+   can check their boxes here instead of through the lasers and sonar
+   (see their setCostmap() and checkRangeDevicesCurrentBox()).
+
+   The centers of the obstacle cells are also put in the current buffer
+   every cycle, so this works as any other range device.  Positions are
+   global, and since the grid can't be rotated it starts over when a
+   transform is applied (from ArRobot::moveTo()).
+
+   It is started by adding it to the robot with ArRobot::addRangeDevice().
+   Lock the device (lockDevice()) while using it from another thread than
+   the robot's.
+
+   @ingroup OptionalClasses
+**/
+class ArLocalCostmap : public ArRangeDevice
+{
+public:
+  /// Constructor
+  AREXPORT ArLocalCostmap(double cellSize = 50, double size = 10000,
+			  const char *name = "localCostmap");
+  /// Destructor
+  AREXPORT virtual ~ArLocalCostmap();
+  /// Sets the robot pointer and attaches its process function
+  AREXPORT virtual void setRobot(ArRobot *robot) override;
+  /// Clears the grid (and the current buffer)
+  AREXPORT virtual void clearCurrentReadings() override;
+  /// Clears the grid, since it can't be transformed
+  AREXPORT virtual void applyTransform(ArTransform trans, 
+				       bool doCumulative = true) override;
+
+  /// Gets the size (mm) of each cell
+  double getCellSize() const { return myCellSize; }
+  /// Gets the size (mm) of the grid from one side to the other
+  double getSize() const { return myCellSize * (double)myNumCells; }
+  /// Sets how long (ms) a cell stays an obstacle without being hit again, 0 for as long as it isn't cleared
+  void setDecayMSecs(int decayMSecs) { myDecayMSecs = decayMSecs; }
+  /// Gets how long (ms) a cell stays an obstacle without being hit again
+  int getDecayMSecs() const { return myDecayMSecs; }
+  /// Sets how much a hit adds to a cell's cost, and how much a ray passing through it takes off
+  AREXPORT void setCosts(unsigned char hitCost, unsigned char clearCost);
+  /// Gets how much a hit adds to a cell's cost
+  unsigned char getHitCost() const { return myHitCost; }
+  /// Gets how much a ray passing through a cell takes off its cost
+  unsigned char getClearCost() const { return myClearCost; }
+  /// Sets whether the robot's sonar go into the grid
+  void setUseSonar(bool useSonar) { myUseSonar = useSonar; }
+  /// Gets whether the robot's sonar go into the grid
+  bool getUseSonar() const { return myUseSonar; }
+  /// Sets the range (mm) at or beyond which sonar readings only clear
+  void setSonarMaxRange(unsigned int sonarMaxRange) 
+    { mySonarMaxRange = sonarMaxRange; }
+  /// Gets the range (mm) at or beyond which sonar readings only clear
+  unsigned int getSonarMaxRange() const { return mySonarMaxRange; }
+
+  /// Gets the cost of the cell that global position x, y is in (0 if it is off the grid)
+  AREXPORT unsigned char getCost(double x, double y) const;
+  /// Gets whether the cell that global position x, y is in is an obstacle
+  bool isObstacle(double x, double y) const 
+    { return getCost(x, y) > 0; }
+  /// Finds the closest obstacle to the robot in a polygon (in robot coordinates)
+  AREXPORT double closestInPolygon(const std::vector<ArPose> &polygon,
+				   ArPose *readingPos = NULL) const;
+  /// Finds the closest obstacle to the robot in a box (in robot coordinates)
+  AREXPORT double closestInBox(double x1, double y1, double x2, double y2,
+			       ArPose *readingPos = NULL) const;
+  /// Gets whether the readings of @a device go into the grid
+  AREXPORT bool coversDevice(const ArRangeDevice *device) const;
+  /// Finds the closest obstacle in a box in the grid and in the robot's range devices that don't go into it
+  AREXPORT double checkRangeDevicesCurrentBox(
+	  double x1, double y1, double x2, double y2,
+	  ArPose *readingPos = NULL,
+	  const ArRangeDevice **rangeDevice = NULL,
+	  bool useLocationDependentDevices = true);
+
+  /// Moves the grid so that it is centered on global position x, y
+  AREXPORT void recenter(double x, double y);
+  /// Puts a ray from a sensor at sensorX, sensorY to x, y (global) into the grid
+  AREXPORT void addRay(double sensorX, double sensorY, double x, double y,
+		       bool hit = true);
+  /// Puts the new laser scans and sonar readings into the grid (done every robot cycle)
+  AREXPORT void processReadings();
+protected:
+  struct Cell
+  {
+    long long lastHit; // ms since myStarted
+    unsigned char cost;
+  };
+  int cellIndex(double v) const { return (int)floor(v / myCellSize); }
+  bool onGrid(int ix, int iy) const
+    { return ix >= myOriginX && ix < myOriginX + myNumCells &&
+	iy >= myOriginY && iy < myOriginY + myNumCells; }
+  // the cells roll around, so cell ix, iy is at ix, iy mod the size
+  size_t cellOffset(int ix, int iy) const
+    {
+      int x = ix % myNumCells, y = iy % myNumCells;
+      if (x < 0) x += myNumCells;
+      if (y < 0) y += myNumCells;
+      return (size_t)y * (size_t)myNumCells + (size_t)x;
+    }
+  unsigned char cost(const Cell &cell, long long now) const
+    { return myDecayMSecs > 0 && now - cell.lastHit > myDecayMSecs ? 
+	0 : cell.cost; }
+  void clearColumn(int ix);
+  void clearRow(int iy);
+  bool clearRay(double sensorX, double sensorY, double x, double y,
+		bool clearLast, long long now);
+  void clearCell(int ix, int iy, long long now);
+  void hitCell(int ix, int iy, long long now);
+  void addLaserScans();
+  void addSonar();
+  void fillCurrentBuffer();
+
+  double myCellSize;
+  int myNumCells;
+  std::vector<Cell> myCells;
+  // the lower left cell of the grid
+  int myOriginX;
+  int myOriginY;
+  ArTime myStarted;
+  int myDecayMSecs;
+  unsigned char myHitCost;
+  unsigned char myClearCost;
+  bool myUseSonar;
+  unsigned int mySonarMaxRange;
+  // the last scan put in the grid from each laser, by laser number
+  std::map<int, unsigned long> myScanCounts;
+  // the cells a scan hit, kept to save allocating each time
+  std::vector<std::pair<int, int> > myHits;
+
+  ArFunctorC<ArLocalCostmap> myProcessCB;
+};
+
+#endif // ARLOCALCOSTMAP_H
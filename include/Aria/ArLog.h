@@ -50,6 +50,14 @@ class ArConfig;
    what level of log messages are displayed.  Set `ARLOG_TIME` to 
    include timestamps in all log messages.  
 
+   Normally each log call writes its message (and flushes it) before
+   returning, with a global mutex held, so a thread that logs can end up
+   waiting on disk I/O or on another thread's logging.  setAsync() changes
+   that: messages are copied into a fixed size queue, without locking, and
+   a background thread writes them out (and calls the functor given with
+   setFunctor()).  Call flush() to wait until everything logged so far has
+   been written; Aria::exit() does this.
+
    @ingroup ImportantClasses
    @ingroup easy
 */
@@ -69,7 +77,15 @@ public:
     Verbose ///< Use verbose logging
   } LogLevel;
 
+  /// What to do with a message logged while the setAsync() queue is full
+  typedef enum {
+    DropWhenFull, ///< Drop the message (and count it, see getAsyncDropped())
+    BlockWhenFull ///< Wait for room (writing queued messages if need be)
+  } AsyncOverflow;
+
   static const LogType DefaultLogType = StdErr;
+  /// Longest message (including time) kept by setAsync(), longer ones are cut off
+  static const size_t ASYNC_MESSAGE_SIZE = 2048;
 
 #ifndef SWIG
   /** @brief Log a message, with formatting and variable number of arguments.
@@ -192,7 +208,27 @@ public:
     ourMutex.unlock();
   }
 
+  /// Sets whether log messages are written by a background thread
+  AREXPORT static bool setAsync(bool async, size_t queueSize = 1024,
+				AsyncOverflow overflow = DropWhenFull);
+  /// Gets whether log messages are being written by a background thread
+  AREXPORT static bool isAsync();
+  /// Gets how many messages have been dropped since the setAsync() queue was full
+  AREXPORT static unsigned long getAsyncDropped();
+  /// Waits until all the messages logged so far have been written
+  AREXPORT static bool flush(int msecs = 5000);
+  /// Writes out the setAsync() queue without locking or waiting, from a handler of a signal the program won't survive
+  AREXPORT static void flushFromSignal();
+
 private:
+  class AsyncWriter;
+  static AsyncWriter *ourAsyncWriter;
+
+  static void writeMessage(const char *message);
+  static void queueMessage_v(LogLevel level, const char *prefix,
+			     const char *format, va_list ptr);
+  static void queueMessage(LogLevel level, const char *format, ...);
+  static bool writeQueued();
   static bool processFile();
   static void invokeFunctor(const char *message);
   static void checkFileSize();
@@ -0,0 +1,113 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARLOGTHROTTLE_H
+#define ARLOGTHROTTLE_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArLog.h"
+#include "Aria/ArMutex.h"
+
+#include <atomic>
+#include <string>
+
+/// Keeps a message that's logged over and over from flooding the log
+/**
+   Give each place that can log the same warning every cycle (a timeout,
+   a bad reading, a dead connection) its own ArLogThrottle, and log
+   through it with ARLOG_THROTTLED():
+
+   @code
+   ARLOG_THROTTLED(myTimeoutLogThrottle, ArLog::Normal,
+                   "%s: Timed out after %d ms", getName(), waited);
+   @endcode
+
+   Then at most one message is logged every intervalMSec.  Calls in
+   between only bump a count; the message isn't even formatted, since
+   ARLOG_THROTTLED() doesn't evaluate its arguments unless check() lets
+   the message through.  A message with the same text as the last one
+   logged through the throttle isn't logged again until repeatMSec has
+   passed.  When a message is logged after some weren't, it says how
+   many were left out.
+
+   ARLOG_EVERY() does the same with a throttle made for that one line of
+   code, for code that isn't run by more than one object (otherwise one
+   object's messages would hold back another's).
+
+   @ingroup UtilityClasses
+**/
+class ArLogThrottle
+{
+public:
+  /// Constructor
+  AREXPORT ArLogThrottle(unsigned int intervalMSec = 1000,
+			 unsigned int repeatMSec = 30000);
+
+  /// Returns true if a message may be logged now, otherwise counts it
+  AREXPORT bool check();
+  /// Logs a message that check() let through (see ARLOG_THROTTLED())
+  AREXPORT void log(ArLog::LogLevel level, const char *format, ...);
+
+  /// Gets the number of messages that haven't been logged since the last one was
+  unsigned long getNumSkipped() const
+    { return mySuppressed.load(std::memory_order_relaxed) +
+	myRepeated.load(std::memory_order_relaxed); }
+  /// Gets the total number of messages that weren't logged
+  unsigned long long getTotalSkipped() const
+    { return myTotalSkipped.load(std::memory_order_relaxed); }
+  /// Gets the least time between logged messages
+  unsigned int getIntervalMSec() const { return (unsigned int)(myIntervalUSec / 1000); }
+  /// Gets how long a message with the same text isn't logged again
+  unsigned int getRepeatMSec() const { return (unsigned int)(myRepeatUSec / 1000); }
+protected:
+  const long long myIntervalUSec;
+  const long long myRepeatUSec;
+  // when check() will next let a message through
+  std::atomic<long long> myNextUSec;
+  // messages check() kept out since the last one logged
+  std::atomic<unsigned long> mySuppressed;
+  std::atomic<unsigned long long> myTotalSkipped;
+
+  // the rest is only used by log(), with myMutex locked
+  ArMutex myMutex;
+  std::string myLastMessage;
+  long long myLastLoggedUSec;
+  // messages with the same text as the last one, not logged
+  std::atomic<unsigned long> myRepeated;
+};
+
+/// Logs a message through an ArLogThrottle, only formatting it if it's logged
+#define ARLOG_THROTTLED(throttle, level, ...) \
+  do { \
+    if ((throttle).check()) \
+      (throttle).log((level), __VA_ARGS__); \
+  } while (0)
+
+/// Logs a message at most once every @a intervalMSec from this line of code
+#define ARLOG_EVERY(intervalMSec, level, ...) \
+  do { \
+    static ArLogThrottle arLogEveryThrottle((intervalMSec)); \
+    ARLOG_THROTTLED(arLogEveryThrottle, (level), __VA_ARGS__); \
+  } while (0)
+
+#endif // ARLOGTHROTTLE_H
@@ -36,6 +36,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
 class ArTime;
 class ArFunctor;
+class ArMutexStats;
 
 /// Cross-platform mutex wrapper class 
 /**
@@ -67,6 +68,9 @@ other undesired effects of lock contention.
       and unlock() is more than a given amount of time.  This can help find potential
       performance impacts and other undesired effects of code holding a lock for a
       long time.
+    <li>Use setContentionStats() to count, for each mutex name, how often
+      locks have to wait for another thread, how long they wait and how long
+      the mutex is held (see ArMutexStats::logHottest()).
     <li>Use setLogName() to name an ArMutex object for logging.
     <li>Use setLog() to enable logging of various events such as lock, unlock, errors.
   </ul>
@@ -157,7 +161,7 @@ public:
   */
   void setLog(bool log) { myLog = log; } 
   /// Sets a name we'll use to log with
-  void setLogName(const char *logName) { myLogName = logName; } 
+  void setLogName(const char *logName) { myLogName = logName; myStats = NULL; } 
 #ifndef SWIG
   /// Sets a name we'll use to log with formatting
   /** @swigomit use setLogName() */
@@ -185,6 +189,15 @@ public:
   */
   static double getUnlockWarningTime()
     { return ourUnlockWarningMS/1000.0; }
+  /** Sets whether to keep contention statistics for all mutexes (default
+      off).  See ArMutexStats for what's kept; the statistics are grouped by
+      the name given with setLogName().  Each lock() then costs a tryLock()
+      first and reading the clock.
+  */
+  static void setContentionStats(bool contentionStats)
+    { ourContentionStats = contentionStats; }
+  /// Gets whether contention statistics are kept for all mutexes
+  static bool getContentionStats() { return ourContentionStats; }
 protected:
   
   bool myFailedInit;
@@ -218,6 +231,16 @@ protected:
   // Check time it took between lock and unlock against ourUnlockWarningMS and log about it
   void checkUnlockTime();
 
+  AREXPORT static bool ourContentionStats;
+  ArMutexStats *myStats;
+  // how many times the holding thread has locked this (it's recursive)
+  int myStatsDepth;
+  long long myStatsLockedUSec;
+  // Count a lock in the contention statistics, that waited waitUSec (-1 if it didn't wait). Call after locking.
+  void startStats(long long waitUSec);
+  // Count the time the mutex was held in the contention statistics. Call before unlocking.
+  void stopStats();
+
 
   static ArFunctor *ourNonRecursiveDeadlockFunctor;
 };
@@ -0,0 +1,118 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARMUTEXSTATS_H
+#define ARMUTEXSTATS_H
+
+#ifndef ARIA_WRAPPER
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArLog.h"
+#include "Aria/ArTimeHistogram.h"
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+/// Contention statistics for all the ArMutex objects with one log name
+/**
+   These are only kept while ArMutex::setContentionStats() is on.  Every
+   lock() (or successful tryLock()) of a mutex counts as an acquisition;
+   if the mutex was held by another thread, so that lock() had to wait,
+   it also counts as contended and the wait is timed.  The time from the
+   outermost lock to its unlock goes in the hold time histogram (in
+   microseconds), and the name of the thread that took the lock is kept.
+
+   Mutexes are grouped by the name given with ArMutex::setLogName() (all
+   the unnamed ones are counted together), and the statistics outlive the
+   mutexes, so a device that's been deleted still shows up.  Use
+   getHottest() or logHottest() to see which mutexes threads spend the
+   most time waiting on.
+
+   @internal
+**/
+class ArMutexStats
+{
+public:
+  /// Gets the log name of the mutexes these are for
+  const char *getName() const { return myName.c_str(); }
+  /// Gets the number of times the mutexes were locked
+  unsigned long long getLocks() const
+    { return myLocks.load(std::memory_order_relaxed); }
+  /// Gets the number of locks that had to wait for another thread
+  unsigned long long getContendedLocks() const
+    { return myContendedLocks.load(std::memory_order_relaxed); }
+  /// Gets the total time spent waiting for the mutexes (usec)
+  long long getTotalWaitUSec() const
+    { return myTotalWaitUSec.load(std::memory_order_relaxed); }
+  /// Gets the longest time spent waiting for one of the mutexes (usec)
+  long long getMaxWaitUSec() const
+    { return myMaxWaitUSec.load(std::memory_order_relaxed); }
+  /// Gets the histogram of how long the mutexes were held (usec)
+  const ArTimeHistogram *getHoldTimes() const { return &myHoldTimes; }
+  /// Gets the name of the thread that last locked one of the mutexes
+  const char *getLastHolder() const
+    { return myLastHolder.load(std::memory_order_relaxed); }
+
+  /// Sets the counts back to 0
+  AREXPORT void reset();
+  /// Logs the statistics on one line (and the hold times on another)
+  AREXPORT void log(ArLog::LogLevel level = ArLog::Normal) const;
+
+  /// Gets the statistics for mutexes named @a name (NULL if there are none)
+  AREXPORT static const ArMutexStats *find(const char *name);
+  /// Gets up to @a num statistics, the most total wait time first
+  AREXPORT static std::vector<const ArMutexStats *> getHottest(
+	  size_t num = 10);
+  /// Logs the @a num mutexes with the most total wait time
+  AREXPORT static void logHottest(size_t num = 10,
+				  ArLog::LogLevel level = ArLog::Normal);
+  /// Resets the statistics of all the mutexes
+  AREXPORT static void resetAll();
+protected:
+  friend class ArMutex;
+
+  /// Gets (creating if needed) the statistics for mutexes named @a name
+  AREXPORT static ArMutexStats *get(const std::string &name);
+  /// Counts a lock, after waiting @a waitUSec (-1 if it didn't wait)
+  AREXPORT void addLock(long long waitUSec, const char *holder);
+  /// Counts the mutex being held for @a holdUSec
+  void addHold(long long holdUSec) { myHoldTimes.add(holdUSec); }
+  /// Gets a name for the calling thread that stays valid for good
+  AREXPORT static const char *getThisThreadName();
+
+  ArMutexStats(const std::string &name);
+  ArMutexStats(const ArMutexStats &) = delete;
+  ArMutexStats &operator=(const ArMutexStats &) = delete;
+
+  std::string myName;
+  std::atomic<unsigned long long> myLocks;
+  std::atomic<unsigned long long> myContendedLocks;
+  std::atomic<long long> myTotalWaitUSec;
+  std::atomic<long long> myMaxWaitUSec;
+  ArTimeHistogram myHoldTimes;
+  std::atomic<const char *> myLastHolder;
+};
+
+#endif // not ARIA_WRAPPER
+#endif // ARMUTEXSTATS_H
@@ -29,6 +29,9 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArTransform.h"
 #include <list>
 #include <vector>
+#include <atomic>
+#include <iterator>
+#include <unordered_map>
 
 /** Stores a point cloud of timestamped positions in global space representing sensor readings or responses, into which recently received sensor readings are added by ArRangeDevice objects, and old or otherwise no-longer-useful readings are removed.
  *  Each ArRangeDevice implementation keeps a "current" ArRangeBuffer of relatively recent readings, and a "cumulative" buffer representing a longer history of readings. 
@@ -38,15 +41,98 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
  *  Some additional utility methods are provided such as finding the closest reading, transforming the reading positions, these are generally used internally or by equivalent API in ArRangeDevice.
  *  New readings are added to the front of the list, and if the list is at capacity, the last reading at the back is discarded. When addReadingConditional() is used, the updated reading is also moved to the front.
  *  Therefore the list is in reverse chronological order.  However, most ArRangeDevice implementations also periodically invalidate old readings, especially for their "current" buffer, which will prevent particularly old readings from remaining.
- *  This class stores the readings as a std::list of ArPoseWithTime objects.  ArRangeDevice provides accessors for the current and cumulative ArRangeBuffer objects, as well as convenience accesors for the underlying std::list<ArPoseWithTime> containers.
+ *  The readings are stored in a ring buffer of at most getCapacity() readings, with the X coordinates, Y coordinates and times each kept in their own array, so
+ *  that code looking at every reading (such as getClosestPolar() and getClosestBox()) goes straight through memory.  Walk through the readings with getBegin() and getEnd()
+ *  (newest first), get one with getReading(), or get the arrays themselves with getSpans().  Only the position and time of each reading is kept (the th of a reading is always 0).
  *  Prior to AriaCoda 3.x, these were stored as a std::list<ArPoseWithTime*> (pointers to allocated objects), and only provided access to a pointer to this std::list, and also included a mechanism to manage this list to reduce re-allocations of ArPoseWithTime objects. 
- *  In AriaCoda 3.x this has been modified to more directly use std::list<ArPoseWithTime>. This avoids allocation, reallocation, and custom management of the list, though sometimes ArPoseWithTime objects are internally copied.
+ *  AriaCoda 3.x stored them as a std::list<ArPoseWithTime>.  getBuffer() (and ArRangeDevice::getCurrentReadings() and ArRangeDevice::getCumulativeReadings()) still return
+ *  such a list for code written for that, but it is a copy made when it's asked for after the readings change, so it is much slower than the accessors above.
  */
 class ArRangeBuffer
 {
 public:
+#ifndef SWIG
+  /// Iterates over the readings in an ArRangeBuffer, newest first
+  /**
+     Dereferencing gives a copy of the reading, since the readings aren't
+     stored as ArPoseWithTime objects.  Like list iterators, these stay
+     valid until the buffer is changed.
+  */
+  class const_iterator
+  {
+  public:
+    typedef std::random_access_iterator_tag iterator_category;
+    typedef ArPoseWithTime value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const ArPoseWithTime *pointer;
+    typedef ArPoseWithTime reference;
+
+    /// Holds the reading for operator->()
+    class Arrow
+    {
+    public:
+      Arrow(const ArPoseWithTime &reading) : myReading(reading) {}
+      const ArPoseWithTime *operator->() const { return &myReading; }
+    protected:
+      ArPoseWithTime myReading;
+    };
+
+    const_iterator() : myBuffer(NULL), myIndex(0) {}
+    const_iterator(const ArRangeBuffer *buffer, size_t index) :
+      myBuffer(buffer), myIndex(index) {}
+
+    ArPoseWithTime operator*() const { return myBuffer->getReading(myIndex); }
+    Arrow operator->() const { return Arrow(myBuffer->getReading(myIndex)); }
+    ArPoseWithTime operator[](difference_type n) const
+      { return myBuffer->getReading(myIndex + (size_t)n); }
+    /// Gets X of the reading, without making a copy of it
+    double getX() const { return myBuffer->getX(myIndex); }
+    /// Gets Y of the reading, without making a copy of it
+    double getY() const { return myBuffer->getY(myIndex); }
+    /// Gets the time of the reading, without making a copy of it
+    const ArTime &getTime() const { return myBuffer->getTime(myIndex); }
+    /// Gets how many readings are newer than this one
+    size_t getIndex() const { return myIndex; }
+
+    const_iterator &operator++() { ++myIndex; return *this; }
+    const_iterator operator++(int) { const_iterator old(*this); ++myIndex; return old; }
+    const_iterator &operator--() { --myIndex; return *this; }
+    const_iterator operator--(int) { const_iterator old(*this); --myIndex; return old; }
+    const_iterator &operator+=(difference_type n) { myIndex += (size_t)n; return *this; }
+    const_iterator &operator-=(difference_type n) { myIndex -= (size_t)n; return *this; }
+    const_iterator operator+(difference_type n) const
+      { return const_iterator(myBuffer, myIndex + (size_t)n); }
+    const_iterator operator-(difference_type n) const
+      { return const_iterator(myBuffer, myIndex - (size_t)n); }
+    difference_type operator-(const const_iterator &other) const
+      { return (difference_type)myIndex - (difference_type)other.myIndex; }
+    bool operator==(const const_iterator &other) const
+      { return myIndex == other.myIndex && myBuffer == other.myBuffer; }
+    bool operator!=(const const_iterator &other) const
+      { return !(*this == other); }
+    bool operator<(const const_iterator &other) const
+      { return myIndex < other.myIndex; }
+  protected:
+    const ArRangeBuffer *myBuffer;
+    size_t myIndex;
+  };
+
+  /// One run of readings stored one after another (see getSpans())
+  struct Span
+  {
+    const double *x; ///< X coordinates
+    const double *y; ///< Y coordinates
+    const ArTime *time; ///< When the readings were added (or last refreshed)
+    size_t size; ///< How many readings
+  };
+#endif
+
   /// Constructor
-  ArRangeBuffer(size_t maxsize) : myCapacity(maxsize) {}
+  ArRangeBuffer(size_t maxsize) : 
+    myStart(0), mySize(0), myRedoIndex(0), myNumRedone(0), myHitEnd(false),
+    myCapacity(maxsize), myChangeCount(0), myListChangeCount(0),
+    myListValid(false), myListHandedOut(false), myListIndexValid(false)
+  {}
 
   /// Destructor
   //AREXPORT virtual ~ArRangeBuffer();
@@ -60,7 +146,35 @@ public:
   }
 
   /// Gets the current number of readings stored in the buffer.
-  size_t getCurrentSize() { return myBuffer.size(); }
+  size_t getCurrentSize() const { takeBackListToRead(); return mySize; }
+
+  /// Gets a reading, 0 being the newest and getCurrentSize() - 1 the oldest
+  ArPoseWithTime getReading(size_t i) const
+  {
+    takeBackListToRead();
+    const size_t p = physicalIndex(i);
+    return ArPoseWithTime(myX[p], myY[p], 0, myTimes[p]);
+  }
+  /// Gets X of a reading, 0 being the newest
+  double getX(size_t i) const 
+    { takeBackListToRead(); return myX[physicalIndex(i)]; }
+  /// Gets Y of a reading, 0 being the newest
+  double getY(size_t i) const 
+    { takeBackListToRead(); return myY[physicalIndex(i)]; }
+  /// Gets the time of a reading, 0 being the newest
+  const ArTime &getTime(size_t i) const 
+    { takeBackListToRead(); return myTimes[physicalIndex(i)]; }
+
+  /// Gets a count that goes up whenever the readings in the buffer change
+  /** ArRobot uses this to tell whether its snapshot of the range devices'
+      current readings is out of date (see ArRobot::setRangeSnapshot()).
+      It can be read without locking the range device.  While the list
+      from getBufferPtr() or getBufferPtrsPtr() may have been changed and
+      the changes haven't been taken back yet, this is one more than it
+      will be if it turns out nothing was changed.
+  */
+  unsigned long getChangeCount() const 
+    { return myChangeCount + (myListHandedOut.load() ? 1 : 0); }
 
   /// Sets the size (capacity) of the buffer
   [[deprecated]] void setSize(size_t size) { setCapacity(size); }
@@ -113,6 +227,13 @@ public:
 
   /// For ArRangeDevice implementations: While doing an invalidation sweep, adds a reading to the list to be invalidated. Called by ArRangeDevice implementations only.
   /// @internal
+  void invalidateReading(const_iterator readingIt)
+  {
+    myInvalidSweepList.push_back(readingIt.getIndex());
+  }
+
+  /// For ArRangeDevice implementations: While doing an invalidation sweep, adds a reading from getBuffer() to the list to be invalidated.
+  /// @internal
   AREXPORT void invalidateReading(std::list<ArPoseWithTime>::const_iterator readingIt);
   //AREXPORT void invalidateReading(std::list<ArPoseWithTime>::iterator readingIt);
 
@@ -120,22 +241,37 @@ public:
   /// @internal
   AREXPORT void endInvalidationSweep();
 
-  /** Return reference to list of readings.  You can use
+  /** Return reference to a list of the readings, newest first.  You can use
   * ArRangeDevice::lockDevice() and ArRangeDevice::unlockDevice() for mutual
   * exclusion of this data if accessing asynchronously from another thread (Note that some range device implementations will be accessing the buffer from their own asynchronous thread (most laser rangefinders, for example), or from the ArRobot task cycle thread (in a Sensor Interp. task))
   * This method replaces the previous getBuffer() method which returned a
   * pointer to the list.  Use getBufferPtr() if you still need to receive a
   * pointer, but that method is deprecated and will be removed in the future.
-  * Also note that this method may need to be removed or replaced if internal implementation of ArRangeBuffer changes.  getBegin() and getEnd() are preferred.
+  * The readings aren't stored in a list, so the list is copied from them
+  * the first time this is called after they change.
+  * getBegin() and getEnd() are preferred.
   */
-  const std::list<ArPoseWithTime>& getBuffer() const { return myBuffer; }
-  // when this is (temporary?) rvalue: std::list<ArPoseWithTime> getBuffer() && { return std::move(myBuffer);  }
+  AREXPORT const std::list<ArPoseWithTime>& getBuffer() const;
 
   /// Get const_iterator pointing to the beginning or start of buffer items (most recent)
-  auto getBegin() const { return myBuffer.cbegin(); }
+  const_iterator getBegin() const 
+    { takeBackListToRead(); return const_iterator(this, 0); }
 
   /// Get const_iterator pointing to the end of the buffer items (oldest)
-  auto getEnd() const { return myBuffer.cend(); }
+  const_iterator getEnd() const 
+    { takeBackListToRead(); return const_iterator(this, mySize); }
+
+  /// Gets the arrays the readings are stored in
+  /**
+     The readings are in at most two runs (since the buffer is a ring):
+     @a spans[0] has the oldest readings, oldest first, and @a spans[1],
+     if there is one, continues with the newer ones.  For code that looks
+     at every reading and doesn't care about order, this is the fastest
+     way to get at them.  The pointers stay valid until the buffer is
+     changed.
+     @return the number of spans filled in (0, 1 or 2)
+  */
+  AREXPORT size_t getSpans(Span spans[2]) const;
 
   /** 
    *  @swigomit
@@ -144,20 +280,31 @@ public:
   PUBLICDEPRECATED("Use ArRangeBuffer::getBuffer() or ArRangeBuffer::getBegin() and ArRangeBuffer::getEnd() instead") 
   const std::list<ArPoseWithTime>* getBufferPtr() const
   {
-    return &myBuffer;
+    return &getBuffer();
   }
 #endif
 
   /** 
+    Changes made to the readings through the list are taken back into
+    the buffer the next time the buffer is read or changed (other than
+    through getBuffer()), so get the list again after that before
+    changing it again.
     @deprecated
   */
   PUBLICDEPRECATED("Use ArRangeBuffer::getBuffer() or ArRangeBuffer::getBegin() and ArRangeBuffer::getEnd() instead") 
   std::list<ArPoseWithTime> *getBufferPtr()
   {
-    return &myBuffer;
+    getBuffer();
+    // the caller may change the readings through this, which is seen
+    // when they are taken back
+    myListHandedOut = true;
+    return &myList;
   }
 
   /** Create a list of pointers to the reading positions. For backward compatibility only.
+   * Changes made to the readings through the pointers are taken back into
+   * the buffer the next time the buffer is read or changed, as with
+   * getBufferPtr().
    * @deprecated */
   PUBLICDEPRECATED("Use ArRangeBuffer::getBuffer() or ArRangeBuffer::getBegin() and ArRangeBuffer::getEnd() instead") 
   std::list<ArPoseWithTime *> *getBufferPtrsPtr() const;
@@ -173,6 +320,29 @@ public:
 				ArPose *readingPos = NULL,
 				ArPose targetPose = ArPose(0, 0, 0)) const;
 
+#ifndef ARIA_WRAPPER
+  /// Ways getClosestPolar() and getClosestBox() can go through the readings
+  /// @internal
+  enum Implementation 
+  {
+    SCALAR, ///< A reading at a time
+    SSE2, ///< 2 readings at a time
+    AVX2 ///< 4 readings at a time
+  };
+  /// Gets which implementation getClosestPolar() and getClosestBox() are using
+  /// @internal
+  AREXPORT static Implementation getImplementation();
+  /// Makes getClosestPolar() and getClosestBox() use @a impl (for tests and benchmarks)
+  /// @internal
+  AREXPORT static bool setImplementation(Implementation impl);
+  /// Sees if @a impl can be used on this build and processor
+  /// @internal
+  AREXPORT static bool isSupported(Implementation impl);
+  /// Gets the name of an implementation
+  /// @internal
+  AREXPORT static const char *getImplementationName(Implementation impl);
+#endif
+
   /// For ArRangeDevice implementations: Applies a transform to all readings in the buffer
   AREXPORT void applyTransform(const ArTransform& trans);
 
@@ -223,20 +393,74 @@ public:
   AREXPORT void logInternal(FILE *fp, const char *linePrefix = "", const char *name = "") const;
 
 protected:
+  /// Gets where reading @a i (0 being the newest) is in the arrays
+  size_t physicalIndex(size_t i) const
+  {
+    size_t p = myStart + mySize - 1 - i;
+    if (p >= myX.size())
+      p -= myX.size();
+    return p;
+  }
+  /// Gets where the reading @a n after the oldest one is in the arrays
+  size_t physicalFromOldest(size_t n) const
+  {
+    size_t p = myStart + n;
+    if (p >= myX.size())
+      p -= myX.size();
+    return p;
+  }
+  /// Makes room for more readings (up to the capacity)
+  void grow();
+  /// Moves the readings into arrays of @a allocated, the oldest first
+  void reallocate(size_t allocated);
+  /// Drops the @a num oldest readings
+  void dropOldest(size_t num);
+  /// Takes back changes made through getBufferPtr() or getBufferPtrsPtr(), if there are any
+  void takeBackList();
+  /// Takes back changes made through the list before the readings are read
+  void takeBackListToRead() const
+  {
+    // the list is only handed out by a buffer that can be changed (a
+    // range device's), so this isn't really const when it was
+    if (myListHandedOut.load(std::memory_order_relaxed))
+      const_cast<ArRangeBuffer *>(this)->takeBackList();
+  }
+
   ArPose myRobotPose;		// where the robot was when readings were acquired
   ArPose myRobotEncoderPose;		// where the robot was when readings were acquired
 
-  std::list<ArPoseWithTime> myBuffer;
-  std::list<ArPoseWithTime> myReserved; /// < Invalidated items that were removed from the buffer (e.g. after "invalidation sweep") are spliced into this list to avoid deallocation and reallocation of items.
-  std::vector<std::list<ArPoseWithTime>::const_iterator> myInvalidSweepList; ///< Items that will be removed from the buffer at the end of an "invalidation sweep"
+  // The readings, in a ring buffer that's grown as needed up to
+  // myCapacity.  The oldest is at myStart, the newest mySize - 1 after it
+  // (wrapping around the end of the arrays).
+  std::vector<double> myX;
+  std::vector<double> myY;
+  std::vector<ArTime> myTimes;
+  size_t myStart;
+  size_t mySize;
+
+  std::vector<size_t> myInvalidSweepList; ///< Readings (by index, 0 being the newest) that will be removed from the buffer at the end of an "invalidation sweep"
+  std::vector<char> myInvalid; ///< used by endInvalidationSweep()
 
-  std::list<ArPoseWithTime>::iterator myRedoIt;
+  size_t myRedoIndex;
   int myNumRedone;
   bool myHitEnd;
   
   size_t myCapacity;
 
-  std::vector<ArPoseWithTime> myVector; // copy of myBuffer, recreated whenever getBufferAsVector() is called.  TODO remove
+  mutable std::atomic<unsigned long> myChangeCount;
+
+  // copy of the readings for getBuffer(), remade when myChangeCount changes
+  mutable std::list<ArPoseWithTime> myList;
+  mutable unsigned long myListChangeCount;
+  mutable bool myListValid;
+  // set when getBufferPtr() or getBufferPtrsPtr() have let the list be
+  // changed (atomic since getChangeCount() reads it without locking)
+  mutable std::atomic<bool> myListHandedOut;
+  // where each reading in myList is, for invalidateReading() with list iterators
+  mutable std::unordered_map<const ArPoseWithTime *, size_t> myListIndex;
+  mutable bool myListIndexValid;
+
+  std::vector<ArPoseWithTime> myVector; // copy of the readings, recreated whenever getBufferAsVector() is called.  TODO remove
 };
 
 #endif // ARRANGEBUFFER_H
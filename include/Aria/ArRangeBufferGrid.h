@@ -0,0 +1,120 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARRANGEBUFFERGRID_H
+#define ARRANGEBUFFERGRID_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArRangeBuffer.h"
+
+#include <math.h>
+#include <deque>
+#include <unordered_map>
+#include <vector>
+
+/// Finds the readings in an ArRangeBuffer near a point or a line, by where they are
+/**
+   Keeps the readings of one ArRangeBuffer in a grid of square cells
+   (hashed, so the grid has no bounds), so finding the readings near a
+   point or along a line only looks at the readings in the cells around it
+   instead of every reading in the buffer.  ArLaser uses this for its
+   cumulative buffer.
+
+   Readings added and removed through the grid (addReading(), remove())
+   keep it up to date.  When the buffer is changed some other way, sync()
+   notices (from ArRangeBuffer::getChangeCount()) and puts all of the
+   readings in the grid again.  Readings removed with remove() stay in the
+   buffer until flush() (or an addReading() to a full buffer), so that
+   removing many readings only goes through the buffer once; they aren't
+   found through the grid after remove() though.
+
+   The buffer should be locked (with its range device) while using this.
+
+   @ingroup UtilityClasses
+**/
+class ArRangeBufferGrid
+{
+public:
+  /// A reading, as kept in the grid
+  struct Reading
+  {
+    double x;
+    double y;
+    unsigned long long id; ///< used by remove() to find it in the buffer
+  };
+
+  /// Constructor
+  AREXPORT ArRangeBufferGrid(double cellSize = 500);
+
+  /// Sets the size of the cells (mm), which puts the readings in the grid again
+  AREXPORT void setCellSize(double cellSize);
+  /// Gets the size of the cells (mm)
+  double getCellSize() const { return myCellSize; }
+
+  /// Puts the readings of @a buffer in the grid, if it changed other than through this
+  AREXPORT void sync(const ArRangeBuffer &buffer);
+  /// Returns true if a reading is closer than sqrt(@a distSquared) to x, y
+  AREXPORT bool anyWithin(double x, double y, double distSquared) const;
+  /// Finds the readings that may be within @a dist of the line segment
+  /**
+     Gives every reading in the cells that the line segment from x1, y1
+     to x2, y2 passes within @a dist of, so it gives all of the readings
+     that are within @a dist of the line segment, and some that aren't.
+  */
+  AREXPORT void findNearSegment(double x1, double y1, double x2, double y2,
+				double dist, std::vector<Reading> *found) const;
+  /// Removes a reading (found with findNearSegment()) from the grid, and later from the buffer
+  AREXPORT void remove(const Reading &reading);
+  /// Takes the readings given to remove() out of @a buffer
+  AREXPORT void flush(ArRangeBuffer *buffer);
+  /// Adds a reading to @a buffer and the grid
+  AREXPORT void addReading(ArRangeBuffer *buffer, double x, double y);
+  /// Gets the number of readings in the grid
+  size_t getNumReadings() const { return myNumReadings; }
+  /// Gets the number of times all of the readings were put in the grid again
+  unsigned long getNumRebuilds() const { return myNumRebuilds; }
+protected:
+  long long cellKey(double x, double y) const
+    { return cellKey(cellIndex(x), cellIndex(y)); }
+  static long long cellKey(int ix, int iy)
+    { return ((long long)ix << 32) ^ (long long)(unsigned int)iy; }
+  int cellIndex(double v) const { return (int)floor(v / myCellSize); }
+  void insert(double x, double y, unsigned long long id);
+  void erase(double x, double y, unsigned long long id);
+  void rebuild(const ArRangeBuffer &buffer);
+
+  double myCellSize;
+  std::unordered_map<long long, std::vector<Reading> > myCells;
+  size_t myNumReadings;
+  // the ids of the readings in the buffer, oldest first (so in order)
+  std::deque<unsigned long long> myIds;
+  unsigned long long myNextId;
+  // ids of readings given to remove() but still in the buffer
+  std::vector<unsigned long long> myRemoved;
+  // the buffer's change count the last time this matched it
+  unsigned long myChangeCount;
+  bool mySynced;
+  unsigned long myNumRebuilds;
+};
+
+#endif // ARRANGEBUFFERGRID_H
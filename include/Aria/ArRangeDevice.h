@@ -29,7 +29,9 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArSensorReading.h"
 #include "Aria/ArDrawingData.h"
 #include "Aria/ArMutex.h"
+#include "Aria/ArRangeScan.h"
 #include <set>
+#include <memory>
 
 class ArRobot;
 
@@ -271,6 +273,24 @@ public:
   PUBLICDEPRECATED("")
   AREXPORT virtual std::vector<ArSensorReading> *getAdjustedRawReadingsAsVectorPtr();
 
+#ifndef ARIA_WRAPPER
+  /// Gets the last whole scan of raw readings, without locking the device
+  /**
+     Devices with raw readings (lasers, see ArLaser) publish a copy of them
+     once each scan has been processed.  This gives the latest one without
+     locking the device or copying the readings, so it doesn't wait on
+     (or hold up) the thread reading the device, and any number of
+     threads can go through the same scan at once.  The scan won't change
+     while you have it; call this again to get the next one
+     (ArRangeScan::getCount() tells them apart).
+
+     @return the last scan, or an empty pointer if the device hasn't
+     published one
+  **/
+  std::shared_ptr<const ArRangeScan> getLatestScan() const
+    { return std::atomic_load(&myLatestScan); }
+#endif
+
 
   /// Sets the maximum seconds to keep current readings around
   /**
@@ -479,6 +499,8 @@ protected:
     can't use this mechanism.
   **/
   AREXPORT void adjustRawReadings(bool interlaced);
+  /// Publishes a copy of the raw readings for getLatestScan() (with the device locked)
+  AREXPORT void publishScan();
   std::vector<ArSensorReading> myRawReadingsVector;
   std::vector<ArSensorReading> myAdjustedRawReadingsVector;
   std::string myName;
@@ -514,6 +536,14 @@ protected:
   bool myOwnCumulativeDrawingData;
   ArMutex myDeviceMutex;
   bool myIsLocationDependent;
+
+  // the scan getLatestScan() gives (myLastScan is the same one, but can
+  // be changed), and the one before it, which publishScan() fills in
+  // again once no one else has it
+  std::shared_ptr<const ArRangeScan> myLatestScan;
+  std::shared_ptr<ArRangeScan> myLastScan;
+  std::shared_ptr<ArRangeScan> mySpareScan;
+  unsigned long myNumScans;
 };
 
 #endif // ARRANGEDEVICE_H
@@ -0,0 +1,82 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARRANGESCAN_H
+#define ARRANGESCAN_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ariaUtil.h"
+#include "Aria/ArSensorReading.h"
+
+#include <vector>
+
+/// One whole scan from a range device, from ArRangeDevice::getLatestScan()
+/**
+   A range device with raw readings (such as a laser) copies them into
+   one of these once it has processed each scan, and publishes it so that
+   any thread can get it with ArRangeDevice::getLatestScan() without
+   locking the device.  A scan is never changed once it is published, so
+   any number of threads can go through the same one at once, and keep it
+   as long as they want (it is freed when the last std::shared_ptr to it
+   goes away).
+
+   The readings are copies of the raw readings (ArRangeDevice::getRawReadings())
+   as they were at the end of the scan, in the same order, including which
+   ones are ignored.  They are not corrected for the robot odometry
+   offset later on, as ArRangeDevice::getAdjustedRawReadings() are.
+
+   @ingroup OptionalClasses
+**/
+class ArRangeScan
+{
+public:
+  /// Constructor
+  ArRangeScan() : myCount(0) {}
+
+  /// Gets the readings
+  const std::vector<ArSensorReading> &getReadings() const 
+    { return myReadings; }
+  /// Gets the number of readings
+  size_t getNumReadings() const { return myReadings.size(); }
+  /// Gets a reading
+  const ArSensorReading &getReading(size_t i) const { return myReadings[i]; }
+
+  /// Gets the robot's global position when the scan was taken
+  ArPose getPoseTaken() const { return myPoseTaken; }
+  /// Gets the robot's encoder position when the scan was taken
+  ArPose getEncoderPoseTaken() const { return myEncoderPoseTaken; }
+  /// Gets when the scan was taken
+  ArTime getTimeTaken() const { return myTimeTaken; }
+  /// Gets how many scans the device had published, counting this one (so readers can tell a new one)
+  unsigned long getCount() const { return myCount; }
+protected:
+  friend class ArRangeDevice;
+
+  std::vector<ArSensorReading> myReadings;
+  ArPose myPoseTaken;
+  ArPose myEncoderPoseTaken;
+  ArTime myTimeTaken;
+  unsigned long myCount;
+};
+
+#endif // ARRANGESCAN_H
@@ -0,0 +1,141 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARRANGESNAPSHOT_H
+#define ARRANGESNAPSHOT_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ariaUtil.h"
+
+#include <list>
+#include <vector>
+
+class ArRangeDevice;
+
+/// Robot-frame snapshot of the current readings of a robot's range devices
+/**
+   ArRobot keeps one of these so that the actions' closest reading queries
+   (ArRobot::checkRangeDevicesCurrentPolar() and
+   ArRobot::checkRangeDevicesCurrentBox()) don't each have to lock every
+   range device and work out the angle and distance to every reading.
+   build() copies each device's current readings once, with the angle and
+   distance to each worked out from the robot's pose just as
+   ArRangeBuffer::getClosestPolar() and ArRangeBuffer::getClosestBox() do
+   it, and sorts them into one degree angle buckets and a grid of
+   GRID_CELL_SIZE mm cells in robot coordinates.  Each bucket and cell
+   remembers its closest reading, so a query only has to look at the
+   individual readings in the buckets or cells its edges cross, and gives
+   exactly the same answer (including which reading wins a tie) as asking
+   each device.
+
+   isCurrent() says whether the snapshot still matches the list of range
+   devices, their readings (ArRangeBuffer::getChangeCount()) and the poses
+   of the robots they're attached to.
+
+   @internal
+**/
+class ArRangeSnapshot
+{
+public:
+  enum { 
+    NUM_ANGLE_BUCKETS = 360, ///< Number of angle buckets (one per degree)
+    GRID_CELL_SIZE = 250 ///< Size of the grid cells (mm)
+  };
+  /// Constructor
+  AREXPORT ArRangeSnapshot();
+
+  /// Builds the snapshot from the current readings of @a devices
+  AREXPORT void build(const std::list<ArRangeDevice *> &devices);
+  /// Whether the snapshot still matches @a devices and their robots' poses
+  AREXPORT bool isCurrent(const std::list<ArRangeDevice *> &devices) const;
+  /// Forgets the snapshot, so isCurrent() is false until it's built again
+  void invalidate() { myValid = false; }
+
+  /// Same as ArRobot::checkRangeDevicesCurrentPolar() 
+  AREXPORT double checkPolar(double startAngle, double endAngle, 
+			     double *angle, const ArRangeDevice **rangeDevice,
+			     bool useLocationDependentDevices) const;
+  /// Same as ArRobot::checkRangeDevicesCurrentBox() 
+  AREXPORT double checkBox(double x1, double y1, double x2, double y2, 
+			   ArPose *readingPos, 
+			   const ArRangeDevice **rangeDevice,
+			   bool useLocationDependentDevices) const;
+
+  /// Gets the number of readings in the snapshot
+  size_t getNumReadings() const { return myNumReadings; }
+  /// Swaps the contents of two snapshots (so their storage can be reused)
+  AREXPORT void swap(ArRangeSnapshot &other);
+protected:
+  struct Reading
+  {
+    ArPose myLocal; ///< reading in robot coordinates
+    double myBoxDist; ///< distance from the robot, as getClosestBox() has it
+    double myPolarDist; ///< distance from the robot, as getClosestPolar() has it
+    double myTh; ///< angle from the robot's heading
+  };
+  struct Cell
+  {
+    int myX;
+    int myY;
+    size_t myBegin; ///< into DeviceSnapshot::myCellOrder
+    size_t myEnd;
+    size_t myClosest; ///< into DeviceSnapshot::myReadings
+  };
+  struct DeviceSnapshot
+  {
+    ArRangeDevice *myDevice;
+    unsigned long myChangeCount;
+    unsigned int myMaxRange;
+    /// the pose of the device's robot the readings were taken relative to
+    ArPose myRobotPose;
+    /// in buffer order, which breaks ties just like the buffer does
+    std::vector<Reading> myReadings;
+    /// indices into myReadings, sorted by angle bucket
+    std::vector<size_t> myBucketOrder;
+    /// where each bucket starts in myBucketOrder (NUM_ANGLE_BUCKETS + 1)
+    std::vector<size_t> myBucketStarts;
+    /// closest reading in each bucket (npos if empty)
+    std::vector<size_t> myBucketClosest;
+    /// indices into myReadings, sorted by cell
+    std::vector<size_t> myCellOrder;
+    /// the cells with readings in them, sorted by x then y
+    std::vector<Cell> myCells;
+  };
+
+  static size_t getAngleBucket(double th);
+  static int getCell(double coord);
+  double checkDevicePolar(const DeviceSnapshot &dev, double startAngle, 
+			  double endAngle, double *angle) const;
+  double checkDeviceBox(const DeviceSnapshot &dev, double x1, double y1, 
+			double x2, double y2, ArPose *readingPos) const;
+  void buildDevice(DeviceSnapshot *dev);
+  static ArPose getDeviceRobotPose(ArRangeDevice *device);
+
+  bool myValid;
+  std::vector<DeviceSnapshot> myDevices;
+  size_t myNumReadings;
+  // scratch for build()
+  std::vector<std::pair<long long, size_t> > myCellKeys;
+};
+
+#endif // ARRANGESNAPSHOT_H
@@ -0,0 +1,121 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARREPLAYDEVICECONNECTION_H
+#define ARREPLAYDEVICECONNECTION_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArDeviceConnection.h"
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+/// Plays back data recorded from a device connection
+/**
+   This reads a capture made with ArDeviceConnection::startRecording()
+   and hands the data out through read(), the same as it was read from
+   the device, so it can be used in place of the robot's or a laser's
+   connection (e.g. with ArRobot::setDeviceConnection() or
+   ArLaser::setDeviceConnection()) for regression runs and benchmarks
+   without hardware or MobileSim.
+
+   In real time mode (the default) each piece of data is only available
+   once as much time has gone by since the connection was opened as
+   had gone by since recording started when it was read from the
+   device, and getTimeRead() gives that time, so the timing that the
+   robot or laser sees is the same as it was when it was recorded.
+   With setRealTime(false) data is handed out as fast as it is read.
+
+   Anything written to the connection is thrown away.  Once all of the
+   capture has been played, read() returns 0 and isAtEnd() returns
+   true.
+
+   @ingroup UtilityClasses
+**/
+class ArReplayDeviceConnection: public ArDeviceConnection
+{
+ public:
+  /// Constructor
+  AREXPORT ArReplayDeviceConnection();
+  /// Destructor also closes connection
+  AREXPORT virtual ~ArReplayDeviceConnection();
+
+  /// Opens a capture file to play back
+  AREXPORT int open(const char *fileName = NULL);
+  /// Sets the capture file to play back with openSimple()
+  AREXPORT void setFileName(const char *fileName);
+  /// Gets the capture file being played back
+  const char *getFileName() const { return myFileName.c_str(); }
+  AREXPORT virtual bool openSimple();
+  AREXPORT virtual bool close();
+  AREXPORT virtual int read(const char *data, unsigned int size, 
+			    unsigned int msWait = 0);
+  AREXPORT virtual int write(const char *data, unsigned int size);
+  virtual int getStatus() { return myStatus; }
+  AREXPORT virtual const char *getOpenMessage(int messageNumber);
+  AREXPORT virtual ArTime getTimeRead(int index);
+  AREXPORT virtual bool isTimeStamping();
+
+  /// Sets whether data is played back with the timing it was recorded with, or as fast as possible
+  void setRealTime(bool realTime) { myRealTime = realTime; }
+  /// Gets whether data is played back with the timing it was recorded with
+  bool getRealTime() const { return myRealTime; }
+  /// Sees if all of the capture has been played back
+  bool isAtEnd() const { return myAtEnd; }
+  /// Gets the number of bytes played back so far
+  unsigned long long getBytesReplayed() const { return myBytesReplayed; }
+  /// Gets the number of bytes written to (and thrown away by) this connection
+  unsigned long long getBytesWritten() const { return myBytesWritten; }
+
+  enum Open { 
+      OPEN_FILE_NOT_FOUND = 1, ///< Could not open the capture file
+      OPEN_NOT_CAPTURE, ///< The file isn't a capture file
+      OPEN_BAD_VERSION ///< The capture file is from a newer version
+  };
+protected:
+  void buildStrMap();
+  /// Reads the next record from the capture file
+  bool readRecord();
+
+  ArStrMap myStrMap;
+  std::string myFileName;
+  FILE *myFile;
+  int myStatus;
+  bool myRealTime;
+  bool myAtEnd;
+  /// When playback started
+  ArTime myReplayStartTime;
+  /// The record being played back, and how much of it has been played
+  std::vector<char> myRecord;
+  size_t myRecordPos;
+  bool myHaveRecord;
+  /// ms after the start of the capture that the record was read
+  long long myRecordMSecs;
+  /// When the first record in the last read() was read
+  ArTime myTimeRead;
+  unsigned long long myBytesReplayed;
+  unsigned long long myBytesWritten;
+};
+
+#endif // ARREPLAYDEVICECONNECTION_H
@@ -32,8 +32,14 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArSensorReading.h"
 #include "Aria/ArMutex.h"
 #include "Aria/ArCondition.h"
+#include "Aria/ArLogThrottle.h"
 #include "Aria/ArSyncLoop.h"
 #include "Aria/ArRobotPacketReaderThread.h"
+#include "Aria/ArRobotPacketRing.h"
+#include "Aria/ArTimeHistogram.h"
+#include "Aria/ArRangeSnapshot.h"
+#include "Aria/ArRobotState.h"
+#include "Aria/ArSeqLock.h"
 #include "Aria/ArRobotParams.h"
 #include "Aria/ArActionDesired.h"
 #include "Aria/ArResolver.h"
@@ -339,6 +345,18 @@ public:
    *
    */
   ArPose getPose() const { return myGlobalPose; }
+  /// Gets a copy of the robot's state as of the last SIP, without locking
+  /**
+     The other accessors read the robot's values as they are being
+     changed, so a thread other than the robot's own has to lock() the
+     robot to get a consistent set of them, which means waiting for the
+     whole robot cycle.  This instead copies the state ArRobot publishes
+     at the end of handling each SIP (and when moveTo() or
+     setEncoderTransform() change the pose) and never blocks, or holds up
+     the robot cycle.  Call it without the robot locked.
+     @sa ArRobotState
+  */
+  ArRobotState getStateSnapshot() const { return myStateSnapshot.read(); }
   /// Gets the global X position of the robot
   /** @sa getPose() 
       @ingroup easy
@@ -675,6 +693,12 @@ public:
   /// Gets the number of sonar returns received in the last second
   AREXPORT int getSonarPacCount() const;
 
+  /// Gets how many received packets were dropped because the sync loop fell behind the packet reader thread
+  unsigned long getNumPacketsDropped() const 
+    { return myPacketRing.getNumOverflows(); }
+  /// Gets the most received packets that have been waiting for the sync loop at once
+  size_t getMaxPacketsQueued() const { return myPacketRing.getMaxDepth(); }
+
   /// Gets the range of the last sonar reading for the given sonar
   /// @ingroup easy
   AREXPORT int getSonarRange(int num) const;
@@ -944,6 +968,26 @@ public:
 	  const ArRangeDevice **rangeDevice = NULL,
 	  bool useLocationDependentDevices = true) const;
 
+  /// Sets whether the current readings checks are answered from a snapshot
+  /**
+     When this is on (the default) checkRangeDevicesCurrentPolar() and
+     checkRangeDevicesCurrentBox() are answered from an ArRangeSnapshot of
+     all the range devices' current readings, in robot coordinates, which
+     is only rebuilt when the robot moves or a device's current readings
+     change (normally once a cycle, by the first action that checks).  The
+     answers are exactly the same as asking each device, unless a range
+     device overrides ArRangeDevice::currentReadingPolar() or
+     ArRangeDevice::currentReadingBox(), in which case this should be
+     turned off.
+  **/
+  void setRangeSnapshot(bool useRangeSnapshot) 
+    { myUseRangeSnapshot = useRangeSnapshot; }
+  /// Gets whether the current readings checks are answered from a snapshot
+  bool getRangeSnapshot() const { return myUseRangeSnapshot; }
+  /// Gets the number of times the range snapshot has been built
+  unsigned long getRangeSnapshotBuilds() const 
+    { return myRangeSnapshotBuilds; }
+
   /// Adds a laser to the robot's map of them
   AREXPORT bool addLaser(ArLaser *laser, int laserNumber, 
 			 bool addAsRangeDevice = true);
@@ -1189,9 +1233,11 @@ public:
   AREXPORT ArSyncTask *findUserTask(ArFunctor *functor);
   
   /// Logs the list of user tasks, strictly for your viewing pleasure
-  AREXPORT void logUserTasks() const;
+  AREXPORT void logUserTasks(bool runTimes = false) const;
   /// Logs the list of all tasks, strictly for your viewing pleasure
-  AREXPORT void logAllTasks() const;
+  AREXPORT void logAllTasks(bool runTimes = false) const;
+  /// Empties the run times kept for all the tasks (see logAllTasks())
+  AREXPORT void resetTaskRunTimes();
 
   /// Adds a sensor interpretation task. These are called during the ArRobot
   /// task synchronous cycle after robot data has been received (from the SIP
@@ -1215,6 +1261,16 @@ public:
   AREXPORT void remSensorInterpTask(const char *name);
   /// Removes a sensor interp tasks by functor
   AREXPORT void remSensorInterpTask(ArFunctor *functor);
+  /// Lets a sensor interp task run at the same time as other concurrent ones
+  AREXPORT bool setSensorInterpTaskConcurrent(const char *name, 
+					      bool concurrent = true);
+  /// Makes a concurrent sensor interp task wait for another one to finish
+  AREXPORT bool addSensorInterpTaskDependency(const char *name, 
+					      const char *dependsOnName);
+  /// Sets how many extra threads run concurrent sensor interp tasks
+  AREXPORT void setSensorInterpThreads(unsigned int numThreads);
+  /// Gets how many extra threads run concurrent sensor interp tasks
+  AREXPORT unsigned int getSensorInterpThreads() const;
 
   /// Finds a task by name
   AREXPORT ArSyncTask *findTask(const char *name);
@@ -1283,6 +1339,35 @@ public:
   void setCycleChained(bool cycleChained) { myCycleChained = cycleChained; }
   /// Gets whether we chain the robot cycle to when we get in SIP packets
   bool isCycleChained() const { return myCycleChained; }
+  /// Sets whether the robot cycle keeps its own time with absolute deadlines
+  /**
+     When @a realTime is true the synchronous loop sleeps until absolute
+     deadlines a cycle time apart (see ArSyncLoop::setRealTime()), so the
+     cycle holds its period to well under a millisecond instead of
+     drifting by however long each millisecond sleep overshot.  This is
+     only used when the loop is doing its own timing, i.e. when the
+     cycle isn't chained to SIPs or the robot isn't connected.
+
+     @param realTime whether to use absolute deadlines
+     @param priority SCHED_FIFO priority for the loop's thread, 0 to leave it alone
+     @param cpu CPU to pin the loop's thread to, -1 for any
+     @param lockMemory whether to mlockall() the process's memory
+  **/
+  void setCycleRealTime(bool realTime, int priority = 0, int cpu = -1,
+			bool lockMemory = false)
+    { mySyncLoop.setRealTime(realTime); 
+      mySyncLoop.setRealTimePriority(priority);
+      mySyncLoop.setCpuAffinity(cpu);
+      mySyncLoop.setLockMemory(lockMemory); }
+  /// Gets whether the robot cycle keeps its own time with absolute deadlines
+  bool getCycleRealTime() const { return mySyncLoop.getRealTime(); }
+  /// Gets the synchronous loop (for its cycle and overrun statistics)
+  const ArSyncLoop *getSyncLoop() const { return &mySyncLoop; }
+  /// Resets the synchronous loop's cycle and overrun statistics
+  void resetCycleStats() { mySyncLoop.resetStats(); }
+  /// Logs the synchronous loop's cycle and overrun statistics
+  void logCycleStats(ArLog::LogLevel level = ArLog::Normal) const
+    { mySyncLoop.logStats(level); }
   /// Sets the time without a response until connection assumed lost (threadsafe)
   AREXPORT void setConnectionTimeoutTime(int mSecs);
   /// Gets the time without a response until connection assumed lost (threadsafe)
@@ -1308,6 +1393,14 @@ public:
 				     ArPoseWithTime *mostRecent = NULL)
     { return myInterpolation.getPose(timeStamp, position, mostRecent); }
 
+  /// Gets the positions the robot was at at each of the given timestamps
+  /** @see ArInterpolation::getPoses 
+   */
+  size_t getPoseInterpPositions(const std::vector<ArTime> &timeStamps,
+				std::vector<ArPose> *positions,
+				std::vector<int> *results = NULL)
+    { return myInterpolation.getPoses(timeStamps, positions, results); }
+
   /// Gets the pose interpolation object, this should only really used internally
   ArInterpolation *getPoseInterpolation()
     { return &myInterpolation; }
@@ -1334,6 +1427,14 @@ public:
 					    ArPoseWithTime *mostRecent = NULL)
     { return myEncoderInterpolation.getPose(timeStamp, position, mostRecent); }
 
+  /// Gets the encoder positions the robot was at at each of the given timestamps
+  /** @see ArInterpolation::getPoses 
+   */
+  size_t getEncoderPoseInterpPositions(const std::vector<ArTime> &timeStamps,
+				       std::vector<ArPose> *positions,
+				       std::vector<int> *results = NULL)
+    { return myEncoderInterpolation.getPoses(timeStamps, positions, results); }
+
   ArInterpolation *getEncoderPoseInterpolation()
     { return &myEncoderInterpolation; }
 
@@ -1527,6 +1628,55 @@ public:
 		myPacketsSentTracking = packetsSentTracking; 
 		}
 
+  /// Gets if the motion commands sent each cycle are written to the robot together
+  bool getCommandBatching() { return myCommandBatching; }
+  /// Sets if the motion commands sent each cycle are written to the robot together
+  /**
+     If this is true (the default) the commands sent by stateReflector()
+     during a cycle are collected and written to the robot with a single
+     write at the end of stateReflector(), instead of one write per
+     command. The commands still go out in the order they were sent.
+  **/
+  void setCommandBatching(bool commandBatching)
+    { myCommandBatching = commandBatching; }
+
+  /// Stages of the time from a SIP arriving to the commands it leads to being sent
+  enum LatencyStage 
+  {
+    LATENCY_RECEIVE_TO_HANDLE, ///< SIP read from the connection to handlePacket()
+    LATENCY_HANDLE_TO_SENSOR_INTERP, ///< handlePacket() to the sensor interp tasks being done
+    LATENCY_SENSOR_INTERP_TO_ACTIONS, ///< Sensor interp tasks done to the actions being resolved
+    LATENCY_ACTIONS_TO_SEND, ///< Actions resolved to stateReflector() writing the commands
+    LATENCY_RECEIVE_TO_SEND, ///< SIP read from the connection to the commands being written
+    NUM_LATENCY_STAGES
+  };
+  /// Gets if the latency from SIPs to commands is being measured
+  bool getLatencyTracing() const { return myLatencyTracing; }
+  /// Sets if the latency from SIPs to commands is measured (on by default)
+  /**
+     When this is on, each cycle that handles a SIP notes when it was
+     read from the robot connection, when it was handled, when the
+     sensor interp tasks finished, when the actions were resolved and
+     when stateReflector() wrote the resulting commands, and adds the
+     time each stage took to a histogram (see getLatencyHistogram()).
+     Cycles where stateReflector() doesn't send anything aren't
+     counted past LATENCY_RECEIVE_TO_HANDLE.
+  **/
+  void setLatencyTracing(bool latencyTracing) 
+    { myLatencyTracing = latencyTracing; myLatencyHaveSip = false; }
+#ifndef ARIA_WRAPPER
+  /// Gets the histogram of how long a stage of getting from a SIP to commands took
+  const ArTimeHistogram *getLatencyHistogram(LatencyStage stage) const
+    { return (stage >= 0 && stage < NUM_LATENCY_STAGES) ? 
+	&myLatencyHistograms[stage] : NULL; }
+#endif
+  /// Gets the name of a latency stage
+  AREXPORT static const char *getLatencyStageName(LatencyStage stage);
+  /// Empties the latency histograms
+  AREXPORT void resetLatencyHistograms();
+  /// Logs the latency histograms
+  AREXPORT void logLatency(ArLog::LogLevel level = ArLog::Normal);
+
   /// Gets if we're logging all the actions as they happen
   bool getLogActions() { return myLogActions; }
   /// Sets if we're logging all the actions as they happen
@@ -1583,6 +1733,8 @@ public:
   /// Processes a motor packet, internal 
   /// @internal 
   bool processMotorPacket(ArRobotPacket *packet);
+  /// Copies the current state for getStateSnapshot() (with the robot locked)
+  void publishStateSnapshot();
   /// Processes a new sonar reading, internal
   /// @internal
   void processNewSonar(int number, unsigned int range, ArTime timeReceived);
@@ -1795,6 +1947,15 @@ protected:
   long myPacketsReceivedTrackingCount;
   ArTime myPacketsReceivedTrackingStarted;
   bool myPacketsSentTracking;
+  bool myCommandBatching;
+  bool myLatencyTracing;
+  /// If a SIP was handled this cycle (and the times of its stages so far)
+  bool myLatencyHaveSip;
+  ArTime myLatencyReceived;
+  ArTime myLatencyHandled;
+  ArTime myLatencySensorInterpDone;
+  ArTime myLatencyActionsResolved;
+  ArTimeHistogram myLatencyHistograms[NUM_LATENCY_STAGES];
   ArMutex myMutex;
   ArSyncTask *mySyncTaskRoot;
   std::list<ArRetFunctor1<bool, ArRobotPacket *> *> myPacketHandlerList;
@@ -1803,9 +1964,10 @@ protected:
   ArRobotPacketReaderThread myPacketReader;
 
   // the data items for reading packets in one thread and processing them in another
-  ArMutex myPacketMutex;
-  std::list<ArRobotPacket *> myPacketList;
+  ArRobotPacketRing myPacketRing;
   ArCondition myPacketReceivedCondition;
+  ArLogThrottle myPacketTimeoutLogThrottle;
+  bool myPacketRingOverflowing;
   bool myRunningNonThreaded;
 
 
@@ -1820,6 +1982,18 @@ protected:
   std::list<ArRangeDevice *> myRangeDeviceList;
   std::map<int, ArLaser *> myLaserMap;
 
+  // makes sure myRangeSnapshot is current and returns with its mutex locked
+  void lockRangeSnapshot() const;
+  std::atomic<bool> myUseRangeSnapshot;
+  mutable ArMutex myRangeSnapshotMutex;
+  mutable ArRangeSnapshot myRangeSnapshot;
+  // storage for the next build, so it doesn't have to be reallocated
+  mutable ArRangeSnapshot myRangeSnapshotSpare;
+  mutable std::atomic<unsigned long> myRangeSnapshotBuilds;
+
+  ArSeqLock<ArRobotState> myStateSnapshot;
+  ArRobotState myStateToPublish;
+
   std::map<int, ArBatteryMTX *> myBatteryMap;
 
   std::map<int, ArLCDMTX *> myLCDMap;
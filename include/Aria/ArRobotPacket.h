@@ -61,7 +61,7 @@ public:
   AREXPORT bool verifyCheckSum();
 
   /// returns the ID of the packet 
-  AREXPORT uint8_t getID();
+  AREXPORT uint8_t getID() const;
 
   /// Get string containing packet type name, if known
   const char *getName() { return Aria::getPacketTypeName(getID()); }
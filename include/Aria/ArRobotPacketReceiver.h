@@ -69,6 +69,21 @@ public:
   AREXPORT void setAllocatingPackets(bool allocatePackets) 
     { myAllocatePackets = allocatePackets; }
 
+  /// Sets how long receivePacket() waits for the rest of a partial packet
+  /**
+     Once the start of a packet has been seen receivePacket() waits for the
+     rest of it, giving up if no data comes in for this long (100 ms by
+     default).  If this is 0 then it never waits, a partial packet is left in
+     the connection's read-ahead buffer and receivePacket() returns NULL;
+     the packet is returned by a later call once the rest of it has been read
+     in (this is how devices read from an ArDeviceReactor work).
+  **/
+  void setPartialPacketTimeout(unsigned int msecs) 
+    { myPartialPacketTimeout = msecs; }
+  /// Gets how long receivePacket() waits for the rest of a partial packet
+  unsigned int getPartialPacketTimeout() const 
+    { return myPartialPacketTimeout; }
+
 #ifdef DEBUG_SPARCS_TESTING
   AREXPORT void setSync1(unsigned char s1) { mySync1 = s1; }
   AREXPORT void setSync2(unsigned char s2) { mySync2 = s2; }
@@ -98,6 +113,7 @@ protected:
   enum { STATE_SYNC1, STATE_SYNC2, STATE_ACQUIRE_DATA };
   unsigned char mySync1;
   unsigned char mySync2;
+  unsigned int myPartialPacketTimeout;
 
   ArFunctor1<ArRobotPacket *> *myPacketReceivedCallback;
 };
@@ -0,0 +1,107 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARROBOTPACKETRING_H
+#define ARROBOTPACKETRING_H
+
+#ifndef ARIA_WRAPPER
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArRobotPacket.h"
+
+#include <atomic>
+#include <vector>
+
+/// Bounded queue of preallocated packets between the packet reader thread and the sync loop
+/**
+   This is a single-producer, single-consumer ring: exactly one thread
+   (the ArRobotPacketReaderThread) may call push(), and exactly one
+   thread (the robot sync loop) may call front() and pop().  Neither
+   side takes a lock or allocates memory; packets are copied into
+   slots that are allocated once when the ring is constructed.
+
+   The ring also keeps count of how many SIPs are queued, so the sync
+   loop can tell whether another SIP is waiting behind the one it's
+   handling without walking the queue.
+
+   If the sync loop falls behind and the ring fills up, new packets are
+   dropped (and counted, see getNumOverflows()) rather than blocking
+   the reader.
+
+   @internal
+**/
+class ArRobotPacketRing
+{
+public:
+  /// Constructor
+  AREXPORT explicit ArRobotPacketRing(size_t capacity = 128,
+				      unsigned char sync1 = 0xfa, 
+				      unsigned char sync2 = 0xfb);
+  ArRobotPacketRing(const ArRobotPacketRing &) = delete;
+  ArRobotPacketRing &operator=(const ArRobotPacketRing &) = delete;
+
+  /// Copies a packet into the ring (reader thread only)
+  AREXPORT bool push(const ArRobotPacket *packet);
+  /// Gets the oldest packet in the ring, or NULL if it's empty (sync loop only)
+  AREXPORT ArRobotPacket *front();
+  /// Removes the packet returned by front() (sync loop only)
+  AREXPORT void pop();
+  /// Removes all the packets in the ring (sync loop only)
+  AREXPORT void clear();
+
+  /// Gets the number of SIPs in the ring (including the one at the front)
+  int getNumPendingSips() const 
+    { return myPendingSips.load(std::memory_order_acquire); }
+  /// Gets the number of packets in the ring
+  AREXPORT size_t size() const;
+  /// Gets the maximum number of packets the ring will hold
+  size_t getCapacity() const { return mySlots.size() - 1; }
+
+  /// Gets how many packets have been dropped because the ring was full
+  unsigned long getNumOverflows() const 
+    { return myNumOverflows.load(std::memory_order_relaxed); }
+  /// Gets how many packets have been put in the ring
+  unsigned long getNumPushed() const
+    { return myNumPushed.load(std::memory_order_relaxed); }
+  /// Gets the most packets that have been in the ring at once
+  size_t getMaxDepth() const 
+    { return myMaxDepth.load(std::memory_order_relaxed); }
+  /// Resets the overflow and depth statistics
+  AREXPORT void resetStats();
+
+  /// Returns true if the packet is a SIP (type 0x3X)
+  static bool isSip(const ArRobotPacket *packet)
+    { return (packet->getID() & 0xf0) == 0x30; }
+protected:
+  // one slot is always left empty to tell full from empty
+  std::vector<ArRobotPacket> mySlots;
+  std::atomic<size_t> myHead; ///< next slot to pop, written by the consumer
+  std::atomic<size_t> myTail; ///< next slot to push, written by the producer
+  std::atomic<int> myPendingSips;
+  std::atomic<unsigned long> myNumOverflows;
+  std::atomic<unsigned long> myNumPushed;
+  std::atomic<size_t> myMaxDepth;
+};
+
+#endif // not ARIA_WRAPPER
+#endif // ARROBOTPACKETRING_H
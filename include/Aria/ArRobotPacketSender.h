@@ -29,12 +29,22 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArRobotPacket.h"
-
+#include <atomic>
+#include <vector>
 
 class ArDeviceConnection;
 
-/// Given a device connection this sends commands through it to the robot
-/// @internal
+/**
+   Given a device connection this sends commands through it to the robot
+
+   Normally each command is written to the device connection as soon as it
+   is sent.  Between startBatch() and flushBatch() the finalized packets are
+   instead appended (in the order they were sent, from whatever thread) to a
+   staging buffer, and flushBatch() writes them all out with a single
+   write(). ArRobot does this around ArRobot::stateReflector() so that all of
+   the motion commands for a cycle cost one write to the robot.
+   @internal
+**/
 class ArRobotPacketSender
 {
 public:
@@ -68,6 +78,20 @@ public:
   /// Sends a ArRobotPacket
   AREXPORT bool sendPacket(ArRobotPacket *packet);
   
+  /// Starts collecting commands instead of writing each one as it is sent
+  AREXPORT void startBatch();
+  /// Writes all commands collected since startBatch() and stops batching
+  AREXPORT bool flushBatch();
+  /// Gets if commands are currently being collected for a batch
+  bool isBatching() const { return myBatching; }
+  /// Gets the number of batches that have been written
+  unsigned long getNumBatchesFlushed() const { return myNumBatchesFlushed; }
+  /// Gets the number of commands that went out in batches
+  unsigned long getNumBatchedCommands() const { return myNumBatchedCommands; }
+  /// Gets the number of packets that have been written to the device (batched or not)
+  unsigned long getNumPacketsWritten() const 
+    { return myNumPacketsWritten.load(std::memory_order_relaxed); }
+
   /// Sets the device this instance sends commands to
   AREXPORT void setDeviceConnection(ArDeviceConnection *deviceConnection);
   /// Gets the device this instance sends commands to
@@ -95,6 +119,7 @@ public:
   }
 protected:
   bool connValid();
+  bool writePacket(ArRobotPacket *packet);
   ArDeviceConnection * myDeviceConn;
   ArRobotPacket myPacket;
 
@@ -103,6 +128,13 @@ protected:
 
   ArMutex mySendingMutex;
 
+  bool myBatching;
+  std::vector<char> myBatchBuf;
+  unsigned long myBatchCount;
+  unsigned long myNumBatchesFlushed;
+  unsigned long myNumBatchedCommands;
+  std::atomic<unsigned long> myNumPacketsWritten;
+
   ArFunctor1<ArRobotPacket *> *myPacketSentCallback;
   ArFunctor2<unsigned char, short int> *myCommandMonitorCB;
 
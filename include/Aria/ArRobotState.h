@@ -0,0 +1,157 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARROBOTSTATE_H
+#define ARROBOTSTATE_H
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ariaUtil.h"
+
+class ArRobot;
+
+/// Copy of the robot's state as of the last SIP, from ArRobot::getStateSnapshot()
+/**
+   ArRobot fills in one of these at the end of handling each SIP (and when
+   its pose is moved with ArRobot::moveTo() or a new encoder transform).
+   Any thread can get a copy with ArRobot::getStateSnapshot() without
+   locking the robot, so it never waits on (or holds up) the robot cycle,
+   and all of the values in a copy came from the same SIP.
+
+   The accessors mean the same as the ArRobot ones of the same name.
+
+   @ingroup OptionalClasses
+**/
+class ArRobotState
+{
+public:
+  enum {
+    MAX_SONAR = 64 ///< Most sonar ranges kept (higher numbered sonar are left out)
+  };
+  /// Constructor
+  ArRobotState() :
+    myVel(0), myRotVel(0), myLatVel(0), myLeftVel(0), myRightVel(0),
+    myStallValue(0), myFlags(0), myFaultFlags(0),
+    myBatteryVoltage(0), myRealBatteryVoltage(0), myStateOfCharge(0),
+    myAnalogPortSelected(0), myAnalog(0), myDigIn(0), myDigOut(0),
+    myNumSonar(0), myCount(0)
+    {
+      for (int i = 0; i < MAX_SONAR; i++)
+	mySonarRanges[i] = -1;
+    }
+
+  /// Gets the global position of the robot
+  ArPose getPose() const { return myPose; }
+  /// Gets the global X position of the robot
+  double getX() const { return myPose.getX(); }
+  /// Gets the global Y position of the robot
+  double getY() const { return myPose.getY(); }
+  /// Gets the global heading of the robot
+  double getTh() const { return myPose.getTh(); }
+  /// Gets the encoder position of the robot
+  ArPose getEncoderPose() const { return myEncoderPose; }
+  /// Gets when the SIP the state came from was received
+  ArTime getTime() const { return myTime; }
+
+  /// Gets the translational velocity of the robot
+  double getVel() const { return myVel; }
+  /// Gets the rotational velocity of the robot
+  double getRotVel() const { return myRotVel; }
+  /// Gets the lateral velocity of the robot
+  double getLatVel() const { return myLatVel; }
+  /// Gets the velocity of the left wheel
+  double getLeftVel() const { return myLeftVel; }
+  /// Gets the velocity of the right wheel
+  double getRightVel() const { return myRightVel; }
+
+  /// Gets the 2 bytes of stall and bumper flags from the robot
+  int getStallValue() const { return myStallValue; }
+  /// Returns true if the left motor is stalled
+  bool isLeftMotorStalled() const
+    { return (myStallValue & 0xff) & ArUtil::BIT0; }
+  /// Returns true if the right motor is stalled
+  bool isRightMotorStalled() const
+    { return ((myStallValue & 0xff00) >> 8) & ArUtil::BIT0; }
+  /// Gets the flags values
+  int getFlags() const { return myFlags; }
+  /// Gets the fault flags values
+  int getFaultFlags() const { return myFaultFlags; }
+  /// returns true if the motors are enabled
+  bool areMotorsEnabled() const { return (myFlags & ArUtil::BIT0); }
+  /// returns true if the estop is pressed (or unrelieved)
+  bool isEStopPressed() const { return (myFlags & ArUtil::BIT5); }
+
+  /// Gets the battery voltage of the robot (normalized to 12 volt system)
+  double getBatteryVoltage() const { return myBatteryVoltage; }
+  /// Gets the real battery voltage of the robot
+  double getRealBatteryVoltage() const { return myRealBatteryVoltage; }
+  /// Gets the state of charge (percent of charge, as number between 0 and 100)
+  double getStateOfCharge() const { return myStateOfCharge; }
+
+  /// Gets which analog port is selected
+  int getAnalogPortSelected() const { return myAnalogPortSelected; }
+  /// Gets the analog value
+  unsigned char getAnalog() const { return myAnalog; }
+  /// Gets the byte representing digital input status
+  unsigned char getDigIn() const { return myDigIn; }
+  /// Gets the byte representing digital output status
+  unsigned char getDigOut() const { return myDigOut; }
+
+  /// Gets the number of sonar ranges kept
+  int getNumSonar() const { return myNumSonar; }
+  /// Gets the range of a sonar (-1 if there's no such sonar)
+  int getSonarRange(int num) const
+    {
+      if (num < 0 || num >= myNumSonar)
+	return -1;
+      return mySonarRanges[num];
+    }
+
+  /// Gets how many times the state has been published (so readers can tell a new one)
+  unsigned long getCount() const { return myCount; }
+protected:
+  friend class ArRobot;
+
+  ArPose myPose;
+  ArPose myEncoderPose;
+  ArTime myTime;
+  double myVel;
+  double myRotVel;
+  double myLatVel;
+  double myLeftVel;
+  double myRightVel;
+  int myStallValue;
+  int myFlags;
+  int myFaultFlags;
+  double myBatteryVoltage;
+  double myRealBatteryVoltage;
+  double myStateOfCharge;
+  int myAnalogPortSelected;
+  unsigned char myAnalog;
+  unsigned char myDigIn;
+  unsigned char myDigOut;
+  int myNumSonar;
+  int mySonarRanges[MAX_SONAR];
+  unsigned long myCount;
+};
+
+#endif // ARROBOTSTATE_H
@@ -28,6 +28,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaOSDef.h"
 #include "Aria/ArRobotPacket.h"
 #include "Aria/ArLaser.h"   
+#include "Aria/ArLaserRawReadings.h"
 #include "Aria/ArFunctor.h"
 
 #ifndef ARIA_WRAPPER
@@ -245,6 +246,8 @@ protected:
   bool myStartConnect;
 
   int myNumChans;
+  // the raw readings, myRawReadings is its list
+  ArLaserRawReadings myLaserReadings;
 
 	bool myIsMonitoringDataAvailable;
 	int myMonitoringData;
@@ -223,6 +223,43 @@ coordinate system.
 			bool ignoreThisReading = false,
 			int extraInt = 0);
 
+  /// Update data with the reading already projected
+  /**
+     Like newData(), but for a range device that worked out where the
+     reading is (local and global) for many readings at once (see
+     ArLaserRawReadings).
+     @param range Sensed distance
+     @param localX the x of the reading on the robot (mm)
+     @param localY the y of the reading on the robot (mm)
+     @param x the x of the reading in global coordinates (mm)
+     @param y the y of the reading in global coordinates (mm)
+     @param th the heading of @a trans, which the reading pose gets
+     (as newData() would give it)
+     @param robotPose Robot position in global coordinates space when the sensor data was received.
+     @param encoderPose Robot encoder-only position in global coordinate space when the sensor data was received.
+     @param counter an incrementing counter used to check for updated data
+     @param timeTaken System time when this measurement was taken or received.
+     @param ignoreThisReading Set the "ignore" flag for this reading.
+     @param extraInt extra device-specific data. @see getExtraInt()
+  **/
+  void newProjectedData(unsigned int range, double localX, double localY,
+			double x, double y, double th,
+			const ArPose& robotPose, const ArPose& encoderPose,
+			unsigned int counter, const ArTime& timeTaken,
+			bool ignoreThisReading = false, int extraInt = 0)
+  {
+    myRange = range;
+    myCounterTaken = counter;
+    myReadingTaken = robotPose;
+    myEncoderPoseTaken = encoderPose;
+    myLocalReading.setPose(localX, localY);
+    myReading.setPose(x, y, th);
+    myTimeTaken = timeTaken;
+    myIgnoreThisReading = ignoreThisReading;
+    myExtraInt = extraInt;
+    myAdjusted = false;
+  }
+
   /// Resets the sensors idea of its physical location on the robot
   AREXPORT void resetSensorPosition(double xPos, double yPos, double thPos,
 				    bool forceComputation = false);
@@ -0,0 +1,104 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARSEQLOCK_H
+#define ARSEQLOCK_H
+
+#ifndef ARIA_WRAPPER
+
+#include <atomic>
+#include <cstring>
+#include <type_traits>
+
+/// Holds a copy of a value that one thread updates and any thread can read without locking
+/**
+   write() never waits for readers, and read() never blocks the writer; a
+   reader that overlaps a write just copies the value again.  Writers have
+   to be kept from overlapping each other by the caller (ArRobot only
+   writes while it's locked).
+
+   The value is kept as an array of atomic words, so a reader racing a
+   writer reads torn words rather than undefined behaviour, and the
+   sequence count tells it to throw them away.  @a T must be trivially
+   copyable.
+
+   @internal
+**/
+template<class T>
+class ArSeqLock
+{
+  static_assert(std::is_trivially_copyable<T>::value,
+		"ArSeqLock can only hold trivially copyable types");
+public:
+  /// Constructor
+  ArSeqLock() : mySeq(0) { write(T()); }
+  /// Constructor, with the first value
+  explicit ArSeqLock(const T &value) : mySeq(0) { write(value); }
+  ArSeqLock(const ArSeqLock &) = delete;
+  ArSeqLock &operator=(const ArSeqLock &) = delete;
+
+  /// Replaces the value (only one thread at a time)
+  void write(const T &value)
+    {
+      unsigned long long words[NUM_WORDS] = { 0 };
+      memcpy(words, &value, sizeof(T));
+      const unsigned long seq = mySeq.load(std::memory_order_relaxed);
+      // an odd count means a write is under way
+      mySeq.store(seq + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+      for (size_t i = 0; i < NUM_WORDS; i++)
+	myWords[i].store(words[i], std::memory_order_relaxed);
+      mySeq.store(seq + 2, std::memory_order_release);
+    }
+
+  /// Gets a consistent copy of the value (from any thread)
+  T read() const
+    {
+      unsigned long long words[NUM_WORDS];
+      unsigned long before, after;
+      do
+      {
+	before = mySeq.load(std::memory_order_acquire);
+	for (size_t i = 0; i < NUM_WORDS; i++)
+	  words[i] = myWords[i].load(std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_acquire);
+	after = mySeq.load(std::memory_order_relaxed);
+      } while ((before & 1) != 0 || before != after);
+      T value;
+      memcpy(&value, words, sizeof(T));
+      return value;
+    }
+
+  /// Gets the number of times write() has been called
+  unsigned long getNumWrites() const
+    { return mySeq.load(std::memory_order_acquire) / 2 - 1; }
+protected:
+  enum { NUM_WORDS =
+	 (sizeof(T) + sizeof(unsigned long long) - 1) /
+	 sizeof(unsigned long long) };
+  std::atomic<unsigned long> mySeq;
+  std::atomic<unsigned long long> myWords[NUM_WORDS];
+};
+
+#endif // not ARIA_WRAPPER
+#endif // ARSEQLOCK_H
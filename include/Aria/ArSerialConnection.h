@@ -104,6 +104,7 @@ class ArSerialConnection: public ArDeviceConnection
   };
   AREXPORT virtual ArTime getTimeRead(int index);
   AREXPORT virtual bool isTimeStamping();
+  AREXPORT virtual int getPollFD() override;
 
  protected:
   void buildStrMap();
@@ -30,6 +30,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArRobot.h"
 #include "Aria/ArRobotPacket.h"
 
+class ArDeviceReactor;
 
 
 // Packets are in the format of 
@@ -156,6 +157,11 @@ public:
 	/// Connect used for debug replay
   AREXPORT virtual bool fakeConnect();
   AREXPORT virtual bool disconnect();
+  /// Reads the sonar from @a reactor's thread instead of its own thread
+  /// (must be called before connecting)
+  void setDeviceReactor(ArDeviceReactor *reactor) { myReactor = reactor; }
+  /// Gets the reactor the sonar is read from (NULL if it has its own thread)
+  ArDeviceReactor *getDeviceReactor() { return myReactor; }
   virtual bool isConnected() { return myIsConnected; }
 	virtual bool isTryingToConnect ()
 	{
@@ -491,6 +497,8 @@ protected:
 
   AREXPORT virtual void sonarSetName(const char *name);
   AREXPORT virtual void * runThread(void *arg);
+  void startReading();
+  void reactorRead();
 	
   void sensorInterp();
   void failedToConnect();
@@ -592,6 +600,8 @@ enum Commands {
   ArFunctorC<ArSonarMTX> mySensorInterpTask;
   ArRetFunctorC<bool, ArSonarMTX> myAriaExitCB;
 
+  ArDeviceReactor *myReactor;
+  ArFunctorC<ArSonarMTX> myReactorReadCB;
 };
 
 
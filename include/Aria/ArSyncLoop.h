@@ -28,6 +28,10 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArASyncTask.h"
 #include "Aria/ArSyncTask.h"
+#include "Aria/ArLog.h"
+#include "Aria/ArLogThrottle.h"
+
+#include <atomic>
 
 
 class ArRobot;
@@ -47,12 +51,74 @@ public:
 
   AREXPORT virtual std::string getThreadActivity() override;
 
+  /// Sets if the loop wakes up at absolute deadlines (see ArRobot::setCycleRealTime())
+  AREXPORT void setRealTime(bool realTime);
+  /// Gets if the loop wakes up at absolute deadlines
+  bool getRealTime() const { return myRealTime; }
+  /// Sets the SCHED_FIFO priority for the loop's thread (0 to leave the scheduling alone)
+  AREXPORT void setRealTimePriority(int priority);
+  /// Gets the SCHED_FIFO priority for the loop's thread (0 if not set)
+  int getRealTimePriority() const { return myRealTimePriority; }
+  /// Sets the CPU the loop's thread is pinned to (-1 to let it run on any)
+  AREXPORT void setCpuAffinity(int cpu);
+  /// Gets the CPU the loop's thread is pinned to (-1 if any)
+  int getCpuAffinity() const { return myCpuAffinity; }
+  /// Sets if the process's memory is locked (mlockall()) when the loop starts
+  AREXPORT void setLockMemory(bool lockMemory);
+  /// Gets if the process's memory is locked when the loop starts
+  bool getLockMemory() const { return myLockMemory; }
+
+  /// Gets the number of cycles run since the statistics were reset
+  unsigned long long getNumCycles() const { return myNumCycles.load(); }
+  /// Gets the number of cycles whose tasks ran past the end of the cycle
+  unsigned long long getNumOverruns() const { return myNumOverruns.load(); }
+  /// Gets the longest a cycle has run past the end of the cycle (in microseconds)
+  long long getMaxOverrunUSec() const { return myMaxOverrunUSec.load(); }
+  /// Gets the largest difference between a cycle's period and the cycle time (in microseconds)
+  long long getMaxPeriodErrorUSec() const { return myMaxPeriodErrorUSec.load(); }
+  /// Gets the mean difference between the cycles' periods and the cycle time (in microseconds)
+  AREXPORT double getMeanPeriodErrorUSec() const;
+  /// Gets the latest the loop has woken up after a deadline (in microseconds, real-time mode only)
+  long long getMaxWakeLatenessUSec() const { return myMaxWakeLatenessUSec.load(); }
+  /// Resets the cycle statistics
+  AREXPORT void resetStats();
+  /// Logs the cycle statistics
+  AREXPORT void logStats(ArLog::LogLevel level = ArLog::Normal) const;
 
 protected:
+  /// Sets up the calling thread's priority, affinity and memory locking
+  void applyThreadSettings();
+  /// Counts a cycle in the statistics
+  void addCycleStats(long long periodUSec, long long overrunUSec,
+		     long long wakeLatenessUSec);
+
   bool myStopRunIfNotConnected;
   ArRobot *myRobot;
   bool myInRun;
 
+  std::atomic<bool> myRealTime;
+  std::atomic<int> myRealTimePriority;
+  std::atomic<int> myCpuAffinity;
+  std::atomic<bool> myLockMemory;
+  /// Set when the settings above change, so the loop applies them next cycle
+  std::atomic<bool> myThreadSettingsChanged;
+  // what applyThreadSettings() has done to the thread (only used by it)
+  bool myPriorityApplied;
+  bool myAffinityApplied;
+  bool myMemoryLocked;
+
+  std::atomic<unsigned long long> myNumCycles;
+  std::atomic<unsigned long long> myNumPeriods;
+  std::atomic<unsigned long long> myNumOverruns;
+  std::atomic<long long> myMaxOverrunUSec;
+  std::atomic<long long> myMaxPeriodErrorUSec;
+  std::atomic<long long> myTotalPeriodErrorUSec;
+  std::atomic<long long> myMaxWakeLatenessUSec;
+
+  // so a robot that's always late doesn't log it every cycle
+  ArLogThrottle myLockWaitLogThrottle;
+  ArLogThrottle myTasksLogThrottle;
+
 };
 
 
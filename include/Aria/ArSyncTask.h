@@ -31,10 +31,17 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
 #include <string>
 #include <map>
+#include <list>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArFunctor.h"
 #include "Aria/ArTaskState.h"
+#include "Aria/ArTimeHistogram.h"
 
+class ArSyncTaskWorkers;
 
 /// Class used internally to manage the tasks that are called every cycle
 /**
@@ -76,6 +83,26 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
    The state of a task can be stored in the target of a given ArTaskState::State pointer,
    or if NULL than ArSyncTask will use its own member variable.
 
+   So that run() doesn't have to walk the tree every cycle, the node it
+   is called on flattens its part of the tree into a list of the tasks
+   in the order they run (its plan), and only does that again when
+   tasks are added or removed.  Each task keeps a histogram of how long
+   its functor took to run, which log() can print.
+
+   Leaves can be marked concurrent with setConcurrent().  Concurrent
+   leaves that are next to each other in their parent's list make up a
+   group, and if the node run() is called on has worker threads (see
+   setNumWorkers()) the tasks in a group are run at the same time on
+   them and the thread calling run(), which then waits for the whole
+   group to finish before going on to the next task.  A task in a group
+   can be made to wait for others in the group with addDependency();
+   the group is run in an order that puts each task after the ones it
+   depends on, even if their positions say otherwise.  Without worker
+   threads the tasks are run one at a time in that order.  Concurrent
+   tasks must not add or remove tasks, and they run while the thread
+   calling run() is waiting for them, so anything it has locked stays
+   locked (e.g. the ArRobot, for sensor interpretation tasks).
+
   @internal
   @swigomit
 */
@@ -93,7 +120,25 @@ public:
   /// Runs the node, which runs all children of this node as well
   AREXPORT void run();
   /// Prints the node, which prints all the children of this node as well
-  AREXPORT void log(int depth = 0);
+  AREXPORT void log(int depth = 0, bool runTimes = false);
+
+  /// Gets how long this task's functor took to run (in microseconds)
+  const ArTimeHistogram *getRunTimes() const { return &myRunTimes; }
+  /// Empties the run times of this task and all its children
+  AREXPORT void resetRunTimes();
+
+  /// Sets if this leaf can run at the same time as the concurrent leaves next to it
+  AREXPORT void setConcurrent(bool concurrent);
+  /// Gets if this leaf can run at the same time as the concurrent leaves next to it
+  bool isConcurrent() const { return myConcurrent; }
+  /// Makes this task wait for the task named @a name (in the same list) to run first
+  AREXPORT void addDependency(const char *name);
+  /// Stops this task waiting for the task named @a name
+  AREXPORT void remDependency(const char *name);
+  /// Sets how many threads (besides the one calling run()) run concurrent tasks
+  AREXPORT void setNumWorkers(unsigned int numWorkers);
+  /// Gets how many threads (besides the one calling run()) run concurrent tasks
+  AREXPORT unsigned int getNumWorkers() const;
 
   /// Gets the state of the task
   AREXPORT ArTaskState::State getState();
@@ -158,6 +203,60 @@ protected:
   bool myRunning;
   // this is just a pointer to what we're invoking so we can know later
   ArSyncTask *myInvokingOtherFunctor;
+
+  /// A task in the plan, in the order run() goes through them
+  struct PlanEntry
+  {
+    ArSyncTask *myTask;
+    ArFunctor *myFunctor;
+    /// Where the task's state is kept (see getState())
+    ArTaskState::State *myState;
+    /// Index just past the task's children, to skip them if it isn't running
+    size_t myEnd;
+    /// Index just past the group this task starts, if it starts one (else 0)
+    size_t myGroupEnd;
+    /// The indices of the tasks this one waits for are in myPlanDeps[myDepsBegin, myDepsEnd)
+    size_t myDepsBegin;
+    size_t myDepsEnd;
+  };
+  /// Marks this node's plan and the plans of all its parents out of date
+  void invalidatePlan();
+  /// Flattens this node and its children into myPlan
+  void compilePlan();
+  /// Adds @a task and its children to the end of myPlan
+  void addToPlan(ArSyncTask *task);
+  /// Adds a group of concurrent leaves to the end of myPlan, ordered by their dependencies
+  void addGroupToPlan(const std::vector<ArSyncTask *> &group);
+  /// Recompiles the plan after a task changed the tree partway through run()
+  size_t replan(size_t index, long long tookUSec);
+  /// Finds where to carry on in the new plan, from index @a next in @a oldPlan on
+  size_t findInPlan(const std::vector<PlanEntry> &oldPlan, size_t next);
+  /// Runs a task from the plan and counts how long it took (if it still exists)
+  long long runPlanTask(size_t index, long warningTime);
+  /// Runs the group of concurrent tasks in myPlan[first, end)
+  void runGroup(size_t first, size_t end, long warningTime);
+  friend class ArSyncTaskWorkers;
+  /// Runs tasks from the current group until there are none left (from any thread)
+  void runGroupTasks();
+
+  std::vector<PlanEntry> myPlan;
+  std::atomic<bool> myPlanDirty;
+  ArTimeHistogram myRunTimes;
+
+  bool myConcurrent;
+  std::list<std::string> myDependencies;
+
+  ArSyncTaskWorkers *myWorkers;
+  std::vector<size_t> myPlanDeps;
+  /// Which tasks in the group being run are done
+  std::vector<std::atomic<bool> > myPlanDone;
+  /// The next task in the group being run for a thread to take
+  std::atomic<size_t> myGroupNext;
+  size_t myGroupEnd;
+  long myGroupWarningTime;
+  /// Lets tasks in a group wait for the ones they depend on
+  std::mutex myGroupMutex;
+  std::condition_variable myGroupCond;
 };
 
 
@@ -29,6 +29,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArSocket.h"
+#include "Aria/ArLogThrottle.h"
 
 /// For connecting to a device through a TCP network socket
 /// @ingroup UtilityClasses
@@ -56,6 +57,7 @@ class ArTcpConnection: public ArDeviceConnection
   AREXPORT virtual const char * getOpenMessage(int messageNumber);
   AREXPORT virtual ArTime getTimeRead(int index);
   AREXPORT virtual bool isTimeStamping();
+  AREXPORT virtual int getPollFD() override;
 
   /// Gets the name of the host connected to
   AREXPORT std::string getHost();
@@ -93,6 +95,9 @@ protected:
   std::string myHostName;
   int myPortNum;
   ArTime myTimeRead;
+  // read() and write() can be called over and over on a dead connection
+  ArLogThrottle myReadLogThrottle;
+  ArLogThrottle myWriteLogThrottle;
 };
 
 #endif //ARTCPCONNECTION_H
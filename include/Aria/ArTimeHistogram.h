@@ -0,0 +1,99 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#ifndef ARTIMEHISTOGRAM_H
+#define ARTIMEHISTOGRAM_H
+
+#ifndef ARIA_WRAPPER
+
+#include "Aria/ariaTypedefs.h"
+#include "Aria/ArLog.h"
+
+#include <atomic>
+
+/// Histogram of times in fixed, power-of-two millisecond buckets
+/**
+   Bucket 0 counts times of 0 ms, bucket 1 counts 1 ms, and each bucket
+   after that counts twice the range of the one before it (bucket @a b
+   counts times from 2^(b-1) up to 2^b - 1 ms), except the last bucket,
+   which counts everything from getBucketLow(NUM_BUCKETS - 1) ms on up.
+   
+   The buckets are atomic counters, so add() is cheap and can be called
+   from one thread while another thread reads or resets the histogram.
+   A reader may see a histogram that is partway through an add() (e.g.
+   the bucket counted but not the total), which is fine for monitoring.
+
+   Nothing but log() cares what unit the times are in, so it can also
+   count times in other units (ArSyncTask counts microseconds).
+
+   @internal
+**/
+class ArTimeHistogram
+{
+public:
+  enum { NUM_BUCKETS = 16 };
+  /// Constructor
+  AREXPORT ArTimeHistogram();
+  ArTimeHistogram(const ArTimeHistogram &) = delete;
+  ArTimeHistogram &operator=(const ArTimeHistogram &) = delete;
+
+  /// Counts a time (in ms, negative times count as 0)
+  AREXPORT void add(long long ms);
+  /// Sets all the counts back to 0
+  AREXPORT void reset();
+
+  /// Gets the number of times counted in bucket @a bucket
+  unsigned long long getCount(int bucket) const
+    { return (bucket < 0 || bucket >= NUM_BUCKETS) ? 0 : 
+	myCounts[bucket].load(std::memory_order_relaxed); }
+  /// Gets the number of times counted in all the buckets
+  unsigned long long getTotalCount() const 
+    { return myTotalCount.load(std::memory_order_relaxed); }
+  /// Gets the largest time counted
+  long long getMax() const { return myMax.load(std::memory_order_relaxed); }
+  /// Gets the smallest time counted (0 if nothing has been counted)
+  long long getMin() const { return myMin.load(std::memory_order_relaxed); }
+  /// Gets the mean of the times counted
+  AREXPORT double getMean() const;
+  /// Gets (an upper bound on) the time that @a percent percent of the times were at or under
+  AREXPORT long long getPercentile(double percent) const;
+
+  /// Gets the smallest time that goes in bucket @a bucket
+  AREXPORT static long long getBucketLow(int bucket);
+  /// Gets the largest time that goes in bucket @a bucket (-1 for no limit)
+  AREXPORT static long long getBucketHigh(int bucket);
+  /// Gets the bucket a time goes in
+  AREXPORT static int getBucket(long long ms);
+
+  /// Logs the nonempty buckets, mean, 50th/99th percentile and max
+  AREXPORT void log(const char *name, ArLog::LogLevel level = ArLog::Normal) const;
+protected:
+  std::atomic<unsigned long long> myCounts[NUM_BUCKETS];
+  std::atomic<unsigned long long> myTotalCount;
+  std::atomic<long long> mySum;
+  std::atomic<long long> myMax;
+  std::atomic<long long> myMin;
+};
+
+#endif // not ARIA_WRAPPER
+#endif // ARTIMEHISTOGRAM_H
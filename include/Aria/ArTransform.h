@@ -162,6 +162,10 @@ public:
   double getY() const { return myY; }
   /// Gets the transform angle value (degrees)
   double getTh()const  { return myTh; }
+  /// Gets the cosine that doTransform() multiplies by
+  double getCos() const { return myCos; }
+  /// Gets the sine that doTransform() multiplies by
+  double getSin() const { return mySin; }
   /// Internal function for setting the transform from low level data not poses
   AREXPORT void setTransformLowLevel(double x, double y, double th);
 protected:
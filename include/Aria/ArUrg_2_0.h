@@ -26,6 +26,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArLaser.h"
+#include "Aria/ArLaserRawReadings.h"
 #include "Aria/ArDeviceConnection.h"
 
 /** 
@@ -111,6 +112,9 @@ protected:
   bool myFlipped;
   char myRequestString[1024];
   double myClusterMiddleAngle;
+  // the raw readings, myRawReadings is its list
+  ArLaserRawReadings myLaserReadings;
+  void setRays();
 
   bool internalConnect();
 
@@ -33,7 +33,9 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaTypedefs.h"
 #include "Aria/ArSerialConnection.h"
 #include "Aria/ArTcpConnection.h"
+#include "Aria/ArReplayDeviceConnection.h"
 #include "Aria/ArLog.h"
+#include "Aria/ArLogThrottle.h"
 //#include "Aria/ArRobotPacket.h"
 //#include "Aria/ArRobotPacketSender.h"
 //#include "Aria/ArRobotPacketReceiver.h"
@@ -117,6 +119,8 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 //#include "Aria/ArTCMCompassRobot.h"
 //#include "Aria/ArTCMCompassDirect.h"
 #include "Aria/ArLaserFilter.h"
+#include "Aria/ArLaserFusion.h"
+#include "Aria/ArLocalCostmap.h"
 #include "Aria/ArUrg.h"
 #include "Aria/ArGPS.h"
 #include "Aria/ArTrimbleGPS.h"
@@ -130,6 +134,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArLCDConnector.h"
 #include "Aria/ArSonarMTX.h"
 #include "Aria/ArBatteryMTX.h"
+#include "Aria/ArDeviceReactor.h"
 #include "Aria/ArLCDMTX.h"
 #include "Aria/ArSimulatedLaser.h"
 #include "Aria/ArExitErrorSource.h"
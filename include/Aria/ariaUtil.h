@@ -154,6 +154,8 @@ public:
   
   /// Get the time in milliseconds.
   AREXPORT static unsigned int getTime();
+  /// Get the time in microseconds, for timing things shorter than a millisecond
+  AREXPORT static long long getTimeUSec();
 
 #ifndef ARIA_WRAPPER
 
@@ -1842,7 +1844,7 @@ public:
       // they weren't parallel so see where the intersection is
       if(pose)
       {
-        const double x = ((line.getC() * getB()) - (line.getA() * getC())) / n;
+        const double x = ((line.getC() * getB()) - (line.getB() * getC())) / n;
         const double y = ((getC() * line.getA()) - (getA() * line.getC())) / n;
         pose->setPose(x, y);
       }
@@ -1861,7 +1863,7 @@ public:
       }
       // they weren't parallel so see where the intersection is
       *valid = true;
-      const double x = ((line.getC() * getB()) - (line.getA() * getC())) / n;
+      const double x = ((line.getC() * getB()) - (line.getB() * getC())) / n;
       const double y = ((getC() * line.getA()) - (getA() * line.getC())) / n;
       return ArPose(x, y);
   }
@@ -29,6 +29,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaInternal.h"
 #include "Aria/ArRobotConfigPacketReader.h"
 #include "Aria/ArRangeDevice.h"
+#include "Aria/ArLocalCostmap.h"
 #include <cassert>
 
 /**
@@ -52,6 +53,7 @@ AREXPORT ArActionDeceleratingLimiter::ArActionDeceleratingLimiter(
   myLastStopped = false;
   myUseLocationDependentDevices = true;
   myStopRotationToo = false;
+  myCostmap = NULL;
 
 }
 
@@ -262,76 +264,76 @@ ArActionDeceleratingLimiter::fire(ArActionDesired currentDesired)
   ArPose obstacleInnerPose(-1, -1, -1);
 
   if (myType == FORWARDS)
-    dist = myRobot->checkRangeDevicesCurrentBox(
+    dist = checkBox(
 	    0,
 	    -(myRobot->getRobotWidth()/2.0 + sideClearance),
 	    myRobot->getRobotLength()/2.0 + myClearance + padding + lookAhead,
 	    (myRobot->getRobotWidth()/2.0 + sideClearance),
 	    &obstaclePose,
-	    &distRangeDevice, myUseLocationDependentDevices);
+	    &distRangeDevice);
   else if (myType == BACKWARDS)
-    dist = myRobot->checkRangeDevicesCurrentBox(
+    dist = checkBox(
 	    0,
 	    -(myRobot->getRobotWidth()/2.0 + sideClearance),
 	    -(myRobot->getRobotLength()/2.0 + myClearance + padding + lookAhead),
 	    (myRobot->getRobotWidth()/2.0 + sideClearance),
 	    &obstaclePose,
-	    &distRangeDevice, myUseLocationDependentDevices);
+	    &distRangeDevice);
   //todo
   else if (myType == LATERAL_LEFT)
-    dist = myRobot->checkRangeDevicesCurrentBox(
+    dist = checkBox(
 	    -(myRobot->getRobotLength()/2.0 + sideClearance),
 	    0,
 	    (myRobot->getRobotLength()/2.0 + sideClearance),
 	    myRobot->getRobotWidth()/2.0 + myClearance + padding + lookAhead,
 	    &obstaclePose,
-	    &distRangeDevice, myUseLocationDependentDevices);
+	    &distRangeDevice);
   //todo
   else if (myType == LATERAL_RIGHT)
-    dist = myRobot->checkRangeDevicesCurrentBox(
+    dist = checkBox(
 	    -(myRobot->getRobotLength()/2.0 + sideClearance),
 	    -(myRobot->getRobotWidth()/2.0 + myClearance + padding + lookAhead),  
 	    (myRobot->getRobotLength()/2.0 + sideClearance),
 	    0,
 	    &obstaclePose,
-	    &distRangeDevice, myUseLocationDependentDevices);
+	    &distRangeDevice);
   else
     assert(false);
 
   if (myType == FORWARDS)
-    distInner = myRobot->checkRangeDevicesCurrentBox(
+    distInner = checkBox(
 	    0,
 	    -(myRobot->getRobotWidth()/2.0 + mySideClearanceAtSlowSpeed),
 	    myRobot->getRobotLength()/2.0 + myClearance + lookAhead,
 	    (myRobot->getRobotWidth()/2.0 + mySideClearanceAtSlowSpeed),
 	    &obstacleInnerPose,
-	    &distInnerRangeDevice, myUseLocationDependentDevices);
+	    &distInnerRangeDevice);
   else if (myType == BACKWARDS)
-    distInner = myRobot->checkRangeDevicesCurrentBox(
+    distInner = checkBox(
 	    0,
 	    -(myRobot->getRobotWidth()/2.0 + mySideClearanceAtSlowSpeed),
 	    -(myRobot->getRobotLength()/2.0 + myClearance + lookAhead),
 	    (myRobot->getRobotWidth()/2.0 + mySideClearanceAtSlowSpeed),
 	    &obstacleInnerPose,
-	    &distInnerRangeDevice, myUseLocationDependentDevices);
+	    &distInnerRangeDevice);
   // todo
   else if (myType == LATERAL_LEFT)
-    distInner = myRobot->checkRangeDevicesCurrentBox(
+    distInner = checkBox(
 	    -(myRobot->getRobotLength()/2.0 + mySideClearanceAtSlowSpeed),
 	    0,
 	    (myRobot->getRobotLength()/2.0 + mySideClearanceAtSlowSpeed),
 	    myRobot->getRobotWidth()/2.0 + myClearance + lookAhead,
 	    &obstacleInnerPose,
-	    &distInnerRangeDevice, myUseLocationDependentDevices);
+	    &distInnerRangeDevice);
   // todo
   else if (myType == LATERAL_RIGHT)
-    distInner = myRobot->checkRangeDevicesCurrentBox(
+    distInner = checkBox(
 	    -(myRobot->getRobotLength()/2.0 + mySideClearanceAtSlowSpeed),
 	    -(myRobot->getRobotWidth()/2.0 + myClearance + lookAhead),
 	    (myRobot->getRobotLength()/2.0 + mySideClearanceAtSlowSpeed),
 	    0,
 	    &obstacleInnerPose,
-	    &distInnerRangeDevice, myUseLocationDependentDevices);
+	    &distInnerRangeDevice);
   else 
     assert(false);
 
@@ -549,5 +551,19 @@ ArActionDeceleratingLimiter::fire(ArActionDesired currentDesired)
   return &myDesired;
 }
 
+double ArActionDeceleratingLimiter::checkBox(double x1, double y1, 
+					     double x2, double y2,
+					     ArPose *readingPos,
+					     const ArRangeDevice **rangeDevice)
+{
+  if (myCostmap == NULL)
+    return myRobot->checkRangeDevicesCurrentBox(
+	    x1, y1, x2, y2, readingPos, rangeDevice, 
+	    myUseLocationDependentDevices);
+  return myCostmap->checkRangeDevicesCurrentBox(
+	  x1, y1, x2, y2, readingPos, rangeDevice, 
+	  myUseLocationDependentDevices);
+}
+
 
 
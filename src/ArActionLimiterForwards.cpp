@@ -26,6 +26,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArActionLimiterForwards.h"
 #include "Aria/ArRobot.h"
 #include "Aria/ArRangeDevice.h"
+#include "Aria/ArLocalCostmap.h"
 
 /**
    @param name name of the action
@@ -60,6 +61,7 @@ AREXPORT ArActionLimiterForwards::ArActionLimiterForwards(const char *name,
   myWidthRatio = widthRatio;
   myLastStopped = false;
   myLastSensorReadingDev = NULL;
+  myCostmap = NULL;
 }
 
 /* AREXPORT ArActionLimiterForwards::~ArActionLimiterForwards()
@@ -99,7 +101,7 @@ ArActionLimiterForwards::fire(UNUSED ArActionDesired currentDesired)
     checkDist = mySlowDist;
 
   myDesired.reset();
-  dist = myRobot->checkRangeDevicesCurrentBox(
+  dist = checkBox(
         0,
 				-myRobot->getRobotWidth()/2.0 * myWidthRatio,
   			checkDist + myRobot->getRobotLength()/2,
@@ -144,3 +146,15 @@ ArActionLimiterForwards::fire(UNUSED ArActionDesired currentDesired)
   return &myDesired;
   
 }
+
+double ArActionLimiterForwards::checkBox(double x1, double y1, 
+					 double x2, double y2,
+					 ArPose *readingPos,
+					 const ArRangeDevice **rangeDevice)
+{
+  if (myCostmap == NULL)
+    return myRobot->checkRangeDevicesCurrentBox(x1, y1, x2, y2, readingPos,
+						rangeDevice);
+  return myCostmap->checkRangeDevicesCurrentBox(
+	  x1, y1, x2, y2, readingPos, rangeDevice);
+}
@@ -28,6 +28,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 //#include "Aria/ArRobot.h"
 #include "Aria/ariaOSDef.h"
 #include "Aria/ArSerialConnection.h"
+#include "Aria/ArDeviceReactor.h"
 #include "Aria/ariaInternal.h"
 #include <time.h>
 
@@ -48,7 +49,9 @@ AREXPORT ArBatteryMTX::ArBatteryMTX (int batteryBoardNum, const char *name,
 	myName (name),
 	myBoardNum (batteryBoardNum),
 	mySensorInterpTask (this, &ArBatteryMTX::sensorInterp),
-	myAriaExitCB (this, &ArBatteryMTX::disconnect)
+	myAriaExitCB (this, &ArBatteryMTX::disconnect),
+	myReactor (NULL),
+	myReactorReadCB (this, &ArBatteryMTX::reactorRead)
 {
 
 	myInfoLogLevel = ArLog::Normal;
@@ -197,6 +200,8 @@ AREXPORT bool ArBatteryMTX::disconnect ()
 	if (!isConnected())
 		return true;
 	ArLog::log (ArLog::Normal, "%s: Disconnecting", getName());
+  if (myReactor != NULL && myConn != NULL)
+    myReactor->remConnection(myConn);
   if(myConn)
     myConn->close();
 	return true;
@@ -642,10 +647,59 @@ AREXPORT bool ArBatteryMTX::blockingConnect (bool sendTracking, bool recvTrackin
 
   myLastReading.setToNow();
 
-	runAsync();
+	startReading();
 	return true;
 } // end blockingConnect
 
+/**
+   Starts reading packets from the battery, from the reactor if we have one
+   (falling back to our own thread if it can't read our connection), otherwise
+   from our own thread.
+**/
+void ArBatteryMTX::startReading()
+{
+	if (myReactor != NULL) {
+		// the reactor reads whatever's there and calls us, so don't wait
+		// for partial packets
+		myReceiver->setPartialPacketTimeout(0);
+		if (myReactor->addConnection(myConn, &myReactorReadCB, getName()))
+			return;
+		myReceiver->setPartialPacketTimeout(100);
+		ArLog::log (ArLog::Normal,
+		            "%s: Could not be read from %s, using its own thread instead",
+		            getName(), myReactor->getName());
+	}
+	runAsync();
+}
+
+/**
+   Called from the reactor thread when there's new data on our connection
+   (and periodically), does what the loop in runThread() does but only with
+   the packets that have already been read.
+**/
+void ArBatteryMTX::reactorRead()
+{
+	ArRobotPacket *packet;
+
+	while (myIsConnected && (packet = myReceiver->receivePacket (0)) != NULL) {
+		myPacketsMutex.lock();
+		myPackets.push_back (packet);
+		myPacketsMutex.unlock();
+		if (myRobot == NULL)
+			sensorInterp();
+	}
+
+	if (myIsConnected && checkLostConnection() ) {
+		ArLog::log (ArLog::Terse,
+		            "%s::reactorRead()  Lost connection to the MTX battery because of error.  Nothing received for %g seconds (greater than the timeout of %g).", getName(),
+		            (double)myLastReading.mSecSince() / 1000.0,
+		            getConnectionTimeoutSeconds() );
+		myIsConnected = false;
+		myReactor->remConnection(myConn);
+		disconnectOnError();
+	}
+}
+
 AREXPORT const char * ArBatteryMTX::getName () const
 {
 	return myName.c_str();
@@ -0,0 +1,323 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArChecksum.h"
+
+#include <atomic>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARCHECKSUM_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is only used if the processor has it, so it needs the compiler to
+// build just those functions for AVX2 (and to tell us if the processor
+// has it)
+#if defined(ARCHECKSUM_SSE2) && defined(__GNUC__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define ARCHECKSUM_AVX2
+#include <immintrin.h>
+#define ARCHECKSUM_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+/// CRC-16 (CCITT) tables, table k is for a byte followed by k more bytes
+struct ArChecksumCrc16Tables
+{
+  uint16_t t[8][256];
+  ArChecksumCrc16Tables()
+  {
+    for (unsigned int b = 0; b < 256; b++)
+    {
+      uint16_t crc = (uint16_t) (b << 8);
+      for (int i = 0; i < 8; i++)
+	crc = (uint16_t) ((crc & 0x8000) ? ((crc << 1) ^ 0x1021) : (crc << 1));
+      t[0][b] = crc;
+    }
+    for (int k = 1; k < 8; k++)
+      for (unsigned int b = 0; b < 256; b++)
+	t[k][b] = (uint16_t) ((t[k-1][b] << 8) ^ t[0][t[k-1][b] >> 8]);
+  }
+};
+
+static const ArChecksumCrc16Tables &crc16Tables()
+{
+  static const ArChecksumCrc16Tables tables;
+  return tables;
+}
+
+AREXPORT uint16_t ArChecksum::crc16CCITTBytewise(const unsigned char *data,
+						 size_t len, uint16_t crc)
+{
+  const uint16_t *t0 = crc16Tables().t[0];
+  for (size_t i = 0; i < len; i++)
+    crc = (uint16_t) ((crc << 8) ^ t0[(crc >> 8) ^ data[i]]);
+  return crc;
+}
+
+/**
+   This is the CRC the S3 series (with @a crc 0xffff) and SZ series
+   (with @a crc 0) lasers use.  It does 8 bytes per step with
+   slicing-by-8 tables.
+
+   @param data the bytes to compute the CRC of
+   @param len the number of bytes
+   @param crc the initial value (or the CRC of the data before this,
+   to do it in pieces)
+**/
+AREXPORT uint16_t ArChecksum::crc16CCITT(const unsigned char *data, 
+					 size_t len, uint16_t crc)
+{
+  const ArChecksumCrc16Tables &tables = crc16Tables();
+  while (len >= 8)
+  {
+    crc = (uint16_t) (tables.t[7][data[0] ^ (crc >> 8)] ^ 
+		      tables.t[6][data[1] ^ (crc & 0xff)] ^
+		      tables.t[5][data[2]] ^ tables.t[4][data[3]] ^
+		      tables.t[3][data[4]] ^ tables.t[2][data[5]] ^
+		      tables.t[1][data[6]] ^ tables.t[0][data[7]]);
+    data += 8;
+    len -= 8;
+  }
+  return crc16CCITTBytewise(data, len, crc);
+}
+
+/**
+   This CRC mixes in each byte along with the one before it, so it
+   doesn't work a byte at a time from a table, but it is only a shift
+   and a couple XORs per byte anyways.
+**/
+AREXPORT uint16_t ArChecksum::crc16LMS2xx(const unsigned char *data, 
+					  size_t len)
+{
+  uint16_t crc = 0;
+  unsigned char prev = 0;
+  for (size_t i = 0; i < len; i++)
+  {
+    if (crc & 0x8000)
+      crc = (uint16_t) (((crc & 0x7fff) << 1) ^ 0x8005);
+    else
+      crc = (uint16_t) (crc << 1);
+    crc ^= (uint16_t) (data[i] | (prev << 8));
+    prev = data[i];
+  }
+  return crc;
+}
+
+/// Adds the words after the vector part (and an odd byte at the end)
+static uint16_t wordSumBETail(uint16_t sum, const unsigned char *data, 
+			      size_t len)
+{
+  size_t i = 0;
+  for (; i + 1 < len; i += 2)
+    sum = (uint16_t) (sum + ((data[i] << 8) | data[i + 1]));
+  // an odd byte at the end is XORed in rather than added
+  if (i < len)
+    sum ^= data[i];
+  return sum;
+}
+
+static unsigned char xorFoldTail(unsigned char x, const unsigned char *data,
+				 size_t len)
+{
+  for (size_t i = 0; i < len; i++)
+    x ^= data[i];
+  return x;
+}
+
+#ifdef ARCHECKSUM_SSE2
+static uint16_t wordSumBESSE2(const unsigned char *data, size_t len)
+{
+  // each 16 bit lane sums every 8th word, then the lanes are added up,
+  // overflow doesn't matter since it's all mod 2^16
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16)
+  {
+    const __m128i v = _mm_loadu_si128((const __m128i *) (data + i));
+    // swap the bytes in each word to make them big-endian
+    acc = _mm_add_epi16(acc, _mm_or_si128(_mm_slli_epi16(v, 8), 
+					  _mm_srli_epi16(v, 8)));
+  }
+  uint16_t lanes[8];
+  _mm_storeu_si128((__m128i *) lanes, acc);
+  uint16_t sum = 0;
+  for (int j = 0; j < 8; j++)
+    sum = (uint16_t) (sum + lanes[j]);
+  return wordSumBETail(sum, data + i, len - i);
+}
+
+static unsigned char xorFoldSSE2(const unsigned char *data, size_t len)
+{
+  __m128i acc = _mm_setzero_si128();
+  size_t i = 0;
+  for (; i + 16 <= len; i += 16)
+    acc = _mm_xor_si128(acc, 
+			_mm_loadu_si128((const __m128i *) (data + i)));
+  unsigned char lanes[16];
+  _mm_storeu_si128((__m128i *) lanes, acc);
+  return xorFoldTail(xorFoldTail(0, lanes, 16), data + i, len - i);
+}
+#endif // ARCHECKSUM_SSE2
+
+#ifdef ARCHECKSUM_AVX2
+ARCHECKSUM_TARGET_AVX2 
+static uint16_t wordSumBEAVX2(const unsigned char *data, size_t len)
+{
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32)
+  {
+    const __m256i v = _mm256_loadu_si256((const __m256i *) (data + i));
+    acc = _mm256_add_epi16(acc, _mm256_or_si256(_mm256_slli_epi16(v, 8), 
+						_mm256_srli_epi16(v, 8)));
+  }
+  uint16_t lanes[16];
+  _mm256_storeu_si256((__m256i *) lanes, acc);
+  uint16_t sum = 0;
+  for (int j = 0; j < 16; j++)
+    sum = (uint16_t) (sum + lanes[j]);
+  return wordSumBETail(sum, data + i, len - i);
+}
+
+ARCHECKSUM_TARGET_AVX2 
+static unsigned char xorFoldAVX2(const unsigned char *data, size_t len)
+{
+  __m256i acc = _mm256_setzero_si256();
+  size_t i = 0;
+  for (; i + 32 <= len; i += 32)
+    acc = _mm256_xor_si256(acc, 
+			   _mm256_loadu_si256((const __m256i *) (data + i)));
+  unsigned char lanes[32];
+  _mm256_storeu_si256((__m256i *) lanes, acc);
+  return xorFoldTail(xorFoldTail(0, lanes, 32), data + i, len - i);
+}
+#endif // ARCHECKSUM_AVX2
+
+AREXPORT bool ArChecksum::isSupported(Implementation impl)
+{
+  switch (impl)
+  {
+  case SCALAR:
+    return true;
+  case SSE2:
+#ifdef ARCHECKSUM_SSE2
+    return true;
+#else
+    return false;
+#endif
+  case AVX2:
+#ifdef ARCHECKSUM_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+AREXPORT const char *ArChecksum::getImplementationName(Implementation impl)
+{
+  switch (impl)
+  {
+  case SCALAR:
+    return "scalar";
+  case SSE2:
+    return "SSE2";
+  case AVX2:
+    return "AVX2";
+  }
+  return "unknown";
+}
+
+static std::atomic<int> &currentImplementation()
+{
+  // picked the first time it's needed
+  static std::atomic<int> impl(
+	  ArChecksum::isSupported(ArChecksum::AVX2) ? ArChecksum::AVX2 :
+	  ArChecksum::isSupported(ArChecksum::SSE2) ? ArChecksum::SSE2 :
+	  ArChecksum::SCALAR);
+  return impl;
+}
+
+AREXPORT ArChecksum::Implementation ArChecksum::getImplementation()
+{
+  return (Implementation) currentImplementation().load(
+	  std::memory_order_relaxed);
+}
+
+/**
+   @return true if @a impl will be used, false if it isn't supported
+   (and the implementation wasn't changed)
+**/
+AREXPORT bool ArChecksum::setImplementation(Implementation impl)
+{
+  if (!isSupported(impl))
+    return false;
+  currentImplementation().store(impl, std::memory_order_relaxed);
+  return true;
+}
+
+/**
+   This is the checksum on robot packets: the data is taken as
+   big-endian 16 bit words, which are added up (mod 2^16), and if there
+   is an odd byte at the end it is XORed into the low byte of the sum.
+**/
+AREXPORT uint16_t ArChecksum::wordSumBE(const unsigned char *data, 
+					size_t len)
+{
+  switch (getImplementation())
+  {
+#ifdef ARCHECKSUM_AVX2
+  case AVX2:
+    return wordSumBEAVX2(data, len);
+#endif
+#ifdef ARCHECKSUM_SSE2
+  case SSE2:
+    return wordSumBESSE2(data, len);
+#endif
+  default:
+    return wordSumBETail(0, data, len);
+  }
+}
+
+AREXPORT unsigned char ArChecksum::xorFold(const unsigned char *data, 
+					   size_t len)
+{
+  switch (getImplementation())
+  {
+#ifdef ARCHECKSUM_AVX2
+  case AVX2:
+    return xorFoldAVX2(data, len);
+#endif
+#ifdef ARCHECKSUM_SSE2
+  case SSE2:
+    return xorFoldSSE2(data, len);
+#endif
+  default:
+    return xorFoldTail(0, data, len);
+  }
+}
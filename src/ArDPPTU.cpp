@@ -717,7 +717,7 @@ AREXPORT ArBasePacket *ArDPPTU::readPacket()
   for(i = 0;  i < maxbytes; ++i)
   {
     char c = '\0';
-    if(myConn->read(&c, 1, 1) <= 0)
+    if(myConn->readBuffered(&c, 1, 1) <= 0)
       break; // no data, abort read until next robot cycle
 
     //printf("ArDPPTU::read[%d]= %c (0x%x)\n", i, c, c);
@@ -25,10 +25,14 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaOSDef.h"
 #include "Aria/ArDeviceConnection.h"
 
+#include <string.h>
+
 bool ArDeviceConnection::ourStrMapInited = false;
 ArStrMap ArDeviceConnection::ourStrMap;
 bool ArDeviceConnection::ourDCDebugShouldLog = false;
 ArTime ArDeviceConnection::ourDCDebugFirstTime;
+const char ArDeviceConnection::ourCaptureMagic[8] = 
+  { 'A', 'r', 'D', 'e', 'v', 'C', 'a', 'p' };
 
 /**
    Subclasses of this connection type should call setDCPortType in
@@ -51,8 +55,21 @@ ArTime ArDeviceConnection::ourDCDebugFirstTime;
    already there.  Generally this information isn't used or computed,
    unless the global member ArDeviceConnection::debugShouldLog is
    called to turn it on.
+
+   Subclasses that are reopened should call clearReadAhead() when
+   they close, so that stale data from the previous connection isn't
+   handed to the next reader.
 **/
-AREXPORT ArDeviceConnection::ArDeviceConnection()
+AREXPORT ArDeviceConnection::ArDeviceConnection() :
+  myReadAheadBuf(4096),
+  myReadAheadStart(0),
+  myReadAheadEnd(0),
+  myReadAheadConsumed(0),
+  myReadAheadReceived(0),
+  myIOStatsHaveLastPacket(false),
+  myRecording(false),
+  myRecordFile(NULL),
+  myRecordLastMSecs(0)
 {
   if (!ourStrMapInited)
   {
@@ -74,6 +91,7 @@ AREXPORT ArDeviceConnection::ArDeviceConnection()
 AREXPORT ArDeviceConnection::~ArDeviceConnection()
 {
   close();
+  stopRecording();
 }
 
 
@@ -197,3 +215,447 @@ AREXPORT bool ArDeviceConnection::debugShouldLog(bool shouldLog)
   ourDCDebugShouldLog = shouldLog;
   return true;
 }
+
+/**
+   Unlike the debug methods, these are always on, they just bump a few
+   atomic counters (see getIOStats()).  Receivers that frame packets
+   out of the read-ahead buffer should call this while the packet is
+   still at the front of the buffer (before consumeReadAhead()), so
+   the time from its first to its last byte can be worked out from
+   when each part of it was read.  Receivers that have already taken
+   the packet out of the buffer should pass 0 for @a size; then the
+   packet is counted, and the interval since the last packet is taken
+   from the current time, but its span isn't known.
+**/
+AREXPORT void ArDeviceConnection::ioStatsGoodPacket(unsigned int size)
+{
+  ArTime firstByte;
+  long long span = -1;
+  if (size == 0 || size > getReadAheadCount())
+  {
+    firstByte.setToNow();
+  }
+  else
+  {
+    firstByte = getReadAheadTimeRead(0);
+    span = firstByte.mSecSinceLL(getReadAheadTimeRead(size - 1));
+  }
+  myIOStats.addGoodPacket(
+	  span, 
+	  myIOStatsHaveLastPacket ? 
+	  myIOStatsLastPacketTime.mSecSinceLL(firstByte) : -1);
+  myIOStatsLastPacketTime = firstByte;
+  myIOStatsHaveLastPacket = true;
+}
+
+AREXPORT void ArDeviceConnection::ioStatsBadPacket(bool badChecksum)
+{
+  myIOStats.addBadPacket(badChecksum);
+}
+
+AREXPORT void ArDeviceConnection::ioStatsResync(unsigned int bytesSkipped)
+{
+  if (bytesSkipped > 0)
+    myIOStats.addResync(bytesSkipped);
+}
+
+/**
+   Everything that comes in through the read-ahead buffer (which is
+   what all the packet receivers use) is saved, along with the time it
+   was read, so that ArReplayDeviceConnection can play it back later
+   with the same timing, e.g. to run a robot or laser through ArRobot
+   or ArLaser without the hardware.
+
+   The capture file is the 8 characters "ArDevCap", a byte with the
+   format version (1), and then a record for each read: the ms since
+   the previous read (or since recording started), the number of bytes
+   read, and the bytes.  The two numbers are each stored 7 bits per
+   byte, low bits first, with the high bit set on all but the last
+   byte, so most records have only 2 or 3 bytes of overhead.
+
+   @param fileName the file to write the capture to (it is replaced if
+   it exists)
+   @return true if the file could be opened, false otherwise
+**/
+AREXPORT bool ArDeviceConnection::startRecording(const char *fileName)
+{
+  stopRecording();
+  myRecordMutex.lock();
+  myRecordFile = ArUtil::fopen(fileName, "wb");
+  if (myRecordFile == NULL)
+  {
+    ArLog::log(ArLog::Terse, 
+	       "ArDeviceConnection: Could not open %s to record %s %s",
+	       fileName, myDCPortType.c_str(), myDCPortName.c_str());
+    myRecordMutex.unlock();
+    return false;
+  }
+  const char version = CAPTURE_VERSION;
+  fwrite(ourCaptureMagic, 1, sizeof(ourCaptureMagic), myRecordFile);
+  fwrite(&version, 1, 1, myRecordFile);
+  myRecordFileName = fileName;
+  myRecordStartTime.setToNow();
+  myRecordLastMSecs = 0;
+  myRecording = true;
+  ArLog::log(ArLog::Normal, "ArDeviceConnection: Recording %s %s to %s",
+	     myDCPortType.c_str(), myDCPortName.c_str(), fileName);
+  myRecordMutex.unlock();
+  return true;
+}
+
+AREXPORT void ArDeviceConnection::stopRecording()
+{
+  myRecordMutex.lock();
+  myRecording = false;
+  if (myRecordFile != NULL)
+  {
+    fclose(myRecordFile);
+    myRecordFile = NULL;
+    ArLog::log(ArLog::Normal, "ArDeviceConnection: Stopped recording to %s",
+	       myRecordFileName.c_str());
+  }
+  myRecordMutex.unlock();
+}
+
+AREXPORT bool ArDeviceConnection::isRecording()
+{
+  return myRecording;
+}
+
+static void writeCaptureNumber(FILE *file, unsigned long long num)
+{
+  unsigned char buf[10];
+  size_t len = 0;
+  do
+  {
+    buf[len] = (unsigned char) (num & 0x7f);
+    num >>= 7;
+    if (num != 0)
+      buf[len] |= 0x80;
+    len++;
+  } while (num != 0);
+  fwrite(buf, 1, len, file);
+}
+
+void ArDeviceConnection::recordData(const char *data, unsigned int size, 
+				    ArTime timeRead)
+{
+  myRecordMutex.lock();
+  if (myRecordFile == NULL)
+  {
+    myRecordMutex.unlock();
+    return;
+  }
+  // the time read can be from before the last read returned (or before
+  // recording started) so don't let time go backwards
+  long long msecs = myRecordStartTime.mSecSinceLL(timeRead);
+  if (msecs < myRecordLastMSecs)
+    msecs = myRecordLastMSecs;
+  writeCaptureNumber(myRecordFile, 
+		     (unsigned long long) (msecs - myRecordLastMSecs));
+  writeCaptureNumber(myRecordFile, size);
+  if (fwrite(data, 1, size, myRecordFile) != size)
+  {
+    ArLog::log(ArLog::Terse, 
+	       "ArDeviceConnection: Could not write to %s, stopping recording",
+	       myRecordFileName.c_str());
+    fclose(myRecordFile);
+    myRecordFile = NULL;
+    myRecording = false;
+  }
+  myRecordLastMSecs = msecs;
+  myRecordMutex.unlock();
+}
+
+AREXPORT void ArDeviceConnection::resetIOStats()
+{
+  myIOStats.reset();
+}
+
+AREXPORT void ArDeviceConnection::logIOStats(ArLog::LogLevel level)
+{
+  std::string name = "DevCon ";
+  name += myDCPortType + " " + myDCPortName + " " + myDCDeviceName;
+  myIOStats.log(name.c_str(), level);
+}
+
+void ArDeviceConnection::makeReadAheadRoom()
+{
+  if (myReadAheadEnd < myReadAheadBuf.size())
+    return;
+  // slide what's left down to the front, if there's anything to gain
+  if (myReadAheadStart > 0)
+  {
+    const unsigned int count = myReadAheadEnd - myReadAheadStart;
+    if (count > 0)
+      memmove(myReadAheadBuf.data(), myReadAheadBuf.data() + myReadAheadStart,
+	      count);
+    myReadAheadStart = 0;
+    myReadAheadEnd = count;
+  }
+  // still full, so a packet is bigger than the buffer; grow it
+  if (myReadAheadEnd == myReadAheadBuf.size())
+    myReadAheadBuf.resize(myReadAheadBuf.size() * 2);
+}
+
+/**
+   This reads all the data that is available from the device (up to
+   the free space in the read-ahead buffer) with a single non-blocking
+   read().  If nothing is available and @a msWait is nonzero, it then
+   waits up to @a msWait ms for at least one byte to arrive, and then
+   picks up whatever else came along with it.
+
+   @return the number of bytes added to the read-ahead buffer, or -1
+   if the read failed
+**/
+AREXPORT int ArDeviceConnection::fillReadAhead(unsigned int msWait)
+{
+  if (myReadAheadStart == myReadAheadEnd)
+  {
+    myReadAheadStart = 0;
+    myReadAheadEnd = 0;
+  }
+  makeReadAheadRoom();
+
+  char *dest = myReadAheadBuf.data() + myReadAheadEnd;
+  const unsigned int room = (unsigned int) myReadAheadBuf.size() - myReadAheadEnd;
+
+  int n = read(dest, room, 0);
+  myIOStats.addRead(n);
+  if (n == 0 && msWait > 0)
+  {
+    n = read(dest, 1, msWait);
+    myIOStats.addRead(n);
+    if (n > 0 && room > 1)
+    {
+      const int more = read(dest + n, room - (unsigned int) n, 0);
+      myIOStats.addRead(more);
+      if (more > 0)
+	n += more;
+    }
+  }
+  if (n <= 0)
+    return n;
+
+  myReadAheadEnd += (unsigned int) n;
+  myReadAheadReceived += (unsigned int) n;
+  ReadAheadChunk chunk;
+  chunk.end = myReadAheadReceived;
+  chunk.time = getTimeRead(0);
+  myReadAheadChunks.push_back(chunk);
+  if (myRecording.load(std::memory_order_relaxed))
+    recordData(dest, (unsigned int) n, chunk.time);
+  return n;
+}
+
+/**
+   This works like read(), except that the data comes out of the
+   read-ahead buffer, which is refilled from the device as needed.  So
+   a receiver can read a packet one or a few bytes at a time without
+   making a system call for each one.
+
+   @param data pointer to a character array to read the data into
+   @param size maximum number of bytes to read
+   @param msWait if fewer than @a size bytes are buffered, wait this
+   many ms for more (not at all for == 0)
+   @return number of bytes read, or -1 for failure
+**/
+AREXPORT int ArDeviceConnection::readBuffered(const char *data, 
+					      unsigned int size, 
+					      unsigned int msWait)
+{
+  if (getReadAheadCount() < size)
+  {
+    peekBuffered(size, msWait);
+    if (getReadAheadCount() == 0 && getStatus() != STATUS_OPEN)
+      return -1;
+  }
+  const unsigned int count = ArUtil::findMinU(size, getReadAheadCount());
+  if (count > 0)
+  {
+    memcpy(const_cast<char *>(data), getReadAheadData(), count);
+    consumeReadAhead(count);
+  }
+  return (int) count;
+}
+
+/**
+   @return the number of bytes in the read-ahead buffer (which is less
+   than @a size if they didn't arrive in time); the data is available
+   from getReadAheadData() and stays buffered until consumeReadAhead()
+**/
+AREXPORT unsigned int ArDeviceConnection::peekBuffered(unsigned int size, 
+						       unsigned int msWait)
+{
+  if (getReadAheadCount() >= size)
+    return getReadAheadCount();
+
+  ArTime timeDone;
+  timeDone.addMSec(msWait);
+  long timeLeft = msWait;
+  do
+  {
+    if (fillReadAhead((unsigned int) timeLeft) < 0)
+      break;
+    if (getReadAheadCount() >= size)
+      break;
+  } while ((timeLeft = timeDone.mSecTo()) > 0);
+
+  return getReadAheadCount();
+}
+
+/**
+   @param delim character to look for
+   @param startIndex index in the read-ahead buffer to start looking from
+   @return index of the character, relative to the start of the
+   read-ahead buffer (see getReadAheadData()), or -1 if it isn't buffered
+**/
+AREXPORT int ArDeviceConnection::scanReadAhead(char delim,
+					       unsigned int startIndex) const
+{
+  return internalScanReadAhead(&delim, 1, startIndex);
+}
+
+/**
+   @param delims set of characters to look for (a NUL terminated string)
+   @param startIndex index in the read-ahead buffer to start looking from
+   @return index of the first of the characters found, relative to the
+   start of the read-ahead buffer, or -1 if none of them are buffered
+**/
+AREXPORT int ArDeviceConnection::scanReadAheadAny(const char *delims,
+						  unsigned int startIndex) const
+{
+  if (delims == NULL)
+    return -1;
+  return internalScanReadAhead(delims, strlen(delims), startIndex);
+}
+
+/**
+   Like scanReadAhead(), but if the character isn't found then this
+   reads more data from the device (for up to @a msWait ms) and keeps
+   looking in the new data.
+
+   @return index of the character, relative to the start of the
+   read-ahead buffer, or -1 if it didn't arrive in time
+**/
+AREXPORT int ArDeviceConnection::scanBufferedFor(char delim,
+						 unsigned int msWait,
+						 unsigned int startIndex)
+{
+  return internalScanBufferedFor(&delim, 1, msWait, startIndex);
+}
+
+/**
+   Like scanReadAheadAny(), but reads more data from the device (for up
+   to @a msWait ms) until one of the characters is found.
+**/
+AREXPORT int ArDeviceConnection::scanBufferedForAny(const char *delims,
+						    unsigned int msWait,
+						    unsigned int startIndex)
+{
+  if (delims == NULL)
+    return -1;
+  return internalScanBufferedFor(delims, strlen(delims), msWait, startIndex);
+}
+
+int ArDeviceConnection::internalScanReadAhead(const char *delims, 
+					      size_t numDelims,
+					      unsigned int startIndex) const
+{
+  const unsigned int count = getReadAheadCount();
+  if (startIndex >= count || numDelims == 0)
+    return -1;
+
+  const char *begin = getReadAheadData();
+  const char *found = NULL;
+  if (numDelims == 1)
+  {
+    found = (const char *) memchr(begin + startIndex, delims[0], 
+				  count - startIndex);
+  }
+  else
+  {
+    for (const char *p = begin + startIndex; p < begin + count; p++)
+    {
+      if (memchr(delims, *p, numDelims) != NULL)
+      {
+	found = p;
+	break;
+      }
+    }
+  }
+  if (found == NULL)
+    return -1;
+  return (int) (found - begin);
+}
+
+int ArDeviceConnection::internalScanBufferedFor(const char *delims, 
+						size_t numDelims,
+						unsigned int msWait,
+						unsigned int startIndex)
+{
+  int found = internalScanReadAhead(delims, numDelims, startIndex);
+  if (found >= 0)
+    return found;
+
+  ArTime timeDone;
+  timeDone.addMSec(msWait);
+  long timeLeft = msWait;
+  do
+  {
+    // only look through the new data
+    const unsigned int scanned = ArUtil::findMaxU(getReadAheadCount(), 
+						  startIndex);
+    const int n = fillReadAhead((unsigned int) timeLeft);
+    if (n < 0)
+      return -1;
+    if (n > 0 && 
+	(found = internalScanReadAhead(delims, numDelims, scanned)) >= 0)
+      return found;
+  } while ((timeLeft = timeDone.mSecTo()) > 0);
+  return -1;
+}
+
+AREXPORT void ArDeviceConnection::consumeReadAhead(unsigned int size)
+{
+  if (size > getReadAheadCount())
+    size = getReadAheadCount();
+  myReadAheadStart += size;
+  myReadAheadConsumed += size;
+  if (myReadAheadStart == myReadAheadEnd)
+  {
+    myReadAheadStart = 0;
+    myReadAheadEnd = 0;
+  }
+  while (!myReadAheadChunks.empty() && 
+	 myReadAheadChunks.front().end <= myReadAheadConsumed)
+    myReadAheadChunks.pop_front();
+}
+
+AREXPORT void ArDeviceConnection::clearReadAhead()
+{
+  consumeReadAhead(getReadAheadCount());
+}
+
+/**
+   This is the equivalent of getTimeRead(0) for the first byte that's
+   waiting in the read-ahead buffer, i.e. when it was actually read
+   from the device (which may have been before the read that got the
+   rest of the packet).  If nothing is buffered, this is the current
+   time.  With @a index, it is when the byte that many bytes into the
+   buffer was read (the current time if fewer bytes are buffered).
+**/
+AREXPORT ArTime ArDeviceConnection::getReadAheadTimeRead(
+	unsigned int index) const
+{
+  const unsigned long long offset = myReadAheadConsumed + index;
+  for (std::deque<ReadAheadChunk>::const_iterator it = 
+	 myReadAheadChunks.begin(); it != myReadAheadChunks.end(); ++it)
+  {
+    if ((*it).end > offset)
+      return (*it).time;
+  }
+  ArTime now;
+  now.setToNow();
+  return now;
+}
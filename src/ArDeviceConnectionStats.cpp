@@ -0,0 +1,61 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArDeviceConnectionStats.h"
+
+#include <string>
+
+AREXPORT ArDeviceConnectionStats::ArDeviceConnectionStats()
+{
+  reset();
+}
+
+AREXPORT void ArDeviceConnectionStats::reset()
+{
+  myBytesRead.store(0, std::memory_order_relaxed);
+  myReads.store(0, std::memory_order_relaxed);
+  myGoodPackets.store(0, std::memory_order_relaxed);
+  myBadPackets.store(0, std::memory_order_relaxed);
+  myChecksumFailures.store(0, std::memory_order_relaxed);
+  myResyncs.store(0, std::memory_order_relaxed);
+  myBytesSkipped.store(0, std::memory_order_relaxed);
+  myPacketSpan.reset();
+  myPacketInterval.reset();
+}
+
+AREXPORT void ArDeviceConnectionStats::log(const char *name,
+					   ArLog::LogLevel level) const
+{
+  ArLog::log(level, "%s: %llu bytes in %llu reads, %llu good packets, %llu bad packets (%llu bad checksums), %llu resyncs skipping %llu bytes",
+	     name, getBytesRead(), getReads(), getGoodPackets(), 
+	     getBadPackets(), getChecksumFailures(), getResyncs(), 
+	     getBytesSkipped());
+  std::string histName = name;
+  histName += " packet span";
+  myPacketSpan.log(histName.c_str(), level);
+  histName = name;
+  histName += " packet interval";
+  myPacketInterval.log(histName.c_str(), level);
+}
@@ -0,0 +1,320 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArDeviceReactor.h"
+#include "Aria/ArDeviceConnection.h"
+#include "Aria/ArLog.h"
+
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <unistd.h>
+#include <errno.h>
+#endif
+
+AREXPORT ArDeviceReactor::ArDeviceReactor(const char *name) :
+  myName(name),
+  myEpollFD(-1),
+  myTickMSecs(100),
+  myNumWakeups(0),
+  myNumDispatches(0)
+{
+  setThreadName(myName.c_str());
+  myMutex.setLogNameVar("%s::myMutex", myName.c_str());
+#ifdef __linux__
+  myEpollFD = epoll_create1(EPOLL_CLOEXEC);
+  if (myEpollFD < 0)
+    ArLog::logErrorFromOS(ArLog::Terse, 
+			  "%s: Could not create epoll instance", 
+			  myName.c_str());
+#endif
+}
+
+AREXPORT ArDeviceReactor::~ArDeviceReactor()
+{
+  if (getRunning())
+  {
+    stopRunning();
+    join();
+  }
+#ifdef __linux__
+  if (myEpollFD >= 0)
+    ::close(myEpollFD);
+#endif
+}
+
+/**
+   @param conn the connection to read, it should already be open (if it
+   isn't it will be waited on once it is)
+   @param readCB called from the reactor thread after data has been read
+   into the read-ahead buffer of @a conn, and every tick
+   @param name name to use when logging about this connection
+   @return true if the connection will be read, false if it couldn't be
+   (already added, or the reactor isn't available on this platform)
+**/
+AREXPORT bool ArDeviceReactor::addConnection(ArDeviceConnection *conn,
+					     ArFunctor *readCB,
+					     const char *name)
+{
+  if (myEpollFD < 0)
+  {
+    ArLog::log(ArLog::Normal, 
+	       "%s: Cannot read connections (not available on this platform)",
+	       myName.c_str());
+    return false;
+  }
+  if (conn == NULL || readCB == NULL)
+    return false;
+
+  myMutex.lock();
+  if (myEntries.find(conn) != myEntries.end())
+  {
+    myMutex.unlock();
+    ArLog::log(ArLog::Normal, "%s: Already reading %s", myName.c_str(),
+	       name != NULL ? name : conn->getPortName());
+    return false;
+  }
+  Entry &entry = myEntries[conn];
+  entry.myReadCB = readCB;
+  entry.myName = (name != NULL) ? name : conn->getPortName();
+  entry.myFD = -1;
+  entry.myPollEveryTick = false;
+  entry.myHungUpFD = -1;
+  entry.myNumDispatches = 0;
+  registerFD(conn, &entry);
+  ArLog::log(ArLog::Verbose, "%s: Reading %s", myName.c_str(), 
+	     entry.myName.c_str());
+  myMutex.unlock();
+
+  if (!getRunning())
+    runAsync();
+  return true;
+}
+
+/**
+   Once this returns the connection's callback won't be called again
+   (unless it is called from the callback itself, in which case the
+   callback won't be called again after it returns).
+**/
+AREXPORT bool ArDeviceReactor::remConnection(ArDeviceConnection *conn)
+{
+  myMutex.lock();
+  std::map<ArDeviceConnection *, Entry>::iterator it = myEntries.find(conn);
+  if (it == myEntries.end())
+  {
+    myMutex.unlock();
+    return false;
+  }
+  unregisterFD(conn, &(*it).second);
+  ArLog::log(ArLog::Verbose, "%s: Stopped reading %s", myName.c_str(), 
+	     (*it).second.myName.c_str());
+  myEntries.erase(it);
+  myMutex.unlock();
+  return true;
+}
+
+AREXPORT size_t ArDeviceReactor::getNumConnections()
+{
+  myMutex.lock();
+  size_t ret = myEntries.size();
+  myMutex.unlock();
+  return ret;
+}
+
+AREXPORT void ArDeviceReactor::log(ArLog::LogLevel level)
+{
+  myMutex.lock();
+  ArLog::log(level, "%s: %lu connections, %lu wakeups, %lu dispatches",
+	     myName.c_str(), (unsigned long) myEntries.size(), myNumWakeups,
+	     myNumDispatches);
+  std::map<ArDeviceConnection *, Entry>::iterator it;
+  for (it = myEntries.begin(); it != myEntries.end(); ++it)
+    ArLog::log(level, "%s:\t%s fd %d%s, %lu dispatches", myName.c_str(),
+	       (*it).second.myName.c_str(), (*it).second.myFD,
+	       (*it).second.myPollEveryTick ? " (read every tick)" : "",
+	       (*it).second.myNumDispatches);
+  myMutex.unlock();
+}
+
+/// Must be called with myMutex locked
+void ArDeviceReactor::registerFD(ArDeviceConnection *conn, Entry *entry)
+{
+#ifdef __linux__
+  const int fd = conn->getPollFD();
+  if (fd < 0)
+    return;
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = conn;
+  if (epoll_ctl(myEpollFD, EPOLL_CTL_ADD, fd, &ev) == 0)
+  {
+    entry->myFD = fd;
+    entry->myPollEveryTick = false;
+  }
+  else if (errno == EPERM)
+  {
+    // plain files can't be waited on, but are always readable
+    entry->myFD = fd;
+    entry->myPollEveryTick = true;
+  }
+  else
+    ArLog::logErrorFromOS(ArLog::Normal, 
+			  "%s: Could not wait on %s (fd %d)",
+			  myName.c_str(), entry->myName.c_str(), fd);
+#else
+  (void) conn;
+  (void) entry;
+#endif
+}
+
+/// Must be called with myMutex locked
+void ArDeviceReactor::unregisterFD(ArDeviceConnection *conn, Entry *entry)
+{
+#ifdef __linux__
+  // if the connection closed the descriptor it's already gone from epoll
+  // (and the number may belong to some other connection by now)
+  if (entry->myFD >= 0 && !entry->myPollEveryTick && 
+      conn->getPollFD() == entry->myFD)
+    epoll_ctl(myEpollFD, EPOLL_CTL_DEL, entry->myFD, NULL);
+#else
+  (void) conn;
+#endif
+  entry->myFD = -1;
+  entry->myPollEveryTick = false;
+}
+
+/**
+   Makes sure we're waiting on the connection's current descriptor, since
+   the connection may have been closed or reopened (possibly getting the
+   same descriptor number back) since it was registered.  Must be called
+   with myMutex locked.
+**/
+void ArDeviceReactor::refreshFD(ArDeviceConnection *conn, Entry *entry)
+{
+  const int fd = conn->getPollFD();
+  if (fd != entry->myHungUpFD)
+    entry->myHungUpFD = -1;
+  if (fd != entry->myFD)
+  {
+    unregisterFD(conn, entry);
+    if (fd != entry->myHungUpFD)
+      registerFD(conn, entry);
+    return;
+  }
+#ifdef __linux__
+  struct epoll_event ev;
+  ev.events = EPOLLIN;
+  ev.data.ptr = conn;
+  if (fd >= 0 && !entry->myPollEveryTick && 
+      epoll_ctl(myEpollFD, EPOLL_CTL_MOD, fd, &ev) != 0 && errno == ENOENT)
+    registerFD(conn, entry);
+#endif
+}
+
+/// Must be called with myMutex locked
+void ArDeviceReactor::dispatch(ArDeviceConnection *conn, Entry *entry,
+			       bool hungUp)
+{
+  // read everything that's there, so the callback only has to frame
+  // packets out of the read-ahead buffer
+  int numRead = -1;
+  if (conn->getStatus() == ArDeviceConnection::STATUS_OPEN)
+    numRead = conn->fillReadAhead(0);
+  if (numRead < 0 || (hungUp && numRead == 0))
+  {
+    // the descriptor failed or hung up, stop waiting on it so we don't
+    // spin (the device will notice the lost connection from its
+    // callback), if it gets reopened it'll be picked up at the next tick
+    entry->myHungUpFD = entry->myFD;
+    unregisterFD(conn, entry);
+  }
+  entry->myNumDispatches++;
+  myNumDispatches++;
+  entry->myReadCB->invoke();
+}
+
+/// Must be called with myMutex locked
+void ArDeviceReactor::tick()
+{
+  myLastTick.setToNow();
+  std::map<ArDeviceConnection *, Entry>::iterator it;
+  for (it = myEntries.begin(); it != myEntries.end(); )
+  {
+    ArDeviceConnection *conn = (*it).first;
+    Entry *entry = &(*it).second;
+    refreshFD(conn, entry);
+    if (entry->myPollEveryTick && 
+	conn->getStatus() == ArDeviceConnection::STATUS_OPEN)
+      conn->fillReadAhead(0);
+    entry->myReadCB->invoke();
+    // the callback may have removed any connection, its own included, so
+    // go on from the key instead of an iterator that may be gone
+    it = myEntries.upper_bound(conn);
+  }
+}
+
+AREXPORT void *ArDeviceReactor::runThread(void *)
+{
+  threadStarted();
+
+#ifdef __linux__
+  const int maxEvents = 32;
+  struct epoll_event events[maxEvents];
+
+  myLastTick.setToNow();
+  while (getRunning())
+  {
+    long timeout = myTickMSecs - myLastTick.mSecSince();
+    if (timeout < 0)
+      timeout = 0;
+    const int numEvents = epoll_wait(myEpollFD, events, maxEvents, 
+				     (int) timeout);
+    if (numEvents < 0 && errno != EINTR)
+    {
+      ArLog::logErrorFromOS(ArLog::Terse, "%s: epoll_wait failed", 
+			    myName.c_str());
+      ArUtil::sleep((unsigned int) myTickMSecs);
+    }
+
+    myMutex.lock();
+    if (numEvents > 0)
+      myNumWakeups++;
+    for (int i = 0; i < numEvents; i++)
+    {
+      // look it up again since an earlier callback may have removed it
+      std::map<ArDeviceConnection *, Entry>::iterator it = 
+	myEntries.find((ArDeviceConnection *) events[i].data.ptr);
+      if (it != myEntries.end() && (*it).second.myFD >= 0)
+	dispatch((*it).first, &(*it).second, 
+		 (events[i].events & (EPOLLHUP | EPOLLERR)) != 0);
+    }
+    if (myLastTick.mSecSince() >= myTickMSecs)
+      tick();
+    myMutex.unlock();
+  }
+#endif
+
+  threadFinished();
+  return NULL;
+}
@@ -110,6 +110,7 @@ AREXPORT bool ArFileDeviceConnection::close()
   ArUtil::close(myInFD);
   ArUtil::close(myOutFD);
   myStatus = STATUS_CLOSED_NORMALLY;
+  clearReadAhead();
   return true;
 }
 
@@ -143,6 +144,13 @@ AREXPORT bool ArFileDeviceConnection::isTimeStamping()
   return false;
 }
 
+AREXPORT int ArFileDeviceConnection::getPollFD()
+{
+  if (myStatus != STATUS_OPEN)
+    return -1;
+  return myInFD;
+}
+
 AREXPORT ArTime ArFileDeviceConnection::getTimeRead(UNUSED int index)
 {
   ArTime now;
@@ -25,7 +25,11 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaOSDef.h"
 #include "Aria/ArInterpolation.h"
 
-AREXPORT ArInterpolation::ArInterpolation(size_t numberOfReadings)
+AREXPORT ArInterpolation::ArInterpolation(size_t numberOfReadings) :
+  myTimes(numberOfReadings),
+  myPoses(numberOfReadings),
+  myStart(0),
+  myCount(0)
 {
   mySize = numberOfReadings;
   myDataMutex.setLogName("ArInterpolation");
@@ -40,17 +44,60 @@ AREXPORT bool ArInterpolation::addReading(ArTime timeOfReading,
 					  ArPose position)
 {
   myDataMutex.lock();
-  if (myTimes.size() >= mySize)
+  if (mySize == 0)
   {
-    myTimes.pop_back();
-    myPoses.pop_back();
+    myDataMutex.unlock();
+    return true;
+  }
+  // keep them in order, if the time went back the newer ones go
+  while (myCount > 0 && 
+	 myTimes[physicalIndex(myCount - 1)].mSecSinceLL(timeOfReading) < 0)
+    myCount--;
+  if (myCount >= mySize)
+  {
+    myStart = physicalIndex(1);
+    myCount--;
   }
-  myTimes.push_front(timeOfReading);
-  myPoses.push_front(position);
+  const size_t p = physicalIndex(myCount);
+  myTimes[p] = timeOfReading;
+  myPoses[p] = position;
+  myCount++;
   myDataMutex.unlock();
   return true;
 }
 
+size_t ArInterpolation::findReading(const ArTime &timeStamp, 
+				    size_t from, size_t to) const
+{
+  // the first reading after the time stamp
+  size_t low = from, high = to;
+  while (low < high)
+  {
+    const size_t mid = low + (high - low) / 2;
+    if (myTimes[physicalIndex(mid)].mSecSinceLL(timeStamp) < 0)
+      high = mid;
+    else
+      low = mid + 1;
+  }
+  return low > 0 ? low - 1 : myCount;
+}
+
+size_t ArInterpolation::findReadingFrom(const ArTime &timeStamp, 
+					size_t from) const
+{
+  // times in order are usually close together, so look right after the
+  // last one, then twice as far on and so on before searching between
+  size_t step = 1;
+  while (from + step < myCount && 
+	 myTimes[physicalIndex(from + step)].mSecSinceLL(timeStamp) >= 0)
+  {
+    from += step;
+    step *= 2;
+  }
+  return findReading(timeStamp, from, 
+		     from + step < myCount ? from + step : myCount);
+}
+
 /**
    @param timeStamp the time we are interested in
    @param position the pose to set to the given position
@@ -65,14 +112,63 @@ AREXPORT bool ArInterpolation::addReading(ArTime timeOfReading,
 AREXPORT int ArInterpolation::getPose(
 	ArTime timeStamp, ArPose *position, ArPoseWithTime *mostRecent)
 {
-  std::list<ArTime>::iterator tit;
-  std::list<ArPose>::iterator pit;
-  
-  ArPose thisPose;
-  ArTime thisTime;
-  ArPose lastPose;
-  ArTime lastTime;
+  myDataMutex.lock();
+  const int ret = poseFrom(findReading(timeStamp, 0, myCount), timeStamp, 
+			   position, mostRecent);
+  myDataMutex.unlock();
+  return ret;
+}
 
+/**
+   Does the same as calling getPose() for each time, but locks only once,
+   and when a time is after the one before it (such as the times of the
+   readings in a laser scan) it looks on from where it found that one
+   instead of searching all the readings again.
+
+   @param timeStamps the times we are interested in
+   @param positions set to the position at each time, those that couldn't
+   be found (a result below 0) are left at 0, 0, 0
+   @param results if not NULL, set to what getPose() returns for each time
+   @return how many of the positions were found (interpolated or predicted)
+**/
+AREXPORT size_t ArInterpolation::getPoses(
+	const std::vector<ArTime> &timeStamps, std::vector<ArPose> *positions,
+	std::vector<int> *results)
+{
+  positions->assign(timeStamps.size(), ArPose());
+  if (results != NULL)
+    results->resize(timeStamps.size());
+  size_t numFound = 0;
+  size_t from = 0;
+  const ArTime *lastStamp = NULL;
+
+  myDataMutex.lock();
+  for (size_t i = 0; i < timeStamps.size(); i++)
+  {
+    const ArTime &timeStamp = timeStamps[i];
+    // the readings before where the last time was found are before this
+    // one, unless it is before the last
+    size_t found;
+    if (lastStamp == NULL || lastStamp->mSecSinceLL(timeStamp) < 0 ||
+	from >= myCount)
+      found = findReading(timeStamp, 0, myCount);
+    else
+      found = findReadingFrom(timeStamp, from);
+    const int ret = poseFrom(found, timeStamp, &(*positions)[i], NULL);
+    if (ret >= 0)
+      numFound++;
+    if (results != NULL)
+      (*results)[i] = ret;
+    from = found;
+    lastStamp = &timeStamp;
+  }
+  myDataMutex.unlock();
+  return numFound;
+}
+
+int ArInterpolation::poseFrom(size_t found, const ArTime &timeStamp, 
+			      ArPose *position, ArPoseWithTime *mostRecent)
+{
   // MPL don't use nowtime, use the time stamp that was passed in...
   // that was bad
   //ArTime nowTime;
@@ -80,62 +176,41 @@ AREXPORT int ArInterpolation::getPose(
   long toStamp;
   double percentage;
   ArPose retPose;
-  
-  myDataMutex.lock();
-  // find the time we want
-  for (tit = myTimes.begin(), pit = myPoses.begin();
-       tit != myTimes.end() && pit != myPoses.end(); 
-       ++tit, ++pit)
-  {
-    lastTime = thisTime;
-    lastPose = thisPose;
-
-    thisTime = (*tit);
-    thisPose = (*pit);
 
-    //printf("## %d %d %d b %d at %d after %d\n", timeStamp.getMSec(), thisTime.getMSec(), timeStamp.mSecSince(thisTime), timeStamp.isBefore(thisTime), timeStamp.isAt(thisTime), timeStamp.isAfter(thisTime));
-    //if (timeStamp.isBefore(thisTime) || timeStamp.isAt(thisTime))
-    if (!timeStamp.isAfter(thisTime))
+  // if we're at the end then it was too long ago (and the data is the
+  // oldest)
+  if (found >= myCount)
+  {
+    //printf("Too old\n");
+    if (mostRecent != NULL)
     {
-      //printf("Found one!\n");
-      break;
-    } 
-
+      mostRecent->setPose(myCount > 0 ? myPoses[myStart] : ArPose());
+      mostRecent->setTime(myCount > 0 ? myTimes[myStart] : ArTime());
+    }
+    return -2;
   }
 
+  // these are references, since making an ArTime gets the time
+  const ArTime &thisTime = myTimes[physicalIndex(found)];
+  const ArPose &thisPose = myPoses[physicalIndex(found)];
   if (mostRecent != NULL)
   {
     mostRecent->setPose(thisPose);
     mostRecent->setTime(thisTime);
   }
-    
-
-  // if we're at the end then it was too long ago
-  if (tit == myTimes.end() || pit == myPoses.end())
-  {
-    //printf("Too old\n");
-    myDataMutex.unlock();
-    return -2;
-  }
   
   // this is for forecasting (for the brave)
-  if ((tit == myTimes.begin() || pit == myPoses.begin()) && 
-      !timeStamp.isAt((*tit)))
+  if (found == myCount - 1 && !timeStamp.isAt(thisTime))
   {
-    //printf("Too new %d %d\n", tit == myTimes.begin(), pit == myPoses.begin());
+    //printf("Too new\n");
   
-    thisTime = (*tit);
-    thisPose = (*pit);
-    tit++;
-    pit++;  
-    if (tit == myTimes.end() || pit == myPoses.end())
+    if (found == 0)
     {
       //printf("Not enough data\n");
-      myDataMutex.unlock();
       return -3;
     }
-    lastTime = (*tit);
-    lastPose = (*pit);
+    const ArTime &lastTime = myTimes[physicalIndex(found - 1)];
+    const ArPose &lastPose = myPoses[physicalIndex(found - 1)];
 
     // MPL don't use nowtime, use the time stamp that was passed in...
     //nowTime.setToNow();
@@ -153,7 +228,6 @@ AREXPORT int ArInterpolation::getPose(
       if (myLogPrediction)
 	      ArLog::log(ArLog::Normal, "%s: returningPercentage Total time %d, to stamp %d, percentage %.2f (allowed %d)", getName(), total, toStamp, percentage * 100, myAllowedPercentageForPrediction);
       
-      myDataMutex.unlock();
       return -1;
     }
 
@@ -162,7 +236,6 @@ AREXPORT int ArInterpolation::getPose(
     {
       if (myLogPrediction)
         ArLog::log(ArLog::Normal, "%s: returningMS Total time %d, to stamp %d, percentage %.2f (allowed %d)", getName(), total, toStamp, percentage * 100, myAllowedMSForPrediction);
-      myDataMutex.unlock();
       return -1;
     }
 
@@ -185,13 +258,14 @@ AREXPORT int ArInterpolation::getPose(
 
 
     *position = retPose;
-    myDataMutex.unlock();
     return 0;
   }
 
-  // this is the actual interpolation
-
-  //printf("Woo hoo!\n");
+  // this is the actual interpolation, toward the next newer reading (at
+  // the newest reading it is that one)
+  const size_t last = found + 1 < myCount ? found + 1 : found;
+  const ArTime &lastTime = myTimes[physicalIndex(last)];
+  const ArPose &lastPose = myPoses[physicalIndex(last)];
 
   total = thisTime.mSecSince(lastTime);
   toStamp = thisTime.mSecSince(timeStamp);
@@ -200,9 +274,6 @@ AREXPORT int ArInterpolation::getPose(
   if (total == 0)
     percentage = 0;
 
-  //if (total == 0)
-  //printf("Total time %d, to stamp %d, percentage %.2f\n", 	 total, toStamp, percentage * 100);
-
   retPose.setX(thisPose.getX() + 
 	       (lastPose.getX() - thisPose.getX()) * percentage); 
   retPose.setY(thisPose.getY() + 
@@ -211,18 +282,8 @@ AREXPORT int ArInterpolation::getPose(
 				 ArMath::subAngle(lastPose.getTh(), 
 						  thisPose.getTh())
 				 * percentage));
-/*
-  printf("original:");
-  thisPose.log();
-  printf("After:");
-  lastPose.log();
-  printf("ret:");
-  retPose.log();
-*/
   *position = retPose;
-  myDataMutex.unlock();
   return 1;
-  
 }
 
 AREXPORT size_t ArInterpolation::getNumberOfReadings() const
@@ -233,11 +294,20 @@ AREXPORT size_t ArInterpolation::getNumberOfReadings() const
 AREXPORT void ArInterpolation::setNumberOfReadings(size_t numberOfReadings)
 {
   myDataMutex.lock();
-  while (myTimes.size() > numberOfReadings)
+  // keep the newest ones, oldest first at the start of the new buffers
+  const size_t keep = myCount < numberOfReadings ? myCount : numberOfReadings;
+  std::vector<ArTime> times(numberOfReadings);
+  std::vector<ArPose> poses(numberOfReadings);
+  for (size_t i = 0; i < keep; i++)
   {
-    myTimes.pop_back();
-    myPoses.pop_back();
+    const size_t p = physicalIndex(myCount - keep + i);
+    times[i] = myTimes[p];
+    poses[i] = myPoses[p];
   }
+  myTimes.swap(times);
+  myPoses.swap(poses);
+  myStart = 0;
+  myCount = keep;
   mySize = numberOfReadings;  
   myDataMutex.unlock();
 }
@@ -245,10 +315,8 @@ AREXPORT void ArInterpolation::setNumberOfReadings(size_t numberOfReadings)
 AREXPORT void ArInterpolation::reset()
 {
   myDataMutex.lock();
-  while (myTimes.size() > 0)
-    myTimes.pop_back();
-  while (myPoses.size() > 0)
-    myPoses.pop_back();
+  myStart = 0;
+  myCount = 0;
   myDataMutex.unlock();
 }
 
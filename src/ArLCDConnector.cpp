@@ -898,7 +898,7 @@ AREXPORT bool ArLCDConnector::verifyFirmware (LCDData *lcd)
 			return false;
 		}
 
-		if ((lcd->myConn->read((char *) &helloResp[0], 4, 500)) > 0) {
+		if ((lcd->myConn->readBuffered((char *) &helloResp[0], 4, 500)) > 0) {
 
 			ArLog::log(ArLog::Normal,
 					"ArLCDConnector::verifyFirmware(%d) received hello response 0x%02x 0x%02x 0x%02x 0x%02x",
@@ -1039,7 +1039,7 @@ AREXPORT bool ArLCDConnector::verifyFirmware (LCDData *lcd)
 		}
 
 		// wait a sec for the response
-		if ((lcd->myConn->read((char *) &c, 1, 1000)) > 0) {
+		if ((lcd->myConn->readBuffered((char *) &c, 1, 1000)) > 0) {
 	
 			if (c == 0x4b) 
 				continue;
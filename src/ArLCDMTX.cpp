@@ -1814,7 +1814,7 @@ AREXPORT bool ArLCDMTX::downloadFirmware()
 			return false;
 		}
 
-		if ((myConn->read((char *)&helloResp[0], 4, 500)) > 0) {
+		if ((myConn->readBuffered((char *)&helloResp[0], 4, 500)) > 0) {
 
 			ArLog::log(ArLog::Normal,
 				"%s::downloadFirmware() received hello response 0x%02x 0x%02x 0x%02x 0x%02x",
@@ -1907,7 +1907,7 @@ AREXPORT bool ArLCDMTX::downloadFirmware()
 
 
 		// wait a sec for the response
-		if ((myConn->read((char *)&c, 1, 1000)) > 0) {
+		if ((myConn->readBuffered((char *)&c, 1, 1000)) > 0) {
 
 			if (c == 0x4b)
 				continue;
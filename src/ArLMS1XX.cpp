@@ -27,6 +27,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArRobot.h"
 #include "Aria/ArSerialConnection.h"
 #include "Aria/ariaInternal.h"
+#include "Aria/ArChecksum.h"
 #include <time.h>
 
 //#define TRACE
@@ -395,20 +396,18 @@ ArDeviceConnection *ArLMS1XXPacketReceiver::getDeviceConnection()
 }
 
 
+/**
+   Packets are framed out of the device connection's read-ahead buffer:
+   everything up to the STX (0x02) is skipped, and then the buffer is
+   scanned for the ETX (0x03) as more data arrives.  Data left in the
+   buffer after a packet is kept for the next call (unless
+   @a ignoreRemainders is true, in which case it's thrown away).
+**/
 ArLMS1XXPacket *ArLMS1XXPacketReceiver::receivePacket(unsigned int msWait,
 						      UNUSED bool scandataShortcut,
-						      UNUSED bool ignoreRemainders)
+						      bool ignoreRemainders)
 {
 	ArLMS1XXPacket *packet;
-	//unsigned char c = 0;
-	//long timeToRunFor;
-	//ArTime lastDataRead;
-	//ArTime packetReceived;
-	//int numRead;
-	//int i;
-
-	//if (myLaserModel == ArLMS1XX::TiM3XX)
-	//	return receiveTiMPacket(msWait, scandataShortcut, ignoreRemainders);
 
 	if (myConn == NULL ||
 			myConn->getStatus() != ArDeviceConnection::STATUS_OPEN)
@@ -429,235 +428,102 @@ ArLMS1XXPacket *ArLMS1XXPacketReceiver::receivePacket(unsigned int msWait,
 		if (timeToRunFor < 0)
 			timeToRunFor = 0;
 
-		//printf("%x\n", c);
 		if (myState == STARTING)
 		{
-			char c = 0;
-			const int numRead = myConn->read(&c, 1, (unsigned int) timeToRunFor);
-			
-			if (numRead <= 0)
+			const int start = myConn->scanBufferedFor('\002', (unsigned int) timeToRunFor);
+			if (start < 0)
 			{
-
-				//ArLog::log(ArLog::Terse,
-				//			"%s::receivePacket() Timeout on initial read - read timeout = (%lu)",
-				//					myName, timeToRunFor);
+				const unsigned int skipped = myConn->getReadAheadCount();
+				if (skipped > 0)
+					ArLog::log(ArLog::Verbose,
+							"%s::receivePacket() Warning: Received %u invalid chars during STARTING, looking for 0x02. Skipping.",
+							myName, skipped);
+				myConn->ioStatsResync(skipped);
+				myConn->consumeReadAhead(skipped);
 				return NULL;
-
-			} //printf("%x\n", c);
-
-			if (c == '\002')
-			{
-				myState = DATA;
-				myPacket.empty();
-				myPacket.setLength(0);
-				myPacket.rawCharToBuf((unsigned char)c);
-				myReadCount = 0;
-				//packetReceived = myConn->getTimeRead(0);
-				myPacket.setTimeReceived(myConn->getTimeRead(0)); //packetReceived);
 			}
-			else
+			if (start > 0)
 			{
-        			char l = ' ';
-       				if(c >= ' ' && c <= '~')
-          				l = c;
 				ArLog::log(ArLog::Verbose,
-							"%s::receivePacket() Warning: Received invalid char during STARTING, looking for 0x02 got 0x%02x %c. Skipping.",
-									myName, c, l);
+						"%s::receivePacket() Warning: Received %d invalid chars during STARTING, looking for 0x02. Skipping.",
+						myName, start);
+				myConn->ioStatsResync((unsigned int) start);
+				myConn->consumeReadAhead((unsigned int) start);
 			}
+			myState = DATA;
+			// the STX has been looked at already
+			myReadCount = 1;
+			myPacket.setTimeReceived(myConn->getReadAheadTimeRead());
 		}
 		else if (myState == DATA)
 		{
-			int numRead = myConn->read(&myReadBuf[myReadCount],
-					sizeof(myReadBuf) - myReadCount, myReadTimeout);
-
-			// trap if we failed the read
-			if (numRead < 0)
+			// see if we have the end of the packet (or the start of a
+			// new one) in the data we haven't looked at yet
+			const int found = myConn->scanReadAheadAny("\002\003", myReadCount);
+			if (found < 0)
 			{
-				//printf("read failed \n");
-				ArLog::log(ArLog::Normal,
-						"%s::receivePacket() Failed read (%d)",
-						myName,numRead);
-				myState = STARTING;
-				return NULL;
-			}
-			/*
-			ArLog::log(ArLog::Normal, "%s::receivePacket() Read %d bytes",
-					myName,numRead);
-			*/
-
-            IFDEBUG(
-
-			if (numRead != 0)
-			{
-
-				// print out using logging
-				//int i;
-				char x[100000];
-				x[0] = '\0';
-				int idx=0;
-				strcat(&x[idx],"<STX>");
-				idx = idx+5;
-				for (unsigned int i = 0;i < numRead;i++)
+				myReadCount = myConn->getReadAheadCount();
+				const int numRead = myConn->fillReadAhead(myReadTimeout);
+				// trap if we failed the read
+				if (numRead < 0)
 				{
-					//
-					if (myReadBuf[i] == '\002')
-					{
-						strcat(&x[idx], "<STX>");
-						idx = idx+5;
-					}
-					else if (myReadBuf[i] == '\003')
-					{
-						strcat(&x[idx], "<ETX>");
-						idx = idx+5;
-					}
-					else
-						sprintf(&x[idx++], "%c",(char *)myReadBuf[i]);
-				}
-
 					ArLog::log(ArLog::Normal,
-							"%s::receivePacket() Buffer with %d bytes = %s", myName, numRead, x);
-			}
-             ); // end IFDEBUG
-
-			// see if we found the end of the packet
-			for (unsigned int i = myReadCount; i < myReadCount + (unsigned int)numRead; i++)
-			{
-				if (myReadBuf[i] == '\002')
-				{
-//					ArLog::log(myInfoLogLevel, "%s::receivePacket() Data found start of new packet...",
-					ArLog::log(myInfoLogLevel, "%s::receivePacket() Data found start of new packet...",
-							myName);
-					myPacket.empty();
-					myPacket.setLength(0);
-					memmove(myReadBuf, &myReadBuf[i], myReadCount + (unsigned int)numRead - i);
-					numRead -= (int)(i - myReadCount);
-					myReadCount -= i;
-					i = 0;
-					continue;
-				}
-				if (myReadBuf[i] == '\003')
-				{
-
-					myPacket.dataToBuf(myReadBuf, i + 1);
-					myPacket.resetRead();
-					packet = new ArLMS1XXPacket;
-					packet->duplicatePacket(&myPacket);
-					myPacket.empty();
-					myPacket.setLength(0);
-
-					// if it's the end of the data just go back to the beginning
-					//printf("i=%d, myReadCount = %d, numRead = %d\n",i, myReadCount, numRead);
-
-					if (i == myReadCount + (unsigned int)numRead - 1)
-					{
-						//ArLog::log(myLogLevel1XXPacketReceiver: Starting again");
-						myState = STARTING;
-					}
-					// if it isn't move the data up and start again
-					else
-					{
-					  if (!ignoreRemainders)
-					  {
-					    memmove(myReadBuf, &myReadBuf[i+1], myReadCount + (unsigned int)numRead - i - 1);
-					    myReadCount = myReadCount + (unsigned int)numRead - i - 1;
-					    myState = REMAINDER;
-					    ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ...",
-						       myName,myReadCount);
-					  }
-					  else
-					  {
-					    myState = STARTING;
-					    ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ... ignoring it",
-						       myName,myReadCount);
-					  }
-					}
-					return packet;
+							"%s::receivePacket() Failed read (%d)",
+							myName,numRead);
+					myState = STARTING;
+					return NULL;
 				}
+				if (numRead != 0)
+					ArLog::log(myInfoLogLevel, "%s::receivePacket() Got %d bytes (but not end char), up to %d",
+							myName, numRead, myConn->getReadAheadCount());
+				continue;
 			}
-			//printf("didn't get enough bytes\n");
-			myReadCount += (unsigned int)numRead;
-			if (numRead != 0)
-				ArLog::log(myInfoLogLevel, "%s::receivePacket() Got %d bytes (but not end char), up to %d",
-						myName, numRead, myReadCount);
-		}
-		else if (myState == REMAINDER)
-		{
-			//printf("In remainder ('%c' %d) \n", myReadBuf[0], myReadBuf[0]);
-			if (myReadBuf[0] != '\002')
+
+			const char *data = myConn->getReadAheadData();
+			if (data[found] == '\002')
 			{
-				ArLog::log(myInfoLogLevel,
-						"%s::receivePacket() Remainder didn't start with \\002, starting over...",myName);
-				myState = STARTING;
+				ArLog::log(myInfoLogLevel, "%s::receivePacket() Data found start of new packet...",
+						myName);
+				myConn->ioStatsBadPacket(false);
+				myConn->consumeReadAhead((unsigned int) found);
+				myReadCount = 1;
+				myPacket.setTimeReceived(myConn->getReadAheadTimeRead());
 				continue;
 			}
 
-			// PS - 9/1/11 not sure why, but for LMS500 this is off by 1 and it dosn't see the <EXT>
-			// and thinks the last
-			// packet does not have the last byte
-			// so for the LMS500 - just use one less byte in the for loop
-
-			const unsigned int loopcount = (myLaserModel == ArLMS1XX::LMS1XX) ? myReadCount - 1 : myReadCount;
-
-//			if (myIsLMS5XX)
-//				loopcount = myReadCount;
-//			else
-//				loopcount = myReadCount - 1;
+			IFDEBUG(
+				ArLog::log(ArLog::Normal,
+						"%s::receivePacket() Packet with %d bytes = <STX>%.*s<ETX>", 
+						myName, found + 1, found - 1, data + 1);
+			); // end IFDEBUG
+
+			myPacket.empty();
+			myPacket.setLength(0);
+			myPacket.dataToBuf(data, (size_t) found + 1);
+			myConn->ioStatsGoodPacket((unsigned int) found + 1);
+			myConn->consumeReadAhead((unsigned int) found + 1);
+			myPacket.resetRead();
+			packet = new ArLMS1XXPacket;
+			packet->duplicatePacket(&myPacket);
+			myPacket.empty();
+			myPacket.setLength(0);
 
-			for (unsigned int i = 0; i < loopcount; i++)
-			//for (i = 0; i < myReadCount - 1; i++)
+			myState = STARTING;
+			if (myConn->getReadAheadCount() > 0)
 			{
-				//printf("%03d '%c' %d\n", i, myReadBuf[i], myReadBuf[i]);
-				if (myReadBuf[i] == '\002' && i != 0)
+				if (!ignoreRemainders)
 				{
-					ArLog::log(myInfoLogLevel, "%s::receivePacket() Remainder found start of new packet...",
-							myName, myReadCount);
-					myPacket.empty();
-					myPacket.setLength(0);
-					memmove(myReadBuf, &myReadBuf[i], myReadCount + i); // TODO use range, index or pointer instead
-					myReadCount -= i;
-					i = 0;
-					continue;
+					ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ...",
+							myName, myConn->getReadAheadCount());
 				}
-				if (myReadBuf[i] == '\003')
+				else
 				{
-					myPacket.dataToBuf(myReadBuf, i + 1);
-					myPacket.resetRead();
-					packet = new ArLMS1XXPacket;
-					packet->duplicatePacket(&myPacket);
-					myPacket.empty();
-					myPacket.setLength(0);
-
-					// if it's the end of the data just go back to the beginning
-					if (i == myReadCount - 1)
-					{
-						myState = STARTING;
-						ArLog::log(myInfoLogLevel,
-								"%s::receivePacket() Remainder was one packet...",myName);
-					}
-					// if it isn't move the data up and start again
-					else
-					{
-						// PS - took out this printf and replaced with a log
-						if (myReadCount - i < 50)
-							//printf("read buf (%d %d) %s\n", myReadCount, i, myReadBuf);
-						   ArLog::log(ArLog::Terse, "%s::receivePacket() read buf (%d %d) %s",
-								   myName, myReadCount, i, myReadBuf);
-
-						memmove(myReadBuf, &myReadBuf[i+1], myReadCount - i); // TODO use range, index or pointer instead
-						myReadCount = myReadCount - i - 1;
-						myState = REMAINDER;
-						ArLog::log(myInfoLogLevel,
-								"%s::receivePacket() Remainder was more than one packet... (%d %d)", myName, myReadCount, i);
-					}
-					return packet;
+					ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ... ignoring it",
+							myName, myConn->getReadAheadCount());
+					myConn->clearReadAhead();
 				}
 			}
-			// if we didn't find the end of the packet, then get the rest of the data
-			myState = DATA;
-			ArLog::log(myInfoLogLevel,
-					"%s::receivePacket() Remainder didn't contain a whole packet...",myName);
-
-			continue;
+			return packet;
 		}
 		else
 		{
@@ -665,184 +531,21 @@ ArLMS1XXPacket *ArLMS1XXPacketReceiver::receivePacket(unsigned int msWait,
 					myName,myState);
 			myState = STARTING;
 		}
-	} while (timeDone.mSecTo() >= 0); // || !myStarting)
+	} while (timeDone.mSecTo() >= 0);
 
 	return NULL;
 }
 
 
+/**
+   The TiM framing is the same as for the other lasers, except that
+   anything after the end of a packet is always ignored.
+**/
 ArLMS1XXPacket *ArLMS1XXPacketReceiver::receiveTiMPacket(unsigned int msWait,
-						      UNUSED bool scandataShortcut,
+						      bool scandataShortcut,
 						      UNUSED bool ignoreRemainders)
 {
-	ArLMS1XXPacket *packet;
-	unsigned char c = 0;
-	long timeToRunFor;
-	ArTime timeDone;
-	ArTime lastDataRead;
-	ArTime packetReceived;
-	int numRead;
-
-	if (myConn == NULL ||
-			myConn->getStatus() != ArDeviceConnection::STATUS_OPEN)
-	{
-		return NULL;
-	}
-
-	timeDone.setToNow();
-	if (!timeDone.addMSec(msWait)) {
-		ArLog::log(ArLog::Terse,
-				"%s::receiveTiMPacket() error adding msecs (%i)",
-				myName,msWait);
-	}
-
-	do
-	{
-		timeToRunFor = timeDone.mSecTo();
-		if (timeToRunFor < 0)
-			timeToRunFor = 0;
-
-		//printf("%x\n", c);
-		if (myState == STARTING)
-		{
-			assert(timeToRunFor <= UINT_MAX);
-			if ((numRead = myConn->read((char *)&c, 1, (unsigned int)timeToRunFor)) <= 0) {
-
-				return NULL;
-
-				}//printf("%x\n", c);
-			if (c == '\002')
-			{
-				myState = DATA;
-				myPacket.empty();
-				myPacket.setLength(0);
-				myPacket.rawCharToBuf(c);
-				myReadCount = 0;
-				packetReceived = myConn->getTimeRead(0);
-				myPacket.setTimeReceived(packetReceived);
-			}
-			else
-			{
-				ArLog::log(ArLog::Terse,
-						"%s::receiveTiMPacket() Failed single char read (%d) %02x %c",
-						myName,numRead, c, c);
-			}
-		}
-		else if (myState == DATA)
-		{
-			numRead = myConn->read(&myReadBuf[myReadCount],
-					sizeof(myReadBuf) - myReadCount, myReadTimeout);
-
-			// trap if we failed the read
-			if (numRead < 0)
-			{
-				//printf("read failed \n");
-				ArLog::log(ArLog::Normal,
-						"%s::receivePacket() Failed read (%d)",
-						myName,numRead);
-				myState = STARTING;
-				return NULL;
-			}
-			/*
-			ArLog::log(ArLog::Normal, "%s::receivePacket() Read %d bytes",
-					myName,numRead);
-			*/
-
-            IFDEBUG(
-
-			if (numRead != 0)
-			{
-
-				// print out using logging
-				char x[100000];
-				x[0] = '\0';
-				int idx=0;
-				strcat(&x[idx],"<STX>");
-				idx = idx+5;
-				for (unsigned int i = 0;i < numRead;i++)
-				{
-					//
-					if (myReadBuf[i] == '\002')
-					{
-						strcat(&x[idx], "<STX>");
-						idx = idx+5;
-					}
-					else if (myReadBuf[i] == '\003')
-					{
-						strcat(&x[idx], "<ETX>");
-						idx = idx+5;
-					}
-					else
-						sprintf(&x[idx++], "%c",(char *)myReadBuf[i]);
-				}
-
-					ArLog::log(ArLog::Normal,
-							"%s::receivePacket() Buffer with %d bytes = %s", myName, numRead, x);
-			}
-             ); // end IFDEBUG
-
-			// see if we found the end of the packet
-			for (unsigned int i = myReadCount; i < myReadCount + (unsigned int)numRead; i++)
-			{
-				if (myReadBuf[i] == '\002')
-				{
-//					ArLog::log(myInfoLogLevel, "%s::receivePacket() Data found start of new packet...",
-					ArLog::log(myInfoLogLevel, "%s::receivePacket() Data found start of new packet...",
-							myName);
-					myPacket.empty();
-					myPacket.setLength(0);
-					memmove(myReadBuf, &myReadBuf[i], myReadCount + (unsigned int)numRead - i); // TODO update range/index/pointer instead
-					numRead -= (int)(i - myReadCount);
-					myReadCount -= i;
-					i = 0;
-					continue;
-				}
-				if (myReadBuf[i] == '\003')
-				{
-
-					myPacket.dataToBuf(myReadBuf, i + 1);
-					myPacket.resetRead();
-					packet = new ArLMS1XXPacket;
-					packet->duplicatePacket(&myPacket); // TODO would it be better to avoid this, or is this the best way?
-					myPacket.empty();
-					myPacket.setLength(0);
-
-					// if it's the end of the data just go back to the beginning
-					//printf("i=%d, myReadCount = %d, numRead = %d\n",i, myReadCount, numRead);
-
-					ArLog::log(myInfoLogLevel, "%s::receiveTiMPacket() i=%d, myReadCount = %d, numRead = %d",
-									myName, i, myReadCount, numRead);
-
-					if (i == myReadCount + (unsigned int)numRead - 1)
-					{
-						ArLog::log(myInfoLogLevel, "%s::receiveTiMPacket() Starting again", myName);
-						myState = STARTING;
-					}
-					// if it isn't move the data up and start again
-					else
-					{
-					    myState = STARTING;
-					    ArLog::log(myInfoLogLevel, "%s::receivePacket() Got remainder, %d bytes beyond one packet ... ignoring it",
-						       myName,myReadCount);
-					}
-					return packet;
-				}
-			}
-			//printf("didn't get enough bytes\n");
-			myReadCount += (unsigned int)numRead;
-			if (numRead != 0)
-				ArLog::log(myInfoLogLevel, "%s::receivePacket() Got %d bytes (but not end char), up to %d",
-						myName, numRead, myReadCount);
-		}
-		else
-		{
-			ArLog::log(ArLog::Terse, "%s::receivePacket() Bad state (%d)",
-					myName,myState);
-			myState = STARTING;
-		}
-	} while (timeDone.mSecTo() >= 0); // || !myStarting)
-
-	return NULL;
+	return receivePacket(msWait, scandataShortcut, true);
 }
 
 
@@ -861,7 +564,7 @@ AREXPORT ArLMS1XX::ArLMS1XX(int laserNumber,
     myLaserModelFamily = TiM;
 
 	clear();
-	myRawReadings = new std::list<ArSensorReading *>;
+	myRawReadings = myLaserReadings.getList();
 
 	Aria::addExitCallback(&myAriaExitCB, -10);
 
@@ -1077,13 +780,6 @@ AREXPORT ArLMS1XX::~ArLMS1XX()
 		myRobot->remLaser(this);
 		myRobot->remSensorInterpTask(&mySensorInterpTask);
 	}
-	if (myRawReadings != NULL)
-	{
-		ArUtil::deleteSet(myRawReadings->begin(), myRawReadings->end());
-		myRawReadings->clear();
-		delete myRawReadings;
-		myRawReadings = NULL;
-	}
 	lockDevice();
 	if (isConnected())
 		disconnect();
@@ -1115,7 +811,6 @@ void ArLMS1XX::clear()
 	myNumberEncoders = 0;
 	myNumChans16Bit = 0;
 	myNumChans8Bit = 0;
-	myFirstReadings = true;
 }
 
 AREXPORT void ArLMS1XX::laserSetName(const char *name)
@@ -1237,7 +932,7 @@ void ArLMS1XX::sensorInterp ()
 		(retEncoder =
 		myRobot->getEncoderPoseInterpPosition(time, &encoderPose)) < 0)
 		{
-		ArLog::log(ArLog::Normal, "%s::sensorInterp() reading too old to process", getName());
+		ARLOG_THROTTLED(mySensorInterpLogThrottle, ArLog::Normal, "%s::sensorInterp() reading too old to process", getName());
 		delete packet;
 		continue;
 		}
@@ -1333,7 +1028,7 @@ void ArLMS1XX::sensorInterp ()
 		} else if ( (ret = myRobot->getPoseInterpPosition (time, &pose)) < 0 ||
 		            (retEncoder =
 		               myRobot->getEncoderPoseInterpPosition (time, &encoderPose)) < 0) {
-			ArLog::log (ArLog::Normal, "%s::sensorInterp() reading too old to process", getName());
+			ARLOG_THROTTLED (mySensorInterpLogThrottle, ArLog::Normal, "%s::sensorInterp() reading too old to process", getName());
 			delete packet;
 			unlockDevice();
 			myDataMutex.unlock();
@@ -1375,7 +1070,6 @@ void ArLMS1XX::sensorInterp ()
 		char eachChanMeasured[1024];
 		//double eachAngularStepWidth;
 		size_t eachNumberData = 0;
-		std::list<ArSensorReading *>::iterator it;
 		double atDeg = 0; // angle of reading transformed according to sensorPoseTh parameter
     double atDegLocal = 0; // angle of reading local to laser
 		size_t onReading;
@@ -1431,26 +1125,6 @@ void ArLMS1XX::sensorInterp ()
 			eachStartingAngle, eachAngularStepWidth,
 			eachNumberData);
 			*/
-			// If we don't have any sensor readings created at all, make 'em all
-			if (myRawReadings->size() == 0)
-				for (size_t j = 0; j < eachNumberData; j++)
-					myRawReadings->push_back (new ArSensorReading);
-
-			if (eachNumberData > myRawReadings->size()) {
-				ArLog::log (ArLog::Terse, "%s::sensorInterp() Bad data, in theory have %d readings but can only have %d... skipping this packet\n",
-				            getName(), myRawReadings->size(), eachNumberData);
-				//printf("%s\n", packet->getBuf());
-				delete packet;
-				unlockDevice();
-				myDataMutex.unlock();
-				continue;
-			}
-
-      // TODO? Move some of the logic below regarding projecting from rays to
-      // cartesian points based on sensor position, flipped, etc. to ArLaser,
-      // ArRangeDevice or ArSensorReading so other laser and sensor classes can
-      // use it?
-
       // first iteration:
 			if (!startedProcessing) {
         startLocal = -1 * ((double)(eachNumberData - 1) * eachAngularStepWidth) / 2.0;
@@ -1477,30 +1151,39 @@ void ArLMS1XX::sensorInterp ()
 						start, mySensorPose.getTh(), eachStartingAngle, eachAngularStepWidth, eachNumberData);
 					*/
 				}
+				// lay the readings out for these beams (which only works out
+				// the sin/cos of each beam again if something changed)
+				myLaserReadings.setRays (eachNumberData,
+				                         ArMath::roundInt (mySensorPose.getX()),
+				                         ArMath::roundInt (mySensorPose.getY()),
+				                         start, increment);
+			}
+
+			if (eachNumberData > myLaserReadings.getNumReadings()) {
+				ArLog::log (ArLog::Terse, "%s::sensorInterp() Bad data, in theory have %d readings but can only have %d... skipping this packet\n",
+				            getName(), myLaserReadings.getNumReadings(), eachNumberData);
+				//printf("%s\n", packet->getBuf());
+				delete packet;
+				unlockDevice();
+				myDataMutex.unlock();
+				continue;
 			}
 			startedProcessing = true;
 			bool ignore;
 
 			for (atDeg = start,
            atDegLocal = startLocal,
-			     it = myRawReadings->begin(),
 			     onReading = 0;
 			     onReading < eachNumberData;
 			     // MPL trying to fix bug with negative readings
 			     //atDeg += increment,
 			     atDeg = ArMath::addAngle(atDeg, increment),
            atDegLocal = ArMath::addAngle(atDegLocal, eachAngularStepWidth),
-			     it++,
 			     onReading++) {
 
 				ignore = false;
 
-        ArSensorReading* reading = (*it);
-
-				if (myFirstReadings)
-					reading->resetSensorPosition (ArMath::roundInt (mySensorPose.getX()),
-					                              ArMath::roundInt (mySensorPose.getY()),
-					                              atDeg);
+        ArSensorReading* reading = myLaserReadings.getReading(onReading);
 
         // was configured to have restricted fov, set ignore flag. (Move to ArLaser or other shared class?)
         if (    (canSetDegrees()    && (atDegLocal < getStartDegrees()             || atDegLocal > getEndDegrees()))
@@ -1552,8 +1235,8 @@ void ArLMS1XX::sensorInterp ()
 					  eachChanMeasured, dist);
 					  }
 					*/
-					reading->newData (dist, pose, encoderPose, transform, counter,
-					                  time, ignore, 0); // no reflector yet
+					// projected with the rest of the readings below
+					myLaserReadings.setRange (onReading, dist, ignore, 0); // no reflector yet
 				} else if (measuringReflectance) {
 					const int refl = packet->bufToUByte2();
 					if (refl > 254 * 255) {
@@ -1566,6 +1249,10 @@ void ArLMS1XX::sensorInterp ()
 					}
 				}
 			}
+			// work out where all of the readings are at once
+			if (measuringDistance)
+				myLaserReadings.project (0, eachNumberData, pose, encoderPose,
+				                         transform, counter, time);
 			/*
 			ArLog::log(ArLog::Normal,
 			"Received: %s %s scan %d numReadings %d",
@@ -1574,11 +1261,6 @@ void ArLMS1XX::sensorInterp ()
 			*/
 		} // end for 16bit
 
-		// if we processed the readings and they were our first ones set
-		// it so it's not our first ones anymore so that we only do the
-		// sin/cos once
-		if (startedProcessing && myFirstReadings)
-			myFirstReadings = false;
 		// read the 8 bit channels, that's just reflectance for now
 		myNumChans8Bit = packet->bufToUByte2();
 		//myLogLevel,
@@ -1627,13 +1309,11 @@ void ArLMS1XX::sensorInterp ()
 				            eachChanMeasured8Bit);
 
 			for (atDeg = start,
-			     it = myRawReadings->begin(),
 			     onReading = 0;
 			     onReading < eachNumberData;
 			     atDeg += increment,
-			     it++,
 			     onReading++) {
-				ArSensorReading *reading = (*it);
+				ArSensorReading *reading = myLaserReadings.getReading(onReading);
 				const int refl = packet->bufToUByte();
 				if (refl == 254) {
 					reading->setExtraInt (32);
@@ -2954,9 +2634,11 @@ bool ArLMS1XX::validateCheckSum(ArLMS1XXPacket *packet)
 {
 
   // XOR all values in the message including the checksum, which should result
-  // in 0.
+  // in 0.  The values are collected and then XORed all at once.
 
   unsigned short checksum = 0;
+  unsigned char values[1024];
+  size_t numValues = 0;
   char str[1024];
   char *pch;
   //unsigned char val = 0;
@@ -2976,11 +2658,11 @@ bool ArLMS1XX::validateCheckSum(ArLMS1XXPacket *packet)
 
 		if (pch[0] != '0') {
 			if (strcmp(pch, "DIST1") == 0) {
-				checksum ^= 0x44;
-				checksum ^= 0x49;
-				checksum ^= 0x53;
-				checksum ^= 0x54;
-				checksum ^= 0x31;
+				values[numValues++] = 0x44;
+				values[numValues++] = 0x49;
+				values[numValues++] = 0x53;
+				values[numValues++] = 0x54;
+				values[numValues++] = 0x31;
 			}
 			else {
 				// if it's an odd number - do the 1st byte
@@ -2999,7 +2681,7 @@ bool ArLMS1XX::validateCheckSum(ArLMS1XXPacket *packet)
 						}
 					)
 
-					checksum ^= val;
+					values[numValues++] = (unsigned char) val;
 
 					pch = &pch[1];
 
@@ -3036,7 +2718,7 @@ bool ArLMS1XX::validateCheckSum(ArLMS1XXPacket *packet)
 					)
 
 
-					checksum ^= (unsigned short)(val1 | (val << 4));       // Calculate the checksum... (XOR)
+					values[numValues++] = (unsigned char)(val1 | (val << 4));
 
 					pch = &pch[2];
 				}
@@ -3044,6 +2726,7 @@ bool ArLMS1XX::validateCheckSum(ArLMS1XXPacket *packet)
 		}
 		pch = strtok(NULL, " ");
 	} // end while
+	checksum = ArChecksum::xorFold(values, numValues);
 
 
   IFDEBUG(
@@ -79,10 +79,9 @@ AREXPORT ArLMS2xx::ArLMS2xx(
   laserAllowAutoBaudChoices("38400", baudChoices);
 
 
-  myAssembleReadings = new std::list<ArSensorReading *>;
-  myCurrentReadings = new std::list<ArSensorReading *>;
-  myRawReadings = myCurrentReadings;
-  myIter = myAssembleReadings->begin();
+  myAssembleReadings = &myLaserReadings[0];
+  myCurrentReadings = &myLaserReadings[1];
+  myRawReadings = myCurrentReadings->getList();
   myConn = NULL;
   myRobot = NULL;
   myStartConnect = false;
@@ -187,10 +186,7 @@ AREXPORT bool ArLMS2xx::simPacketHandler(ArRobotPacket *packet)
 
   unsigned int totalNumReadings;
   unsigned int readingNumber;
-  double atDeg;
   unsigned int i;
-  ArSensorReading *reading;
-  std::list<ArSensorReading *>::iterator tempIt;
   unsigned int newReadings;
   //int range;
   int refl = 0;
@@ -238,57 +234,23 @@ AREXPORT bool ArLMS2xx::simPacketHandler(ArRobotPacket *packet)
     mySimPacketCounter = myRobot->getCounter();
   }
   //printf("ArLMS2xx::simPacketHandler: On reading number %d out of %d, new %d\n", readingNumber, totalNumReadings, newReadings);
-  // if we have too many readings in our list of raw readings, pop the extras
-  while (myAssembleReadings->size() > totalNumReadings)
-  {
-    ArLog::log(ArLog::Verbose, "ArLMS2xx::simPacketHandler, too many readings, popping one.");
-    tempIt = myAssembleReadings->begin();
-    if (tempIt != myAssembleReadings->end())
-      delete (*tempIt);
-    myAssembleReadings->pop_front();
-  }
-  
-  // If we don't have any sensor readings created at all, make 'em all now
-  if (myAssembleReadings->size() == 0)
-    for (i = 0; i < totalNumReadings; i++)
-      myAssembleReadings->push_back(new ArSensorReading);
-  
-  // Okay, we know where we're at, so get an iterator to the right spot, or 
-  // make sure the one we keep around is in the right spot... if neither of
-  // these trigger, then the iter should be in the right spot
-  if ((readingNumber != myWhichReading + 1) || 
-      totalNumReadings != myTotalNumReadings)
-  {
-    //printf("2\n");
-    myWhichReading = readingNumber;
-    myTotalNumReadings = totalNumReadings;
-    for (i = 0, myIter = myAssembleReadings->begin(); i < readingNumber; i++)
-    {
-      tempIt = myIter;
-      tempIt++;
-      if (tempIt == myAssembleReadings->end() && (i + 1 != myTotalNumReadings))
-	myAssembleReadings->push_back(new ArSensorReading);
-      myIter++;
-    }
-  }
-  else
-  {
-    //printf("3\n");
-    myWhichReading = readingNumber;
-  }
+  // make as many readings as there are in the whole set (this only works
+  // the beams out again if they changed)
+  myAssembleReadings->setRays(totalNumReadings,
+			      ArMath::roundInt(mySensorPose.getX()),
+			      ArMath::roundInt(mySensorPose.getY()),
+			      mySensorPose.getTh() - myOffsetAmount,
+			      myIncrementAmount);
 
-  atDeg = (mySensorPose.getTh() - myOffsetAmount + 
-	   readingNumber * myIncrementAmount);
   //printf("4\n");
   encoderPose = mySimPacketEncoderTrans.doInvTransform(mySimPacketStart);
   // while we have in the readings and have stuff left we can read 
   for (i = 0; 
        //	 (myWhichReading < myTotalNumReadings && 
        //	  packet->getReadLength() < packet->getLength() - 4);
-       i < newReadings;
-       i++, myWhichReading++, atDeg += myIncrementAmount)
+       i < newReadings && readingNumber + i < totalNumReadings;
+       i++)
   {
-    reading = (*myIter);
     const unsigned int range = packet->bufToUByte2();
     if(isExtendedPacket)
     {
@@ -317,36 +279,22 @@ AREXPORT bool ArLMS2xx::simPacketHandler(ArRobotPacket *packet)
     if (myMaxRange != 0 && range > (int)myMaxRange)
       ignore = true;
     */
-    reading->resetSensorPosition(ArMath::roundInt(mySensorPose.getX()),
-				 ArMath::roundInt(mySensorPose.getY()),
-				 atDeg);
     //      printf("dist %d\n", dist);
-    reading->newData(range, mySimPacketStart, 
-		     encoderPose,
-		     mySimPacketTrans,
-		     mySimPacketCounter, packet->getTimeReceived(), ignore, refl);
+    myAssembleReadings->setRange(readingNumber + i, range, ignore, refl);
     //printf("%d ", range);
-
-    //addReading(reading->getX(), reading->getY());
-    tempIt = myIter;
-    tempIt++;
-    if (tempIt == myAssembleReadings->end() && 
-	myWhichReading + 1 != myTotalNumReadings)
-    {
-      myAssembleReadings->push_back(new ArSensorReading);
-    }
-    myIter++;
   }
+  myAssembleReadings->project(readingNumber, i, mySimPacketStart, encoderPose,
+			      mySimPacketTrans, mySimPacketCounter,
+			      packet->getTimeReceived());
   
   // check if the sensor set is complete
   //printf("%d %d %d\n", newReadings, readingNumber, totalNumReadings);
   if (newReadings + readingNumber >= totalNumReadings)
   {
     // set ArRangeDevice buffer
-    myRawReadings = myAssembleReadings;
+    myRawReadings = myAssembleReadings->getList();
     // switch internal buffers
-    myAssembleReadings = myCurrentReadings;
-    myCurrentReadings = myRawReadings;
+    std::swap(myAssembleReadings, myCurrentReadings);
     // We have in all the readings, now sort 'em and update the current ones
     //filterReadings();
     laserProcessReadings();
@@ -1322,12 +1270,10 @@ AREXPORT void ArLMS2xx::processPacket(ArLMS2xxPacket *packet, ArPose pose,
   unsigned int value;
   int reflector = 0;
   unsigned int numReadings;
-  unsigned int i;
   double atDeg;
   unsigned int onReading;
   ArSensorReading *reading;
   unsigned int dist;
-  std::list<ArSensorReading *>::iterator tempIt;
   ArTransform transform;
   //std::list<double>::iterator ignoreIt;  
   bool ignore;
@@ -1370,31 +1316,22 @@ AREXPORT void ArLMS2xx::processPacket(ArLMS2xxPacket *packet, ArPose pose,
     /*printf("Reading number %d, complete %d, unit: %d %d:\n", numReadings,
       !(bool)(value & ArUtil::BIT13), (bool)(value & ArUtil::BIT14),
       (bool)(value & ArUtil::BIT15));*/
-    while (myAssembleReadings->size() > numReadings)
-    {
-      ArLog::log(ArLog::Verbose, "%s::processPacket, too many readings, popping one.",
-		 getName());
-      tempIt = myAssembleReadings->begin();
-      if (tempIt != myAssembleReadings->end())
-	delete (*tempIt);
-      myAssembleReadings->pop_front();
-    }
-    
-    // If we don't have any sensor readings created at all, make 'em all 
-    if (myAssembleReadings->size() == 0)
-      for (i = 0; i < numReadings; i++)
-	myAssembleReadings->push_back(new ArSensorReading);
+    // make as many readings as there are (this only works the beams out
+    // again if they changed, or if the last scan was deinterlaced)
+    myAssembleReadings->setRays(numReadings,
+				ArMath::roundInt(mySensorPose.getX()),
+				ArMath::roundInt(mySensorPose.getY()),
+				mySensorPose.getTh() - myOffsetAmount,
+				myIncrementAmount);
 
     transform.setTransform(pose);
     //deinterlaceDelta = transform.doInvTransform(deinterlacePose);
     // printf("usePose2 %d, th1 %.0f th2 %.0f\n",  usePose2, pose.getTh(), pose2.getTh());
-    for (atDeg = mySensorPose.getTh() - myOffsetAmount, onReading = 0,
-	 myIter = myAssembleReadings->begin();
+    for (atDeg = mySensorPose.getTh() - myOffsetAmount, onReading = 0;
 	 (onReading < numReadings && 
 	  packet->getReadLength() < packet->getLength() - 4);
-	 myWhichReading++, atDeg += myIncrementAmount, myIter++, onReading++)
+	 atDeg += myIncrementAmount, onReading++)
     {
-      reading = (*myIter);
       //reading->resetSensorPosition(0, 0, 0);
 
       //value = packet->bufToUByte2() & 0x1fff;
@@ -1445,41 +1382,48 @@ AREXPORT void ArLMS2xx::processPacket(ArLMS2xxPacket *packet, ArPose pose,
       if (myMaxRange != 0 && dist > (int)myMaxRange)
 	ignore = true;
       */
-      if (deinterlace && (onReading % 2) == 0)
+      // deinterlaced readings each have their own sensor position and
+      // time, so they go into the readings one at a time
+      if (deinterlace)
       {
-	reading->resetSensorPosition(
+	reading = myAssembleReadings->getReading(onReading);
+	if ((onReading % 2) == 0)
+	{
+	  reading->resetSensorPosition(
 	       ArMath::roundInt(mySensorPose.getX() + deinterlaceDelta.getX()),
 	       ArMath::roundInt(mySensorPose.getY() + deinterlaceDelta.getY()),
 	       ArMath::addAngle(atDeg, deinterlaceDelta.getTh()));
-	reading->newData(dist, pose, encoderPose, transform, counter, 
-			 deinterlaceTime, ignore, reflector);
+	  reading->newData(dist, pose, encoderPose, transform, counter, 
+			   deinterlaceTime, ignore, reflector);
+	}
+	else
+	{
+	  reading->resetSensorPosition(ArMath::roundInt(mySensorPose.getX()),
+				       ArMath::roundInt(mySensorPose.getY()),
+				       atDeg); 
+	  reading->newData(dist, pose, encoderPose, transform, counter, 
+			   arTime, ignore, reflector);
+	}
       }
       else
       {
-	reading->resetSensorPosition(ArMath::roundInt(mySensorPose.getX()),
-				     ArMath::roundInt(mySensorPose.getY()),
-				     atDeg); 
-	reading->newData(dist, pose, encoderPose, transform, counter, 
-			 arTime, ignore, reflector);
+	myAssembleReadings->setRange(onReading, dist, ignore, reflector);
       }
       /*
       reading->newData(onReading, 0, 0, 0,
 		       ArTransform(), counter, 
 		       packet->getTimeReceived());
       */
-      tempIt = myIter;
-      tempIt++;
-      if (tempIt == myAssembleReadings->end() && 
-	  onReading + 1 != numReadings)
-      {
-	myAssembleReadings->push_back(new ArSensorReading);
-      }
     }
+    if (deinterlace)
+      myAssembleReadings->invalidate();
+    else
+      myAssembleReadings->project(0, onReading, pose, encoderPose, transform,
+				  counter, arTime);
     // set ArRangeDevice buffer, switch internal buffers
-    myRawReadings = myAssembleReadings;
+    myRawReadings = myAssembleReadings->getList();
     //printf("Readings? 0x%x\n", myRawReadings);
-    myAssembleReadings = myCurrentReadings;
-    myCurrentReadings = myRawReadings;
+    std::swap(myAssembleReadings, myCurrentReadings);
     //printf("\n");
     myLastReading.setToNow();
     //filterReadings();
@@ -24,6 +24,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArExport.h"
 #include "Aria/ariaOSDef.h"
 #include "Aria/ArLMS2xxPacket.h"
+#include "Aria/ArChecksum.h"
 #include "stdio.h"
 
 AREXPORT ArLMS2xxPacket::ArLMS2xxPacket(unsigned char sendingAddress) :
@@ -126,29 +127,8 @@ AREXPORT void ArLMS2xxPacket::duplicatePacket(ArLMS2xxPacket *packet)
 
 AREXPORT int16_t ArLMS2xxPacket::calcCRC()
 {
-  unsigned short uCrc16;
-  unsigned char abData[2];
-  unsigned int uLen = myLength;
-  unsigned char * commData = (unsigned char *)myBuf;
-
-  uCrc16 = 0;
-  abData[0] = 0;
-  while (uLen--)
-  {
-    abData[1] = abData[0];
-    abData[0] = *commData++;
-    if (uCrc16 & 0x8000)
-    {
-      uCrc16 = (unsigned short)((uCrc16 & 0x7fff) << 1);
-      uCrc16 ^= 0x8005;
-    }
-    else
-    {
-      uCrc16 <<= 1;
-    }
-    uCrc16 ^= (unsigned short)(abData[0] | (abData[1] << 8));
-  }
-  return (int16_t)uCrc16;
+  return (int16_t) ArChecksum::crc16LMS2xx((const unsigned char *) myBuf, 
+					   myLength);
 }
 
 AREXPORT bool ArLMS2xxPacket::verifyCRC() 
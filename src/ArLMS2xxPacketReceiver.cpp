@@ -128,7 +128,7 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
       myDeviceConn->debugStartPacket();
 
     assert(timeToRunFor >= 0 && timeToRunFor <= UINT_MAX);
-    if (myDeviceConn->read((char *)&c, 1, (unsigned int)timeToRunFor) == 0) 
+    if (myDeviceConn->readBuffered((char *)&c, 1, (unsigned int)timeToRunFor) == 0) 
     {
       myDeviceConn->debugBytesRead(0);
       if (state == STATE_START)
@@ -184,6 +184,7 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
       {
 	ArLog::log(ArLog::Terse, 
 		   "ArLMS2xxPacketReceiver::receivePacket: wrong address (0x%x instead of 0x%x)", c, (unsigned) 0x80 + myReceivingAddress);
+	myDeviceConn->ioStatsResync(2);
 	state = STATE_START;
       }
       break;
@@ -207,6 +208,7 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
       {
         ArLog::log(ArLog::Normal, 
           "ArLMS2xxPacketReceiver::receivePacket: packet too long, it is %d long while the maximum is %d.", packetLength, myPacket.getMaxLength());
+        myDeviceConn->ioStatsBadPacket(false);
         state = STATE_START;
         //myPacket.log();
         break;
@@ -220,7 +222,7 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
       {
         const long len = maxPktLen - count;
         assert(len >= 0 && len <= UINT_MAX);
-        numRead = myDeviceConn->read(buf + count, (unsigned int)len, 1);
+        numRead = myDeviceConn->readBuffered(buf + count, (unsigned int)len, 1);
         if (numRead > 0)
         {	
           myDeviceConn->debugBytesRead(numRead);
@@ -242,6 +244,7 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
       if (myPacket.verifyCRC()) 
       {
         myPacket.resetRead();
+        myDeviceConn->ioStatsGoodPacket(0);
         myDeviceConn->debugEndPacket(true, myPacket.getID());
         //printf("Received ");
         //myPacket.log();
@@ -258,6 +261,7 @@ AREXPORT ArLMS2xxPacket *ArLMS2xxPacketReceiver::receivePacket(
       {
         ArLog::log(ArLog::Normal, 
           "ArLMS2xxPacketReceiver::receivePacket: bad packet, bad checksum");
+        myDeviceConn->ioStatsBadPacket(true);
         state = STATE_START;
         //myPacket.log();
         break;
@@ -65,6 +65,9 @@ AREXPORT ArLaser::ArLaser(
 
   myHaveSensorPose = false;
 
+  myCumulativeCleanDist = 0;
+  myCumulativeCleanDistSquared = 0;
+
   myFlipped = false;
   myFlippedSet = false;
 
@@ -179,7 +182,8 @@ AREXPORT void ArLaser::laserSetAbsoluteMaxRange(unsigned int absoluteMaxRange)
 
    This must be called for the laser subclass to work right.
 
-   This also calls the reading callbacks.
+   This also publishes a copy of the raw readings for
+   ArRangeDevice::getLatestScan(), then calls the reading callbacks.
 **/
 
 void ArLaser::laserProcessReadings()
@@ -203,6 +207,14 @@ void ArLaser::laserProcessReadings()
     clean = false;
   }
   
+  // cells about as big as the distances looked at around each reading
+  double cellSize = 500;
+  if (getMinDistBetweenCumulative() > cellSize)
+    cellSize = getMinDistBetweenCumulative();
+  if (myCumulativeCleanDist > cellSize)
+    cellSize = myCumulativeCleanDist;
+  myCumulativeGrid.setCellSize(cellSize);
+
   myCurrentBuffer.setPoseTaken(myRawReadings->front()->getPoseTaken());
   myCurrentBuffer.setEncoderPoseTaken(
 	  myRawReadings->front()->getEncoderPoseTaken());
@@ -294,10 +306,13 @@ void ArLaser::laserProcessReadings()
     //i++;
   }
   myCurrentBuffer.endRedoBuffer();
+  // take the readings that were cleaned out of the cumulative buffer
+  myCumulativeGrid.flush(&myCumulativeBuffer);
   /*  Put this in to see how long the cumulative filtering is taking  
   if (clean)
     printf("### %ld %d\n", len.mSecSince(), myCumulativeBuffer.getBuffer()->size());
     */
+  publishScan();
   internalGotReading();
 }
 
@@ -345,51 +360,52 @@ void ArLaser::internalProcessReading(double x, double y,
     return;
   // until here
   
-  // if we're cleaning we start our sweep
+  // the grid finds the cumulative readings near this one, the readings
+  // it cleans out are taken out of the buffer at the end of
+  // laserProcessReadings()
+  myCumulativeGrid.sync(myCumulativeBuffer);
+  // if its closer to a reading than the filter near dist, just return
+  if (addReading && myCumulativeGrid.getNumReadings() > 0 &&
+      (myMinDistBetweenCumulativeSquared < .0000001 ||
+       myCumulativeGrid.anyWithin(x, y, myMinDistBetweenCumulativeSquared)))
+  {
+    // if we're not cleaning it and its too close just return,
+    // otherwise keep going (to clear out invalid readings)
+    if (!clean)
+      return;
+    addReading = false;
+  }
+  // see if this reading invalidates some other readings by coming too close
   if (clean)
-    myCumulativeBuffer.beginInvalidationSweep();
-  // run through all the readings
-  for (auto cit = getCumulativeReadings().begin(); 
-       cit != getCumulativeReadings().end(); 
-       ++cit)
   {
-    // if its closer to a reading than the filter near dist, just return
-    if (addReading && ( myMinDistBetweenCumulativeSquared < .0000001 ||
-      (ArMath::squaredDistanceBetween(x, y, (*cit).getX(), (*cit).getY()) <
-      myMinDistBetweenCumulativeSquared) ) )
-    {
-      // if we're not cleaning it and its too close just return,
-      // otherwise keep going (to clear out invalid readings)
-      if (!clean)
-	      return;
-      addReading = false;
-    }
-    // see if this reading invalidates some other readings by coming too close
-    if (clean)
+    // set up our line
+    const ArLineSegment line(x, y, xTaken, yTaken);
+    myCumulativeGrid.findNearSegment(x, y, xTaken, yTaken,
+				     myCumulativeCleanDist,
+				     &myCumulativeNearLine);
+    for (auto cit = myCumulativeNearLine.cbegin(); 
+	 cit != myCumulativeNearLine.cend(); 
+	 ++cit)
     {
-      // set up our line
-      const ArLineSegment line(x, y, xTaken, yTaken);
+      const ArPose cumReading(cit->x, cit->y);
       // see if the cumulative buffer reading perpindicular intersects
       // this line segment, and then see if its too close if it does,
       // but if the intersection is very near the endpoint then leave it
       bool found;
-      const ArPose intersection(line.perpendicularPoint(*cit, &found));
+      const ArPose intersection(line.perpendicularPoint(cumReading, &found));
       if (found &&
-        (intersection.squaredFindDistanceTo(*cit) < myCumulativeCleanDistSquared) &&
+        (intersection.squaredFindDistanceTo(cumReading) < myCumulativeCleanDistSquared) &&
         (intersection.squaredFindDistanceTo(reading) >  (50 * 50) )
       )
       {
         //printf("Found one too close to the line\n");
-        myCumulativeBuffer.invalidateReading(cit);
+        myCumulativeGrid.remove(*cit);
       }
     }
   }
-  // if we're cleaning finish the sweep
-  if (clean)
-    myCumulativeBuffer.endInvalidationSweep();
   // toss the reading in
   if (addReading)
-    myCumulativeBuffer.addReading(x, y);
+    myCumulativeGrid.addReading(&myCumulativeBuffer, x, y);
 
 }
 
@@ -26,6 +26,8 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArRobot.h"
 #include "Aria/ArConfig.h"
 
+#include <limits.h>
+
 //#define DEBUGRANGEFILTER
 
 AREXPORT ArLaserFilter::ArLaserFilter(
@@ -35,7 +37,10 @@ AREXPORT ArLaserFilter::ArLaserFilter(
 	  laser->getAbsoluteMaxRange(),
 	  laser->isLocationDependent(),
 	  false),
-  myProcessCB(this, &ArLaserFilter::processReadings)
+  myProcessCB(this, &ArLaserFilter::processReadings),
+  myProcessImmediately(false),
+  myNeighborAngleToCheck(0),
+  myNeighborsInOrder(false)
 {
   myLaser = laser;
 
@@ -154,6 +159,8 @@ AREXPORT ArLaserFilter::~ArLaserFilter()
     myRobot->remSensorInterpTask(&myProcessCB);
     myRobot->remLaser(this);
   }
+  if (myProcessImmediately)
+    myLaser->remReadingCB(&myProcessCB);
 }
 
 AREXPORT void ArLaserFilter::addToConfig(ArConfig *config, 
@@ -228,11 +235,39 @@ AREXPORT void ArLaserFilter::setRobot(ArRobot *robot)
   if (myRobot != NULL)
   {
     myRobot->remSensorInterpTask(&myProcessCB);
-    myRobot->addSensorInterpTask(myName.c_str(), 51, &myProcessCB);
+    if (!myProcessImmediately)
+      myRobot->addSensorInterpTask(myName.c_str(), 51, &myProcessCB);
   }
   ArLaser::setRobot(robot);
 }
 
+/**
+   Normally the readings are filtered in a sensor interpretation task on
+   the robot, so a scan waits for the next robot cycle (or the one after)
+   to be filtered.  If @a processImmediately is true, each scan is
+   filtered as soon as the base laser has processed it instead (from a
+   reading callback on the base laser, see ArLaser::addReadingCB()), in
+   whatever thread the base laser processes its readings in.
+**/
+AREXPORT void ArLaserFilter::setProcessImmediately(bool processImmediately)
+{
+  if (processImmediately == myProcessImmediately)
+    return;
+  myProcessImmediately = processImmediately;
+  if (myProcessImmediately)
+  {
+    if (myRobot != NULL)
+      myRobot->remSensorInterpTask(&myProcessCB);
+    myLaser->addReadingCB(&myProcessCB);
+  }
+  else
+  {
+    myLaser->remReadingCB(&myProcessCB);
+    if (myRobot != NULL)
+      myRobot->addSensorInterpTask(myName.c_str(), 51, &myProcessCB);
+  }
+}
+
 void ArLaserFilter::processReadings()
 {
   myLaser->lockDevice();
@@ -274,10 +309,11 @@ void ArLaserFilter::processReadings()
   file = ArUtil::fopen("/tmp/filter", "w");
 #endif
 
-  std::map<int, ArSensorReading *> readingMap;
-  int numReadings = 0;
+  size_t numReadings = 0;
+  myRanges.resize(rdRawSize);
+  myAngles.resize(rdRawSize);
 
-  // first pass to copy the readings and put them into a map
+  // first pass to copy the readings, and their ranges and angles
   for (rdIt = rdRawReadings->begin(), it = myRawReadings->begin();
        rdIt != rdRawReadings->end() && it != myRawReadings->end();
        rdIt++, it++)
@@ -286,7 +322,8 @@ void ArLaserFilter::processReadings()
     reading = (*it);
     *reading = *rdReading;
 
-    readingMap[numReadings] = reading;
+    myRanges[numReadings] = reading->getRange();
+    myAngles[numReadings] = reading->getSensorTh();
     numReadings++;
   }
 
@@ -305,14 +342,15 @@ void ArLaserFilter::processReadings()
     return;
   }
   
-  int i;
-  int j;
-  //ArSensorReading *lastAddedReading = NULL;
+  findNeighbors(numReadings);
+  findNeighborRanges(numReadings);
+
+  size_t i;
   
   // now walk through the readings to filter them
-  for (i = 0; i < numReadings; i++)
+  for (i = 0, it = myRawReadings->begin(); i < numReadings; i++, it++)
   {
-    reading = readingMap[i];
+    reading = (*it);
 
     // if we're ignoring this reading then just get on with life
     if (reading->getIgnoreThisReading())
@@ -333,9 +371,10 @@ void ArLaserFilter::processReadings()
       continue;
     }
     */
-    if (myAnyMinRange >= 0 && reading->getRange() < myAnyMinRange &&
-	(reading->getSensorTh() < myAnyMinRangeLessThanAngle ||
-	 reading->getSensorTh() > myAnyMinRangeGreaterThanAngle))
+    const unsigned int range = myRanges[i];
+    const bool minRangeAngle = (myAngles[i] < myAnyMinRangeLessThanAngle ||
+				myAngles[i] > myAnyMinRangeGreaterThanAngle);
+    if (myAnyMinRange >= 0 && range < myAnyMinRange && minRangeAngle)
     {
 #ifdef DEBUGRANGEFILTER
       if (file != NULL)
@@ -346,125 +385,41 @@ void ArLaserFilter::processReadings()
       continue;
     }
 
-    /*
-    if (lastAddedReading != NULL)
-    {
-
-      if (lastAddedReading->getPose().findDistanceTo(reading->getPose()) < 50)
-      {
-#ifdef DEBUGRANGEFILTER
-	if (file != NULL)
-	  fprintf(file, "%.1f too close from last %6.0f\n", 
-		  reading->getSensorTh(),
-		  lastAddedReading->getPose().findDistanceTo(
-			  reading->getPose()));
-#endif
-	reading->setIgnoreThisReading(true);
-	continue;
-      }
-#ifdef DEBUGRANGEFILTER
-      else if (file != NULL)
-	fprintf(file, "%.1f from last %6.0f\n", 
-		reading->getSensorTh(),
-		lastAddedReading->getPose().findDistanceTo(
-			reading->getPose()));
-#endif
-    }
-    */
-
-#ifdef DEBUGRANGEFILTER
-  char buf[1024];
-  buf[0] = '\0';
-#endif
-
+    // These are the same as checkRanges() against each neighbor (even
+    // ignored ones, or you get onesided filtering).  With a factor of
+    // 1 or more a reading is further than all of its neighbors times
+    // the factor if it's further than the closest one times it, and
+    // further than any of them if it's further than the furthest one
+    // times it.  A factor less than 1 is the other way around.
+    const bool hasNeighbors = (myFirstNeighbor[i] != i || 
+			       myLastNeighbor[i] != i);
+    const double closest = myMinNeighborRange[i];
+    const double furthest = myMaxNeighborRange[i];
     bool goodAll = true;
-    bool goodAny = false;
+    bool goodAny = true;
     bool goodMinRange = true;
-    if (myAnyFactor <= 0)
-      goodAny = true;
-    for (j = i - 1; 
-	 (j >= 0 && //good && 
-	  fabs(ArMath::subAngle(readingMap[j]->getSensorTh(),
-				reading->getSensorTh())) <= myAngleToCheck);
-	 j--)
-    {
-      /* You can't skip these, or you get onesided filtering
-      if (readingMap[j]->getIgnoreThisReading())
-      {
-#ifdef DEBUGRANGEFILTER
-	sprintf(buf, "%s %6s", buf, "i");
-#endif
-	continue;
-      }
-      */
-#ifdef DEBUGRANGEFILTER
-      sprintf(buf, "%s %6d", buf, readingMap[j]->getRange());
-#endif
-      if (myAllFactor > 0 && 
-	  !checkRanges(reading->getRange(), 
-		       readingMap[j]->getRange(), myAllFactor))
-	goodAll = false;
-      if (myAnyFactor > 0 &&
-	  checkRanges(reading->getRange(), 
-		      readingMap[j]->getRange(), myAnyFactor))
-	goodAny = true;
-      if (myAnyMinRange > 0 && 
-	  (reading->getSensorTh() < myAnyMinRangeLessThanAngle ||
-	   reading->getSensorTh() > myAnyMinRangeGreaterThanAngle) &&
-	  readingMap[j]->getRange() <= myAnyMinRange)
-	goodMinRange = false;
-	
-    }
-#ifdef DEBUGRANGEFILTER
-    buf[0] = '\0';
-    sprintf(buf, "%s %6d*", buf, reading->getRange());
-#endif 
-    for (j = i + 1; 
-	 (j < numReadings && //good &&
-	  fabs(ArMath::subAngle(readingMap[j]->getSensorTh(),
-				reading->getSensorTh())) <= myAngleToCheck);
-	 j++)
-    {
-      // you can't ignore these or you get one sided filtering
-      /*
-      if (readingMap[j]->getIgnoreThisReading())
-      {
-#ifdef DEBUGRANGEFILTER
-	sprintf(buf, "%s %6s", buf, "i");
-#endif
-	continue;
-      }
-      */
-#ifdef DEBUGRANGEFILTER
-      sprintf(buf, "%s %6d", buf, readingMap[j]->getRange());
-#endif
-      if (myAllFactor > 0 && 
-	  !checkRanges(reading->getRange(), 
-		       readingMap[j]->getRange(), myAllFactor))
-	goodAll = false;
-      if (myAnyFactor > 0 &&
-	  checkRanges(reading->getRange(), 
-		       readingMap[j]->getRange(), myAnyFactor))
-	goodAny = true;
-      if (myAnyMinRange > 0 && 
-	  (reading->getSensorTh() < myAnyMinRangeLessThanAngle ||
-	   reading->getSensorTh() > myAnyMinRangeGreaterThanAngle) &&
-	  readingMap[j]->getRange() <= myAnyMinRange)
-	goodMinRange = false;
-    }
-    
+    if (myAllFactor > 0 && hasNeighbors &&
+	((myAllFactor >= 1 && range > closest * myAllFactor) ||
+	 (myAllFactor < 1 && range < furthest * myAllFactor)))
+      goodAll = false;
+    if (myAnyFactor > 0 &&
+	(!hasNeighbors ||
+	 (myAnyFactor >= 1 && range > furthest * myAnyFactor) ||
+	 (myAnyFactor < 1 && range < closest * myAnyFactor)))
+      goodAny = false;
+    if (myAnyMinRange > 0 && minRangeAngle && hasNeighbors &&
+	closest <= myAnyMinRange)
+      goodMinRange = false;
 
     if (!goodAll || !goodAny || !goodMinRange)
       reading->setIgnoreThisReading(true);
-    /*
-    else
-      lastAddedReading = reading;
-    */
 #ifdef DEBUGRANGEFILTER
     if (file != NULL)
       fprintf(file, 
-	      "%5.1f %6d %c\t%s\n", reading->getSensorTh(), reading->getRange(),
-	      goodAll && goodAny && goodMinRange ? 'g' : 'b', buf);
+	      "%5.1f %6d %c\t%lu neighbors %6.0f to %6.0f\n",
+	      reading->getSensorTh(), reading->getRange(),
+	      goodAll && goodAny && goodMinRange ? 'g' : 'b', 
+	      myLastNeighbor[i] - myFirstNeighbor[i], closest, furthest);
 #endif
 	    
   }
@@ -482,6 +437,145 @@ void ArLaserFilter::processReadings()
   myLaser->unlockDevice();
 }
 
+/**
+   The neighbors of a reading are the readings next to it (on each
+   side) that are within myAngleToCheck of it, up to the first one that
+   isn't.  These only change when the angles of the readings or the
+   angle spread do, so they're kept from scan to scan.
+**/
+void ArLaserFilter::findNeighbors(size_t numReadings)
+{
+  if (myFirstNeighbor.size() == numReadings && 
+      myNeighborAngleToCheck == myAngleToCheck &&
+      myNeighborAngles == myAngles)
+    return;
+
+  myFirstNeighbor.resize(numReadings);
+  myLastNeighbor.resize(numReadings);
+  myNeighborAngles = myAngles;
+  myNeighborAngleToCheck = myAngleToCheck;
+
+  // if the angles only go one way, in steps small enough that the
+  // readings around each one don't wrap around, the neighbors of each
+  // reading start and end at or after those of the reading before it
+  bool increasing = true;
+  bool decreasing = true;
+  double maxStep = 0;
+  size_t i;
+  for (i = 1; i < numReadings; i++)
+  {
+    const double step = ArMath::subAngle(myAngles[i], myAngles[i - 1]);
+    if (step < 0)
+      increasing = false;
+    if (step > 0)
+      decreasing = false;
+    if (fabs(step) > maxStep)
+      maxStep = fabs(step);
+  }
+  myNeighborsInOrder = ((increasing || decreasing) && 
+			myAngleToCheck + 2 * maxStep < 180);
+
+  size_t first = 0;
+  size_t last = 0;
+  for (i = 0; i < numReadings; i++)
+  {
+    if (myNeighborsInOrder)
+    {
+      while (first < i && 
+	     fabs(ArMath::subAngle(myAngles[first], myAngles[i])) > 
+	     myAngleToCheck)
+	first++;
+      if (last < i)
+	last = i;
+    }
+    // otherwise walk out from each reading
+    else
+    {
+      first = i;
+      while (first > 0 &&
+	     fabs(ArMath::subAngle(myAngles[first - 1], myAngles[i])) <= 
+	     myAngleToCheck)
+	first--;
+      last = i;
+    }
+    while (last + 1 < numReadings &&
+	   fabs(ArMath::subAngle(myAngles[last + 1], myAngles[i])) <= 
+	   myAngleToCheck)
+      last++;
+    myFirstNeighbor[i] = first;
+    myLastNeighbor[i] = last;
+  }
+}
+
+/**
+   With the neighbors in order this keeps the readings in the window
+   that could still be the closest (or furthest) in a queue, so each
+   reading goes in and out of the queue once however many neighbors
+   each reading has, going through the neighbors before each reading
+   and then the ones after it.
+**/
+void ArLaserFilter::findNeighborRanges(size_t numReadings)
+{
+  myMinNeighborRange.assign(numReadings, UINT_MAX);
+  myMaxNeighborRange.assign(numReadings, 0);
+  const unsigned int *ranges = &myRanges[0];
+  size_t i;
+  size_t j;
+
+  if (!myNeighborsInOrder)
+  {
+    for (i = 0; i < numReadings; i++)
+    {
+      for (j = myFirstNeighbor[i]; j <= myLastNeighbor[i]; j++)
+      {
+	if (j == i)
+	  continue;
+	if (ranges[j] < myMinNeighborRange[i])
+	  myMinNeighborRange[i] = ranges[j];
+	if (ranges[j] > myMaxNeighborRange[i])
+	  myMaxNeighborRange[i] = ranges[j];
+      }
+    }
+    return;
+  }
+
+  myWindowMin.resize(numReadings);
+  myWindowMax.resize(numReadings);
+  size_t *windowMin = &myWindowMin[0];
+  size_t *windowMax = &myWindowMax[0];
+  for (int after = 0; after < 2; after++)
+  {
+    size_t minHead = 0, minTail = 0;
+    size_t maxHead = 0, maxTail = 0;
+    size_t next = 0;
+    for (i = 0; i < numReadings; i++)
+    {
+      // the window is start up to (not including) end
+      const size_t start = after ? i + 1 : myFirstNeighbor[i];
+      const size_t end = after ? myLastNeighbor[i] + 1 : i;
+      for (; next < end; next++)
+      {
+	while (minTail > minHead && ranges[windowMin[minTail - 1]] >= ranges[next])
+	  minTail--;
+	windowMin[minTail++] = next;
+	while (maxTail > maxHead && ranges[windowMax[maxTail - 1]] <= ranges[next])
+	  maxTail--;
+	windowMax[maxTail++] = next;
+      }
+      while (minHead < minTail && windowMin[minHead] < start)
+	minHead++;
+      while (maxHead < maxTail && windowMax[maxHead] < start)
+	maxHead++;
+      if (start >= end)
+	continue;
+      if (ranges[windowMin[minHead]] < myMinNeighborRange[i])
+	myMinNeighborRange[i] = ranges[windowMin[minHead]];
+      if (ranges[windowMax[maxHead]] > myMaxNeighborRange[i])
+	myMaxNeighborRange[i] = ranges[windowMax[maxHead]];
+    }
+  }
+}
+
 /**
    @return Return true if the reading is good, false if the reading is bad
 **/
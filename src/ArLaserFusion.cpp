@@ -0,0 +1,293 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArLaserFusion.h"
+#include "Aria/ArLaser.h"
+#include "Aria/ArRobot.h"
+
+/**
+   @param mergeDist how close (mm) a reading can be to one already merged
+   before it is left out, 0 or less to keep every reading
+   @param name the name of the device
+**/
+AREXPORT ArLaserFusion::ArLaserFusion(double mergeDist, const char *name) :
+  // the buffers grow to hold all of the lasers' readings
+  ArRangeDevice(0, 0, name, 0),
+  myMergeDist(0),
+  myMergeDistSquared(0),
+  myNumScans(0),
+  myNumCurrentMerged(0),
+  myNumCumulativeMerged(0),
+  myProcessCB(this, &ArLaserFusion::processReadings)
+{
+  setMergeDist(mergeDist);
+
+  char buf[1024];
+  sprintf(buf, "%sProcessCB", getName());
+  myProcessCB.setName(buf);
+
+  setCurrentDrawingData(
+	  new ArDrawingData("polyDots", 
+			    ArColor(0, 0, 255), 
+			    80,  // mm diameter of dots
+			    75), // layer above sonar 
+	  true);
+  setCumulativeDrawingData(
+	  new ArDrawingData("polyDots", 
+			    ArColor(125, 125, 125), 
+			    100, // mm diameter of dots
+			    60), // layer below current range devices
+	  true);
+}
+
+AREXPORT ArLaserFusion::~ArLaserFusion()
+{
+  if (myRobot != NULL)
+    myRobot->remSensorInterpTask(&myProcessCB);
+}
+
+AREXPORT void ArLaserFusion::setRobot(ArRobot *robot)
+{
+  if (myRobot != NULL)
+    myRobot->remSensorInterpTask(&myProcessCB);
+  // after the lasers' filters (ArLaserFilter)
+  if (robot != NULL)
+    robot->addSensorInterpTask(myName.c_str(), 52, &myProcessCB);
+  ArRangeDevice::setRobot(robot);
+}
+
+/**
+   Readings from the same laser are merged too, so this also thins out
+   the readings close to a laser.
+**/
+AREXPORT void ArLaserFusion::setMergeDist(double mergeDist)
+{
+  lockDevice();
+  if (mergeDist < 0)
+    mergeDist = 0;
+  myMergeDist = mergeDist;
+  myMergeDistSquared = mergeDist * mergeDist;
+  // cells as big as the distance looked at around each reading
+  myCurrentGrid.setCellSize(mergeDist);
+  myCumulativeGrid.setCellSize(mergeDist);
+  // merge everything again with the new distance
+  myLasers.clear();
+  unlockDevice();
+}
+
+AREXPORT void ArLaserFusion::applyTransform(ArTransform trans, 
+					    bool doCumulative)
+{
+  ArRangeDevice::applyTransform(trans, doCumulative);
+  if (myRobot == NULL)
+    return;
+  // the robot only transforms its own range devices
+  for (auto it = myLasers.begin(); it != myLasers.end(); ++it)
+  {
+    if (myRobot->hasRangeDevice(*it))
+      continue;
+    (*it)->lockDevice();
+    (*it)->applyTransform(trans, doCumulative);
+    (*it)->unlockDevice();
+  }
+}
+
+bool ArLaserFusion::mergeReading(ArRangeBufferGrid *grid, 
+				 ArRangeBuffer *buffer, double x, double y)
+{
+  if (myMergeDistSquared <= 0)
+  {
+    buffer->addReading(x, y);
+    return true;
+  }
+  if (grid->anyWithin(x, y, myMergeDistSquared))
+    return false;
+  grid->addReading(buffer, x, y);
+  return true;
+}
+
+AREXPORT void ArLaserFusion::processReadings()
+{
+  if (myRobot == NULL)
+    return;
+
+  lockDevice();
+
+  const std::map<int, ArLaser *> *lasers = myRobot->getLaserMap();
+  const ArTransform encoderTrans = myRobot->getEncoderTransform();
+
+  // the lasers were changed (or the merge distance) so start over
+  bool lasersChanged = lasers->size() != myLasers.size();
+  size_t i = 0;
+  for (auto it = lasers->begin(); 
+       !lasersChanged && it != lasers->end(); 
+       ++it, i++)
+    lasersChanged = it->second != myLasers[i];
+  if (lasersChanged)
+  {
+    myLasers.clear();
+    for (auto it = lasers->begin(); it != lasers->end(); ++it)
+      myLasers.push_back(it->second);
+    myScans.assign(myLasers.size(), std::shared_ptr<const ArRangeScan>());
+    myScanCounts.assign(myLasers.size(), 0);
+    myScanEncoderTrans.assign(myLasers.size(), encoderTrans);
+    myCumulativeChangeCounts.assign(myLasers.size(), 0);
+  }
+
+  // the scans go in again if any laser has a new one (or lost its old
+  // one), or if the encoder transform changed since the last merge
+  bool currentChanged = lasersChanged ||
+    encoderTrans.getX() != myEncoderTrans.getX() ||
+    encoderTrans.getY() != myEncoderTrans.getY() ||
+    encoderTrans.getTh() != myEncoderTrans.getTh();
+  bool cumulativeChanged = lasersChanged;
+  for (i = 0; i < myLasers.size(); i++)
+  {
+    ArLaser *laser = myLasers[i];
+    if (laser->isConnected())
+      myScans[i] = laser->getLatestScan();
+    const unsigned long count = myScans[i] ? myScans[i]->getCount() : 0;
+    if (count != myScanCounts[i])
+    {
+      myScanCounts[i] = count;
+      myScanEncoderTrans[i] = encoderTrans;
+      currentChanged = true;
+    }
+
+    laser->lockDevice();
+    const unsigned long changeCount = 
+      laser->getCumulativeRangeBuffer().getChangeCount();
+    if (changeCount != myCumulativeChangeCounts[i])
+    {
+      myCumulativeChangeCounts[i] = changeCount;
+      cumulativeChanged = true;
+    }
+    if (laser->getMaxRange() > myMaxRange)
+      myMaxRange = laser->getMaxRange();
+    laser->unlockDevice();
+  }
+  myEncoderTrans = encoderTrans;
+
+  if (currentChanged)
+    mergeCurrent(encoderTrans);
+  if (cumulativeChanged)
+    mergeCumulative();
+
+  // don't keep the lasers from reusing their scans
+  for (i = 0; i < myScans.size(); i++)
+    myScans[i].reset();
+
+  unlockDevice();
+}
+
+void ArLaserFusion::mergeCurrent(const ArTransform &encoderTrans)
+{
+  size_t numReadings = 0;
+  for (size_t i = 0; i < myScans.size(); i++)
+    if (myScans[i])
+      numReadings += myScans[i]->getNumReadings();
+  if (myCurrentBuffer.getCapacity() < numReadings)
+    setCurrentBufferSize(numReadings);
+
+  myCurrentBuffer.clear();
+  myCurrentGrid.sync(myCurrentBuffer);
+  myNumScans = 0;
+  myNumCurrentMerged = 0;
+  const ArRangeScan *newest = NULL;
+  ArTransform newestMove;
+  for (size_t i = 0; i < myScans.size(); i++)
+  {
+    if (!myScans[i])
+      continue;
+    const ArRangeScan &scan = *myScans[i];
+    myNumScans++;
+    // the readings were placed with the encoder transform as it was when
+    // the scan came in, so move them by however it changed since
+    const ArTransform &then = myScanEncoderTrans[i];
+    const bool moved = then.getX() != encoderTrans.getX() || 
+      then.getY() != encoderTrans.getY() || 
+      then.getTh() != encoderTrans.getTh();
+    const ArTransform move(then.doTransform(ArPose(0, 0, 0)),
+			   encoderTrans.doTransform(ArPose(0, 0, 0)));
+    if (newest == NULL || 
+	scan.getTimeTaken().isAfter(newest->getTimeTaken()))
+    {
+      newest = &scan;
+      newestMove = moved ? move : ArTransform();
+    }
+    const std::vector<ArSensorReading> &readings = scan.getReadings();
+    for (auto it = readings.cbegin(); it != readings.cend(); ++it)
+    {
+      if (it->getIgnoreThisReading())
+	continue;
+      double x = it->getX();
+      double y = it->getY();
+      if (moved)
+      {
+	const ArPose pose = move.doTransform(ArPose(x, y));
+	x = pose.getX();
+	y = pose.getY();
+      }
+      if (!mergeReading(&myCurrentGrid, &myCurrentBuffer, x, y))
+	myNumCurrentMerged++;
+    }
+  }
+  if (newest != NULL)
+  {
+    myCurrentBuffer.setPoseTaken(
+	    newestMove.doTransform(newest->getPoseTaken()));
+    myCurrentBuffer.setEncoderPoseTaken(newest->getEncoderPoseTaken());
+  }
+}
+
+void ArLaserFusion::mergeCumulative()
+{
+  size_t numReadings = 0;
+  for (size_t i = 0; i < myLasers.size(); i++)
+  {
+    myLasers[i]->lockDevice();
+    numReadings += myLasers[i]->getCumulativeRangeBuffer().getCurrentSize();
+    myLasers[i]->unlockDevice();
+  }
+  if (myCumulativeBuffer.getCapacity() < numReadings)
+    setCumulativeBufferSize(numReadings);
+
+  myCumulativeBuffer.clear();
+  myCumulativeGrid.sync(myCumulativeBuffer);
+  myNumCumulativeMerged = 0;
+  // the lasers keep their cumulative buffers up to date with the
+  // robot's pose, so these go in as they are
+  for (size_t i = 0; i < myLasers.size(); i++)
+  {
+    myLasers[i]->lockDevice();
+    const ArRangeBuffer &buffer = myLasers[i]->getCumulativeRangeBuffer();
+    // oldest first, so they stay in the same order
+    for (size_t n = buffer.getCurrentSize(); n > 0; n--)
+      if (!mergeReading(&myCumulativeGrid, &myCumulativeBuffer, 
+			buffer.getX(n - 1), buffer.getY(n - 1)))
+	myNumCumulativeMerged++;
+    myLasers[i]->unlockDevice();
+  }
+}
@@ -0,0 +1,118 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArLaserRawReadings.h"
+#include "Aria/ariaUtil.h"
+
+AREXPORT ArLaserRawReadings::ArLaserRawReadings() :
+  myValid(false),
+  mySensorX(0),
+  mySensorY(0),
+  myStartAngle(0),
+  myIncrement(0)
+{
+}
+
+/**
+   The readings' sensor positions are at @a sensorX, @a sensorY, pointing
+   at @a startAngle + @a increment * the beam number (all on the robot,
+   so these include the sensor's heading and whether it's flipped).
+
+   @return true if the beams were worked out again, false if they were
+   already laid out this way
+**/
+AREXPORT bool ArLaserRawReadings::setRays(size_t numReadings,
+					  double sensorX, double sensorY,
+					  double startAngle, double increment)
+{
+  if (myValid && numReadings == myReadings.size() &&
+      sensorX == mySensorX && sensorY == mySensorY &&
+      startAngle == myStartAngle && increment == myIncrement)
+    return false;
+
+  if (numReadings != myReadings.size())
+  {
+    myReadings.resize(numReadings);
+    myCos.resize(numReadings);
+    mySin.resize(numReadings);
+    myRanges.resize(numReadings);
+    myIgnore.resize(numReadings);
+    myExtraInts.resize(numReadings);
+    myList.clear();
+    for (size_t i = 0; i < numReadings; i++)
+      myList.push_back(&myReadings[i]);
+  }
+
+  for (size_t i = 0; i < numReadings; i++)
+  {
+    myReadings[i].resetSensorPosition(
+	    sensorX, sensorY, 
+	    ArMath::fixAngle(startAngle + increment * (double)i), true);
+    myCos[i] = myReadings[i].getSensorDX();
+    mySin[i] = myReadings[i].getSensorDY();
+  }
+  myValid = true;
+  mySensorX = sensorX;
+  mySensorY = sensorY;
+  myStartAngle = startAngle;
+  myIncrement = increment;
+  return true;
+}
+
+/**
+   This works out the same positions as ArSensorReading::newData() would
+   for each reading, in one pass that puts each straight into its
+   reading, but with the sensor position and the transform only looked
+   up once, and without checking each reading's sensor position again
+   (which setRays() already did).
+**/
+AREXPORT void ArLaserRawReadings::project(size_t first, size_t count,
+					  const ArPose &robotPose,
+					  const ArPose &encoderPose,
+					  const ArTransform &trans,
+					  unsigned int counter,
+					  const ArTime &timeTaken)
+{
+  if (first >= myReadings.size())
+    return;
+  const size_t end = (count > myReadings.size() - first) ?
+    myReadings.size() : first + count;
+
+  const double sensorX = mySensorX, sensorY = mySensorY;
+  // the same arithmetic as ArTransform::doTransform()
+  const double tx = trans.getX(), ty = trans.getY();
+  const double c = trans.getCos(), s = trans.getSin();
+  const double th = ArMath::addAngle(0, trans.getTh());
+  for (size_t i = first; i < end; i++)
+  {
+    const double localX = sensorX + myRanges[i] * myCos[i];
+    const double localY = sensorY + myRanges[i] * mySin[i];
+    myReadings[i].newProjectedData(myRanges[i], localX, localY,
+				   tx + c * localX + s * localY,
+				   ty + c * localY - s * localX, th,
+				   robotPose, encoderPose, counter, timeTaken,
+				   myIgnore[i] != 0, myExtraInts[i]);
+  }
+}
@@ -0,0 +1,606 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArLocalCostmap.h"
+#include "Aria/ArLaser.h"
+#include "Aria/ArRobot.h"
+#include "Aria/ArSonarDevice.h"
+
+#include <algorithm>
+
+/**
+   @param cellSize the size (mm) of each cell
+   @param size how far (mm) the grid goes from one side to the other, it
+   is rounded up to a whole number of cells
+   @param name the name of the device
+**/
+AREXPORT ArLocalCostmap::ArLocalCostmap(double cellSize, double size,
+					const char *name) :
+  ArRangeDevice(0, 0, name, 0),
+  myCellSize(cellSize > 1 ? cellSize : 1),
+  myNumCells(1),
+  myOriginX(0),
+  myOriginY(0),
+  myDecayMSecs(2000),
+  myHitCost(100),
+  myClearCost(50),
+  myUseSonar(true),
+  mySonarMaxRange(5000),
+  myProcessCB(this, &ArLocalCostmap::processReadings)
+{
+  if (size > myCellSize)
+    myNumCells = (int)ceil(size / myCellSize);
+  Cell empty;
+  empty.lastHit = 0;
+  empty.cost = 0;
+  myCells.assign((size_t)myNumCells * (size_t)myNumCells, empty);
+  // readings are never further than across the grid
+  setMaxRange((unsigned int)ceil(getSize() * sqrt(2.0)));
+
+  char buf[1024];
+  sprintf(buf, "%sProcessCB", getName());
+  myProcessCB.setName(buf);
+
+  setCurrentDrawingData(
+	  new ArDrawingData("polyDots", 
+			    ArColor(255, 0, 255), 
+			    (int)myCellSize, // mm diameter of dots
+			    70), // layer below the sensors
+	  true);
+}
+
+AREXPORT ArLocalCostmap::~ArLocalCostmap()
+{
+  if (myRobot != NULL)
+    myRobot->remSensorInterpTask(&myProcessCB);
+}
+
+AREXPORT void ArLocalCostmap::setRobot(ArRobot *robot)
+{
+  if (myRobot != NULL)
+    myRobot->remSensorInterpTask(&myProcessCB);
+  // after the lasers' filters (ArLaserFilter)
+  if (robot != NULL)
+    robot->addSensorInterpTask(myName.c_str(), 52, &myProcessCB);
+  ArRangeDevice::setRobot(robot);
+}
+
+/**
+   With the default costs a hit makes a cell an obstacle, and two rays
+   passing through it without another hit make it free again.
+**/
+AREXPORT void ArLocalCostmap::setCosts(unsigned char hitCost,
+				       unsigned char clearCost)
+{
+  myHitCost = hitCost > 0 ? hitCost : 1;
+  myClearCost = clearCost;
+}
+
+AREXPORT void ArLocalCostmap::clearCurrentReadings()
+{
+  Cell empty;
+  empty.lastHit = 0;
+  empty.cost = 0;
+  std::fill(myCells.begin(), myCells.end(), empty);
+  myCurrentBuffer.clear();
+}
+
+AREXPORT void ArLocalCostmap::applyTransform(ArTransform, bool)
+{
+  // the cells can't be turned, the sensors will fill them in again
+  clearCurrentReadings();
+}
+
+void ArLocalCostmap::clearColumn(int ix)
+{
+  const size_t x = cellOffset(ix, 0);
+  for (int y = 0; y < myNumCells; y++)
+  {
+    Cell &cell = myCells[(size_t)y * (size_t)myNumCells + x];
+    cell.lastHit = 0;
+    cell.cost = 0;
+  }
+}
+
+void ArLocalCostmap::clearRow(int iy)
+{
+  const size_t row = cellOffset(0, iy);
+  for (int x = 0; x < myNumCells; x++)
+  {
+    Cell &cell = myCells[row + (size_t)x];
+    cell.lastHit = 0;
+    cell.cost = 0;
+  }
+}
+
+/**
+   The cells that go off the grid are cleared, to be used for the ones
+   coming onto the other side.
+**/
+AREXPORT void ArLocalCostmap::recenter(double x, double y)
+{
+  const int originX = cellIndex(x) - myNumCells / 2;
+  const int originY = cellIndex(y) - myNumCells / 2;
+  if (originX == myOriginX && originY == myOriginY)
+    return;
+  if (abs(originX - myOriginX) >= myNumCells || 
+      abs(originY - myOriginY) >= myNumCells)
+  {
+    clearCurrentReadings();
+  }
+  else
+  {
+    int i;
+    // the new columns are past the old right side, or before the old left
+    for (i = myOriginX + myNumCells; i < originX + myNumCells; i++)
+      clearColumn(i);
+    for (i = originX; i < myOriginX; i++)
+      clearColumn(i);
+    for (i = myOriginY + myNumCells; i < originY + myNumCells; i++)
+      clearRow(i);
+    for (i = originY; i < myOriginY; i++)
+      clearRow(i);
+  }
+  myOriginX = originX;
+  myOriginY = originY;
+}
+
+void ArLocalCostmap::clearCell(int ix, int iy, long long now)
+{
+  if (!onGrid(ix, iy))
+    return;
+  Cell &cell = myCells[cellOffset(ix, iy)];
+  const unsigned char c = cost(cell, now);
+  cell.cost = c > myClearCost ? (unsigned char)(c - myClearCost) : 0;
+}
+
+void ArLocalCostmap::hitCell(int ix, int iy, long long now)
+{
+  if (!onGrid(ix, iy))
+    return;
+  Cell &cell = myCells[cellOffset(ix, iy)];
+  const int c = cost(cell, now) + myHitCost;
+  cell.cost = c < 255 ? (unsigned char)c : 255;
+  cell.lastHit = now;
+}
+
+/**
+   Clears the cells the ray passes through, then makes the cell x, y is
+   in more costly if @a hit is true, or clears it too if not.  Only the
+   part of the ray on the grid goes in.
+**/
+AREXPORT void ArLocalCostmap::addRay(double sensorX, double sensorY, 
+				     double x, double y, bool hit)
+{
+  const long long now = myStarted.mSecSinceLL();
+  if (clearRay(sensorX, sensorY, x, y, !hit, now) && hit)
+    hitCell(cellIndex(x), cellIndex(y), now);
+}
+
+/**
+   Clears the cells the ray passes through, and the cell x, y is in if @a
+   clearLast is true.  Returns whether that cell is on the grid.
+**/
+bool ArLocalCostmap::clearRay(double sensorX, double sensorY, 
+			      double x, double y, bool clearLast, 
+			      long long now)
+{
+  // cut the ray down to the part on the grid (Liang-Barsky)
+  const double minX = myOriginX * myCellSize;
+  const double minY = myOriginY * myCellSize;
+  const double maxX = minX + getSize(), maxY = minY + getSize();
+  const double dx = x - sensorX, dy = y - sensorY;
+  const double p[4] = { -dx, dx, -dy, dy };
+  const double q[4] = { sensorX - minX, maxX - sensorX, 
+			sensorY - minY, maxY - sensorY };
+  double t0 = 0, t1 = 1;
+  for (int i = 0; i < 4; i++)
+  {
+    if (p[i] == 0)
+    {
+      if (q[i] < 0)
+	return false;
+      continue;
+    }
+    const double t = q[i] / p[i];
+    if (p[i] < 0)
+      t0 = std::max(t0, t);
+    else
+      t1 = std::min(t1, t);
+  }
+  if (t0 > t1)
+    return false;
+  // the reading itself is off the grid
+  const bool lastOnGrid = t1 >= 1;
+  if (!lastOnGrid)
+    clearLast = true;
+  const double startX = sensorX + t0 * dx, startY = sensorY + t0 * dy;
+  const double endX = sensorX + t1 * dx, endY = sensorY + t1 * dy;
+
+  // walk the cells the ray passes through, crossing into the next cell
+  // in x or y, whichever boundary the ray reaches first
+  int ix = cellIndex(startX), iy = cellIndex(startY);
+  const int lastX = cellIndex(endX), lastY = cellIndex(endY);
+  const int stepX = lastX >= ix ? 1 : -1, stepY = lastY >= iy ? 1 : -1;
+  const double deltaX = dx != 0 ? fabs(myCellSize / dx) : HUGE_VAL;
+  const double deltaY = dy != 0 ? fabs(myCellSize / dy) : HUGE_VAL;
+  double nextX = dx != 0 ? 
+    ((ix + (stepX > 0 ? 1 : 0)) * myCellSize - startX) / dx : HUGE_VAL;
+  double nextY = dy != 0 ? 
+    ((iy + (stepY > 0 ? 1 : 0)) * myCellSize - startY) / dy : HUGE_VAL;
+  while (ix != lastX || iy != lastY)
+  {
+    clearCell(ix, iy, now);
+    // rounding can't take it past the last cell
+    if (iy == lastY || (ix != lastX && nextX < nextY))
+    {
+      nextX += deltaX;
+      ix += stepX;
+    }
+    else
+    {
+      nextY += deltaY;
+      iy += stepY;
+    }
+  }
+  if (clearLast)
+    clearCell(lastX, lastY, now);
+  return lastOnGrid;
+}
+
+AREXPORT unsigned char ArLocalCostmap::getCost(double x, double y) const
+{
+  const int ix = cellIndex(x), iy = cellIndex(y);
+  if (!onGrid(ix, iy))
+    return 0;
+  return cost(myCells[cellOffset(ix, iy)], myStarted.mSecSinceLL());
+}
+
+/**
+   Goes through each row of cells the polygon is in, and in each only the
+   cells from where the polygon starts in the row to where it ends, so it
+   looks at every cell any part of the polygon is in, and no others (but
+   those in the gaps of a polygon that isn't convex).  An obstacle cell
+   is as close as its nearest point to the robot, even if that point
+   isn't in the polygon, so no part of an obstacle in the polygon is
+   closer than this says.
+
+   @param polygon the corners of the polygon, in order, in robot
+   coordinates (as for ArRobot::checkRangeDevicesCurrentBox())
+   @param readingPos if not NULL, is set to the point of the closest
+   obstacle cell nearest the robot, in robot coordinates
+   @return the distance from the robot to the nearest point of the
+   closest obstacle cell in the polygon, or getMaxRange() if there isn't
+   one
+**/
+AREXPORT double ArLocalCostmap::closestInPolygon(
+	const std::vector<ArPose> &polygon, ArPose *readingPos) const
+{
+  const ArPose robotPose = myRobot != NULL ? myRobot->getPose() : ArPose();
+  const ArTransform trans(robotPose);
+  std::vector<ArPose> corners;
+  corners.reserve(polygon.size());
+  double minY = HUGE_VAL, maxY = -HUGE_VAL;
+  for (auto it = polygon.cbegin(); it != polygon.cend(); ++it)
+  {
+    corners.push_back(trans.doTransform(*it));
+    minY = std::min(minY, corners.back().getY());
+    maxY = std::max(maxY, corners.back().getY());
+  }
+  double closest = getMaxRange();
+  if (corners.size() < 3)
+    return closest;
+
+  const long long now = myStarted.mSecSinceLL();
+  const int lastCol = myOriginX + myNumCells - 1;
+  double closestDistSquared = HUGE_VAL;
+  double closestX = 0, closestY = 0;
+  // the columns the polygon is in, in the row
+  std::vector<std::pair<int, int> > spans;
+  std::vector<double> crossings;
+  const int firstRow = std::max(cellIndex(minY), myOriginY);
+  const int lastRow = std::min(cellIndex(maxY), myOriginY + myNumCells - 1);
+  for (int iy = firstRow; iy <= lastRow; iy++)
+  {
+    const double bottom = iy * myCellSize, top = bottom + myCellSize;
+    spans.clear();
+    // the part of the polygon in the row goes from the leftmost to the
+    // rightmost of the edges in the row, and where the polygon crosses
+    // the bottom and top of the row
+    for (size_t i = 0, j = corners.size() - 1; i < corners.size(); j = i++)
+    {
+      const ArPose &a = corners[j], &b = corners[i];
+      const double low = std::min(a.getY(), b.getY());
+      const double high = std::max(a.getY(), b.getY());
+      if (high < bottom || low > top)
+	continue;
+      double x1 = a.getX(), x2 = b.getX();
+      if (a.getY() != b.getY())
+      {
+	const double slope = (b.getX() - a.getX()) / (b.getY() - a.getY());
+	x1 = a.getX() + (std::max(bottom, low) - a.getY()) * slope;
+	x2 = a.getX() + (std::min(top, high) - a.getY()) * slope;
+      }
+      spans.push_back(std::make_pair(cellIndex(std::min(x1, x2)), 
+				     cellIndex(std::max(x1, x2))));
+    }
+    for (int side = 0; side < 2; side++)
+    {
+      const double lineY = side == 0 ? bottom : top;
+      crossings.clear();
+      for (size_t i = 0, j = corners.size() - 1; i < corners.size(); j = i++)
+      {
+	const ArPose &a = corners[j], &b = corners[i];
+	if ((a.getY() <= lineY) != (b.getY() <= lineY))
+	  crossings.push_back(a.getX() + (lineY - a.getY()) * 
+			      (b.getX() - a.getX()) / (b.getY() - a.getY()));
+      }
+      std::sort(crossings.begin(), crossings.end());
+      for (size_t k = 0; k + 1 < crossings.size(); k += 2)
+	spans.push_back(std::make_pair(cellIndex(crossings[k]), 
+				       cellIndex(crossings[k + 1])));
+    }
+    std::sort(spans.begin(), spans.end());
+
+    // the near side of the row to the robot
+    const double nearY = std::max(bottom, std::min(top, robotPose.getY()));
+    int next = myOriginX;
+    for (auto it = spans.cbegin(); it != spans.cend(); ++it)
+    {
+      const int last = std::min(it->second, lastCol);
+      for (int ix = std::max(it->first, next); ix <= last; ix++)
+      {
+	if (cost(myCells[cellOffset(ix, iy)], now) == 0)
+	  continue;
+	const double left = ix * myCellSize;
+	const double nearX = std::max(left, std::min(left + myCellSize, 
+						     robotPose.getX()));
+	const double distSquared = ArMath::squaredDistanceBetween(
+		nearX, nearY, robotPose.getX(), robotPose.getY());
+	if (distSquared < closestDistSquared)
+	{
+	  closestDistSquared = distSquared;
+	  closestX = nearX;
+	  closestY = nearY;
+	}
+      }
+      next = std::max(next, last + 1);
+    }
+  }
+  if (closestDistSquared < HUGE_VAL && sqrt(closestDistSquared) < closest)
+  {
+    closest = sqrt(closestDistSquared);
+    if (readingPos != NULL)
+      *readingPos = trans.doInvTransform(ArPose(closestX, closestY));
+  }
+  return closest;
+}
+
+/**
+   @param x1 the x coordinate of one corner of the box (robot coordinates)
+   @param y1 the y coordinate of one corner of the box
+   @param x2 the x coordinate of the opposite corner
+   @param y2 the y coordinate of the opposite corner
+   @param readingPos if not NULL, is set to the point of the closest
+   obstacle cell nearest the robot, in robot coordinates
+   @return the distance from the robot to the nearest point of the
+   closest obstacle cell in the box, or getMaxRange() if there isn't one
+**/
+AREXPORT double ArLocalCostmap::closestInBox(double x1, double y1, 
+					     double x2, double y2,
+					     ArPose *readingPos) const
+{
+  std::vector<ArPose> box;
+  box.reserve(4);
+  box.push_back(ArPose(x1, y1));
+  box.push_back(ArPose(x2, y1));
+  box.push_back(ArPose(x2, y2));
+  box.push_back(ArPose(x1, y2));
+  return closestInPolygon(box, readingPos);
+}
+
+/**
+   These are this, the lasers in the robot's laser map, and the robot's
+   sonar device (ArSonarDevice) if the sonar go in (getUseSonar()).
+**/
+AREXPORT bool ArLocalCostmap::coversDevice(const ArRangeDevice *device) const
+{
+  if (device == this)
+    return true;
+  if (myRobot == NULL)
+    return false;
+  if (myUseSonar && dynamic_cast<const ArSonarDevice *>(device) != NULL)
+    return true;
+  const std::map<int, ArLaser *> *lasers = myRobot->getLaserMap();
+  for (auto it = lasers->cbegin(); it != lasers->cend(); ++it)
+    if (it->second == device)
+      return true;
+  return false;
+}
+
+/**
+   Checks the grid with closestInBox(), then the robot's range devices
+   whose readings don't go into the grid (see coversDevice()) as
+   ArRobot::checkRangeDevicesCurrentBox() does, so the bumpers, IR,
+   forbidden lines and the like are still seen.  Locks each device, this
+   one too, while checking it.
+
+   @param x1 the x coordinate of one corner of the box (robot coordinates)
+   @param y1 the y coordinate of one corner of the box
+   @param x2 the x coordinate of the opposite corner
+   @param y2 the y coordinate of the opposite corner
+   @param readingPos if not NULL, is set to the closest reading (or the
+   point of the closest obstacle cell nearest the robot), in robot
+   coordinates, if there is one
+   @param rangeDevice if not NULL, is set to the device the closest
+   reading is from (this for an obstacle cell), or NULL if there isn't
+   one
+   @param useLocationDependentDevices whether to check the range devices
+   that are location dependent (ArRangeDevice::isLocationDependent())
+   @return the distance from the robot to the closest reading or
+   obstacle cell in the box, or 32000 if there isn't one (as from
+   ArRobot::checkRangeDevicesCurrentBox())
+**/
+AREXPORT double ArLocalCostmap::checkRangeDevicesCurrentBox(
+	double x1, double y1, double x2, double y2, ArPose *readingPos,
+	const ArRangeDevice **rangeDevice, bool useLocationDependentDevices)
+{
+  ArPose closestPos, tempPos;
+  lockDevice();
+  double closest = closestInBox(x1, y1, x2, y2, &closestPos);
+  unlockDevice();
+  const ArRangeDevice *closestRangeDevice = this;
+  // nothing in the grid, which ArRobot says with 32000 and no device
+  if (closest >= getMaxRange())
+  {
+    closest = 32000;
+    closestRangeDevice = NULL;
+  }
+  if (myRobot != NULL)
+  {
+    std::list<ArRangeDevice *> *devices = myRobot->getRangeDeviceList();
+    for (auto it = devices->cbegin(); it != devices->cend(); ++it)
+    {
+      ArRangeDevice *device = *it;
+      if (coversDevice(device))
+	continue;
+      device->lockDevice();
+      if (useLocationDependentDevices || !device->isLocationDependent())
+      {
+	const double dist = device->currentReadingBox(x1, y1, x2, y2, 
+						      &tempPos);
+	if (dist < closest)
+	{
+	  closest = dist;
+	  closestPos = tempPos;
+	  closestRangeDevice = device;
+	}
+      }
+      device->unlockDevice();
+    }
+  }
+  if (readingPos != NULL && closestRangeDevice != NULL)
+    *readingPos = closestPos;
+  if (rangeDevice != NULL)
+    *rangeDevice = closestRangeDevice;
+  return closest;
+}
+
+/**
+   All the rays of a scan clear before any of its readings go in, so the
+   rays that graze a wall on the way to the readings next to them don't
+   clear it.
+**/
+void ArLocalCostmap::addLaserScans()
+{
+  const long long now = myStarted.mSecSinceLL();
+  const std::map<int, ArLaser *> *lasers = myRobot->getLaserMap();
+  for (auto it = lasers->begin(); it != lasers->end(); ++it)
+  {
+    ArLaser *laser = it->second;
+    std::shared_ptr<const ArRangeScan> scan = laser->getLatestScan();
+    if (!scan || myScanCounts[it->first] == scan->getCount())
+      continue;
+    myScanCounts[it->first] = scan->getCount();
+    const unsigned int maxRange = laser->getMaxRange();
+    const ArTransform trans(scan->getPoseTaken());
+    const std::vector<ArSensorReading> &readings = scan->getReadings();
+    myHits.clear();
+    for (auto rIt = readings.cbegin(); rIt != readings.cend(); ++rIt)
+    {
+      // readings ignored for being too far still clear, others don't
+      const bool tooFar = maxRange != 0 && rIt->getRange() > maxRange;
+      if (rIt->getIgnoreThisReading() && !tooFar)
+	continue;
+      const ArPose sensor = trans.doTransform(
+	      ArPose(rIt->getSensorX(), rIt->getSensorY()));
+      if (clearRay(sensor.getX(), sensor.getY(), rIt->getX(), rIt->getY(),
+		   tooFar, now) && !tooFar)
+	myHits.push_back(std::make_pair(cellIndex(rIt->getX()), 
+					cellIndex(rIt->getY())));
+    }
+    for (auto hIt = myHits.cbegin(); hIt != myHits.cend(); ++hIt)
+      hitCell(hIt->first, hIt->second, now);
+  }
+}
+
+void ArLocalCostmap::addSonar()
+{
+  for (int i = 0; i < myRobot->getNumSonar(); i++)
+  {
+    const ArSensorReading *reading = myRobot->getSonarReading(i);
+    if (reading == NULL || !reading->isNew(myRobot->getCounter()))
+      continue;
+    const ArPose sensor = ArTransform(reading->getPoseTaken()).doTransform(
+	    ArPose(reading->getSensorX(), reading->getSensorY()));
+    if (reading->getRange() < mySonarMaxRange)
+    {
+      addRay(sensor.getX(), sensor.getY(), reading->getX(), reading->getY());
+    }
+    else if (reading->getRange() > 0)
+    {
+      // nothing seen, so only clear out to the max range
+      const double ratio = (double)mySonarMaxRange / reading->getRange();
+      addRay(sensor.getX(), sensor.getY(),
+	     sensor.getX() + (reading->getX() - sensor.getX()) * ratio,
+	     sensor.getY() + (reading->getY() - sensor.getY()) * ratio,
+	     false);
+    }
+  }
+}
+
+void ArLocalCostmap::fillCurrentBuffer()
+{
+  const long long now = myStarted.mSecSinceLL();
+  size_t numObstacles = 0;
+  for (auto it = myCells.cbegin(); it != myCells.cend(); ++it)
+    if (cost(*it, now) > 0)
+      numObstacles++;
+  if (myCurrentBuffer.getCapacity() < numObstacles)
+    setCurrentBufferSize(numObstacles);
+
+  myCurrentBuffer.setPoseTaken(myRobot->getPose());
+  myCurrentBuffer.setEncoderPoseTaken(myRobot->getEncoderPose());
+  myCurrentBuffer.beginRedoBuffer();
+  for (int iy = myOriginY; iy < myOriginY + myNumCells; iy++)
+    for (int ix = myOriginX; ix < myOriginX + myNumCells; ix++)
+      if (cost(myCells[cellOffset(ix, iy)], now) > 0)
+	myCurrentBuffer.redoReading((ix + 0.5) * myCellSize, 
+				    (iy + 0.5) * myCellSize);
+  myCurrentBuffer.endRedoBuffer();
+}
+
+AREXPORT void ArLocalCostmap::processReadings()
+{
+  if (myRobot == NULL)
+    return;
+  lockDevice();
+  recenter(myRobot->getX(), myRobot->getY());
+  addLaserScans();
+  if (myUseSonar)
+    addSonar();
+  fillCurrentBuffer();
+  unlockDevice();
+}
@@ -31,6 +31,12 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include <ctype.h>
 #include <string.h>
 #include "Aria/ariaInternal.h"
+#include "Aria/ArASyncTask.h"
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
 
 
 #ifdef WIN32
@@ -39,6 +45,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include <fcntl.h>
 #include <errno.h>
 #include <execinfo.h>
+#include <unistd.h>
 #endif
 
 #if defined(_ATL_VER) || defined(ARIA_MSVC_ATL_VER)
@@ -65,6 +72,88 @@ ArGlobalRetFunctor<bool> ArLog::ourConfigProcessFileCB(&ArLog::processFile);
 
 ArFunctor1<const char *> *ArLog::ourFunctor;
 
+namespace {
+  // One message in the setAsync() queue.  mySeq says whose turn the slot
+  // is: the slot for position pos is free to be claimed when mySeq is pos,
+  // and holds a finished message for the writer when mySeq is pos + 1.
+  struct AsyncSlot
+  {
+    std::atomic<unsigned long long> mySeq;
+    time_t myTime;
+    char myMessage[ArLog::ASYNC_MESSAGE_SIZE];
+  };
+
+  // The queue is allocated the first time setAsync(true) is called and
+  // never freed, so threads still logging into it when the writer goes
+  // away never touch freed memory.
+  AsyncSlot *ourAsyncSlots = NULL;
+  size_t ourAsyncMask = 0;
+  std::atomic<unsigned long long> ourAsyncHead(0);
+  std::atomic<unsigned long long> ourAsyncTail(0);
+  std::atomic<bool> ourAsync(false);
+  std::atomic<int> ourAsyncOverflow(ArLog::DropWhenFull);
+  std::atomic<unsigned long> ourAsyncDropped(0);
+  unsigned long ourAsyncDroppedLogged = 0;
+  // only one thread at a time writes out queued messages
+  std::atomic<bool> ourAsyncWriting(false);
+  thread_local bool ourWritingQueued = false;
+
+  std::mutex ourAsyncWaitMutex;
+  std::condition_variable ourAsyncWaitCond;
+  std::atomic<bool> ourAsyncWriterWaiting(false);
+  std::atomic<bool> ourAsyncWriterRunning(false);
+  ArMutex ourAsyncMutex;
+
+  bool asyncQueued()
+  {
+    const unsigned long long tail = ourAsyncTail.load(std::memory_order_relaxed);
+    return ourAsyncSlots[tail & ourAsyncMask].mySeq.load(
+	    std::memory_order_acquire) == tail + 1;
+  }
+
+  void wakeAsyncWriter()
+  {
+    // pairs with the fence in AsyncWriter::runThread, so either the writer
+    // sees the message or this sees that the writer is waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (ourAsyncWriterWaiting.load(std::memory_order_relaxed))
+    {
+      std::lock_guard<std::mutex> lock(ourAsyncWaitMutex);
+      ourAsyncWaitCond.notify_one();
+    }
+  }
+}
+
+/// Writes out the setAsync() queue
+class ArLog::AsyncWriter : public ArASyncTask
+{
+public:
+  AsyncWriter() { setThreadName("ArLog::AsyncWriter"); }
+  virtual void *runThread(void *) override
+  {
+    while (getRunning())
+    {
+      if (writeQueued())
+	continue;
+      std::unique_lock<std::mutex> lock(ourAsyncWaitMutex);
+      ourAsyncWriterWaiting.store(true, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!asyncQueued() && getRunning())
+	ourAsyncWaitCond.wait_for(lock, std::chrono::milliseconds(100));
+      ourAsyncWriterWaiting.store(false, std::memory_order_relaxed);
+    }
+    // stopped, either by setAsync(false) or ArThread::stopAll() on
+    // shutdown, so go back to writing messages as they're logged (anyone
+    // who queues one after this writes it out themselves)
+    ourAsync.store(false);
+    writeQueued();
+    ourAsyncWriterRunning.store(false);
+    return NULL;
+  }
+};
+
+ArLog::AsyncWriter *ArLog::ourAsyncWriter = NULL;
+
 
 AREXPORT void ArLog::logPlain(LogLevel level, const char *str)
 {
@@ -81,6 +170,15 @@ AREXPORT void ArLog::log(LogLevel level, const char *str, ...)
 {
   if (level > ourLevel)
     return;
+
+  if (isAsync())
+  {
+    va_list ptr;
+    va_start(ptr, str);
+    queueMessage_v(level, "", str, ptr);
+    va_end(ptr);
+    return;
+  }
   
   //printf("logging %s\n", str);
 
@@ -110,29 +208,7 @@ AREXPORT void ArLog::log(LogLevel level, const char *str, ...)
   bufPtr[sizeof(buf) - timeLen - 1] = '\0';
   //vsprintf(bufPtr, str, ptr);
   // can do whatever you want with the buf now
-  if (ourFP)
-  {
-    int written;
-    if ((written = fprintf(ourFP, "%s\n", buf)) > 0)
-      ourCharsLogged += written;
-    fflush(ourFP);
-    if(ourType == File) checkFileSize();
-  }
-  else if (ourType != None)
-  {
-    printf("%s\n", buf);
-    fflush(stdout);
-  }
-  if (ourAlsoPrint)
-    printf("%s\n", buf);
-
-  invokeFunctor(buf);
-
-
-// Also send it to the VC++ debug output window...
-#ifdef HAVEATL
-  ATLTRACE2("%s\n", buf);
-#endif
+  writeMessage(buf);
   
   va_end(ptr);
   ourMutex.unlock();
@@ -174,10 +250,12 @@ AREXPORT void ArLog::logErrorFromOS(LogLevel level, const char *str, ...)
   char *bufPtr;
   size_t timeLen = 0; 
 
-
-  ourMutex.lock();
+  // when async the writer puts the time in
+  const bool async = isAsync();
+  if (!async)
+    ourMutex.lock();
   // put our time in if we want it
-  if (ourLoggingTime)
+  if (ourLoggingTime && !async)
   {
     const time_t now = time(NULL);
     char *timeStr = ctime(&now);
@@ -228,32 +306,14 @@ AREXPORT void ArLog::logErrorFromOS(LogLevel level, const char *str, ...)
 
   //vsprintf(bufPtr, str, ptr);
   // can do whatever you want with the buf now
-  if (ourFP)
-  {
-    int written;
-    if ((written = fprintf(ourFP, "%s\n", bufWithError)) > 0)
-      ourCharsLogged += written;
-    fflush(ourFP);
-    if(ourType == File) checkFileSize();
-  }
-  else if (ourType != None)
-  {
-    printf("%s\n", bufWithError);
-    fflush(stdout);
-  }
-  if (ourAlsoPrint)
-    printf("%s\n", bufWithError);
-
-  invokeFunctor(bufWithError);
-
-
-// Also send it to the VC++ debug output window...
-#ifdef HAVEATL
-  ATLTRACE2("%s\n", buf);
-#endif
+  if (async)
+    queueMessage(level, "%s", bufWithError);
+  else
+    writeMessage(bufWithError);
   
   va_end(ptr);
-  ourMutex.unlock();
+  if (!async)
+    ourMutex.unlock();
 }
 
 
@@ -807,9 +867,15 @@ AREXPORT void ArLog::log_v(LogLevel level, const char *prefix, const char *str,
 
 AREXPORT void ArLog::info(const char *str, ...)
 {
-  ourMutex.lock();
   va_list ptr;
   va_start(ptr, str);
+  if (isAsync())
+  {
+    queueMessage_v(Normal, "", str, ptr);
+    va_end(ptr);
+    return;
+  }
+  ourMutex.lock();
   log_v(Normal, "", str, ptr);
   va_end(ptr);
   ourMutex.unlock();
@@ -817,9 +883,15 @@ AREXPORT void ArLog::info(const char *str, ...)
 
 AREXPORT void ArLog::warning(const char *str, ...)
 {
-  ourMutex.lock();
   va_list ptr;
   va_start(ptr, str);
+  if (isAsync())
+  {
+    queueMessage_v(Terse, "Warning: ", str, ptr);
+    va_end(ptr);
+    return;
+  }
+  ourMutex.lock();
   log_v(Terse, "Warning: ", str, ptr);
   va_end(ptr);
   ourMutex.unlock();
@@ -827,9 +899,15 @@ AREXPORT void ArLog::warning(const char *str, ...)
 
 AREXPORT void ArLog::error(const char *str, ...)
 {
-  ourMutex.lock();
   va_list ptr;
   va_start(ptr, str);
+  if (isAsync())
+  {
+    queueMessage_v(Terse, "Error: ", str, ptr);
+    va_end(ptr);
+    return;
+  }
+  ourMutex.lock();
   log_v(Terse, "Error: ", str, ptr);
   va_end(ptr);
   ourMutex.unlock();
@@ -837,9 +915,15 @@ AREXPORT void ArLog::error(const char *str, ...)
 
 AREXPORT void ArLog::debug(const char *str, ...)
 {
-  ourMutex.lock();
   va_list ptr;
   va_start(ptr, str);
+  if (isAsync())
+  {
+    queueMessage_v(Terse, "[debug] ", str, ptr);
+    va_end(ptr);
+    return;
+  }
+  ourMutex.lock();
   log_v(Terse, "[debug] ", str, ptr);
   va_end(ptr);
   ourMutex.unlock();
@@ -859,3 +943,331 @@ AREXPORT unsigned long ArLog::getAvailableDiskSpaceMB()
     return ULONG_MAX;
 }
 
+/**
+   Writes one finished message (with the time already in it, if wanted)
+   to wherever messages are going.  ourMutex must be locked.
+**/
+void ArLog::writeMessage(const char *message)
+{
+  if (ourFP)
+  {
+    int written;
+    if ((written = fprintf(ourFP, "%s\n", message)) > 0)
+      ourCharsLogged += written;
+    fflush(ourFP);
+    if(ourType == File) checkFileSize();
+  }
+  else if (ourType != None)
+  {
+    printf("%s\n", message);
+    fflush(stdout);
+  }
+  if (ourAlsoPrint)
+    printf("%s\n", message);
+
+  invokeFunctor(message);
+
+
+// Also send it to the VC++ debug output window...
+#ifdef HAVEATL
+  ATLTRACE2("%s\n", message);
+#endif
+}
+
+/**
+   Messages are written in the order they're put in the queue.  When the
+   queue is full the message is dropped or this waits, depending on the
+   overflow given to setAsync(), except that messages logged while
+   writing out the queue (from checkFileSize() or the functor) are always
+   dropped, since waiting would never end.
+**/
+void ArLog::queueMessage_v(LogLevel level, const char *prefix,
+			   const char *format, va_list ptr)
+{
+  if (level > ourLevel)
+    return;
+
+  AsyncSlot *slot;
+  unsigned long long pos = ourAsyncHead.load(std::memory_order_relaxed);
+  while (true)
+  {
+    slot = &ourAsyncSlots[pos & ourAsyncMask];
+    const long long diff = (long long)(slot->mySeq.load(
+	    std::memory_order_acquire) - pos);
+    if (diff == 0)
+    {
+      if (ourAsyncHead.compare_exchange_weak(pos, pos + 1,
+					     std::memory_order_relaxed))
+	break;
+    }
+    else if (diff < 0)
+    {
+      // full
+      if (ourAsyncOverflow.load(std::memory_order_relaxed) == DropWhenFull ||
+	  ourWritingQueued)
+      {
+	ourAsyncDropped.fetch_add(1, std::memory_order_relaxed);
+	return;
+      }
+      wakeAsyncWriter();
+      if (!writeQueued())
+	ArUtil::sleep(1);
+      pos = ourAsyncHead.load(std::memory_order_relaxed);
+    }
+    else
+      pos = ourAsyncHead.load(std::memory_order_relaxed);
+  }
+
+  slot->myTime = time(NULL);
+  size_t prefixLen = strlen(prefix);
+  if (prefixLen > ASYNC_MESSAGE_SIZE - 1)
+    prefixLen = ASYNC_MESSAGE_SIZE - 1;
+  memcpy(slot->myMessage, prefix, prefixLen);
+  vsnprintf(slot->myMessage + prefixLen, ASYNC_MESSAGE_SIZE - prefixLen,
+	    format, ptr);
+  slot->myMessage[ASYNC_MESSAGE_SIZE - 1] = '\0';
+  slot->mySeq.store(pos + 1, std::memory_order_release);
+
+  wakeAsyncWriter();
+  // if the writer stopped while this was being queued, nothing else will
+  // write it out
+  if (!ourAsync.load())
+    writeQueued();
+}
+
+void ArLog::queueMessage(LogLevel level, const char *format, ...)
+{
+  va_list ptr;
+  va_start(ptr, format);
+  queueMessage_v(level, "", format, ptr);
+  va_end(ptr);
+}
+
+/**
+   Writes out every message that's finished being queued, in order,
+   putting the time in front of them if wanted.
+
+   @return true if any messages were written, false if there were none or
+   another thread is writing them out
+**/
+bool ArLog::writeQueued()
+{
+  if (ourAsyncSlots == NULL || !asyncQueued() ||
+      ourAsyncWriting.exchange(true, std::memory_order_acquire))
+    return false;
+  ourWritingQueued = true;
+
+  char buf[ASYNC_MESSAGE_SIZE + 32];
+  char *bufPtr;
+  bool wrote = false;
+  unsigned long long tail = ourAsyncTail.load(std::memory_order_relaxed);
+  ourMutex.lock();
+  while (true)
+  {
+    AsyncSlot *slot = &ourAsyncSlots[tail & ourAsyncMask];
+    if (slot->mySeq.load(std::memory_order_acquire) != tail + 1)
+      break;
+    bufPtr = buf;
+    if (ourLoggingTime)
+    {
+      // the same as the first 20 characters of ctime()
+      struct tm t;
+      ArUtil::localtime(&slot->myTime, &t);
+      bufPtr += strftime(buf, 32, "%a %b %e %H:%M:%S ", &t);
+    }
+    strcpy(bufPtr, slot->myMessage);
+    writeMessage(buf);
+    slot->mySeq.store(tail + ourAsyncMask + 1, std::memory_order_release);
+    ourAsyncTail.store(++tail, std::memory_order_release);
+    wrote = true;
+  }
+  const unsigned long dropped = ourAsyncDropped.load(std::memory_order_relaxed);
+  if (dropped != ourAsyncDroppedLogged)
+  {
+    snprintf(buf, sizeof(buf),
+	     "ArLog: Dropped %lu log messages because the queue was full",
+	     dropped - ourAsyncDroppedLogged);
+    ourAsyncDroppedLogged = dropped;
+    writeMessage(buf);
+  }
+  ourMutex.unlock();
+
+  ourWritingQueued = false;
+  ourAsyncWriting.store(false, std::memory_order_release);
+  return wrote;
+}
+
+/**
+   With async on, logging a message only copies it into a queue (without
+   taking any locks) and a background thread writes it out, so threads
+   that log never wait on file or console I/O, checking the log file's
+   size, the functor given with setFunctor(), or each other.  The
+   functor is called in the background thread.  If the time is being
+   logged it is the time the message was queued.
+
+   logNoLock(), logErrorFromOSNoLock(), and beginWrite(), write() and
+   endWrite() always write their message right away, so their messages
+   can come out ahead of ones still in the queue.
+
+   The background thread is stopped by ArThread::stopAll() (so by
+   Aria::shutdown()) as well as setAsync(false); either way everything
+   already queued is written out and logging goes back to writing each
+   message as it's logged.
+
+   @param async true to write messages in the background, false to write
+   them as they're logged again (after writing what's queued)
+
+   @param queueSize the most messages that can be waiting to be written
+   (rounded up to a power of 2).  The queue is made the first time async
+   is turned on, so this is ignored after that.  Each message takes
+   ASYNC_MESSAGE_SIZE bytes.
+
+   @param overflow what to do with messages logged while the queue is full
+
+   @return true if async is now what was asked for
+**/
+AREXPORT bool ArLog::setAsync(bool async, size_t queueSize,
+			      AsyncOverflow overflow)
+{
+  ourAsyncMutex.lock();
+  ourAsyncOverflow.store(overflow);
+  if (async == ourAsync.load() && async == ourAsyncWriterRunning.load())
+  {
+    ourAsyncMutex.unlock();
+    return true;
+  }
+
+  // stop the writer, or let one stopped by ArThread::stopAll() finish
+  if (ourAsyncWriter != NULL)
+  {
+    ourAsyncWriter->stopRunning();
+    while (ourAsyncWriterRunning.load())
+    {
+      wakeAsyncWriter();
+      ArUtil::sleep(1);
+    }
+  }
+  if (!async)
+  {
+    ourAsyncMutex.unlock();
+    return true;
+  }
+
+  if (ourAsyncSlots == NULL)
+  {
+    size_t size = 2;
+    while (size < queueSize)
+      size *= 2;
+    ourAsyncSlots = new AsyncSlot[size];
+    for (size_t i = 0; i < size; i++)
+      ourAsyncSlots[i].mySeq.store(i, std::memory_order_relaxed);
+    ourAsyncMask = size - 1;
+  }
+  if (ourAsyncWriter == NULL)
+    ourAsyncWriter = new AsyncWriter;
+  ourAsyncWriterRunning.store(true);
+  ourAsync.store(true);
+  // not joinable, so ArThread::joinAll() doesn't wait on it
+  if (ourAsyncWriter->create(false, false) != 0)
+  {
+    ourAsync.store(false);
+    ourAsyncWriterRunning.store(false);
+    ourAsyncMutex.unlock();
+    ArLog::log(ArLog::Terse, "ArLog::setAsync: Could not start the writer thread");
+    return false;
+  }
+  ourAsyncMutex.unlock();
+  return true;
+}
+
+AREXPORT bool ArLog::isAsync()
+{
+  return ourAsync.load(std::memory_order_relaxed);
+}
+
+AREXPORT unsigned long ArLog::getAsyncDropped()
+{
+  return ourAsyncDropped.load(std::memory_order_relaxed);
+}
+
+/**
+   Waits for the background thread to write out the messages queued
+   before this was called, or writes them out on this thread if the
+   background thread isn't writing.  Does nothing if setAsync() has
+   never been turned on, since messages are already written as they're
+   logged.
+
+   @param msecs the most time to wait, or -1 to wait as long as it takes
+
+   @return true if everything was written, false if it timed out
+**/
+AREXPORT bool ArLog::flush(int msecs)
+{
+  if (ourAsyncSlots == NULL)
+    return true;
+  const unsigned long long head = ourAsyncHead.load();
+  ArTime started;
+  while (ourAsyncTail.load(std::memory_order_acquire) < head)
+  {
+    if (writeQueued())
+      continue;
+    if (msecs >= 0 && started.mSecSince() >= msecs)
+      return false;
+    wakeAsyncWriter();
+    ArUtil::sleep(1);
+  }
+  return true;
+}
+
+/**
+   For a signal handler (such as ArSignalHandler's for SIGSEGV and
+   SIGFPE), where flush() can't be used: it waits on the background
+   thread and locks mutexes, so if the signal came while one was held it
+   would hang instead of letting the program die.  This only uses
+   write(2) and atomics, so it is safe to call from a signal handler.
+
+   The queued messages are written straight to the log file (or stdout),
+   without the time, the functor or setAlsoPrint().  Then setAsync() is
+   turned off without stopping the background thread, so anything logged
+   after this is written right away.  If another thread was writing out
+   the queue when the signal came, the messages it hadn't finished may be
+   written twice.
+**/
+AREXPORT void ArLog::flushFromSignal()
+{
+  ourAsync.store(false);
+  if (ourAsyncSlots == NULL)
+    return;
+#ifndef WIN32
+  int fd = -1;
+  if (ourFP != NULL)
+    fd = fileno(ourFP);
+  else if (ourType != None)
+    fd = STDOUT_FILENO;
+  // only take the messages out of the queue if nothing else is writing
+  // them out (or it was this thread, which the signal interrupted)
+  const bool owner = ourWritingQueued ||
+    !ourAsyncWriting.exchange(true, std::memory_order_acquire);
+  unsigned long long tail = ourAsyncTail.load(std::memory_order_acquire);
+  while (true)
+  {
+    AsyncSlot *slot = &ourAsyncSlots[tail & ourAsyncMask];
+    if (slot->mySeq.load(std::memory_order_acquire) != tail + 1)
+      break;
+    if (fd >= 0)
+    {
+      const size_t len = strnlen(slot->myMessage, ASYNC_MESSAGE_SIZE);
+      if (::write(fd, slot->myMessage, len) < 0 || ::write(fd, "\n", 1) < 0)
+	fd = -1;
+    }
+    if (owner)
+    {
+      slot->mySeq.store(tail + ourAsyncMask + 1, std::memory_order_release);
+      ourAsyncTail.store(tail + 1, std::memory_order_release);
+    }
+    tail++;
+  }
+  if (owner && !ourWritingQueued)
+    ourAsyncWriting.store(false, std::memory_order_release);
+#endif
+}
@@ -0,0 +1,105 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArLogThrottle.h"
+#include "Aria/ariaUtil.h"
+
+#include <stdarg.h>
+
+/**
+   @param intervalMSec the least time between messages logged through
+   this throttle (0 to log every one, and only leave out repeats)
+
+   @param repeatMSec how long to wait before logging a message with the
+   same text as the last one logged (0 to log repeats like any other)
+**/
+AREXPORT ArLogThrottle::ArLogThrottle(unsigned int intervalMSec,
+				      unsigned int repeatMSec) :
+  myIntervalUSec((long long)intervalMSec * 1000),
+  myRepeatUSec((long long)repeatMSec * 1000),
+  myNextUSec(0),
+  mySuppressed(0),
+  myTotalSkipped(0),
+  myLastLoggedUSec(0),
+  myRepeated(0)
+{
+  myMutex.setLogName("ArLogThrottle::myMutex");
+}
+
+/**
+   Only one of the threads calling this at about the same time gets
+   true, and nothing is locked, so it's cheap to call every cycle.
+**/
+AREXPORT bool ArLogThrottle::check()
+{
+  const long long now = ArUtil::getTimeUSec();
+  long long next = myNextUSec.load(std::memory_order_relaxed);
+  if (now >= next &&
+      myNextUSec.compare_exchange_strong(next, now + myIntervalUSec,
+					 std::memory_order_relaxed))
+    return true;
+  mySuppressed.fetch_add(1, std::memory_order_relaxed);
+  myTotalSkipped.fetch_add(1, std::memory_order_relaxed);
+  return false;
+}
+
+AREXPORT void ArLogThrottle::log(ArLog::LogLevel level,
+				 const char *format, ...)
+{
+  char buf[2048];
+  va_list ptr;
+  va_start(ptr, format);
+  vsnprintf(buf, sizeof(buf), format, ptr);
+  va_end(ptr);
+  buf[sizeof(buf) - 1] = '\0';
+
+  const long long now = ArUtil::getTimeUSec();
+  myMutex.lock();
+  const bool same = (myLastMessage == buf);
+  if (same && myRepeatUSec > 0 && now - myLastLoggedUSec < myRepeatUSec)
+  {
+    myRepeated.fetch_add(1, std::memory_order_relaxed);
+    myTotalSkipped.fetch_add(1, std::memory_order_relaxed);
+    myMutex.unlock();
+    return;
+  }
+  const unsigned long suppressed = mySuppressed.exchange(0);
+  const unsigned long repeated = myRepeated.exchange(0);
+  const double secs = (double)(now - myLastLoggedUSec) / 1000000.0;
+  myLastMessage = buf;
+  myLastLoggedUSec = now;
+  myMutex.unlock();
+
+  // the ones check() kept out weren't formatted, so they're only known
+  // to be repeats if there weren't any
+  if (suppressed == 0 && repeated == 0)
+    ArLog::log(level, "%s", buf);
+  else if (suppressed == 0 && same)
+    ArLog::log(level, "%s (repeated %lu times in the last %.1f sec)",
+	       buf, repeated, secs);
+  else
+    ArLog::log(level, "%s (%lu more not logged in the last %.1f sec)",
+	       buf, suppressed + repeated, secs);
+}
@@ -27,12 +27,14 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaOSDef.h"
 #include "Aria/ariaUtil.h"
 #include "Aria/ArThread.h"
+#include "Aria/ArMutexStats.h"
 #include <stdio.h>
 #include <stdarg.h>
 
 
 unsigned int ArMutex::ourLockWarningMS = 0;
 unsigned int ArMutex::ourUnlockWarningMS = 0;
+bool ArMutex::ourContentionStats = false;
 ArFunctor *ArMutex::ourNonRecursiveDeadlockFunctor = NULL;
 
 
@@ -52,6 +54,9 @@ void ArMutex::initLockTiming()
   myFirstLock = true;
   myLockTime = new ArTime;
   myLockStarted = new ArTime;
+  myStats = NULL;
+  myStatsDepth = 0;
+  myStatsLockedUSec = 0;
 }
 
 void ArMutex::uninitLockTiming()
@@ -113,3 +118,29 @@ void ArMutex::checkUnlockTime() {
 #endif
 		  (double) myLockTime->mSecSince() / 1000.0);
 }
+
+void ArMutex::startStats(long long waitUSec)
+{
+  // only the outermost lock of a recursive lock is timed
+  if (myStatsDepth > 0)
+  {
+    myStatsDepth++;
+    return;
+  }
+  const char *holder = ArMutexStats::getThisThreadName();
+  // this is ArThread's mutex being locked to find the thread's name
+  if (holder == NULL)
+    return;
+  if (myStats == NULL)
+    myStats = ArMutexStats::get(myLogName);
+  myStats->addLock(waitUSec, holder);
+  myStatsDepth = 1;
+  myStatsLockedUSec = ArUtil::getTimeUSec();
+}
+
+void ArMutex::stopStats()
+{
+  if (myStatsDepth == 0 || --myStatsDepth > 0 || myStats == NULL)
+    return;
+  myStats->addHold(ArUtil::getTimeUSec() - myStatsLockedUSec);
+}
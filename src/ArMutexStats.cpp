@@ -0,0 +1,199 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArMutexStats.h"
+#include "Aria/ArThread.h"
+
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include <set>
+
+namespace {
+  // These use std::mutex rather than ArMutex, since locking an ArMutex
+  // comes back in here.  Nothing in them is ever freed, so the stats and
+  // thread names handed out stay valid.
+  std::mutex &getRegistryMutex()
+  {
+    static std::mutex mutex;
+    return mutex;
+  }
+  std::map<std::string, ArMutexStats *> &getRegistry()
+  {
+    static std::map<std::string, ArMutexStats *> registry;
+    return registry;
+  }
+  std::set<std::string> &getThreadNames()
+  {
+    static std::set<std::string> names;
+    return names;
+  }
+
+  thread_local const char *ourThisThreadName = NULL;
+  // so the lookup of the thread's name doesn't count (and recurse into)
+  // the lock of ArThread's map of threads
+  thread_local bool ourLookingUpThreadName = false;
+}
+
+ArMutexStats::ArMutexStats(const std::string &name) :
+  myName(name),
+  myLocks(0),
+  myContendedLocks(0),
+  myTotalWaitUSec(0),
+  myMaxWaitUSec(0),
+  myLastHolder("")
+{
+}
+
+AREXPORT ArMutexStats *ArMutexStats::get(const std::string &name)
+{
+  std::lock_guard<std::mutex> lock(getRegistryMutex());
+  ArMutexStats *&stats = getRegistry()[name];
+  if (stats == NULL)
+    stats = new ArMutexStats(name);
+  return stats;
+}
+
+AREXPORT const ArMutexStats *ArMutexStats::find(const char *name)
+{
+  std::lock_guard<std::mutex> lock(getRegistryMutex());
+  std::map<std::string, ArMutexStats *>::const_iterator it =
+    getRegistry().find(name);
+  if (it == getRegistry().end())
+    return NULL;
+  return (*it).second;
+}
+
+/**
+   Threads that aren't ArThread objects (or haven't been added to
+   ArThread's map yet) look their name up again each time, so they show
+   up by name once they have one.  A thread that's renamed after it has
+   locked a mutex keeps its old name here.
+
+   @return the name, or NULL while the calling thread's name is being
+   looked up (in which case the lock shouldn't be counted)
+**/
+AREXPORT const char *ArMutexStats::getThisThreadName()
+{
+  if (ourThisThreadName != NULL)
+    return ourThisThreadName;
+  if (ourLookingUpThreadName)
+    return NULL;
+  ourLookingUpThreadName = true;
+  ArThread *self = ArThread::self();
+  const std::string name = (self != NULL) ? self->getThreadName() :
+    ArThread::getThisThreadName();
+  ourLookingUpThreadName = false;
+
+  std::lock_guard<std::mutex> lock(getRegistryMutex());
+  const char *interned = getThreadNames().insert(name).first->c_str();
+  if (self != NULL)
+    ourThisThreadName = interned;
+  return interned;
+}
+
+AREXPORT void ArMutexStats::addLock(long long waitUSec, const char *holder)
+{
+  myLocks.fetch_add(1, std::memory_order_relaxed);
+  if (waitUSec >= 0)
+  {
+    myContendedLocks.fetch_add(1, std::memory_order_relaxed);
+    myTotalWaitUSec.fetch_add(waitUSec, std::memory_order_relaxed);
+    long long max = myMaxWaitUSec.load(std::memory_order_relaxed);
+    while (waitUSec > max &&
+	   !myMaxWaitUSec.compare_exchange_weak(max, waitUSec,
+						std::memory_order_relaxed))
+      ;
+  }
+  myLastHolder.store(holder, std::memory_order_relaxed);
+}
+
+AREXPORT void ArMutexStats::reset()
+{
+  myLocks.store(0, std::memory_order_relaxed);
+  myContendedLocks.store(0, std::memory_order_relaxed);
+  myTotalWaitUSec.store(0, std::memory_order_relaxed);
+  myMaxWaitUSec.store(0, std::memory_order_relaxed);
+  myHoldTimes.reset();
+}
+
+AREXPORT void ArMutexStats::log(ArLog::LogLevel level) const
+{
+  const ArTimeHistogram &hold = myHoldTimes;
+  ArLog::log(level,
+	     "Mutex '%s': %llu locks, %llu contended (%.1f%%), waited %.3f sec total, max %lld us, held mean %.1f us, 99%% <= %lld us, max %lld us, last locked by '%s'",
+	     getName(), getLocks(), getContendedLocks(),
+	     getLocks() == 0 ? 0.0 :
+	     100.0 * (double)getContendedLocks() / (double)getLocks(),
+	     (double)getTotalWaitUSec() / 1000000.0, getMaxWaitUSec(),
+	     hold.getMean(), hold.getPercentile(99), hold.getMax(),
+	     getLastHolder());
+}
+
+AREXPORT std::vector<const ArMutexStats *> ArMutexStats::getHottest(
+	size_t num)
+{
+  std::vector<const ArMutexStats *> hottest;
+  {
+    std::lock_guard<std::mutex> lock(getRegistryMutex());
+    for (std::map<std::string, ArMutexStats *>::const_iterator it =
+	   getRegistry().begin(); it != getRegistry().end(); ++it)
+      hottest.push_back((*it).second);
+  }
+  // sort on copies of the totals, since they can change while sorting
+  std::vector<std::pair<long long, const ArMutexStats *> > byWait;
+  for (size_t i = 0; i < hottest.size(); i++)
+    byWait.push_back(std::make_pair(-hottest[i]->getTotalWaitUSec(),
+				    hottest[i]));
+  std::stable_sort(byWait.begin(), byWait.end(),
+		   [](const std::pair<long long, const ArMutexStats *> &a,
+		      const std::pair<long long, const ArMutexStats *> &b)
+		   { return a.first < b.first; });
+  hottest.clear();
+  for (size_t i = 0; i < byWait.size() && i < num; i++)
+    hottest.push_back(byWait[i].second);
+  return hottest;
+}
+
+/**
+   The registry isn't locked while logging, since logging locks
+   ArLog's mutex, which counts itself here.
+**/
+AREXPORT void ArMutexStats::logHottest(size_t num, ArLog::LogLevel level)
+{
+  const std::vector<const ArMutexStats *> hottest = getHottest(num);
+  ArLog::log(level, "Mutex contention, %lu most waited on mutexes:",
+	     (unsigned long)hottest.size());
+  for (size_t i = 0; i < hottest.size(); i++)
+    hottest[i]->log(level);
+}
+
+AREXPORT void ArMutexStats::resetAll()
+{
+  std::lock_guard<std::mutex> lock(getRegistryMutex());
+  for (std::map<std::string, ArMutexStats *>::iterator it =
+	 getRegistry().begin(); it != getRegistry().end(); ++it)
+    (*it).second->reset();
+}
@@ -111,6 +111,7 @@ ArMutex::~ArMutex()
 
 ArMutex::ArMutex(const ArMutex &mutex)
 {
+  initLockTiming();
   myLog = mutex.myLog;
   if (pthread_mutex_init(&myMutex, 0) != 0)
   {
@@ -121,7 +122,6 @@ ArMutex::ArMutex(const ArMutex &mutex)
     unlock();
 
   myLogName = mutex.myLogName;
-  initLockTiming();
   myStrMap[STATUS_FAILED_INIT]="Failed to initialize";
   myStrMap[STATUS_FAILED]="General failure";
   myStrMap[STATUS_ALREADY_LOCKED]="Mutex already locked";
@@ -155,7 +155,17 @@ int ArMutex::lock()
   }
 
   int ret;
-  if ((ret = pthread_mutex_lock(&myMutex)) != 0)
+  long long waitUSec = -1;
+  if (!ourContentionStats)
+    ret = pthread_mutex_lock(&myMutex);
+  else if ((ret = pthread_mutex_trylock(&myMutex)) == EBUSY)
+  {
+    // someone else has it, time how long it takes to get it
+    const long long waitStarted = ArUtil::getTimeUSec();
+    ret = pthread_mutex_lock(&myMutex);
+    waitUSec = ArUtil::getTimeUSec() - waitStarted;
+  }
+  if (ret != 0)
   {
     if (ret == EDEADLK)
     {
@@ -207,6 +217,7 @@ int ArMutex::lock()
 
   if(ourLockWarningMS > 0) checkLockTime();
   if(ourUnlockWarningMS > 0) startUnlockTimer();
+  if(ourContentionStats || myStatsDepth > 0) startStats(waitUSec);
 
   
   return(0);
@@ -291,6 +302,8 @@ int ArMutex::tryLock()
 		     ArThread::getThisThreadName(), 
 		     ArThread::getThisThread(), getpid());
 
+  if(ourContentionStats || myStatsDepth > 0) startStats(-1);
+
   return(0);
 }
 
@@ -304,6 +317,7 @@ int ArMutex::unlock()
 		     ArThread::getThisThread(), getpid());
 
   if(ourUnlockWarningMS > 0) checkUnlockTime();
+  if(myStatsDepth > 0) stopStats();
 
   if (myFailedInit)
   {
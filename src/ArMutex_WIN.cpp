@@ -29,6 +29,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArThread.h"
 #include "Aria/ariaInternal.h"
 #include "Aria/ArThread.h"
+#include "Aria/ariaUtil.h"
 
 //#include <process.h> // for getpid()
 
@@ -42,7 +43,10 @@ ArMutex::ArMutex(bool recursive) :
   myWasAlreadyLocked(false),
   myFirstLock(true),
   myLockTime(NULL),
-  myLockStarted(NULL)
+  myLockStarted(NULL),
+  myStats(NULL),
+  myStatsDepth(0),
+  myStatsLockedUSec(0)
 {
   myMutex=CreateMutex(0, true, 0);
   if (!myMutex)
@@ -72,7 +76,10 @@ AREXPORT ArMutex::ArMutex(const ArMutex &mutex) :
   myWasAlreadyLocked(false),
   myFirstLock(true),
   myLockTime(NULL),
-  myLockStarted(NULL)
+  myLockStarted(NULL),
+  myStats(NULL),
+  myStatsDepth(0),
+  myStatsLockedUSec(0)
 {
   myMutex = CreateMutex(0, true, 0);
   if(!myMutex)
@@ -113,7 +120,16 @@ int ArMutex::lock()
   }
 
   if(ourLockWarningMS > 0) startLockTimer();
-  ret=WaitForSingleObject(myMutex, INFINITE);
+  long long waitUSec = -1;
+  if (!ourContentionStats)
+    ret=WaitForSingleObject(myMutex, INFINITE);
+  else if ((ret=WaitForSingleObject(myMutex, 0)) == WAIT_TIMEOUT)
+  {
+    // someone else has it, time how long it takes to get it
+    const long long waitStarted = ArUtil::getTimeUSec();
+    ret=WaitForSingleObject(myMutex, INFINITE);
+    waitUSec = ArUtil::getTimeUSec() - waitStarted;
+  }
   if (ret == WAIT_ABANDONED)
   {
     ArLog::logNoLock(ArLog::Terse, "ArMutex::lock: Tried to lock a mutex %s which was locked by a different thread and never unlocked before that thread exited. This is a recoverable error", myLogName.c_str());
@@ -124,6 +140,7 @@ int ArMutex::lock()
     // locked
 	if(ourLockWarningMS > 0) checkLockTime();
 	if(ourUnlockWarningMS > 0) startUnlockTimer();
+	if(ourContentionStats || myStatsDepth > 0) startStats(waitUSec);
     return(0);
   }
   else
@@ -191,7 +208,10 @@ int ArMutex::tryLock()
     return(STATUS_ALREADY_LOCKED);
   }
   else if (ret == WAIT_OBJECT_0)
+  {
+    if(ourContentionStats || myStatsDepth > 0) startStats(-1);
     return(0);
+  }
   else
   {
     ArLog::logNoLock(ArLog::Terse, "ArMutex::lock: Failed to lock %s due to an unknown error", myLogName.c_str());
@@ -243,6 +263,7 @@ int ArMutex::unlock()
   }
 
   if(ourUnlockWarningMS > 0) checkUnlockTime();
+  if(myStatsDepth > 0) stopStats();
 
   if (!ReleaseMutex(myMutex))
   {
@@ -290,7 +290,7 @@ ArBasePacket * ArRVisionPTZ::readPacket()
   int num;
   memset(data, 0, ARRVISION_MAX_RESPONSE_BYTES);
   for (num=0; num <= ARRVISION_MAX_RESPONSE_BYTES+1; num++) {
-    if (myConn->read((char *) &byte, 1,1) <= 0 ||
+    if (myConn->readBuffered((char *) &byte, 1,1) <= 0 ||
 	num == ARRVISION_MAX_RESPONSE_BYTES+1) {
       return NULL;
     }
@@ -305,7 +305,7 @@ ArBasePacket * ArRVisionPTZ::readPacket()
   }
   // we got the header
   for (num=1; num <= ARRVISION_MAX_RESPONSE_BYTES; num++) {
-    if (myConn->read((char *) &byte, 1, 1) <= 0) {
+    if (myConn->readBuffered((char *) &byte, 1, 1) <= 0) {
       // there are no more bytes, so check the last byte for the footer
       if (data[num-1] != 0xFF) {
 	//printf("ArRVisionPTZ::packetHandler: should have gotten 0xFF, got 0x%x\n", data[num-1]);
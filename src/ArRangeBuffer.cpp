@@ -27,20 +27,119 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArLog.h"
 
 #include <algorithm>
+#include <atomic>
+#include <math.h>
+
+#if defined(__SSE2__) || defined(_M_X64) || \
+  (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define ARRANGEBUFFER_SSE2
+#include <emmintrin.h>
+#endif
+
+// AVX2 is only used if the processor has it (see ArChecksum.cpp)
+#if defined(ARRANGEBUFFER_SSE2) && defined(__GNUC__) && \
+  (defined(__x86_64__) || defined(__i386__))
+#define ARRANGEBUFFER_AVX2
+#include <immintrin.h>
+#define ARRANGEBUFFER_TARGET_AVX2 __attribute__((target("avx2")))
+#endif
 
 
 
 /** @class ArRangeBuffer
  * 
- *  @impnote The data in ArRangeBuffer is currently stored as a std::list of ArPoseWithTime objects.  When new readings are added
- *  to the buffer, an ArPoseWithTime object is added to the beginning of the list, or if buffer is at capacity, the last (oldest) reading
- *  is moved (spliced) to the front and re-used, or else if a previously created ArPoseWithTime is available 
- *  (e.g. was previously removed by being invalidated by the ArRangeDevice or internal condition), it will be re-used and spliced to the beginning 
- *  of the list.   An alternative implementation would be to use a std::vector or std::array (since the max capacity is generally set at compile time),
- *  used as a circular buffer with our own begin/end iterators maintained.  This would enable users to more efficiently make a copy of the buffer
- *  for asynchronous processing.  For this reason, getBegin() and getEnd() are the preferred means of acessing buffer data. (You also generally need to lock/unlock the ArRangeDevice object while accessing the buffer)
+ *  @impnote The readings in ArRangeBuffer are stored in a ring buffer, as three arrays (X coordinates, Y coordinates and times) that are
+ *  allocated as the buffer fills up, to at most the capacity.  A new reading is written after the newest one, over the oldest one if the
+ *  buffer is full, so adding readings never allocates once the buffer has filled up.  Removing readings (invalidation sweeps, clearOlderThan())
+ *  moves the readings that are kept together in one pass.  getBegin() and getEnd() walk through the arrays by index, and getSpans() gives
+ *  the arrays themselves.  getBuffer() copies the readings into a std::list for older code, and getBufferPtr() and getBufferPtrsPtr() let that
+ *  list be changed, and the changes are taken back the next time the buffer is read or changed (through takeBackList()).
+ *  getClosestPolar() and getClosestBox() go through the arrays with SSE2 or AVX2 when the processor has them (see getImplementation()),
+ *  comparing squared distances, and getClosestPolar() tells if a reading is in the slice from cross products with the edges of the slice
+ *  instead of atan2 (which is only used for readings right at an edge, and for the closest one).
+ *  (You also generally need to lock/unlock the ArRangeDevice object while accessing the buffer)
  */
 
+void ArRangeBuffer::reallocate(size_t allocated)
+{
+  std::vector<double> x(allocated), y(allocated);
+  std::vector<ArTime> times(allocated);
+  for (size_t n = 0; n < mySize; ++n)
+  {
+    const size_t p = physicalFromOldest(n);
+    x[n] = myX[p];
+    y[n] = myY[p];
+    times[n] = myTimes[p];
+  }
+  myX.swap(x);
+  myY.swap(y);
+  myTimes.swap(times);
+  myStart = 0;
+}
+
+void ArRangeBuffer::grow()
+{
+  size_t allocated = myX.size() * 2;
+  if (allocated < 16)
+    allocated = 16;
+  if (allocated > myCapacity)
+    allocated = myCapacity;
+  reallocate(allocated);
+}
+
+void ArRangeBuffer::dropOldest(size_t num)
+{
+  if (num >= mySize)
+  {
+    myStart = 0;
+    mySize = 0;
+    return;
+  }
+  myStart = physicalFromOldest(num);
+  mySize -= num;
+}
+
+void ArRangeBuffer::takeBackList()
+{
+  if (!myListHandedOut)
+    return;
+  myListHandedOut = false;
+  // most callers only look, then nothing needs taking back
+  if (myListValid && myList.size() == mySize)
+  {
+    size_t i = 0;
+    auto it = myList.cbegin();
+    for (; it != myList.cend(); ++it, ++i)
+    {
+      const size_t p = physicalIndex(i);
+      if (it->getX() != myX[p] || it->getY() != myY[p] ||
+	  !(it->getTime() == myTimes[p]))
+	break;
+    }
+    if (it == myList.cend())
+      return;
+  }
+  ++myChangeCount;
+  const size_t num = std::min(myList.size(), myCapacity);
+  mySize = 0;
+  myStart = 0;
+  if (myX.size() < num)
+    reallocate(num);
+  // the list is newest first
+  size_t n = num;
+  for (auto it = myList.cbegin(); n > 0; ++it)
+  {
+    --n;
+    myX[n] = it->getX();
+    myY[n] = it->getY();
+    myTimes[n] = it->getTime();
+  }
+  mySize = num;
+  myListValid = (num == myList.size());
+  myListChangeCount = myChangeCount;
+  myListIndexValid = false;
+}
+
 /**
    If the new size is smaller than the current buffer it chops off the 
    readings that are excess from the oldest readings... if the new size
@@ -49,11 +148,550 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 */
 AREXPORT void ArRangeBuffer::setCapacity(size_t size) 
 {
+  takeBackList();
   myCapacity = size;
-  if(myCapacity < myBuffer.size())
-    myBuffer.resize(myCapacity);
+  if(myCapacity < mySize)
+  {
+    dropOldest(mySize - myCapacity);
+    ++myChangeCount;
+  }
+  if (myX.size() > myCapacity)
+    reallocate(myCapacity);
+}
+
+
+/// What getClosestPolar() looks for, worked out once for all of the readings
+struct ArRangeBufferPolarQuery
+{
+  double x, y, th; // where it's looking from
+  double startAngle, endAngle;
+  // directions of the start and end of the slice
+  double startX, startY, endX, endY;
+  // true if the slice is more than 180 degrees
+  bool wide;
+};
+
+/// The closest reading in a span found so far
+struct ArRangeBufferClosest
+{
+  double distSquared;
+  size_t index;
+  bool found;
+};
+
+// readings whose direction is this close (in radians, about) to the edge
+// of the slice are checked with atan2, the same way as they always were,
+// so that the cross products never decide differently
+static const double ourPolarSlack = 1e-9;
+
+static void closestPolarSetup(ArRangeBufferPolarQuery *q, 
+			      double startAngle, double endAngle,
+			      const ArPose &startPos)
+{
+  q->x = startPos.getX();
+  q->y = startPos.getY();
+  q->th = startPos.getTh();
+  q->startAngle = startAngle;
+  q->endAngle = endAngle;
+  q->startX = ArMath::cos(startAngle + q->th);
+  q->startY = ArMath::sin(startAngle + q->th);
+  q->endX = ArMath::cos(endAngle + q->th);
+  q->endY = ArMath::sin(endAngle + q->th);
+  if (startAngle < endAngle)
+    q->wide = endAngle - startAngle > 180;
+  else
+    q->wide = endAngle - startAngle + 360 > 180;
+}
+
+/// Angle to the reading relative to the heading, as getClosestPolar() reports it
+static double polarAngle(const ArRangeBufferPolarQuery &q, double x, double y)
+{
+  return ArMath::subAngle(ArMath::radToDeg(atan2(y - q.y, x - q.x)), q.th);
+}
+
+static bool polarInsideExact(const ArRangeBufferPolarQuery &q, 
+			     double x, double y)
+{
+  return ArMath::angleBetween(polarAngle(q, x, y), q.startAngle, q.endAngle);
+}
+
+/**
+   The cross products of the reading's direction with the start and end
+   of the slice say which side of each it's on, which (with the slice
+   being more or less than 180 degrees) says if it's in the slice.  Only
+   readings too close to an edge to tell need atan2.
+**/
+static bool polarInside(const ArRangeBufferPolarQuery &q, double x, double y)
+{
+  const double dx = x - q.x;
+  const double dy = y - q.y;
+  const double startCross = q.startX * dy - q.startY * dx;
+  const double endCross = q.endX * dy - q.endY * dx;
+  const double slack = ourPolarSlack * (fabs(dx) + fabs(dy));
+  if (!q.wide)
+  {
+    if (startCross > slack && endCross < -slack)
+      return true;
+    if (startCross < -slack || endCross > slack)
+      return false;
+  }
+  else
+  {
+    if (startCross > slack || endCross < -slack)
+      return true;
+    if (startCross < -slack && endCross > slack)
+      return false;
+  }
+  return polarInsideExact(q, x, y);
+}
+
+// squared distances closer than this (relatively) might give the same
+// distance after sqrt
+static const double ourTieLow = 1 - 1.0 / (1LL << 50);
+static const double ourTieHigh = 1 + 1.0 / (1LL << 50);
+
+/**
+   Sees if a reading @a distSquared away is closer than one @a
+   bestDistSquared away, the same way as comparing their distances would,
+   since readings that are different squared distances away can be the
+   same distance away after sqrt, and then the newest of them is the
+   closest.  Only needs sqrt when they're that close.
+**/
+static inline bool closerThan(double distSquared, double bestDistSquared)
+{
+  if (distSquared < bestDistSquared * ourTieLow)
+    return true;
+  if (!(distSquared <= bestDistSquared * ourTieHigh))
+    return false;
+  return sqrt(distSquared) < sqrt(bestDistSquared);
+}
+
+/// Updates the lanes of a vector when some may be ties (see closerThan())
+static void closerLanes(const double *candidate, size_t firstIndex, 
+			int numLanes, double *best, double *bestIndex)
+{
+  for (int j = 0; j < numLanes; j++)
+  {
+    if (closerThan(candidate[j], best[j]))
+    {
+      best[j] = candidate[j];
+      bestIndex[j] = (double)(firstIndex + (size_t)j);
+    }
+  }
+}
+
+/// The closest of the readings (so far) in each lane of a vector, put together
+static void closestFromLanes(const double *distSquared, const double *index,
+			     int numLanes, ArRangeBufferClosest *closest)
+{
+  for (int j = 0; j < numLanes; j++)
+  {
+    if (index[j] < 0)
+      continue;
+    // the newest (highest index) of equally close readings
+    const size_t i = (size_t)index[j];
+    if (!closest->found || closerThan(distSquared[j], closest->distSquared) ||
+	(!closerThan(closest->distSquared, distSquared[j]) && 
+	 i > closest->index))
+    {
+      closest->distSquared = distSquared[j];
+      closest->index = i;
+      closest->found = true;
+    }
+  }
+}
+
+/// Readings before @a end (older than any already found), newest first
+static void closestPolarScalar(const ArRangeBufferPolarQuery &q, 
+			       const double *x, const double *y, size_t end,
+			       ArRangeBufferClosest *closest)
+{
+  for (size_t i = end; i > 0; --i)
+  {
+    if (!polarInside(q, x[i - 1], y[i - 1]))
+      continue;
+    const double distSquared = 
+      ArMath::squaredDistanceBetween(x[i - 1], y[i - 1], q.x, q.y);
+    if (!closest->found || closerThan(distSquared, closest->distSquared))
+    {
+      closest->distSquared = distSquared;
+      closest->index = i - 1;
+      closest->found = true;
+    }
+  }
+}
+
+static void closestBoxScalar(const double *x, const double *y, size_t end,
+			     const ArTransform &trans, 
+			     double x1, double y1, double x2, double y2,
+			     const ArPose &targetPose, 
+			     ArRangeBufferClosest *closest)
+{
+  const double tx = trans.getX(), ty = trans.getY();
+  const double c = trans.getCos(), s = trans.getSin();
+  for (size_t i = end; i > 0; --i)
+  {
+    // the same arithmetic as ArTransform::doTransform()
+    const double px = tx + c * x[i - 1] + s * y[i - 1];
+    const double py = ty + c * y[i - 1] - s * x[i - 1];
+    if (px < x1 || px > x2 || py < y1 || py > y2)
+      continue;
+    const double distSquared = ArMath::squaredDistanceBetween(
+	    px, py, targetPose.getX(), targetPose.getY());
+    if (!closest->found || closerThan(distSquared, closest->distSquared))
+    {
+      closest->distSquared = distSquared;
+      closest->index = i - 1;
+      closest->found = true;
+    }
+  }
+}
+
+#ifdef ARRANGEBUFFER_SSE2
+/**
+   Keeps the closer of @a candidate and @a best in each lane (readings
+   not in the region are NaN in @a candidate, so they're never closer).
+**/
+static inline void closerSSE2(__m128d candidate, size_t firstIndex,
+			      __m128d *best, __m128d *bestIndex)
+{
+  const __m128d low = _mm_mul_pd(*best, _mm_set1_pd(ourTieLow));
+  const __m128d high = _mm_mul_pd(*best, _mm_set1_pd(ourTieHigh));
+  const __m128d maybeTie = _mm_and_pd(_mm_cmpge_pd(candidate, low), 
+				      _mm_cmple_pd(candidate, high));
+  if (_mm_movemask_pd(maybeTie) != 0)
+  {
+    double candidates[2], lanes[2], indexes[2];
+    _mm_storeu_pd(candidates, candidate);
+    _mm_storeu_pd(lanes, *best);
+    _mm_storeu_pd(indexes, *bestIndex);
+    closerLanes(candidates, firstIndex, 2, lanes, indexes);
+    *best = _mm_loadu_pd(lanes);
+    *bestIndex = _mm_loadu_pd(indexes);
+    return;
+  }
+  const __m128d closer = _mm_cmplt_pd(candidate, low);
+  const __m128d index = _mm_set_pd((double)(firstIndex + 1), 
+				   (double)firstIndex);
+  *best = _mm_or_pd(_mm_and_pd(closer, candidate), 
+		    _mm_andnot_pd(closer, *best));
+  *bestIndex = _mm_or_pd(_mm_and_pd(closer, index), 
+			 _mm_andnot_pd(closer, *bestIndex));
+}
+
+static void closestPolarSSE2(const ArRangeBufferPolarQuery &q, 
+			     const double *x, const double *y, size_t n,
+			     ArRangeBufferClosest *closest)
+{
+  const __m128d px = _mm_set1_pd(q.x), py = _mm_set1_pd(q.y);
+  const __m128d startX = _mm_set1_pd(q.startX);
+  const __m128d startY = _mm_set1_pd(q.startY);
+  const __m128d endX = _mm_set1_pd(q.endX), endY = _mm_set1_pd(q.endY);
+  const __m128d slackFactor = _mm_set1_pd(ourPolarSlack);
+  const __m128d absMask = _mm_castsi128_pd(_mm_set1_epi64x(0x7fffffffffffffffLL));
+  const __m128d none = _mm_set1_pd(NAN);
+  __m128d best = _mm_set1_pd(HUGE_VAL), bestIndex = _mm_set1_pd(-1);
+  size_t i = n;
+  // a vector at a time from the newest end, so each lane keeps the newest
+  // of its equally close readings
+  for (; i >= 2; i -= 2)
+  {
+    const __m128d rx = _mm_loadu_pd(x + i - 2), ry = _mm_loadu_pd(y + i - 2);
+    const __m128d dx = _mm_sub_pd(rx, px), dy = _mm_sub_pd(ry, py);
+    const __m128d startCross = _mm_sub_pd(_mm_mul_pd(startX, dy), 
+					  _mm_mul_pd(startY, dx));
+    const __m128d endCross = _mm_sub_pd(_mm_mul_pd(endX, dy), 
+					_mm_mul_pd(endY, dx));
+    const __m128d slack = _mm_mul_pd(slackFactor, 
+				     _mm_add_pd(_mm_and_pd(dx, absMask), 
+						_mm_and_pd(dy, absMask)));
+    const __m128d negSlack = _mm_sub_pd(_mm_setzero_pd(), slack);
+    const __m128d startIn = _mm_cmpgt_pd(startCross, slack);
+    const __m128d endIn = _mm_cmplt_pd(endCross, negSlack);
+    const __m128d startOut = _mm_cmplt_pd(startCross, negSlack);
+    const __m128d endOut = _mm_cmpgt_pd(endCross, slack);
+    __m128d inside, outside;
+    if (!q.wide)
+    {
+      inside = _mm_and_pd(startIn, endIn);
+      outside = _mm_or_pd(startOut, endOut);
+    }
+    else
+    {
+      inside = _mm_or_pd(startIn, endIn);
+      outside = _mm_and_pd(startOut, endOut);
+    }
+    const __m128d distSquared = _mm_add_pd(_mm_mul_pd(dx, dx), 
+					   _mm_mul_pd(dy, dy));
+    __m128d candidate = _mm_or_pd(_mm_and_pd(inside, distSquared), 
+				  _mm_andnot_pd(inside, none));
+    const int unsure = 3 & ~_mm_movemask_pd(_mm_or_pd(inside, outside));
+    if (unsure != 0)
+    {
+      double lanes[2];
+      _mm_storeu_pd(lanes, candidate);
+      for (int j = 0; j < 2; j++)
+	if ((unsure & (1 << j)) && 
+	    polarInsideExact(q, x[i - 2 + (size_t)j], y[i - 2 + (size_t)j]))
+	  lanes[j] = ArMath::squaredDistanceBetween(
+		  x[i - 2 + (size_t)j], y[i - 2 + (size_t)j], q.x, q.y);
+      candidate = _mm_loadu_pd(lanes);
+    }
+    closerSSE2(candidate, i - 2, &best, &bestIndex);
+  }
+  double lanes[2], indexes[2];
+  _mm_storeu_pd(lanes, best);
+  _mm_storeu_pd(indexes, bestIndex);
+  closestFromLanes(lanes, indexes, 2, closest);
+  closestPolarScalar(q, x, y, i, closest);
+}
+
+static void closestBoxSSE2(const double *x, const double *y, size_t n,
+			   const ArTransform &trans, 
+			   double x1, double y1, double x2, double y2,
+			   const ArPose &targetPose, 
+			   ArRangeBufferClosest *closest)
+{
+  const __m128d tx = _mm_set1_pd(trans.getX()), ty = _mm_set1_pd(trans.getY());
+  const __m128d c = _mm_set1_pd(trans.getCos()), s = _mm_set1_pd(trans.getSin());
+  const __m128d minX = _mm_set1_pd(x1), maxX = _mm_set1_pd(x2);
+  const __m128d minY = _mm_set1_pd(y1), maxY = _mm_set1_pd(y2);
+  const __m128d targetX = _mm_set1_pd(targetPose.getX());
+  const __m128d targetY = _mm_set1_pd(targetPose.getY());
+  const __m128d none = _mm_set1_pd(NAN);
+  __m128d best = _mm_set1_pd(HUGE_VAL), bestIndex = _mm_set1_pd(-1);
+  size_t i = n;
+  for (; i >= 2; i -= 2)
+  {
+    const __m128d rx = _mm_loadu_pd(x + i - 2), ry = _mm_loadu_pd(y + i - 2);
+    const __m128d px = _mm_add_pd(_mm_add_pd(tx, _mm_mul_pd(c, rx)), 
+				  _mm_mul_pd(s, ry));
+    const __m128d py = _mm_sub_pd(_mm_add_pd(ty, _mm_mul_pd(c, ry)), 
+				  _mm_mul_pd(s, rx));
+    const __m128d inside = _mm_and_pd(
+	    _mm_and_pd(_mm_cmpge_pd(px, minX), _mm_cmple_pd(px, maxX)),
+	    _mm_and_pd(_mm_cmpge_pd(py, minY), _mm_cmple_pd(py, maxY)));
+    const __m128d dx = _mm_sub_pd(px, targetX), dy = _mm_sub_pd(py, targetY);
+    const __m128d distSquared = _mm_add_pd(_mm_mul_pd(dx, dx), 
+					   _mm_mul_pd(dy, dy));
+    __m128d candidate = _mm_or_pd(_mm_and_pd(inside, distSquared), 
+					_mm_andnot_pd(inside, none));
+    closerSSE2(candidate, i - 2, &best, &bestIndex);
+  }
+  double lanes[2], indexes[2];
+  _mm_storeu_pd(lanes, best);
+  _mm_storeu_pd(indexes, bestIndex);
+  closestFromLanes(lanes, indexes, 2, closest);
+  closestBoxScalar(x, y, i, trans, x1, y1, x2, y2, targetPose, closest);
+}
+#endif // ARRANGEBUFFER_SSE2
+
+#ifdef ARRANGEBUFFER_AVX2
+/// Keeps the closer of @a candidate and @a best in each lane (see closerSSE2())
+ARRANGEBUFFER_TARGET_AVX2
+static inline void closerAVX2(__m256d candidate, size_t firstIndex,
+			      __m256d *best, __m256d *bestIndex)
+{
+  const __m256d low = _mm256_mul_pd(*best, _mm256_set1_pd(ourTieLow));
+  const __m256d high = _mm256_mul_pd(*best, _mm256_set1_pd(ourTieHigh));
+  const __m256d maybeTie = _mm256_and_pd(
+	  _mm256_cmp_pd(candidate, low, _CMP_GE_OQ), 
+	  _mm256_cmp_pd(candidate, high, _CMP_LE_OQ));
+  if (_mm256_movemask_pd(maybeTie) != 0)
+  {
+    double candidates[4], lanes[4], indexes[4];
+    _mm256_storeu_pd(candidates, candidate);
+    _mm256_storeu_pd(lanes, *best);
+    _mm256_storeu_pd(indexes, *bestIndex);
+    closerLanes(candidates, firstIndex, 4, lanes, indexes);
+    *best = _mm256_loadu_pd(lanes);
+    *bestIndex = _mm256_loadu_pd(indexes);
+    return;
+  }
+  const __m256d closer = _mm256_cmp_pd(candidate, low, _CMP_LT_OQ);
+  const __m256d index = _mm256_add_pd(_mm256_set1_pd((double)firstIndex), 
+				      _mm256_set_pd(3, 2, 1, 0));
+  *best = _mm256_blendv_pd(*best, candidate, closer);
+  *bestIndex = _mm256_blendv_pd(*bestIndex, index, closer);
 }
 
+ARRANGEBUFFER_TARGET_AVX2
+static void closestPolarAVX2(const ArRangeBufferPolarQuery &q, 
+			     const double *x, const double *y, size_t n,
+			     ArRangeBufferClosest *closest)
+{
+  const __m256d px = _mm256_set1_pd(q.x), py = _mm256_set1_pd(q.y);
+  const __m256d startX = _mm256_set1_pd(q.startX);
+  const __m256d startY = _mm256_set1_pd(q.startY);
+  const __m256d endX = _mm256_set1_pd(q.endX), endY = _mm256_set1_pd(q.endY);
+  const __m256d slackFactor = _mm256_set1_pd(ourPolarSlack);
+  const __m256d absMask = _mm256_castsi256_pd(
+	  _mm256_set1_epi64x(0x7fffffffffffffffLL));
+  const __m256d none = _mm256_set1_pd(NAN);
+  __m256d best = _mm256_set1_pd(HUGE_VAL), bestIndex = _mm256_set1_pd(-1);
+  size_t i = n;
+  for (; i >= 4; i -= 4)
+  {
+    const __m256d rx = _mm256_loadu_pd(x + i - 4);
+    const __m256d ry = _mm256_loadu_pd(y + i - 4);
+    const __m256d dx = _mm256_sub_pd(rx, px), dy = _mm256_sub_pd(ry, py);
+    const __m256d startCross = _mm256_sub_pd(_mm256_mul_pd(startX, dy), 
+					     _mm256_mul_pd(startY, dx));
+    const __m256d endCross = _mm256_sub_pd(_mm256_mul_pd(endX, dy), 
+					   _mm256_mul_pd(endY, dx));
+    const __m256d slack = _mm256_mul_pd(
+	    slackFactor, _mm256_add_pd(_mm256_and_pd(dx, absMask), 
+				       _mm256_and_pd(dy, absMask)));
+    const __m256d negSlack = _mm256_sub_pd(_mm256_setzero_pd(), slack);
+    const __m256d startIn = _mm256_cmp_pd(startCross, slack, _CMP_GT_OQ);
+    const __m256d endIn = _mm256_cmp_pd(endCross, negSlack, _CMP_LT_OQ);
+    const __m256d startOut = _mm256_cmp_pd(startCross, negSlack, _CMP_LT_OQ);
+    const __m256d endOut = _mm256_cmp_pd(endCross, slack, _CMP_GT_OQ);
+    __m256d inside, outside;
+    if (!q.wide)
+    {
+      inside = _mm256_and_pd(startIn, endIn);
+      outside = _mm256_or_pd(startOut, endOut);
+    }
+    else
+    {
+      inside = _mm256_or_pd(startIn, endIn);
+      outside = _mm256_and_pd(startOut, endOut);
+    }
+    const __m256d distSquared = _mm256_add_pd(_mm256_mul_pd(dx, dx), 
+					      _mm256_mul_pd(dy, dy));
+    __m256d candidate = _mm256_blendv_pd(none, distSquared, inside);
+    const int unsure = 15 & ~_mm256_movemask_pd(_mm256_or_pd(inside, outside));
+    if (unsure != 0)
+    {
+      double lanes[4];
+      _mm256_storeu_pd(lanes, candidate);
+      for (int j = 0; j < 4; j++)
+	if ((unsure & (1 << j)) && 
+	    polarInsideExact(q, x[i - 4 + (size_t)j], y[i - 4 + (size_t)j]))
+	  lanes[j] = ArMath::squaredDistanceBetween(
+		  x[i - 4 + (size_t)j], y[i - 4 + (size_t)j], q.x, q.y);
+      candidate = _mm256_loadu_pd(lanes);
+    }
+    closerAVX2(candidate, i - 4, &best, &bestIndex);
+  }
+  double lanes[4], indexes[4];
+  _mm256_storeu_pd(lanes, best);
+  _mm256_storeu_pd(indexes, bestIndex);
+  closestFromLanes(lanes, indexes, 4, closest);
+  closestPolarScalar(q, x, y, i, closest);
+}
+
+ARRANGEBUFFER_TARGET_AVX2
+static void closestBoxAVX2(const double *x, const double *y, size_t n,
+			   const ArTransform &trans, 
+			   double x1, double y1, double x2, double y2,
+			   const ArPose &targetPose, 
+			   ArRangeBufferClosest *closest)
+{
+  const __m256d tx = _mm256_set1_pd(trans.getX());
+  const __m256d ty = _mm256_set1_pd(trans.getY());
+  const __m256d c = _mm256_set1_pd(trans.getCos());
+  const __m256d s = _mm256_set1_pd(trans.getSin());
+  const __m256d minX = _mm256_set1_pd(x1), maxX = _mm256_set1_pd(x2);
+  const __m256d minY = _mm256_set1_pd(y1), maxY = _mm256_set1_pd(y2);
+  const __m256d targetX = _mm256_set1_pd(targetPose.getX());
+  const __m256d targetY = _mm256_set1_pd(targetPose.getY());
+  const __m256d none = _mm256_set1_pd(NAN);
+  __m256d best = _mm256_set1_pd(HUGE_VAL), bestIndex = _mm256_set1_pd(-1);
+  size_t i = n;
+  for (; i >= 4; i -= 4)
+  {
+    const __m256d rx = _mm256_loadu_pd(x + i - 4);
+    const __m256d ry = _mm256_loadu_pd(y + i - 4);
+    const __m256d px = _mm256_add_pd(_mm256_add_pd(tx, _mm256_mul_pd(c, rx)), 
+				     _mm256_mul_pd(s, ry));
+    const __m256d py = _mm256_sub_pd(_mm256_add_pd(ty, _mm256_mul_pd(c, ry)), 
+				     _mm256_mul_pd(s, rx));
+    const __m256d inside = _mm256_and_pd(
+	    _mm256_and_pd(_mm256_cmp_pd(px, minX, _CMP_GE_OQ), 
+			  _mm256_cmp_pd(px, maxX, _CMP_LE_OQ)),
+	    _mm256_and_pd(_mm256_cmp_pd(py, minY, _CMP_GE_OQ), 
+			  _mm256_cmp_pd(py, maxY, _CMP_LE_OQ)));
+    const __m256d dx = _mm256_sub_pd(px, targetX);
+    const __m256d dy = _mm256_sub_pd(py, targetY);
+    const __m256d distSquared = _mm256_add_pd(_mm256_mul_pd(dx, dx), 
+					      _mm256_mul_pd(dy, dy));
+    __m256d candidate = _mm256_blendv_pd(none, distSquared, inside);
+    closerAVX2(candidate, i - 4, &best, &bestIndex);
+  }
+  double lanes[4], indexes[4];
+  _mm256_storeu_pd(lanes, best);
+  _mm256_storeu_pd(indexes, bestIndex);
+  closestFromLanes(lanes, indexes, 4, closest);
+  closestBoxScalar(x, y, i, trans, x1, y1, x2, y2, targetPose, closest);
+}
+#endif // ARRANGEBUFFER_AVX2
+
+AREXPORT bool ArRangeBuffer::isSupported(Implementation impl)
+{
+  switch (impl)
+  {
+  case SCALAR:
+    return true;
+  case SSE2:
+#ifdef ARRANGEBUFFER_SSE2
+    return true;
+#else
+    return false;
+#endif
+  case AVX2:
+#ifdef ARRANGEBUFFER_AVX2
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+#else
+    return false;
+#endif
+  }
+  return false;
+}
+
+AREXPORT const char *ArRangeBuffer::getImplementationName(Implementation impl)
+{
+  switch (impl)
+  {
+  case SCALAR:
+    return "scalar";
+  case SSE2:
+    return "SSE2";
+  case AVX2:
+    return "AVX2";
+  }
+  return "unknown";
+}
+
+static std::atomic<int> &currentImplementation()
+{
+  // picked the first time it's needed
+  static std::atomic<int> impl(
+	  ArRangeBuffer::isSupported(ArRangeBuffer::AVX2) ? ArRangeBuffer::AVX2 :
+	  ArRangeBuffer::isSupported(ArRangeBuffer::SSE2) ? ArRangeBuffer::SSE2 :
+	  ArRangeBuffer::SCALAR);
+  return impl;
+}
+
+AREXPORT ArRangeBuffer::Implementation ArRangeBuffer::getImplementation()
+{
+  return (Implementation) currentImplementation().load(
+	  std::memory_order_relaxed);
+}
+
+/**
+   @return true if @a impl will be used, false if it isn't supported
+   (and the implementation wasn't changed)
+**/
+AREXPORT bool ArRangeBuffer::setImplementation(Implementation impl)
+{
+  if (!isSupported(impl))
+    return false;
+  currentImplementation().store(impl, std::memory_order_relaxed);
+  return true;
+}
 
 /**
    Gets the closest reading in a region defined by startAngle going to 
@@ -81,36 +719,54 @@ AREXPORT double ArRangeBuffer::getClosestPolar(double startAngle,
 					       unsigned int maxRange,
 					       double *angle) const
 {
-  double closest = 0;
-  bool foundOne = false;
-  double closeTh = 0;
-  double dist = 0;
-
   startAngle = ArMath::fixAngle(startAngle);
   endAngle = ArMath::fixAngle(endAngle);
+  // nothing is between an angle and itself
+  if (startAngle == endAngle)
+    return maxRange;
 
-  for (auto it = myBuffer.begin(); it != myBuffer.end(); ++it)
+  ArRangeBufferPolarQuery q;
+  closestPolarSetup(&q, startAngle, endAngle, startPos);
+  const Implementation impl = getImplementation();
+  bool foundOne = false;
+  double closestDistSquared = 0;
+  double closestX = 0, closestY = 0;
+  // newest first, so the newest of equally close readings is found
+  Span spans[2];
+  for (size_t s = getSpans(spans); s > 0; --s)
   {
-    const double angle1=startPos.findAngleTo(*it);
-    const double angle2=startPos.getTh();
-    const double th = ArMath::subAngle(angle1, angle2);
-    if (ArMath::angleBetween(th, startAngle, endAngle))
+    const Span &span = spans[s - 1];
+    ArRangeBufferClosest inSpan = { 0, 0, false };
+    switch (impl)
     {
-      if (!foundOne || (dist = it->findDistanceTo(startPos)) < closest)
-      {
-        closeTh = th;	
-        if (!foundOne)
-          closest = it->findDistanceTo(startPos);
-        else
-          closest = dist;
-        foundOne = true;
-      }
+#ifdef ARRANGEBUFFER_AVX2
+    case AVX2:
+      closestPolarAVX2(q, span.x, span.y, span.size, &inSpan);
+      break;
+#endif
+#ifdef ARRANGEBUFFER_SSE2
+    case SSE2:
+      closestPolarSSE2(q, span.x, span.y, span.size, &inSpan);
+      break;
+#endif
+    default:
+      closestPolarScalar(q, span.x, span.y, span.size, &inSpan);
+      break;
+    }
+    if (inSpan.found && 
+	(!foundOne || closerThan(inSpan.distSquared, closestDistSquared)))
+    {
+      closestDistSquared = inSpan.distSquared;
+      closestX = span.x[inSpan.index];
+      closestY = span.y[inSpan.index];
+      foundOne = true;
     }
   }
   if (!foundOne)
     return maxRange;
   if (angle != NULL)
-    *angle = closeTh;
+    *angle = polarAngle(q, closestX, closestY);
+  const double closest = sqrt(closestDistSquared);
   if (closest > maxRange)
     return maxRange;
   else
@@ -147,48 +803,59 @@ AREXPORT double ArRangeBuffer::getClosestBox(
 
 {
   double closest = maxRange;
-  double dist;
   ArPose closestPos;
-  //ArPoseWithTime pose;
-  ArPose zeroPos(0, 0, 0);;
+  ArPose zeroPos(0, 0, 0);
   ArTransform trans(startPos, zeroPos);
 
-  // double temp;
-
-
   if (x1 >= x2)
-  {
     std::swap(x1, x2);
-/*     temp = x1, 
-    x1 = x2;
-    x2 = temp; */
-  }
   if (y1 >= y2)
-  {
     std::swap(y1, y2);
-/*     temp = y1, 
-    y1 = y2;
-    y2 = temp; */
-  }
-  
-  for (auto it = myBuffer.begin(); it != myBuffer.end(); ++it)
-  {
-    const ArPoseWithTime pose = trans.doTransform(*it);
 
-    // see if its in the box
-    if (pose.getX() >= x1 && pose.getX() <= x2 &&
-	      pose.getY() >= y1 && pose.getY() <= y2)
+  const Implementation impl = getImplementation();
+  bool foundOne = false;
+  double closestDistSquared = 0;
+  double closestX = 0, closestY = 0;
+  // newest first, so the newest of equally close readings is found
+  Span spans[2];
+  for (size_t s = getSpans(spans); s > 0; --s)
+  {
+    const Span &span = spans[s - 1];
+    ArRangeBufferClosest inSpan = { 0, 0, false };
+    switch (impl)
     {
-      dist = pose.findDistanceTo(targetPose);
-      //pose.log();
-      if (dist < closest)
-      {
-        closest = dist;
-        closestPos = pose;
-      }
+#ifdef ARRANGEBUFFER_AVX2
+    case AVX2:
+      closestBoxAVX2(span.x, span.y, span.size, trans, x1, y1, x2, y2, 
+		     targetPose, &inSpan);
+      break;
+#endif
+#ifdef ARRANGEBUFFER_SSE2
+    case SSE2:
+      closestBoxSSE2(span.x, span.y, span.size, trans, x1, y1, x2, y2, 
+		     targetPose, &inSpan);
+      break;
+#endif
+    default:
+      closestBoxScalar(span.x, span.y, span.size, trans, x1, y1, x2, y2, 
+		       targetPose, &inSpan);
+      break;
+    }
+    if (inSpan.found && 
+	(!foundOne || closerThan(inSpan.distSquared, closestDistSquared)))
+    {
+      closestDistSquared = inSpan.distSquared;
+      closestX = span.x[inSpan.index];
+      closestY = span.y[inSpan.index];
+      foundOne = true;
     }
   }
 
+  if (foundOne && sqrt(closestDistSquared) < closest)
+  {
+    closest = sqrt(closestDistSquared);
+    closestPos = trans.doTransform(ArPose(closestX, closestY));
+  }
   if (readingPos != NULL)
     *readingPos = closestPos;
   if (closest > maxRange)
@@ -204,7 +871,15 @@ AREXPORT double ArRangeBuffer::getClosestBox(
 */
 AREXPORT void ArRangeBuffer::applyTransform(const ArTransform &trans)
 {
-  std::for_each(myBuffer.begin(), myBuffer.end(), [&](ArPoseWithTime &p) { p = trans.doTransform(p); } );
+  takeBackList();
+  for (size_t n = 0; n < mySize; ++n)
+  {
+    const size_t p = physicalFromOldest(n);
+    const ArPose pose = trans.doTransform(ArPose(myX[p], myY[p]));
+    myX[p] = pose.getX();
+    myY[p] = pose.getY();
+  }
+  ++myChangeCount;
 }
 
 AREXPORT void ArRangeBuffer::clear()
@@ -220,13 +895,12 @@ AREXPORT void ArRangeBuffer::reset()
 
 AREXPORT void ArRangeBuffer::clearOlderThan(int milliSeconds)
 {
-  
-  // TODO if new readings are always added to the front of the buffer, then this could probably just splice all readings after the first reading found into the reserve list.
-
+  // readings refreshed by addReadingConditional() can be newer than
+  // readings added after them, so this can't just drop the oldest
   beginInvalidationSweep();
-  for (auto it = myBuffer.begin(); it != myBuffer.end(); ++it)
+  for (auto it = getBegin(); it != getEnd(); ++it)
   {
-    if (it->getTime().mSecSince() > milliSeconds)
+    if (it.getTime().mSecSince() > milliSeconds)
       invalidateReading(it);
   }
   endInvalidationSweep();
@@ -249,7 +923,8 @@ AREXPORT void ArRangeBuffer::clearOlderThanSeconds(int seconds)
 **/     
 AREXPORT void ArRangeBuffer::beginRedoBuffer()
 {
-  myRedoIt = myBuffer.begin();
+  takeBackList();
+  myRedoIndex = 0;
   myHitEnd = false;
   myNumRedone = 0;
 }
@@ -261,13 +936,16 @@ AREXPORT void ArRangeBuffer::beginRedoBuffer()
 */
 AREXPORT void ArRangeBuffer::redoReading(double x, double y)
 {
-  if (myRedoIt != myBuffer.end() && !myHitEnd)
+  if (myRedoIndex < mySize && !myHitEnd)
   {
-    myRedoIt->setPose(x, y);
+    const size_t p = physicalIndex(myRedoIndex);
+    myX[p] = x;
+    myY[p] = y;
     // TODO sholud we update timestamp?
-    myRedoIt++;
+    myRedoIndex++;
+    ++myChangeCount;
   }
-  // We re-used as many items in myBuffer as we could, we have reached the end of myBuffer. Just append them now.
+  // We re-used as many readings as we could, we have reached the oldest one. Just add them now.
   else
   {
     addReading(x,y);
@@ -283,15 +961,12 @@ AREXPORT void ArRangeBuffer::endRedoBuffer()
 {
   if (!myHitEnd)
   {
-    // There were still some readings left in the old myBuffer, remove the rest.
-    // todo just remove the items
-    beginInvalidationSweep();
-    while (myRedoIt != myBuffer.end())
+    // There were still some old readings left, which are the oldest ones, remove them.
+    if (myRedoIndex < mySize)
     {
-      invalidateReading(myRedoIt);
-      myRedoIt++;
+      dropOldest(mySize - myRedoIndex);
+      ++myChangeCount;
     }
-    endInvalidationSweep();
   } 
 }
 
@@ -307,16 +982,23 @@ AREXPORT void ArRangeBuffer::endRedoBuffer()
 AREXPORT void ArRangeBuffer::addReadingConditional(
 	const ArPoseWithTime& p, double closeDistSquared, bool *wasAdded)
 {
+  takeBackList();
   // find an existing reading to replace with this one.
   // TODO could be optimized if a spatially sorted list is used.
   if (closeDistSquared >= 0)
   {  
-    for (auto it = myBuffer.begin(); it != myBuffer.end(); ++it)
+    const double x = p.getX();
+    const double y = p.getY();
+    for (size_t i = 0; i < mySize; ++i)
     {
-      if (it->squaredFindDistanceTo(p) < closeDistSquared)
+      const size_t r = physicalIndex(i);
+      const double dx = myX[r] - x;
+      const double dy = myY[r] - y;
+      if (dx * dx + dy * dy < closeDistSquared)
       {
-        it->setTimeToNow();
-        // XXX TODO move item to front of list, to keep it sorted with newest at the front?
+        myTimes[r].setToNow();
+        // XXX TODO move reading to be the newest, to keep them sorted by time?
+        ++myChangeCount;
         if (wasAdded != NULL)
           *wasAdded = false;
         return;
@@ -335,30 +1017,20 @@ AREXPORT void ArRangeBuffer::addReadingConditional(
 */
 AREXPORT void ArRangeBuffer::addReading(const ArPoseWithTime& p) 
 {
-
-  // If the buffer is full, reuse the last item, which is the oldest added, and splice it to the beginning.
-  if(myBuffer.size() == myCapacity)
-  {
-    myBuffer.splice(myBuffer.cbegin(), myBuffer, --myBuffer.end());
-    *(myBuffer.begin()) = p; // todo could we std::move from p to buffer?
-  }
-  else
-  {
-    // if there are any items in myReserved, splice them into myBuffer.
-    if(!myReserved.empty())
-    {
-      myBuffer.splice(myBuffer.cbegin(), myReserved, myReserved.cbegin());
-      *(myBuffer.begin()) = p;
-    }
-    else
-      myBuffer.emplace_front(p);
-  }
-
-  /* another Naive solution
-  myBuffer.emplace_front(ArPoseWithTime(x, y));
-  while(myBuffer.size() >= myCapacity)
-    myBuffer.pop_back();
-  */
+  takeBackList();
+  if (myCapacity == 0)
+    return;
+  // If the buffer is full, write over the oldest reading
+  if (mySize == myCapacity)
+    dropOldest(1);
+  else if (mySize == myX.size())
+    grow();
+  const size_t r = physicalFromOldest(mySize);
+  myX[r] = p.getX();
+  myY[r] = p.getY();
+  myTimes[r] = p.getTime();
+  ++mySize;
+  ++myChangeCount;
 }
 
 /**
@@ -370,11 +1042,15 @@ AREXPORT void ArRangeBuffer::addReading(const ArPoseWithTime& p)
 */
 void ArRangeBuffer::beginInvalidationSweep()
 {
+  takeBackList();
   myInvalidSweepList.clear();
 }
 
 /**
-   See the description of beginInvalidationSweep(). 
+   See the description of beginInvalidationSweep().  This takes an
+   iterator from getBuffer(), and has to find which reading it is, so
+   invalidateReading(const_iterator) (with getBegin() and getEnd()) is
+   faster.
    @param readingIt the iterator to the reading you want to get rid of
    @see beginInvaladationSweep
    @see endInvalidationSweep
@@ -382,15 +1058,20 @@ void ArRangeBuffer::beginInvalidationSweep()
 AREXPORT void ArRangeBuffer::invalidateReading(
 	std::list<ArPoseWithTime>::const_iterator readingIt)
 {
-  myInvalidSweepList.push_back(readingIt);
+  const std::list<ArPoseWithTime> &list = getBuffer();
+  if (!myListIndexValid)
+  {
+    myListIndex.clear();
+    size_t i = 0;
+    for (auto it = list.cbegin(); it != list.cend(); ++it, ++i)
+      myListIndex[&(*it)] = i;
+    myListIndexValid = true;
+  }
+  auto found = myListIndex.find(&(*readingIt));
+  if (found != myListIndex.end())
+    myInvalidSweepList.push_back(found->second);
 }
 
-/* REXPORT void ArRangeBuffer::invalidateReading(
-	std::list<ArPoseWithTime>::iterator readingIt)
-{
-  myInvalidSweepList.push_front(readingIt);
-} */
-
 
 /**
    See the description of beginInvalidationSweep()
@@ -399,12 +1080,32 @@ AREXPORT void ArRangeBuffer::invalidateReading(
 */
 void ArRangeBuffer::endInvalidationSweep()
 {
-
-  for(auto i = myInvalidSweepList.cbegin(); i != myInvalidSweepList.cend(); ++i)
+  if (myInvalidSweepList.empty())
+    return;
+  myInvalid.assign(mySize, 0);
+  for (auto i = myInvalidSweepList.cbegin(); i != myInvalidSweepList.cend(); ++i)
+  {
+    if (*i < mySize)
+      myInvalid[mySize - 1 - *i] = 1; // indexed from the oldest
+  }
+  // move the readings that are kept together, from the oldest
+  size_t kept = 0;
+  for (size_t n = 0; n < mySize; ++n)
   {
-    // naive implementation, just remove myBuffer.remove(*i);
-    myReserved.splice(myReserved.cend(), myBuffer, *i); // reserve item for future reuse. (*i) is an iterator into myBuffer.
+    if (myInvalid[n])
+      continue;
+    if (kept != n)
+    {
+      const size_t from = physicalFromOldest(n);
+      const size_t to = physicalFromOldest(kept);
+      myX[to] = myX[from];
+      myY[to] = myY[from];
+      myTimes[to] = myTimes[from];
+    }
+    ++kept;
   }
+  mySize = kept;
+  ++myChangeCount;
   myInvalidSweepList.clear();
 }
 
@@ -417,45 +1118,91 @@ void ArRangeBuffer::endInvalidationSweep()
 */
 AREXPORT std::vector<ArPoseWithTime> *ArRangeBuffer::getBufferAsVectorPtr()
 {
-  myVector.reserve(myBuffer.size());
+  takeBackList();
+  // oldest first
   myVector.clear();
-  for (auto it = myBuffer.cbegin(); it != myBuffer.cend(); it++)
+  myVector.reserve(mySize);
+  for (size_t n = 0; n < mySize; ++n)
   {
-    myVector.insert(myVector.begin(), (*it));
+    const size_t p = physicalFromOldest(n);
+    myVector.push_back(ArPoseWithTime(myX[p], myY[p], 0, myTimes[p]));
   }
   return &myVector;
 }
 
+AREXPORT const std::list<ArPoseWithTime>& ArRangeBuffer::getBuffer() const
+{
+  // if it's been handed out it may have been changed, so it is the readings
+  if (myListHandedOut)
+    return myList;
+  if (myListValid && myListChangeCount == myChangeCount)
+    return myList;
+  myList.resize(mySize);
+  size_t i = 0;
+  for (auto it = myList.begin(); it != myList.end(); ++it, ++i)
+  {
+    const size_t p = physicalIndex(i);
+    *it = ArPoseWithTime(myX[p], myY[p], 0, myTimes[p]);
+  }
+  myListChangeCount = myChangeCount;
+  myListValid = true;
+  myListIndexValid = false;
+  return myList;
+}
+
+AREXPORT size_t ArRangeBuffer::getSpans(Span spans[2]) const
+{
+  takeBackListToRead();
+  if (mySize == 0)
+    return 0;
+  const size_t first = std::min(mySize, myX.size() - myStart);
+  spans[0].x = &myX[myStart];
+  spans[0].y = &myY[myStart];
+  spans[0].time = &myTimes[myStart];
+  spans[0].size = first;
+  if (first == mySize)
+    return 1;
+  spans[1].x = &myX[0];
+  spans[1].y = &myY[0];
+  spans[1].time = &myTimes[0];
+  spans[1].size = mySize - first;
+  return 2;
+}
 
 AREXPORT std::list<ArPoseWithTime*> *ArRangeBuffer::getBufferPtrsPtr() const
 {
-  static std::list<ArPoseWithTime *> ptrlist(myBuffer.size());
+  static std::list<ArPoseWithTime *> ptrlist;
   ptrlist.clear();
-   for (auto i = myBuffer.begin(); i != myBuffer.end(); ++i)
-    ptrlist.push_back(const_cast<ArPoseWithTime*>(&(*i)));
+  getBuffer();
+  // the caller may change the readings through these, which is seen when
+  // they are taken back
+  myListHandedOut = true;
+  for (auto i = myList.begin(); i != myList.end(); ++i)
+    ptrlist.push_back(&(*i));
   return &ptrlist;
 }
 
 AREXPORT void ArRangeBuffer::logData(ArLog::LogLevel level, const char *linePrefix, const char *sensorName, const char *bufferName) const
 {
+  takeBackListToRead();
   ArLog::beginWrite(level);
-  ArLog::write(level, "%s%s %s: %u RobotPose: (%.0f, %.0f) RobotEncoderPose: (%.0f, %.0f) Readings: ", 
-    linePrefix, sensorName, bufferName, myBuffer.size(), 
+  ArLog::write(level, "%s%s %s: %lu RobotPose: (%.0f, %.0f) RobotEncoderPose: (%.0f, %.0f) Readings: ", 
+    linePrefix, sensorName, bufferName, mySize, 
     myRobotPose.getX(), myRobotPose.getY(),
     myRobotEncoderPose.getX(), myRobotEncoderPose.getY()
   );
-  for(auto i = myBuffer.begin(); i != myBuffer.end(); ++i)
-    ArLog::write(level, "(%.0f,%.0f) ", i->getX(), i->getY());
+  for(size_t i = 0; i < mySize; ++i)
+    ArLog::write(level, "(%.0f,%.0f) ", getX(i), getY(i));
   ArLog::endWrite();
 }
 
 AREXPORT void ArRangeBuffer::logInternal(ArLog::LogLevel level, const char *name) const
 {
-    ArLog::log(level, "ArRangeBuffer %s: Buffer.size=%lu Reserved.size=%lu Capacity=%lu, Buffer.max_size=%lu Reserved.max_size=%lu", name, myBuffer.size(), myReserved.size(), myCapacity, myBuffer.max_size(), myReserved.max_size());
+    ArLog::log(level, "ArRangeBuffer %s: Size=%lu Allocated=%lu Capacity=%lu Start=%lu List.size=%lu", name, mySize, myX.size(), myCapacity, myStart, myList.size());
 }
 
 AREXPORT void ArRangeBuffer::logInternal(FILE *fp, const char *prefix, const char *name) const
 {
   assert(fp);
-  fprintf(fp, "%sArRangeBuffer %s: Buffer.size=%lu Reserved.size=%lu, Capacity=%lu, Buffer.max_size=%lu Reserved.max_size=%lu", prefix, name, myBuffer.size(), myReserved.size(), myCapacity, myBuffer.max_size(), myReserved.max_size());
+  fprintf(fp, "%sArRangeBuffer %s: Size=%lu Allocated=%lu Capacity=%lu Start=%lu List.size=%lu", prefix, name, mySize, myX.size(), myCapacity, myStart, myList.size());
 }
@@ -0,0 +1,250 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArRangeBufferGrid.h"
+#include "Aria/ariaUtil.h"
+
+#include <algorithm>
+
+/**
+   @param cellSize the size of the cells (mm).  Cells about as big as the
+   distances searched (or a bit bigger) are best: smaller and searches look
+   in more cells, bigger and they look at more readings that are too far.
+**/
+AREXPORT ArRangeBufferGrid::ArRangeBufferGrid(double cellSize) :
+  myCellSize(cellSize > 1 ? cellSize : 1),
+  myNumReadings(0),
+  myNextId(0),
+  myChangeCount(0),
+  mySynced(false),
+  myNumRebuilds(0)
+{
+}
+
+AREXPORT void ArRangeBufferGrid::setCellSize(double cellSize)
+{
+  if (cellSize < 1)
+    cellSize = 1;
+  if (cellSize == myCellSize)
+    return;
+  myCellSize = cellSize;
+  // the readings are in the wrong cells now
+  mySynced = false;
+}
+
+void ArRangeBufferGrid::insert(double x, double y, unsigned long long id)
+{
+  Reading reading;
+  reading.x = x;
+  reading.y = y;
+  reading.id = id;
+  myCells[cellKey(x, y)].push_back(reading);
+  myNumReadings++;
+}
+
+void ArRangeBufferGrid::erase(double x, double y, unsigned long long id)
+{
+  auto cell = myCells.find(cellKey(x, y));
+  if (cell == myCells.end())
+    return;
+  std::vector<Reading> &readings = cell->second;
+  for (size_t i = 0; i < readings.size(); i++)
+  {
+    if (readings[i].id == id)
+    {
+      readings[i] = readings.back();
+      readings.pop_back();
+      myNumReadings--;
+      return;
+    }
+  }
+}
+
+void ArRangeBufferGrid::rebuild(const ArRangeBuffer &buffer)
+{
+  // empty cells are left behind as readings go away, so start over
+  myCells.clear();
+  myNumReadings = 0;
+  myIds.clear();
+  myRemoved.clear();
+  for (size_t n = buffer.getCurrentSize(); n > 0; n--)
+  {
+    myIds.push_back(myNextId);
+    insert(buffer.getX(n - 1), buffer.getY(n - 1), myNextId);
+    myNextId++;
+  }
+  myChangeCount = buffer.getChangeCount();
+  mySynced = true;
+  myNumRebuilds++;
+}
+
+AREXPORT void ArRangeBufferGrid::sync(const ArRangeBuffer &buffer)
+{
+  if (!mySynced || buffer.getChangeCount() != myChangeCount ||
+      buffer.getCurrentSize() != myIds.size())
+    rebuild(buffer);
+}
+
+AREXPORT bool ArRangeBufferGrid::anyWithin(double x, double y,
+					   double distSquared) const
+{
+  const double dist = sqrt(distSquared);
+  const int ix0 = cellIndex(x - dist), ix1 = cellIndex(x + dist);
+  const int iy0 = cellIndex(y - dist), iy1 = cellIndex(y + dist);
+  for (int ix = ix0; ix <= ix1; ix++)
+  {
+    for (int iy = iy0; iy <= iy1; iy++)
+    {
+      auto cell = myCells.find(cellKey(ix, iy));
+      if (cell == myCells.end())
+	continue;
+      for (auto it = cell->second.cbegin(); it != cell->second.cend(); ++it)
+      {
+	if (ArMath::squaredDistanceBetween(x, y, it->x, it->y) < distSquared)
+	  return true;
+      }
+    }
+  }
+  return false;
+}
+
+AREXPORT void ArRangeBufferGrid::findNearSegment(
+	double x1, double y1, double x2, double y2, double dist,
+	std::vector<Reading> *found) const
+{
+  found->clear();
+  // a little extra, so rounding can't leave out a reading right at dist
+  dist += 1;
+  const double segMinX = std::min(x1, x2), segMaxX = std::max(x1, x2);
+  const double minX = segMinX - dist, maxX = segMaxX + dist;
+  // for a long line past few readings it's quicker to look in every cell
+  // (and a line that's very long would take forever to walk)
+  const double span = (maxX - minX + ArMath::fabs(y2 - y1) + 2 * dist) / 
+    myCellSize;
+  if (span > (double)myCells.size())
+  {
+    for (auto cell = myCells.cbegin(); cell != myCells.cend(); ++cell)
+      found->insert(found->end(), cell->second.begin(), cell->second.end());
+    return;
+  }
+  const bool vertical = segMaxX - segMinX < ArMath::epsilon();
+  const double slope = vertical ? 0 : (y2 - y1) / (x2 - x1);
+  // go through the columns of cells, each from where the segment (moved
+  // out dist) is lowest in the column to where it's highest
+  const int ix0 = cellIndex(minX), ix1 = cellIndex(maxX);
+  for (int ix = ix0; ix <= ix1; ix++)
+  {
+    double lowY, highY;
+    if (vertical)
+    {
+      lowY = std::min(y1, y2);
+      highY = std::max(y1, y2);
+    }
+    else
+    {
+      // a reading in this column can only be near the segment where it is
+      // within dist of the column
+      const double colX0 = std::max(ix * myCellSize, minX) - dist;
+      const double colX1 = std::min((ix + 1) * myCellSize, maxX) + dist;
+      const double ya = y1 + slope * (std::max(colX0, segMinX) - x1);
+      const double yb = y1 + slope * (std::min(colX1, segMaxX) - x1);
+      lowY = std::min(ya, yb);
+      highY = std::max(ya, yb);
+    }
+    const int iy0 = cellIndex(lowY - dist), iy1 = cellIndex(highY + dist);
+    for (int iy = iy0; iy <= iy1; iy++)
+    {
+      auto cell = myCells.find(cellKey(ix, iy));
+      if (cell != myCells.end())
+	found->insert(found->end(), cell->second.begin(), cell->second.end());
+    }
+  }
+}
+
+AREXPORT void ArRangeBufferGrid::remove(const Reading &reading)
+{
+  erase(reading.x, reading.y, reading.id);
+  myRemoved.push_back(reading.id);
+}
+
+AREXPORT void ArRangeBufferGrid::flush(ArRangeBuffer *buffer)
+{
+  if (myRemoved.empty())
+    return;
+  // if the buffer was changed some other way the ids don't match it
+  if (!mySynced || buffer->getChangeCount() != myChangeCount ||
+      buffer->getCurrentSize() != myIds.size())
+  {
+    rebuild(*buffer);
+    return;
+  }
+  std::sort(myRemoved.begin(), myRemoved.end());
+  const size_t size = myIds.size();
+  buffer->beginInvalidationSweep();
+  for (auto it = myRemoved.cbegin(); it != myRemoved.cend(); ++it)
+  {
+    auto pos = std::lower_bound(myIds.begin(), myIds.end(), *it);
+    if (pos != myIds.end() && *pos == *it)
+    {
+      // the buffer is newest first
+      const size_t fromOldest = (size_t)(pos - myIds.begin());
+      buffer->invalidateReading(buffer->getBegin() + 
+				(long)(size - 1 - fromOldest));
+    }
+  }
+  buffer->endInvalidationSweep();
+  myIds.erase(std::remove_if(myIds.begin(), myIds.end(),
+			     [this](unsigned long long id) {
+			       return std::binary_search(myRemoved.begin(),
+							 myRemoved.end(), id);
+			     }),
+	      myIds.end());
+  myRemoved.clear();
+  myChangeCount = buffer->getChangeCount();
+}
+
+AREXPORT void ArRangeBufferGrid::addReading(ArRangeBuffer *buffer,
+					    double x, double y)
+{
+  if (buffer->getCapacity() == 0)
+    return;
+  sync(*buffer);
+  if (buffer->getCurrentSize() >= buffer->getCapacity())
+  {
+    // removed readings go first, otherwise the buffer drops the oldest
+    flush(buffer);
+    if (buffer->getCurrentSize() >= buffer->getCapacity())
+    {
+      const size_t oldest = buffer->getCurrentSize() - 1;
+      erase(buffer->getX(oldest), buffer->getY(oldest), myIds.front());
+      myIds.pop_front();
+    }
+  }
+  buffer->addReading(x, y);
+  myIds.push_back(myNextId);
+  insert(x, y, myNextId);
+  myNextId++;
+  myChangeCount = buffer->getChangeCount();
+}
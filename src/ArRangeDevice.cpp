@@ -26,6 +26,8 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArRangeDevice.h"
 #include "Aria/ArRobot.h"
 
+#include <atomic>
+
 /**
    @param currentBufferSize number of readings to store in the current
    buffer
@@ -103,6 +105,7 @@ AREXPORT ArRangeDevice::ArRangeDevice(size_t currentBufferSize,
   myCumulativeDrawingData = NULL;
   myOwnCumulativeDrawingData = false;
   myIsLocationDependent = locationDependent;
+  myNumScans = 0;
 
   //setMinDistBetweenCurrent();
   //setMinDistBetweenCumulative();
@@ -144,7 +147,11 @@ AREXPORT void ArRangeDevice::setRobot(ArRobot *robot)
   myRobot = robot;
 
   if (myRobot != NULL)
+  {
     myRobot->addSensorInterpTask(buf, 100, &myFilterCB);
+    // only touches this device, so it can run alongside the others
+    myRobot->setSensorInterpTaskConcurrent(buf);
+  }
 }
 
 AREXPORT ArRobot *ArRangeDevice::getRobot() 
@@ -165,9 +172,9 @@ AREXPORT void ArRangeDevice::filterCallback()
   {
     // just walk through and make sure nothings too far away
     myCurrentBuffer.beginInvalidationSweep();
-    for (auto it = getCurrentReadings().begin();  it != getCurrentReadings().end(); ++it)
+    for (auto it = myCurrentBuffer.getBegin();  it != myCurrentBuffer.getEnd(); ++it)
     {
-      if (it->getTime().secSince() >= myMaxSecondsToKeepCurrent)
+      if (it.getTime().secSince() >= myMaxSecondsToKeepCurrent)
 	      myCurrentBuffer.invalidateReading(it);
     }
     myCurrentBuffer.endInvalidationSweep();
@@ -196,17 +203,18 @@ AREXPORT void ArRangeDevice::filterCallback()
 
   // just walk through and make sure nothings too far away
   myCumulativeBuffer.beginInvalidationSweep();
-  for (auto it = getCumulativeReadings().begin(); 
-       it != getCumulativeReadings().end(); 
+  const ArPose robotPose = myRobot->getPose();
+  for (auto it = myCumulativeBuffer.getBegin(); 
+       it != myCumulativeBuffer.getEnd(); 
        ++it)
   {
     // if its closer to a reading than the filter near dist, just return
     if (doingDist && 
-	(myRobot->getPose().squaredFindDistanceTo(*it) > 
+	(robotPose.squaredFindDistanceTo(ArPose(it.getX(), it.getY())) > 
 	 myMaxDistToKeepCumulativeSquared))
       myCumulativeBuffer.invalidateReading(it);
     else if (doingAge && 
-	     it->getTime().secSince() >= myMaxSecondsToKeepCumulative)
+	     it.getTime().secSince() >= myMaxSecondsToKeepCumulative)
       myCumulativeBuffer.invalidateReading(it);
   }
   myCumulativeBuffer.endInvalidationSweep();
@@ -517,6 +525,49 @@ AREXPORT  void ArRangeDevice::setCumulativeDrawingData(
   myOwnCumulativeDrawingData = takeOwnershipOfData; 
 }
 
+/**
+   Range devices with raw readings should call this (with the device
+   locked) once they've finished with each scan, ArLaser does it at the
+   end of ArLaser::laserProcessReadings().
+
+   The copy goes into the scan published two scans ago, if no one is
+   still using it, so that the readings aren't allocated again every
+   scan.  Otherwise (someone is keeping it) it gets a new one.
+**/
+AREXPORT void ArRangeDevice::publishScan()
+{
+  if (myRawReadings == NULL || myRawReadings->empty())
+    return;
+
+  // nothing else can get the spare now since it isn't the latest, so if
+  // this is the only pointer to it no one else has it
+  std::shared_ptr<ArRangeScan> scan;
+  if (mySpareScan && mySpareScan.use_count() == 1)
+  {
+    // use_count() is a relaxed load, so without this the last reader's
+    // reads of the scan could still be going on when it is refilled below
+    std::atomic_thread_fence(std::memory_order_acquire);
+    scan.swap(mySpareScan);
+  }
+  else
+    scan = std::make_shared<ArRangeScan>();
+
+  scan->myReadings.clear();
+  scan->myReadings.reserve(myRawReadings->size());
+  for (std::list<ArSensorReading *>::const_iterator it = myRawReadings->begin();
+       it != myRawReadings->end(); ++it)
+    scan->myReadings.push_back(*(*it));
+  const ArSensorReading &first = scan->myReadings.front();
+  scan->myPoseTaken = first.getPoseTaken();
+  scan->myEncoderPoseTaken = first.getEncoderPoseTaken();
+  scan->myTimeTaken = first.getTimeTaken();
+  scan->myCount = ++myNumScans;
+
+  std::atomic_store(&myLatestScan, std::shared_ptr<const ArRangeScan>(scan));
+  mySpareScan = myLastScan;
+  myLastScan = scan;
+}
+
 AREXPORT void ArRangeDevice::adjustRawReadings(bool interlaced)
 {
   std::list<ArSensorReading *>::iterator rawIt;
@@ -0,0 +1,438 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArRangeSnapshot.h"
+#include "Aria/ArRangeDevice.h"
+#include "Aria/ArRobot.h"
+#include "Aria/ArTransform.h"
+#include "Aria/ArLog.h"
+
+#include <algorithm>
+
+namespace {
+  const size_t npos = (size_t)-1;
+  // keeps the cell coordinates (and their differences) well inside an int
+  const double MAX_CELL = 1 << 30;
+}
+
+AREXPORT ArRangeSnapshot::ArRangeSnapshot() :
+  myValid(false),
+  myNumReadings(0)
+{
+}
+
+AREXPORT void ArRangeSnapshot::swap(ArRangeSnapshot &other)
+{
+  std::swap(myValid, other.myValid);
+  std::swap(myNumReadings, other.myNumReadings);
+  myDevices.swap(other.myDevices);
+  myCellKeys.swap(other.myCellKeys);
+}
+
+/// Readings have angles in (-180, 180], bucket 0 starts at -180
+size_t ArRangeSnapshot::getAngleBucket(double th)
+{
+  const int bucket = (int)floor(th + 180.0);
+  if (bucket < 0)
+    return 0;
+  if (bucket >= NUM_ANGLE_BUCKETS)
+    return NUM_ANGLE_BUCKETS - 1;
+  return (size_t)bucket;
+}
+
+int ArRangeSnapshot::getCell(double coord)
+{
+  const double cell = floor(coord / GRID_CELL_SIZE);
+  if (!(cell > -MAX_CELL))
+    return -(int)MAX_CELL;
+  if (cell > MAX_CELL)
+    return (int)MAX_CELL;
+  return (int)cell;
+}
+
+ArPose ArRangeSnapshot::getDeviceRobotPose(ArRangeDevice *device)
+{
+  // this is the pose ArRangeDevice::currentReadingPolar() and
+  // ArRangeDevice::currentReadingBox() use
+  if (device->getRobot() != NULL)
+    return device->getRobot()->getPose();
+  else
+    return ArPose(0, 0);
+}
+
+AREXPORT bool ArRangeSnapshot::isCurrent(
+	const std::list<ArRangeDevice *> &devices) const
+{
+  if (!myValid || devices.size() != myDevices.size())
+    return false;
+  std::vector<DeviceSnapshot>::const_iterator dev = myDevices.begin();
+  for (std::list<ArRangeDevice *>::const_iterator it = devices.begin();
+       it != devices.end(); ++it, ++dev)
+  {
+    if ((*it) != dev->myDevice || 
+	(*it)->getCurrentRangeBuffer().getChangeCount() != dev->myChangeCount ||
+	(*it)->getMaxRange() != dev->myMaxRange)
+      return false;
+    const ArPose pose = getDeviceRobotPose(*it);
+    if (pose.getX() != dev->myRobotPose.getX() || 
+	pose.getY() != dev->myRobotPose.getY() ||
+	pose.getTh() != dev->myRobotPose.getTh())
+      return false;
+  }
+  return true;
+}
+
+AREXPORT void ArRangeSnapshot::build(const std::list<ArRangeDevice *> &devices)
+{
+  myDevices.resize(devices.size());
+  myNumReadings = 0;
+  std::vector<DeviceSnapshot>::iterator dev = myDevices.begin();
+  for (std::list<ArRangeDevice *>::const_iterator it = devices.begin();
+       it != devices.end(); ++it, ++dev)
+  {
+    dev->myDevice = (*it);
+    buildDevice(&(*dev));
+    myNumReadings += dev->myReadings.size();
+  }
+  myValid = true;
+}
+
+void ArRangeSnapshot::buildDevice(DeviceSnapshot *dev)
+{
+  ArRangeDevice *device = dev->myDevice;
+  device->lockDevice();
+  if (device->getRobot() == NULL)
+    ArLog::log(ArLog::Normal, "ArRangeDevice %s: NULL robot, won't get readings correctly", device->getName());
+  const ArPose pose = getDeviceRobotPose(device);
+  const ArRangeBuffer &buffer = device->getCurrentRangeBuffer();
+  dev->myRobotPose = pose;
+  dev->myMaxRange = device->getMaxRange();
+  dev->myChangeCount = buffer.getChangeCount();
+  dev->myReadings.resize(buffer.getCurrentSize());
+  
+  // work these out exactly as ArRangeBuffer::getClosestPolar() and
+  // ArRangeBuffer::getClosestBox() do, so the answers come out the same
+  ArPose zeroPos(0, 0, 0);
+  ArTransform trans(pose, zeroPos);
+  size_t i = 0;
+  for (auto it = buffer.getBegin(); it != buffer.getEnd(); ++it, ++i)
+  {
+    Reading &reading = dev->myReadings[i];
+    const ArPose position(it.getX(), it.getY());
+    reading.myTh = ArMath::subAngle(pose.findAngleTo(position), pose.getTh());
+    reading.myPolarDist = position.findDistanceTo(pose);
+    const ArPose local = trans.doTransform(position);
+    reading.myLocal = local;
+    reading.myBoxDist = local.findDistanceTo(zeroPos);
+  }
+  device->unlockDevice();
+
+  const size_t numReadings = dev->myReadings.size();
+
+  // counting sort into the angle buckets
+  dev->myBucketStarts.assign(NUM_ANGLE_BUCKETS + 1, 0);
+  dev->myBucketClosest.assign(NUM_ANGLE_BUCKETS, npos);
+  for (i = 0; i < numReadings; i++)
+  {
+    const Reading &reading = dev->myReadings[i];
+    const size_t bucket = getAngleBucket(reading.myTh);
+    dev->myBucketStarts[bucket + 1]++;
+    // readings are in buffer order, so the first of equally close ones
+    // stays the closest, just like in the buffer
+    size_t &closest = dev->myBucketClosest[bucket];
+    if (closest == npos || 
+	reading.myPolarDist < dev->myReadings[closest].myPolarDist)
+      closest = i;
+  }
+  for (size_t b = 0; b < NUM_ANGLE_BUCKETS; b++)
+    dev->myBucketStarts[b + 1] += dev->myBucketStarts[b];
+  dev->myBucketOrder.resize(numReadings);
+  std::vector<size_t> next(dev->myBucketStarts.begin(), 
+			   dev->myBucketStarts.end() - 1);
+  for (i = 0; i < numReadings; i++)
+    dev->myBucketOrder[next[getAngleBucket(dev->myReadings[i].myTh)]++] = i;
+
+  // sort by cell (x then y, then buffer order within a cell)
+  myCellKeys.resize(numReadings);
+  for (i = 0; i < numReadings; i++)
+  {
+    const ArPose &local = dev->myReadings[i].myLocal;
+    myCellKeys[i].first = 
+      (long long)getCell(local.getX()) * (1LL << 32) + 
+      ((long long)getCell(local.getY()) + (1LL << 31));
+    myCellKeys[i].second = i;
+  }
+  std::sort(myCellKeys.begin(), myCellKeys.end());
+  dev->myCellOrder.resize(numReadings);
+  dev->myCells.clear();
+  for (i = 0; i < numReadings; i++)
+  {
+    const size_t r = myCellKeys[i].second;
+    dev->myCellOrder[i] = r;
+    if (i == 0 || myCellKeys[i].first != myCellKeys[i - 1].first)
+    {
+      Cell cell;
+      cell.myX = getCell(dev->myReadings[r].myLocal.getX());
+      cell.myY = getCell(dev->myReadings[r].myLocal.getY());
+      cell.myBegin = i;
+      cell.myClosest = r;
+      dev->myCells.push_back(cell);
+    }
+    else if (dev->myReadings[r].myBoxDist < 
+	     dev->myReadings[dev->myCells.back().myClosest].myBoxDist)
+      dev->myCells.back().myClosest = r;
+    dev->myCells.back().myEnd = i + 1;
+  }
+}
+
+/**
+   Same as ArRangeBuffer::getClosestPolar() on the device's current buffer.
+   Only the buckets the edges of the slice go through have their readings
+   checked one by one, the buckets wholly inside the slice just offer up
+   their closest reading.
+**/
+double ArRangeSnapshot::checkDevicePolar(const DeviceSnapshot &dev, 
+					 double startAngle, double endAngle,
+					 double *angle) const
+{
+  startAngle = ArMath::fixAngle(startAngle);
+  endAngle = ArMath::fixAngle(endAngle);
+  const size_t startBucket = getAngleBucket(startAngle);
+  const size_t endBucket = getAngleBucket(endAngle);
+  const std::vector<Reading> &readings = dev.myReadings;
+  size_t closest = npos;
+
+  for (size_t b = 0; b < NUM_ANGLE_BUCKETS; b++)
+  {
+    const size_t begin = dev.myBucketStarts[b];
+    const size_t end = dev.myBucketStarts[b + 1];
+    if (begin == end)
+      continue;
+    if (b == startBucket || b == endBucket)
+    {
+      for (size_t i = begin; i < end; i++)
+      {
+	const size_t r = dev.myBucketOrder[i];
+	if (ArMath::angleBetween(readings[r].myTh, startAngle, endAngle) &&
+	    (closest == npos || 
+	     readings[r].myPolarDist < readings[closest].myPolarDist ||
+	     (readings[r].myPolarDist == readings[closest].myPolarDist && 
+	      r < closest)))
+	  closest = r;
+      }
+    }
+    // every angle in these buckets is strictly between the start and end
+    else if ((startAngle < endAngle && b > startBucket && b < endBucket) ||
+	     (startAngle > endAngle && (b > startBucket || b < endBucket)))
+    {
+      const size_t r = dev.myBucketClosest[b];
+      if (closest == npos || 
+	  readings[r].myPolarDist < readings[closest].myPolarDist ||
+	  (readings[r].myPolarDist == readings[closest].myPolarDist && 
+	   r < closest))
+	closest = r;
+    }
+  }
+
+  if (closest == npos)
+    return dev.myMaxRange;
+  if (angle != NULL)
+    *angle = readings[closest].myTh;
+  if (readings[closest].myPolarDist > dev.myMaxRange)
+    return dev.myMaxRange;
+  else
+    return readings[closest].myPolarDist;
+}
+
+/**
+   Same as ArRangeBuffer::getClosestBox() on the device's current buffer.
+   Only the cells on the edges of the box have their readings checked one
+   by one, the cells wholly inside the box just offer up their closest
+   reading.
+**/
+double ArRangeSnapshot::checkDeviceBox(const DeviceSnapshot &dev, 
+				       double x1, double y1, 
+				       double x2, double y2, 
+				       ArPose *readingPos) const
+{
+  if (x1 >= x2)
+    std::swap(x1, x2);
+  if (y1 >= y2)
+    std::swap(y1, y2);
+  const int cellX1 = getCell(x1);
+  const int cellX2 = getCell(x2);
+  const int cellY1 = getCell(y1);
+  const int cellY2 = getCell(y2);
+  const std::vector<Reading> &readings = dev.myReadings;
+  const double maxRange = dev.myMaxRange;
+  size_t closest = npos;
+
+  auto checkCell = [&](const Cell &cell)
+  {
+    if (cell.myX > cellX1 && cell.myX < cellX2 && 
+	cell.myY > cellY1 && cell.myY < cellY2)
+    {
+      // every reading in this cell is strictly inside the box
+      const size_t r = cell.myClosest;
+      if (readings[r].myBoxDist < maxRange &&
+	  (closest == npos || 
+	   readings[r].myBoxDist < readings[closest].myBoxDist ||
+	   (readings[r].myBoxDist == readings[closest].myBoxDist && 
+	    r < closest)))
+	closest = r;
+      return;
+    }
+    for (size_t i = cell.myBegin; i < cell.myEnd; i++)
+    {
+      const size_t r = dev.myCellOrder[i];
+      const ArPose &local = readings[r].myLocal;
+      if (local.getX() >= x1 && local.getX() <= x2 &&
+	  local.getY() >= y1 && local.getY() <= y2 &&
+	  readings[r].myBoxDist < maxRange &&
+	  (closest == npos || 
+	   readings[r].myBoxDist < readings[closest].myBoxDist ||
+	   (readings[r].myBoxDist == readings[closest].myBoxDist && 
+	    r < closest)))
+	closest = r;
+    }
+  };
+
+  if ((size_t)((long long)cellX2 - cellX1 + 1) < dev.myCells.size())
+  {
+    // look up each column of cells the box covers
+    for (int x = cellX1; x <= cellX2; x++)
+    {
+      const Cell first = { x, cellY1, 0, 0, 0 };
+      for (auto it = std::lower_bound(dev.myCells.begin(), dev.myCells.end(), 
+				      first, 
+				      [](const Cell &a, const Cell &b)
+				      { return a.myX < b.myX || 
+					  (a.myX == b.myX && a.myY < b.myY); });
+	   it != dev.myCells.end() && it->myX == x && it->myY <= cellY2; ++it)
+	checkCell(*it);
+    }
+  }
+  else
+  {
+    for (auto it = dev.myCells.begin(); it != dev.myCells.end(); ++it)
+      if (it->myX >= cellX1 && it->myX <= cellX2 && 
+	  it->myY >= cellY1 && it->myY <= cellY2)
+	checkCell(*it);
+  }
+
+  if (closest == npos)
+  {
+    if (readingPos != NULL)
+      *readingPos = ArPose();
+    return maxRange;
+  }
+  if (readingPos != NULL)
+    *readingPos = readings[closest].myLocal;
+  return readings[closest].myBoxDist;
+}
+
+/**
+   Goes through the devices just like ArRobot::checkRangeDevicesCurrentPolar()
+   does, so that ties between devices (and what @a angle gets set to when
+   the closer device found nothing) come out the same way.
+**/
+AREXPORT double ArRangeSnapshot::checkPolar(
+	double startAngle, double endAngle, double *angle, 
+	const ArRangeDevice **rangeDevice, 
+	bool useLocationDependentDevices) const
+{
+  double closest = 32000;
+  double closeAngle = 0, tempDist, tempAngle = 0;
+  bool foundOne = false;
+  const ArRangeDevice *closestRangeDevice = NULL;
+
+  for (auto dev = myDevices.begin(); dev != myDevices.end(); ++dev)
+  {
+    if (!useLocationDependentDevices && dev->myDevice->isLocationDependent())
+      continue;
+    if (!foundOne)
+    {
+      closest = checkDevicePolar(*dev, startAngle, endAngle, &closeAngle);
+      closestRangeDevice = dev->myDevice;
+      foundOne = true;
+    }
+    else if ((tempDist = checkDevicePolar(*dev, startAngle, endAngle, 
+					  &tempAngle)) < closest)
+    {
+      closest = tempDist;
+      closeAngle = tempAngle;
+      closestRangeDevice = dev->myDevice;
+    }
+  }
+  if (!foundOne)
+    return -1;
+  if (angle != NULL)
+    *angle = closeAngle;
+  if (rangeDevice != NULL)
+    *rangeDevice = closestRangeDevice;
+  return closest;
+}
+
+/**
+   Goes through the devices just like ArRobot::checkRangeDevicesCurrentBox()
+   does.
+**/
+AREXPORT double ArRangeSnapshot::checkBox(
+	double x1, double y1, double x2, double y2, ArPose *readingPos,
+	const ArRangeDevice **rangeDevice, 
+	bool useLocationDependentDevices) const
+{
+  double closest = 32000;
+  double tempDist;
+  ArPose closestPos, tempPos;
+  bool foundOne = false;
+  const ArRangeDevice *closestRangeDevice = NULL;
+
+  for (auto dev = myDevices.begin(); dev != myDevices.end(); ++dev)
+  {
+    if (!useLocationDependentDevices && dev->myDevice->isLocationDependent())
+      continue;
+    if (!foundOne)
+    {
+      closest = checkDeviceBox(*dev, x1, y1, x2, y2, &closestPos);
+      closestRangeDevice = dev->myDevice;
+      foundOne = true;
+    }
+    else if ((tempDist = checkDeviceBox(*dev, x1, y1, x2, y2, 
+					&tempPos)) < closest)
+    {
+      closest = tempDist;
+      closestPos = tempPos;
+      closestRangeDevice = dev->myDevice;
+    }
+  }
+  if (!foundOne)
+    return -1;
+  if (readingPos != NULL)
+    *readingPos = closestPos;
+  if (rangeDevice != NULL)
+    *rangeDevice = closestRangeDevice;
+  return closest;
+}
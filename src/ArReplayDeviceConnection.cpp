@@ -0,0 +1,263 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArReplayDeviceConnection.h"
+#include "Aria/ArLog.h"
+#include "Aria/ariaUtil.h"
+
+#include <string.h>
+
+AREXPORT ArReplayDeviceConnection::ArReplayDeviceConnection() :
+  myFile(NULL),
+  myStatus(STATUS_NEVER_OPENED),
+  myRealTime(true),
+  myAtEnd(false),
+  myRecordPos(0),
+  myHaveRecord(false),
+  myRecordMSecs(0),
+  myBytesReplayed(0),
+  myBytesWritten(0)
+{
+  buildStrMap();
+  setPortType("replay");
+}
+
+AREXPORT ArReplayDeviceConnection::~ArReplayDeviceConnection()
+{
+  close();
+}
+
+void ArReplayDeviceConnection::buildStrMap()
+{
+  myStrMap[OPEN_FILE_NOT_FOUND] = "Could not open capture file.";
+  myStrMap[OPEN_NOT_CAPTURE] = "File is not a device capture.";
+  myStrMap[OPEN_BAD_VERSION] = "Capture file is from a newer version.";
+}
+
+AREXPORT const char *ArReplayDeviceConnection::getOpenMessage(
+	int messageNumber)
+{
+  return myStrMap[messageNumber].c_str();
+}
+
+AREXPORT void ArReplayDeviceConnection::setFileName(const char *fileName)
+{
+  if (fileName != NULL)
+    myFileName = fileName;
+  setPortName(myFileName.c_str());
+}
+
+/**
+   Playback (and in real time mode, the clock that the capture is played
+   back against) starts over from the beginning of the capture.
+
+   @param fileName the capture file to play, or NULL to use the one
+   from setFileName() or the last open()
+   @return 0 for success, otherwise one of the Open enums
+   @see getOpenMessage
+**/
+AREXPORT int ArReplayDeviceConnection::open(const char *fileName)
+{
+  close();
+  setFileName(fileName);
+  myStatus = STATUS_OPEN_FAILED;
+  myFile = ArUtil::fopen(myFileName.c_str(), "rb");
+  if (myFile == NULL)
+  {
+    ArLog::log(ArLog::Terse, 
+	       "ArReplayDeviceConnection: Could not open capture file %s",
+	       myFileName.c_str());
+    return OPEN_FILE_NOT_FOUND;
+  }
+  char magic[sizeof(ourCaptureMagic)];
+  int version;
+  if (fread(magic, 1, sizeof(magic), myFile) != sizeof(magic) ||
+      memcmp(magic, ourCaptureMagic, sizeof(magic)) != 0 ||
+      (version = fgetc(myFile)) == EOF)
+  {
+    ArLog::log(ArLog::Terse, 
+	       "ArReplayDeviceConnection: %s is not a device capture", 
+	       myFileName.c_str());
+    fclose(myFile);
+    myFile = NULL;
+    return OPEN_NOT_CAPTURE;
+  }
+  if (version > CAPTURE_VERSION)
+  {
+    ArLog::log(ArLog::Terse, 
+	       "ArReplayDeviceConnection: %s is capture format version %d, only up to %d is known", 
+	       myFileName.c_str(), version, (int) CAPTURE_VERSION);
+    fclose(myFile);
+    myFile = NULL;
+    return OPEN_BAD_VERSION;
+  }
+  myAtEnd = false;
+  myHaveRecord = false;
+  myRecordMSecs = 0;
+  myBytesReplayed = 0;
+  myBytesWritten = 0;
+  myReplayStartTime.setToNow();
+  myTimeRead = myReplayStartTime;
+  myStatus = STATUS_OPEN;
+  return 0;
+}
+
+AREXPORT bool ArReplayDeviceConnection::openSimple()
+{
+  return open() == 0;
+}
+
+AREXPORT bool ArReplayDeviceConnection::close()
+{
+  if (myFile != NULL)
+  {
+    fclose(myFile);
+    myFile = NULL;
+  }
+  if (myStatus == STATUS_OPEN)
+    myStatus = STATUS_CLOSED_NORMALLY;
+  myHaveRecord = false;
+  clearReadAhead();
+  return true;
+}
+
+/// Reads a number stored 7 bits per byte, low bits first
+static bool readCaptureNumber(FILE *file, unsigned long long *num)
+{
+  *num = 0;
+  for (int shift = 0; shift < 64; shift += 7)
+  {
+    const int c = fgetc(file);
+    if (c == EOF)
+      return false;
+    *num |= ((unsigned long long) (c & 0x7f)) << shift;
+    if ((c & 0x80) == 0)
+      return true;
+  }
+  return false;
+}
+
+bool ArReplayDeviceConnection::readRecord()
+{
+  unsigned long long msecs;
+  unsigned long long size;
+  if (myFile == NULL || 
+      !readCaptureNumber(myFile, &msecs) || 
+      !readCaptureNumber(myFile, &size) ||
+      size > 0x7fffffff)
+    return false;
+  myRecord.resize((size_t) size);
+  if (size > 0 && fread(&myRecord[0], 1, (size_t) size, myFile) != size)
+    return false;
+  myRecordMSecs += (long long) msecs;
+  myRecordPos = 0;
+  myHaveRecord = true;
+  return true;
+}
+
+/**
+   In real time mode this only returns data that is due to have been
+   read by now, waiting up to @a msWait ms for more to be due if none
+   is yet.  Otherwise it returns as much data as will fit.
+**/
+AREXPORT int ArReplayDeviceConnection::read(const char *data, 
+					    unsigned int size, 
+					    unsigned int msWait)
+{
+  if (myStatus != STATUS_OPEN)
+    return -1;
+
+  ArTime timeDone;
+  timeDone.addMSec(msWait);
+  unsigned int total = 0;
+  while (total < size)
+  {
+    if (!myHaveRecord && !readRecord())
+    {
+      if (!myAtEnd)
+	ArLog::log(ArLog::Normal, 
+		   "ArReplayDeviceConnection: End of capture %s after %llu bytes",
+		   myFileName.c_str(), myBytesReplayed + total);
+      myAtEnd = true;
+      break;
+    }
+    if (myRealTime)
+    {
+      const long long due = myRecordMSecs - myReplayStartTime.mSecSinceLL();
+      if (due > 0)
+      {
+	const long left = timeDone.mSecTo();
+	if (total > 0 || left <= 0)
+	  break;
+	ArUtil::sleep((unsigned int) (due < left ? due : left));
+	continue;
+      }
+    }
+    if (total == 0)
+    {
+      myTimeRead = myReplayStartTime;
+      if (myRealTime)
+	myTimeRead.addMSecLL(myRecordMSecs);
+      else
+	myTimeRead.setToNow();
+    }
+    size_t count = myRecord.size() - myRecordPos;
+    if (count > size - total)
+      count = size - total;
+    if (count > 0)
+      memcpy(const_cast<char *>(data) + total, &myRecord[myRecordPos], count);
+    myRecordPos += count;
+    total += (unsigned int) count;
+    if (myRecordPos >= myRecord.size())
+      myHaveRecord = false;
+  }
+  myBytesReplayed += total;
+  return (int) total;
+}
+
+AREXPORT int ArReplayDeviceConnection::write(UNUSED const char *data, 
+					     unsigned int size)
+{
+  if (myStatus != STATUS_OPEN)
+    return -1;
+  myBytesWritten += size;
+  return (int) size;
+}
+
+/**
+   In real time mode this is when the data returned by the last read()
+   is due, i.e. the time it was read from the device relative to when
+   the capture was started, shifted to the start of playback.
+   Otherwise it is just when the last read() was done.
+**/
+AREXPORT ArTime ArReplayDeviceConnection::getTimeRead(UNUSED int index)
+{
+  return myTimeRead;
+}
+
+AREXPORT bool ArReplayDeviceConnection::isTimeStamping()
+{
+  return myRealTime;
+}
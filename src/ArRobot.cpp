@@ -95,7 +95,6 @@ AREXPORT ArRobot::ArRobot(const char *name, UNUSED bool unused,
   myEncoderPoseInterpPositionCB(this, &ArRobot::getEncoderPoseInterpPosition)
 {
   myMutex.setLogName("ArRobot::myMutex");
-  myPacketMutex.setLogName("ArRobot::myPacketMutex");
   myConnectionTimeoutMutex.setLogName("ArRobot::myConnectionTimeoutMutex");
 
   setName(name);
@@ -111,6 +110,7 @@ AREXPORT ArRobot::ArRobot(const char *name, UNUSED bool unused,
   /// use loopOnce and not one of the run calls can work (the run
   /// calls set this to whatever it should be anyway)
   myRunningNonThreaded = true;
+  myPacketRingOverflowing = false;
 
   myMotorPacketCB.setName("ArRobot::motorPacket");
   myEncoderPacketCB.setName("ArRobot::encoderPacket");
@@ -146,6 +146,12 @@ AREXPORT ArRobot::ArRobot(const char *name, UNUSED bool unused,
   myKeepControlRaw = false;
 
   myPacketsSentTracking = false;
+  myCommandBatching = true;
+  myLatencyTracing = true;
+  myLatencyHaveSip = false;
+  myUseRangeSnapshot = true;
+  myRangeSnapshotBuilds = 0;
+  myRangeSnapshotMutex.setLogName("ArRobot::myRangeSnapshotMutex");
   myPacketsReceivedTracking = false;
   myPacketsReceivedTrackingCount = false;
   myPacketsReceivedTrackingStarted.setToNow();
@@ -3213,6 +3219,88 @@ AREXPORT bool ArRobot::addSensorInterpTask(const char *name, int position,
   return true;	
 }
 
+/**
+   Concurrent sensor interp tasks that are next to each other in the
+   list (i.e. with no ordinary task positioned between them) are run at
+   the same time, on the threads set with setSensorInterpThreads() and
+   the robot's own thread, and all of them finish before the next
+   ordinary task (and the action handler) runs.  The robot stays locked
+   by its own thread while they run, so they must not lock it, and they
+   must be safe to run at the same time as each other.  See
+   ArSyncTask::setConcurrent().
+
+   The cumulative buffer cleaning each ArRangeDevice does ("filter
+   <device name>") is concurrent already.  Another task that has to run
+   after a concurrent one (e.g. an ArLaserFilter after the laser it
+   filters, if both are concurrent) can be made to wait for it with
+   addSensorInterpTaskDependency().
+
+   @param name the name of the task
+   @param concurrent whether it can be run at the same time as others
+   @return false if there's no sensor interp task called @a name
+
+   @warning Not thread safe; if robot thread is running in background (from
+    runAsync()), you must lock the ArRobot object before calling and unlock after
+    calling this method.
+**/
+AREXPORT bool ArRobot::setSensorInterpTaskConcurrent(const char *name, 
+						     bool concurrent)
+{
+  ArSyncTask *proc;
+  if (mySyncTaskRoot == NULL || 
+      (proc = mySyncTaskRoot->findNonRecursive("Sensor Interp")) == NULL ||
+      (proc = proc->findNonRecursive(name)) == NULL)
+    return false;
+  proc->setConcurrent(concurrent);
+  return true;
+}
+
+/**
+   When the two tasks are concurrent and next to each other (see
+   setSensorInterpTaskConcurrent()), the task named @a name won't start
+   until the one named @a dependsOnName is done, wherever their
+   positions put them.  Otherwise this has no effect.
+   @return false if there's no sensor interp task called @a name
+
+   @warning Not thread safe; if robot thread is running in background (from
+    runAsync()), you must lock the ArRobot object before calling and unlock after
+    calling this method.
+**/
+AREXPORT bool ArRobot::addSensorInterpTaskDependency(const char *name, 
+						     const char *dependsOnName)
+{
+  ArSyncTask *proc;
+  if (mySyncTaskRoot == NULL || 
+      (proc = mySyncTaskRoot->findNonRecursive("Sensor Interp")) == NULL ||
+      (proc = proc->findNonRecursive(name)) == NULL)
+    return false;
+  proc->addDependency(dependsOnName);
+  return true;
+}
+
+/**
+   These threads (and the robot's own thread) run the concurrent sensor
+   interp tasks (see setSensorInterpTaskConcurrent()).  With 0 threads
+   (the default) every sensor interp task runs on the robot's thread
+   one after another.
+
+   @warning Not thread safe; if robot thread is running in background (from
+    runAsync()), you must lock the ArRobot object before calling and unlock after
+    calling this method.
+**/
+AREXPORT void ArRobot::setSensorInterpThreads(unsigned int numThreads)
+{
+  if (mySyncTaskRoot != NULL)
+    mySyncTaskRoot->setNumWorkers(numThreads);
+}
+
+AREXPORT unsigned int ArRobot::getSensorInterpThreads() const
+{
+  if (mySyncTaskRoot == NULL)
+    return 0;
+  return mySyncTaskRoot->getNumWorkers();
+}
+
 /**
    @see addSensorInterpTask
    @see remSensorInterpTask(ArFunctor *functor)
@@ -3265,9 +3353,12 @@ AREXPORT void ArRobot::remSensorInterpTask(ArFunctor *functor)
 }
 
 /** 
+    @param runTimes if true, also log how many times each task has run
+    and how long it took (min, mean, 99th percentile and max, in
+    microseconds), to find what is using up the cycle
     @see ArLog
 **/
-AREXPORT void ArRobot::logUserTasks() const
+AREXPORT void ArRobot::logUserTasks(bool runTimes) const
 {
   ArSyncTask *proc;
   if (mySyncTaskRoot == NULL)
@@ -3277,16 +3368,25 @@ AREXPORT void ArRobot::logUserTasks() const
   if (proc == NULL)
     return;
 
-  proc->log();
+  proc->log(0, runTimes);
 }
 
 /**
+   @param runTimes if true, also log how many times each task has run
+   and how long it took (min, mean, 99th percentile and max, in
+   microseconds), to find what is using up the cycle
    @see ArLog
 **/
-AREXPORT void ArRobot::logAllTasks() const
+AREXPORT void ArRobot::logAllTasks(bool runTimes) const
 {
   if (mySyncTaskRoot != NULL)
-    mySyncTaskRoot->log();
+    mySyncTaskRoot->log(0, runTimes);
+}
+
+AREXPORT void ArRobot::resetTaskRunTimes()
+{
+  if (mySyncTaskRoot != NULL)
+    mySyncTaskRoot->resetRunTimes();
 }
 
 /**
@@ -3550,6 +3650,46 @@ AREXPORT void ArRobot::setResolver(ArResolver *resolver)
   myResolver = resolver;
 }
 
+AREXPORT const char *ArRobot::getLatencyStageName(LatencyStage stage)
+{
+  switch (stage)
+  {
+  case LATENCY_RECEIVE_TO_HANDLE:
+    return "receive->handle";
+  case LATENCY_HANDLE_TO_SENSOR_INTERP:
+    return "handle->sensorInterp";
+  case LATENCY_SENSOR_INTERP_TO_ACTIONS:
+    return "sensorInterp->actions";
+  case LATENCY_ACTIONS_TO_SEND:
+    return "actions->send";
+  case LATENCY_RECEIVE_TO_SEND:
+    return "receive->send";
+  default:
+    return "unknown";
+  }
+}
+
+AREXPORT void ArRobot::resetLatencyHistograms()
+{
+  for (int i = 0; i < NUM_LATENCY_STAGES; i++)
+    myLatencyHistograms[i].reset();
+}
+
+AREXPORT void ArRobot::logLatency(ArLog::LogLevel level)
+{
+  ArLog::log(level, "%s: SIP to command latency (cycle time %u ms, %s, tracing %s):",
+	     myName.c_str(), getCycleTime(),
+	     isCycleChained() ? "cycle chained" : "not cycle chained",
+	     myLatencyTracing ? "on" : "off");
+  for (int i = 0; i < NUM_LATENCY_STAGES; i++)
+  {
+    std::string name = myName;
+    name += " ";
+    name += getLatencyStageName((LatencyStage)i);
+    myLatencyHistograms[i].log(name.c_str(), level);
+  }
+}
+
 /**
  * @internal
  *
@@ -3591,7 +3731,15 @@ void ArRobot::stateReflector()
   double latDecel;
 
   if (!myIsConnected)
+  {
+    myLatencyHaveSip = false;
     return;
+  }
+
+  const unsigned long packetsWritten = mySender.getNumPacketsWritten();
+  // everything sent from here on goes out in one write at the end
+  if (myCommandBatching)
+    mySender.startBatch();
 
   myTryingToMove = false;
 
@@ -4527,6 +4675,23 @@ void ArRobot::stateReflector()
       ArLog::log(ArLog::Normal, "Pulse"); 
 
   }
+
+  // write out anything batched above (does nothing if we weren't batching)
+  mySender.flushBatch();
+
+  if (myLatencyHaveSip && mySender.getNumPacketsWritten() != packetsWritten)
+  {
+    ArTime sent;
+    myLatencyHistograms[LATENCY_HANDLE_TO_SENSOR_INTERP].add(
+	    myLatencyHandled.mSecSinceLL(myLatencySensorInterpDone));
+    myLatencyHistograms[LATENCY_SENSOR_INTERP_TO_ACTIONS].add(
+	    myLatencySensorInterpDone.mSecSinceLL(myLatencyActionsResolved));
+    myLatencyHistograms[LATENCY_ACTIONS_TO_SEND].add(
+	    myLatencyActionsResolved.mSecSinceLL(sent));
+    myLatencyHistograms[LATENCY_RECEIVE_TO_SEND].add(
+	    myLatencyReceived.mSecSinceLL(sent));
+  }
+  myLatencyHaveSip = false;
 }
 
 bool ArRobot::handlePacket(ArRobotPacket *packet)
@@ -4557,6 +4722,18 @@ bool ArRobot::handlePacket(ArRobotPacket *packet)
   myLastPacketReceivedTime = packet->getTimeReceived();
   myConnectionTimeoutMutex.unlock();
 
+  if (myLatencyTracing && (packet->getID() & 0xf0) == 0x30)
+  {
+    myLatencyReceived = packet->getTimeReceived();
+    myLatencyHandled.setToNow();
+    // until the sensor interp and actions have had a go at it
+    myLatencySensorInterpDone = myLatencyHandled;
+    myLatencyActionsResolved = myLatencyHandled;
+    myLatencyHaveSip = true;
+    myLatencyHistograms[LATENCY_RECEIVE_TO_HANDLE].add(
+	    myLatencyReceived.mSecSinceLL(myLatencyHandled));
+  }
+
   if (packet->getID() == 0xff) 
   {
     dropConnection("Losing connection because microcontroller reset.",
@@ -4803,7 +4980,6 @@ void ArRobot::packetHandlerThreadedProcessor()
   ArTime start;
   bool sipHandled = false;
   bool anotherSip = false;
-  std::list<ArRobotPacket *>::iterator it;
 
   if (myAsyncConnectFlag)
   {
@@ -4824,28 +5000,14 @@ void ArRobot::packetHandlerThreadedProcessor()
   // packet cycle), if we get the sip we stop...
   while (!sipHandled && isRunning())
   {
-    packet = NULL;
-    anotherSip = false;
-    myPacketMutex.lock();
-    if (!myPacketList.empty())
-    {
-      packet = myPacketList.front();
-      myPacketList.pop_front();
-      // see if there are more sips, since if so we'll keep chugging
-      // through the list
-      for (it = myPacketList.begin(); 
-	   !anotherSip && it != myPacketList.end(); 
-	   it++)
-      {
-	if (((*it)->getID() & 0xf0) == 0x30)
-	  anotherSip = true;
-      }
-      myPacketMutex.unlock();
-    }
-    else
-    {
-      myPacketMutex.unlock();
-    }
+    // the packet stays in the ring (so the reader won't reuse its
+    // slot) until we're done handling it
+    packet = myPacketRing.front();
+    // see if there are more sips, since if so we'll keep chugging
+    // through the ring
+    if (packet != NULL)
+      anotherSip = (myPacketRing.getNumPendingSips() - 
+		    (ArRobotPacketRing::isSip(packet) ? 1 : 0)) > 0;
 
     if (packet == NULL)
     {
@@ -4860,9 +5022,10 @@ void ArRobot::packetHandlerThreadedProcessor()
 	  (ret = myPacketReceivedCondition.timedWait((unsigned int) timeToWait)) != 0)
       {
 	if (myCycleWarningTime != 0)
-	  ArLog::log(ArLog::Normal, "ArRobot::myPacketReader: Timed out (%d) at %d (%d into cycle after sleeping %d)", 	     
-		     ret, myPacketsReceivedTrackingStarted.mSecSince(), 
-		     start.mSecSince(), timeToWait);
+	  ARLOG_THROTTLED(myPacketTimeoutLogThrottle, ArLog::Normal,
+			  "ArRobot::myPacketReader: Timed out (%d) at %d (%d into cycle after sleeping %d)", 	     
+			  ret, myPacketsReceivedTrackingStarted.mSecSince(), 
+			  start.mSecSince(), timeToWait);
 	break;
       }
       else
@@ -4900,7 +5063,7 @@ void ArRobot::packetHandlerThreadedProcessor()
       }
     }
 
-    delete packet;
+    myPacketRing.pop();
     packet = NULL;
   }
 
@@ -4949,10 +5112,13 @@ void ArRobot::packetHandlerThreadedProcessor()
 /// isn't affected by the rest of the sync loop
 AREXPORT void ArRobot::packetHandlerThreadedReader()
 {
+  // packets get copied into the preallocated slots in myPacketRing, so
+  // the receiver doesn't need to allocate them
   bool isAllocatingPackets = myReceiver.isAllocatingPackets();
-  myReceiver.setAllocatingPackets(true);
+  myReceiver.setAllocatingPackets(false);
 
   ArTime lastPacketReceived;
+  unsigned long overflowsBefore = 0;
 
   ArRobotPacket *packet = NULL;
 
@@ -4968,16 +5134,32 @@ AREXPORT void ArRobot::packetHandlerThreadedReader()
     {
 
       lastPacketReceived.setToNow();
-      myPacketMutex.lock();
-      myPacketList.push_back(packet);
       /*
       ArLog::log(ArLog::Normal, "HTR: %x at %d (%x)",
 		 packet->getID(),
 		 myPacketsReceivedTrackingStarted.mSecSince(),
 		 packet->getID() & 0xf0);
       */
+      if (myPacketRing.push(packet))
+      {
+	if (myPacketRingOverflowing)
+	{
+	  myPacketRingOverflowing = false;
+	  ArLog::log(ArLog::Normal, 
+		     "ArRobot::packetReader: Sync loop caught up, %lu packets were dropped (%lu total)",
+		     myPacketRing.getNumOverflows() - overflowsBefore,
+		     myPacketRing.getNumOverflows());
+	}
+      }
+      else if (!myPacketRingOverflowing)
+      {
+	myPacketRingOverflowing = true;
+	overflowsBefore = myPacketRing.getNumOverflows() - 1;
+	ArLog::log(ArLog::Normal, 
+		   "ArRobot::packetReader: Sync loop has fallen behind, %lu packets waiting, dropping packets until it catches up",
+		   (unsigned long) myPacketRing.size());
+      }
       packet = NULL;
-      myPacketMutex.unlock();
       myPacketReceivedCondition.broadcast();
     }
     /* this is taken out for now since it'd spam in cases when the receiver returns instantly and fill the log file
@@ -5008,10 +5190,19 @@ AREXPORT void ArRobot::actionHandler()
 {
   ArActionDesired *actDesired;
 
+  // this runs right after the sensor interp tasks
+  if (myLatencyHaveSip)
+  {
+    myLatencySensorInterpDone.setToNow();
+    myLatencyActionsResolved = myLatencySensorInterpDone;
+  }
+
   if (myResolver == NULL || myActions.size() == 0 || !isConnected())
     return;
   
   actDesired = myResolver->resolve(&myActions, this, myLogActions);
+  if (myLatencyHaveSip)
+    myLatencyActionsResolved.setToNow();
   
   myActionDesired.reset();
 
@@ -5663,9 +5854,39 @@ bool ArRobot::processMotorPacket(ArRobotPacket *packet)
   myInterpolation.addReading(packetTime, myGlobalPose);
   myEncoderInterpolation.addReading(packetTime, myEncoderPose);
 
+  publishStateSnapshot();
   return true;
 }
 
+void ArRobot::publishStateSnapshot()
+{
+  ArRobotState &state = myStateToPublish;
+  state.myPose = myGlobalPose;
+  state.myEncoderPose = myEncoderPose;
+  state.myTime = myEncoderPose.getTime();
+  state.myVel = myVel;
+  state.myRotVel = myRotVel;
+  state.myLatVel = myLatVel;
+  state.myLeftVel = myLeftVel;
+  state.myRightVel = myRightVel;
+  state.myStallValue = myStallValue;
+  state.myFlags = myFlags;
+  state.myFaultFlags = myFaultFlags;
+  state.myBatteryVoltage = getBatteryVoltage();
+  state.myRealBatteryVoltage = getRealBatteryVoltage();
+  state.myStateOfCharge = getStateOfCharge();
+  state.myAnalogPortSelected = myAnalogPortSelected;
+  state.myAnalog = myAnalog;
+  state.myDigIn = myDigIn;
+  state.myDigOut = myDigOut;
+  state.myNumSonar = ArUtil::findMin(getNumSonar(), 
+				     (int)ArRobotState::MAX_SONAR);
+  for (int i = 0; i < state.myNumSonar; i++)
+    state.mySonarRanges[i] = getSonarRange(i);
+  state.myCount++;
+  myStateSnapshot.write(state);
+}
+
 void ArRobot::processNewSonar(int number, unsigned int range,
 				       ArTime timeReceived)
 {
@@ -6056,13 +6277,37 @@ AREXPORT bool ArRobot::hasRangeDevice(ArRangeDevice *device) const
   return false;
 }
 
+/**
+   The snapshot is built without holding its mutex, since building it locks
+   each range device in turn, and whoever holds a device's lock may be
+   waiting on the snapshot's mutex.
+**/
+void ArRobot::lockRangeSnapshot() const
+{
+  myRangeSnapshotMutex.lock();
+  if (myRangeSnapshot.isCurrent(myRangeDeviceList))
+    return;
+  ArRangeSnapshot snapshot;
+  snapshot.swap(myRangeSnapshotSpare);
+  myRangeSnapshotMutex.unlock();
+
+  snapshot.build(myRangeDeviceList);
+
+  myRangeSnapshotMutex.lock();
+  myRangeSnapshot.swap(snapshot);
+  myRangeSnapshotSpare.swap(snapshot);
+  myRangeSnapshotBuilds++;
+}
+
 /**
  *  Find the closest reading from any range device's set of current readings
  *  within a polar region or "slice" defined by the given angle range.
  *  This function iterates through each registered range device (see 
  *  addRangeDevice()), calls ArRangeDevice::lockDevice(), uses
  *  ArRangeDevice::currentReadingPolar() to find a reading, then calls
- *  ArRangeDevice::unlockDevice().
+ *  ArRangeDevice::unlockDevice().  (Unless setRangeSnapshot() has been
+ *  turned off, the same answer comes from a snapshot of all the current
+ *  readings instead.)
  *
  *  @copydoc ArRangeDevice::currentReadingPolar()
  *  @param rangeDevice If not null, then a pointer to the ArRangeDevice 
@@ -6076,6 +6321,16 @@ AREXPORT double ArRobot::checkRangeDevicesCurrentPolar(
 	const ArRangeDevice **rangeDevice,
 	bool useLocationDependentDevices) const
 {
+  if (myUseRangeSnapshot)
+  {
+    lockRangeSnapshot();
+    const double ret = myRangeSnapshot.checkPolar(
+	    startAngle, endAngle, angle, rangeDevice, 
+	    useLocationDependentDevices);
+    myRangeSnapshotMutex.unlock();
+    return ret;
+  }
+
   double closest = 32000;
   double closeAngle, tempDist, tempAngle;
   std::list<ArRangeDevice *>::const_iterator it;
@@ -6191,7 +6446,9 @@ AREXPORT double ArRobot::checkRangeDevicesCumulativePolar(
    Gets the closest reading in a region defined by the two points of a 
    rectangle.
    This goes through all of the registered range devices and locks each,
-   calls currentReadingBox on it, and then unlocks it.
+   calls currentReadingBox on it, and then unlocks it.  (Unless
+   setRangeSnapshot() has been turned off, the same answer comes from a
+   snapshot of all the current readings instead.)
 
    @param x1 the x coordinate of one of the rectangle points
    @param y1 the y coordinate of one of the rectangle points
@@ -6211,6 +6468,15 @@ AREXPORT double ArRobot::checkRangeDevicesCurrentBox(
 	const ArRangeDevice **rangeDevice, 
 	bool useLocationDependentDevices) const
 {
+  if (myUseRangeSnapshot)
+  {
+    lockRangeSnapshot();
+    const double ret = myRangeSnapshot.checkBox(
+	    x1, y1, x2, y2, readingPos, rangeDevice, 
+	    useLocationDependentDevices);
+    myRangeSnapshotMutex.unlock();
+    return ret;
+  }
 
   double closest = 32000;
   double tempDist;
@@ -6352,6 +6618,7 @@ AREXPORT void ArRobot::moveTo(ArPose pose, bool doCumulative)
   myEncoderTransform.setTransform(myEncoderPose, pose);
   myGlobalPose = myEncoderTransform.doTransform(myEncoderPose);
   mySetEncoderTransformCBList.invoke();
+  publishStateSnapshot();
 
   for (it = myRangeDeviceList.begin(); it != myRangeDeviceList.end(); it++)
   {
@@ -6406,6 +6673,7 @@ AREXPORT void ArRobot::moveTo(ArPose poseTo, ArPose poseFrom,
   myEncoderTransform.setTransform(result, poseTo);
   myGlobalPose = myEncoderTransform.doTransform(myEncoderPose);
   mySetEncoderTransformCBList.invoke();
+  publishStateSnapshot();
 
   for (it = myRangeDeviceList.begin(); it != myRangeDeviceList.end(); it++)
   {
@@ -6442,6 +6710,7 @@ AREXPORT void ArRobot::setEncoderTransform(const ArPose& deadReconPos,
   myEncoderTransform.setTransform(deadReconPos, globalPos);
   myGlobalPose = myEncoderTransform.doTransform(myEncoderPose);
   mySetEncoderTransformCBList.invoke();
+  publishStateSnapshot();
 }
 
 /**
@@ -6456,6 +6725,7 @@ AREXPORT void ArRobot::setEncoderTransform(const ArPose& transformPos)
   myEncoderTransform.setTransform(transformPos);
   myGlobalPose = myEncoderTransform.doTransform(myEncoderPose);
   mySetEncoderTransformCBList.invoke();
+  publishStateSnapshot();
 }
 
 /*
@@ -6470,6 +6740,7 @@ AREXPORT void ArRobot::setEncoderTransform(const ArTransform& transform)
   myEncoderTransform = transform;
   myGlobalPose = myEncoderTransform.doTransform(myEncoderPose);
   mySetEncoderTransformCBList.invoke();
+  publishStateSnapshot();
 }
 
 
@@ -6482,6 +6753,7 @@ AREXPORT void ArRobot::setDeadReconPose(const ArPose& pose)
   myEncoderTransform.setTransform(myEncoderPose, myGlobalPose);
   myGlobalPose = myEncoderTransform.doTransform(myEncoderPose);
   mySetEncoderTransformCBList.invoke();
+  publishStateSnapshot();
 }
 
 /** 
@@ -7609,9 +7881,7 @@ AREXPORT int ArRobot::applyEncoderOffset(ArPoseWithTime from, ArTime to,
 void ArRobot::internalIgnoreNextPacket()
 {
   myIgnoreNextPacket = true;
-  myPacketMutex.lock();
-  myPacketList.clear();
-  myPacketMutex.unlock();
+  myPacketRing.clear();
 }
 
 const char *ArRobot::getRobotSerialNumber() {
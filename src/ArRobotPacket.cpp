@@ -24,6 +24,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArExport.h"
 #include "Aria/ariaOSDef.h"
 #include "Aria/ArRobotPacket.h"
+#include "Aria/ArChecksum.h"
 #include "stdio.h"
 
 /**
@@ -81,7 +82,7 @@ AREXPORT ArRobotPacket &ArRobotPacket::operator=(const ArRobotPacket &other)
   return *this;
 }
 
-AREXPORT uint8_t ArRobotPacket::getID()
+AREXPORT uint8_t ArRobotPacket::getID() const
 {
   if (myLength >= 4)
     return (uint8_t) myBuf[3];
@@ -117,18 +118,12 @@ AREXPORT void ArRobotPacket::finalizePacket()
 
 AREXPORT int16_t ArRobotPacket::calcCheckSum()
 {
-  int16_t c = 0;
-  int i = 3;
-  int n = (int) myBuf[2] - 2;
-  while (n > 1) {
-    c += (int16_t) (((unsigned char)myBuf[i]<<8) | (unsigned char)myBuf[i+1]);
-    c = (int16_t) (c & 0xffff);
-    n -= 2;
-    i += 2;
-  }
-  if (n > 0) 
-    c = c ^ (int16_t)((unsigned char) myBuf[i]);
-  return c;
+  // (the count is unsigned, robot packets can be up to 200 bytes)
+  const int n = (int) (unsigned char) myBuf[2] - 2;
+  if (n <= 0)
+    return 0;
+  return (int16_t) ArChecksum::wordSumBE((const unsigned char *) myBuf + 3, 
+					 (size_t) n);
 }
 
 AREXPORT bool ArRobotPacket::verifyCheckSum() 
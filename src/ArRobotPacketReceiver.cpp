@@ -50,6 +50,7 @@ AREXPORT ArRobotPacketReceiver::ArRobotPacketReceiver(bool allocatePackets,
   myDeviceConn = NULL;
   mySync1 = sync1;
   mySync2 = sync2;
+  myPartialPacketTimeout = 100;
   myPacketReceivedCallback = NULL;
 }
 
@@ -75,6 +76,7 @@ AREXPORT ArRobotPacketReceiver::ArRobotPacketReceiver(
   myAllocatePackets = allocatePackets;
   mySync1 = sync1;
   mySync2 = sync2;
+  myPartialPacketTimeout = 100;
   myPacketReceivedCallback = NULL;
 }
 
@@ -102,6 +104,7 @@ AREXPORT ArRobotPacketReceiver::ArRobotPacketReceiver(
   myPacket(sync1, sync2),
   mySync1(sync1),
   mySync2(sync2),
+  myPartialPacketTimeout(100),
   myPacketReceivedCallback(NULL)
 {
  
@@ -130,18 +133,9 @@ AREXPORT ArDeviceConnection *ArRobotPacketReceiver::getDeviceConnection()
 AREXPORT ArRobotPacket* ArRobotPacketReceiver::receivePacket(unsigned int msWait)
 {
   ArRobotPacket *packet;
-  unsigned char c = 0;
-  char buf[256];
-  int count = 0;
-  // state can be one of the STATE_ enums in the class
-  int state = STATE_SYNC1;
-  //unsigned int timeDone;
-  //unsigned int curTime;
   long timeToRunFor;
   ArTime timeDone;
   ArTime lastDataRead;
-  ArTime packetReceived;
-  int numRead;
   if (myAllocatePackets)
     packet = new ArRobotPacket(mySync1, mySync2);
   else
@@ -152,7 +146,8 @@ AREXPORT ArRobotPacket* ArRobotPacketReceiver::receivePacket(unsigned int msWait
   {
     if (myTracking)
       ArLog::log(ArLog::Normal, "%s: receivePacket: connection not open", myTrackingLogName.c_str());
-    myDeviceConn->debugEndPacket(false, -10);
+    if (myDeviceConn != NULL)
+      myDeviceConn->debugEndPacket(false, -10);
     if (myAllocatePackets)
       delete packet;
     return NULL;
@@ -165,171 +160,167 @@ AREXPORT ArRobotPacket* ArRobotPacketReceiver::receivePacket(unsigned int msWait
                msWait);
   }
 
-
+  // Packets are framed out of the connection's read-ahead buffer, so
+  // the device is only read when the buffer runs dry instead of once
+  // per byte
   do
     {
       timeToRunFor = timeDone.mSecTo();
       if (timeToRunFor < 0)
         timeToRunFor = 0;
 
-      if (state == STATE_SYNC1)
-	myDeviceConn->debugStartPacket();
+      myDeviceConn->debugStartPacket();
 
-      if (myDeviceConn->read((char *)&c, 1, (unsigned int) timeToRunFor) == 0) 
+      // STATE_SYNC1: skip anything up to the first sync byte
+      const int syncIndex = myDeviceConn->scanBufferedFor(
+	      (char) mySync1, (unsigned int) timeToRunFor);
+      if (syncIndex < 0)
         {
+          const unsigned int skipped = myDeviceConn->getReadAheadCount();
+          if (myTracking && skipped > 0)
+            ArLog::log(ArLog::Normal, "%s: waiting for sync1, skipped %u bytes.", myTrackingLogName.c_str(), skipped);
+          myDeviceConn->ioStatsResync(skipped);
+          myDeviceConn->consumeReadAhead(skipped);
 	  myDeviceConn->debugBytesRead(0);
-          if (state == STATE_SYNC1)
+	  myDeviceConn->debugEndPacket(false, -30);
+          if (myAllocatePackets)
+            delete packet; 
+          return NULL;
+        }
+      if (syncIndex > 0)
+        {
+          if (myTracking) 
+            ArLog::log(ArLog::Normal, "%s: Not sync1, skipped %d bytes (expected 0x%x)", myTrackingLogName.c_str(), syncIndex, mySync1);
+          myDeviceConn->ioStatsResync((unsigned int) syncIndex);
+          myDeviceConn->consumeReadAhead((unsigned int) syncIndex);
+        }
+      if (myTracking)
+        ArLog::log(ArLog::Normal, "%s: got sync1 0x%x", myTrackingLogName.c_str(), mySync1);
+      packet->empty();
+      packet->setLength(0);
+      packet->setTimeReceived(myDeviceConn->getReadAheadTimeRead());
+
+      // STATE_SYNC2 and STATE_ACQUIRE_DATA: wait for the rest of the
+      // header and then the whole packet, giving up if we go
+      // myPartialPacketTimeout (100 ms by default) without data... its
+      // arbitrary but it doesn't happen often and it'll mean a bad
+      // packet anyways
+      unsigned int needed = 3;
+      unsigned int state = STATE_SYNC2;
+      lastDataRead.setToNow();
+      while (true)
+        {
+          if (myDeviceConn->getReadAheadCount() >= needed)
             {
-	      myDeviceConn->debugEndPacket(false, -30);
+              const unsigned char *buf = 
+		(const unsigned char *) myDeviceConn->getReadAheadData();
+              if (state == STATE_SYNC2)
+                {
+                  if (buf[1] != mySync2) // go back to beginning, packet hosed
+                    {
+	              if(myTracking) ArLog::log(ArLog::Normal, "%s: Bad sync2 0x%x (expected 0x%x)\n", myTrackingLogName.c_str(), buf[1], mySync2);
+                      myDeviceConn->ioStatsResync(2);
+                      myDeviceConn->consumeReadAhead(2);
+                      break;
+                    }
+                  if (myTracking)
+                    ArLog::log(ArLog::Normal, "%s: got sync2 0x%x", myTrackingLogName.c_str(), buf[1]);
+                  // the third byte is the count of the bytes remaining in
+                  // the packet; the spec says the max is 200, and it can't
+                  // be over 255
+                  needed = 3 + buf[2];
+                  state = STATE_ACQUIRE_DATA;
+                  continue;
+                }
+              break;
+            }
+          // if we aren't waiting leave the partial packet in the
+          // read-ahead buffer, it'll be finished on a later call
+          if (myPartialPacketTimeout == 0)
+            {
+	      myDeviceConn->debugEndPacket(false, -40);
               if (myAllocatePackets)
-                delete packet; 
-              if (myTracking)
-                ArLog::log(ArLog::Normal, "%s: waiting for sync1 (got 0x%x).", myTrackingLogName.c_str(), c);
+                delete packet;
               return NULL;
             }
-          else
+          const int numRead = myDeviceConn->fillReadAhead(1);
+          if (numRead > 0)
             {
-              //ArUtil::sleep(1);
-              continue;
-            }
-        }
-
-      myDeviceConn->debugBytesRead(1);
-
-      switch (state) {
-      case STATE_SYNC1:
-
-
-        if (c == mySync1) // move on, resetting packet
-          {
-            if (myTracking)
-              ArLog::log(ArLog::Normal, "%s: got sync1 0x%x", myTrackingLogName.c_str(), c);
-            state = STATE_SYNC2;
-            packet->empty();
-            packet->setLength(0);
-            packet->uByteToBuf(c);
-            packetReceived = myDeviceConn->getTimeRead(0);
-            packet->setTimeReceived(packetReceived);
-          }
-        else
-	      {
-          if(myTracking) ArLog::log(ArLog::Normal, "%s: Not sync1 0x%x (expected 0x%x)\n", myTrackingLogName.c_str(), c, mySync1);
-	      }
-        break;
-      case STATE_SYNC2:
- 
-       if (c == mySync2) // move on, adding this byte
-          {
-            if (myTracking)
-              ArLog::log(ArLog::Normal, "%s: got sync2 0x%x", myTrackingLogName.c_str(), c);
-
-            state = STATE_ACQUIRE_DATA;
-            packet->uByteToBuf(c);
-          }
-        else // go back to beginning, packet hosed
-          {
-	          if(myTracking) ArLog::log(ArLog::Normal, "%s: Bad sync2 0x%x (expected 0x%x)\n", myTrackingLogName.c_str(), c, mySync2);
-            state = STATE_SYNC1;
-          }
-        break;
-      case STATE_ACQUIRE_DATA:
-
-        // the character c is the count of the packets remianing at this point
-        // so we'll just put it into the packet then get the rest of the data
-        packet->uByteToBuf(c);
-        // if c > 200 than there is a problem, spec says packet max size is 200
-        count = 0;
-	/** this case can't happen since c can't be over that so taking it out
-        if (c > 255) 
-          {
-            ArLog::log(ArLog::Normal, "ArRobotPacketReceiver::receivePacket: bad packet, more than 255 bytes");
-            state = STATE_SYNC1;
-            break;
-          }
-	*/
-        // here we read until we get as much as we want, OR until
-        // we go 100 ms without data... its arbitrary but it doesn't happen often
-        // and it'll mean a bad packet anyways
-        lastDataRead.setToNow();
-        while (count < c)
-          {
-            assert(c - count > 0);
-            numRead = myDeviceConn->read(buf + count, (unsigned int)(c - count), 1);
-            if (numRead > 0)
-	    {
 	      myDeviceConn->debugBytesRead(numRead);
               lastDataRead.setToNow();
-	    }
-	    else
-	    {
+            }
+          else
+            {
 	      myDeviceConn->debugBytesRead(0);
-	    }
-            if (lastDataRead.mSecTo() < -100)
-              {
-		myDeviceConn->debugEndPacket(false, -40);
-                if (myAllocatePackets)
-                  delete packet;
-		            //printf("Bad time taken reading\n");
-                return NULL;
-              }
-            count += numRead;
-          }
-        packet->dataToBuf(buf, c);
-        if (packet->verifyCheckSum()) 
-          {
+            }
+          if (numRead < 0 || 
+              lastDataRead.mSecSince() > (long) myPartialPacketTimeout)
+            {
+	      myDeviceConn->debugEndPacket(false, -40);
+              if (myAllocatePackets)
+                delete packet;
+              return NULL;
+            }
+        }
+      if (state != STATE_ACQUIRE_DATA)
+        continue;
+
+      packet->dataToBuf(myDeviceConn->getReadAheadData(), needed);
+      const bool goodCheckSum = packet->verifyCheckSum();
+      if (goodCheckSum)
+        myDeviceConn->ioStatsGoodPacket(needed);
+      else
+        myDeviceConn->ioStatsBadPacket(true);
+      myDeviceConn->consumeReadAhead(needed);
+      if (goodCheckSum) 
+        {
 	
-            packet->resetRead();
-	    /* put this in if you want to see the packets received
-	       printf("Input ");
-               packet->printHex();
-	       */
-
-	    // you can also do this next line if you only care about type
-	    //printf("Input %x\n", packet->getID());
-	    myDeviceConn->debugEndPacket(true, packet->getID());
-	    if (myPacketReceivedCallback != NULL)
-	      myPacketReceivedCallback->invoke(packet);
-
-			// if tracking is on - log packet - also make sure
-			// buffer length is in range
-
-			if ((myTracking) && (packet->getLength() < 10000)) {
-				unsigned char *buf2 = (unsigned char *) packet->getBuf();
+          packet->resetRead();
+	  /* put this in if you want to see the packets received
+	     printf("Input ");
+             packet->printHex();
+	     */
+
+	  // you can also do this next line if you only care about type
+	  //printf("Input %x\n", packet->getID());
+	  myDeviceConn->debugEndPacket(true, packet->getID());
+	  if (myPacketReceivedCallback != NULL)
+	    myPacketReceivedCallback->invoke(packet);
+
+	  // if tracking is on - log packet - also make sure
+	  // buffer length is in range
+
+	  if ((myTracking) && (packet->getLength() < 10000)) {
+	    unsigned char *buf2 = (unsigned char *) packet->getBuf();
 		
-				char obuf[10000];
-				obuf[0] = '\0';
-				int j = 0;
-				for (int i = 0; i < packet->getLength(); i++) {
-					sprintf (&obuf[j], "_%02x", buf2[i]);
-					j= j+3;
-				}
+	    char obuf[10000];
+	    obuf[0] = '\0';
+	    int j = 0;
+	    for (int i = 0; i < packet->getLength(); i++) {
+	      sprintf (&obuf[j], "_%02x", buf2[i]);
+	      j= j+3;
+	    }
 
-				ArLog::log (ArLog::Normal,
-				            "Recv Packet: %s packet = %s (%s)", 
-										myTrackingLogName.c_str(), obuf, packet->getName());
+	    ArLog::log (ArLog::Normal,
+	                "Recv Packet: %s packet = %s (%s)", 
+	                myTrackingLogName.c_str(), obuf, packet->getName());
 
 
-			}  // end tracking		
+	  }  // end tracking		
 
-			return packet;
-          }
-        else 
-          {
-	    /* put this in if you want to see bad checksum packets 
-               printf("Bad Input ");
-               packet->printHex();
-	       */
-            ArLog::log(ArLog::Normal, 
-                       "ArRobotPacketReceiver::receivePacket: Warning: bad packet, bad checksum (received packet type ID 0x%x: %s)", packet->getID(), packet->getName());
-            state = STATE_SYNC1;
-	    myDeviceConn->debugEndPacket(false, -50);
-            break;
-          }
-        break;
-      default:
-        break;
-      }
-    } while (timeDone.mSecTo() >= 0 || state != STATE_SYNC1);
+	  return packet;
+        }
+      else 
+        {
+	  /* put this in if you want to see bad checksum packets 
+             printf("Bad Input ");
+             packet->printHex();
+	     */
+          ArLog::log(ArLog::Normal, 
+                     "ArRobotPacketReceiver::receivePacket: Warning: bad packet, bad checksum (received packet type ID 0x%x: %s)", packet->getID(), packet->getName());
+	  myDeviceConn->debugEndPacket(false, -50);
+        }
+    } while (timeDone.mSecTo() >= 0);
 
   myDeviceConn->debugEndPacket(false, -60);
   //printf("finished the loop...\n"); 
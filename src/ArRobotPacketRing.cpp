@@ -0,0 +1,121 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArRobotPacketRing.h"
+
+/**
+   @param capacity the most packets the ring can hold before packets are
+   dropped
+   @param sync1 first sync byte of the packets (for constructing the slots)
+   @param sync2 second sync byte of the packets (for constructing the slots)
+**/
+AREXPORT ArRobotPacketRing::ArRobotPacketRing(size_t capacity,
+					      unsigned char sync1,
+					      unsigned char sync2) :
+  mySlots(capacity + 1, ArRobotPacket(sync1, sync2)),
+  myHead(0),
+  myTail(0),
+  myPendingSips(0),
+  myNumOverflows(0),
+  myNumPushed(0),
+  myMaxDepth(0)
+{
+}
+
+/**
+   @return true if the packet was queued, false if the ring was full and
+   the packet was dropped
+**/
+AREXPORT bool ArRobotPacketRing::push(const ArRobotPacket *packet)
+{
+  const size_t tail = myTail.load(std::memory_order_relaxed);
+  size_t next = tail + 1;
+  if (next == mySlots.size())
+    next = 0;
+  const size_t head = myHead.load(std::memory_order_acquire);
+  if (next == head)
+  {
+    myNumOverflows.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  // the slots are all the same size as the packets being copied in, so
+  // this is just a copy into the existing buffer
+  mySlots[tail] = *packet;
+  if (isSip(packet))
+    myPendingSips.fetch_add(1, std::memory_order_release);
+  myTail.store(next, std::memory_order_release);
+
+  myNumPushed.fetch_add(1, std::memory_order_relaxed);
+  const size_t depth = (next + mySlots.size() - head) % mySlots.size();
+  if (depth > myMaxDepth.load(std::memory_order_relaxed))
+    myMaxDepth.store(depth, std::memory_order_relaxed);
+  return true;
+}
+
+/**
+   The packet stays valid (and won't be overwritten by the reader) until
+   pop() is called.
+**/
+AREXPORT ArRobotPacket *ArRobotPacketRing::front()
+{
+  const size_t head = myHead.load(std::memory_order_relaxed);
+  if (head == myTail.load(std::memory_order_acquire))
+    return NULL;
+  return &mySlots[head];
+}
+
+AREXPORT void ArRobotPacketRing::pop()
+{
+  const size_t head = myHead.load(std::memory_order_relaxed);
+  if (head == myTail.load(std::memory_order_acquire))
+    return;
+  if (isSip(&mySlots[head]))
+    myPendingSips.fetch_sub(1, std::memory_order_release);
+  size_t next = head + 1;
+  if (next == mySlots.size())
+    next = 0;
+  myHead.store(next, std::memory_order_release);
+}
+
+AREXPORT void ArRobotPacketRing::clear()
+{
+  while (front() != NULL)
+    pop();
+}
+
+AREXPORT size_t ArRobotPacketRing::size() const
+{
+  const size_t head = myHead.load(std::memory_order_acquire);
+  const size_t tail = myTail.load(std::memory_order_acquire);
+  return (tail + mySlots.size() - head) % mySlots.size();
+}
+
+AREXPORT void ArRobotPacketRing::resetStats()
+{
+  myNumOverflows.store(0, std::memory_order_relaxed);
+  myNumPushed.store(0, std::memory_order_relaxed);
+  myMaxDepth.store(0, std::memory_order_relaxed);
+}
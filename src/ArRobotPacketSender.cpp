@@ -45,6 +45,11 @@ AREXPORT ArRobotPacketSender::ArRobotPacketSender(unsigned char sync1,
   mySendingMutex.setLogName("ArRobotPacketSender");
   myPacketSentCallback = NULL;
   myCommandMonitorCB = NULL;
+  myBatching = false;
+  myBatchCount = 0;
+  myNumBatchesFlushed = 0;
+  myNumBatchedCommands = 0;
+  myNumPacketsWritten = 0;
 }
 
 /**
@@ -67,6 +72,12 @@ AREXPORT ArRobotPacketSender::ArRobotPacketSender(
 	myTrackingLogName.clear();
   mySendingMutex.setLogName("ArRobotPacketSender");
   myPacketSentCallback = NULL;
+  myCommandMonitorCB = NULL;
+  myBatching = false;
+  myBatchCount = 0;
+  myNumBatchesFlushed = 0;
+  myNumBatchedCommands = 0;
+  myNumPacketsWritten = 0;
 }
 
 /**
@@ -94,6 +105,12 @@ AREXPORT ArRobotPacketSender::ArRobotPacketSender(
   myDeviceConn = deviceConnection;
   mySendingMutex.setLogName("ArRobotPacketSender");
   myPacketSentCallback = NULL;
+  myCommandMonitorCB = NULL;
+  myBatching = false;
+  myBatchCount = 0;
+  myNumBatchesFlushed = 0;
+  myNumBatchedCommands = 0;
+  myNumPacketsWritten = 0;
 }
 
 
@@ -114,6 +131,73 @@ bool ArRobotPacketSender::connValid()
 	  myDeviceConn->getStatus() == ArDeviceConnection::STATUS_OPEN);
 }
 
+/**
+   Writes the finalized packet to the device connection, or if we're
+   batching appends it to the batch to be written by flushBatch().  Must be
+   called with mySendingMutex locked.
+**/
+bool ArRobotPacketSender::writePacket(ArRobotPacket *packet)
+{
+  if (!myBatching)
+  {
+    myNumPacketsWritten++;
+    return (myDeviceConn->write(packet->getBuf(), packet->getLength()) >= 0);
+  }
+  myBatchBuf.insert(myBatchBuf.end(), packet->getBuf(),
+		    packet->getBuf() + packet->getLength());
+  myBatchCount++;
+  return true;
+}
+
+/**
+   After this is called every command sent (com(), comInt(), sendPacket()
+   and so on) is finalized as usual but, instead of being written to the
+   device connection right away, is appended to a batch.  Call flushBatch()
+   to write the whole batch at once.  While batching the command functions
+   return true if the command was queued, any write error is reported by
+   flushBatch().  Calling this while already batching does nothing.
+**/
+AREXPORT void ArRobotPacketSender::startBatch()
+{
+  mySendingMutex.lock();
+  myBatching = true;
+  mySendingMutex.unlock();
+}
+
+/**
+   Writes every command queued since startBatch() to the device connection
+   with one write, in the order they were sent, and then goes back to
+   writing commands as they are sent.  If the connection was lost while
+   batching the queued commands are dropped.
+   @return true if there was nothing to write or the write succeeded, false
+   if the write failed
+**/
+AREXPORT bool ArRobotPacketSender::flushBatch()
+{
+  bool ret = true;
+
+  mySendingMutex.lock();
+  myBatching = false;
+  if (!myBatchBuf.empty())
+  {
+    if (connValid())
+    {
+      ret = (myDeviceConn->write(&myBatchBuf[0], 
+				 (unsigned int)myBatchBuf.size()) >= 0);
+      myNumBatchesFlushed++;
+      myNumBatchedCommands += myBatchCount;
+      myNumPacketsWritten += myBatchCount;
+    }
+    else
+      ret = false;
+    myBatchBuf.clear();
+  }
+  myBatchCount = 0;
+  mySendingMutex.unlock();
+
+  return ret;
+}
+
 /**
    @param command the command number to send
    @return whether the command could be sent or not
@@ -137,7 +221,7 @@ AREXPORT bool ArRobotPacketSender::com(unsigned char command)
 
   // the old one seems wrong...  (next line)
   //  ret = myDeviceConn->write(myPacket.getBuf(), myPacket.getLength());
-  ret = (myDeviceConn->write(myPacket.getBuf(), myPacket.getLength()) >= 0);
+  ret = writePacket(&myPacket);
 
   if (myPacketSentCallback != NULL)
     myPacketSentCallback->invoke(&myPacket);
@@ -181,7 +265,7 @@ AREXPORT bool ArRobotPacketSender::comInt(unsigned char command,
   if(myTracking)
     myPacket.log();
 
-  ret = (myDeviceConn->write(myPacket.getBuf(), myPacket.getLength()) >= 0);
+  ret = writePacket(&myPacket);
 
   if (myPacketSentCallback != NULL)
     myPacketSentCallback->invoke(&myPacket);
@@ -237,7 +321,7 @@ AREXPORT bool ArRobotPacketSender::comStr(unsigned char command,
   if(myTracking)
 	  myPacket.log();
 
-  ret = (myDeviceConn->write(myPacket.getBuf(), myPacket.getLength()) >= 0);
+  ret = writePacket(&myPacket);
 
   if (myPacketSentCallback != NULL)
     myPacketSentCallback->invoke(&myPacket);
@@ -280,7 +364,7 @@ AREXPORT bool ArRobotPacketSender::comStrN(unsigned char command,
   if(myTracking)
 	  myPacket.log();
 
-  bool ret = (myDeviceConn->write(myPacket.getBuf(), myPacket.getLength()) >= 0);
+  bool ret = writePacket(&myPacket);
 
   if (myPacketSentCallback != NULL)
     myPacketSentCallback->invoke(&myPacket);
@@ -331,7 +415,7 @@ AREXPORT bool ArRobotPacketSender::sendPacket(ArRobotPacket *packet)
 	}
 
 	//packet->log();
-  ret = (myDeviceConn->write(packet->getBuf(), packet->getLength()) >= 0);
+  ret = writePacket(packet);
 
   if (myPacketSentCallback != NULL)
     myPacketSentCallback->invoke(packet);
@@ -360,7 +444,7 @@ AREXPORT bool ArRobotPacketSender::comDataN(unsigned char command, const char* d
   if(myTracking)
     myPacket.log();
 
-  ret = (myDeviceConn->write(myPacket.getBuf(), myPacket.getLength()) >= 0);
+  ret = writePacket(&myPacket);
 
   if (myPacketSentCallback != NULL)
     myPacketSentCallback->invoke(&myPacket);
@@ -27,6 +27,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ArRobot.h"
 #include "Aria/ArSerialConnection.h"
 #include "Aria/ariaInternal.h"
+#include "Aria/ArChecksum.h"
 #include <time.h>
 
 //#define TRACE
@@ -191,7 +192,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 		char prev_c = 0x30;
 		while (nonzero)
 		{
-			if ((myConn->read((char *) &c, 1, msWait)) > 0)
+			if ((myConn->readBuffered((char *) &c, 1, msWait)) > 0)
 			{
 				if (((c == 0x00) && (zerocnt == 0)) || ((c == 0x00) && (prev_c == 0x00)))
 				{
@@ -215,7 +216,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 //#if 0
 		// look for initial sequence 0x00 0x00 0x00 0x00
 		for (i = 0; i < 4; i++) {
-			if ((myConn->read((char *) &c, 1, msWait)) > 0) {
+			if ((myConn->readBuffered((char *) &c, 1, msWait)) > 0) {
 				if (c != 0x00) {
 					//printf("char = %x\n",c);
 					//ArLog::log(ArLog::Terse,
@@ -246,7 +247,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 //#endif
 
 		// next byte = 0x91  - command number
-		if ((myConn->read((char *) &c, 1, msWait)) > 0) {
+		if ((myConn->readBuffered((char *) &c, 1, msWait)) > 0) {
 			if (c != 0x91) {
 				//ArLog::log(ArLog::Terse,
 				//                 "ArSZSeries::receivePacket() error data block number in header");
@@ -275,7 +276,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 		// next byte = 0x00  - Communication ID
 		// note we are assuming this needs to be 0
 		// as set in the Configurator
-		if ((myConn->read((char *) &c, 1, msWait)) > 0) {
+		if ((myConn->readBuffered((char *) &c, 1, msWait)) > 0) {
 			if (c != 0x00) {
 				//ArLog::log(ArLog::Terse,
 				//                 "ArSZSeries::receivePacket() error data block number in header");
@@ -303,7 +304,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 		// next 2 bytes are length,
 
 		for (i = 0; i < 2; i++) {
-			if ((myConn->read((char *) &c, 1, msWait)) > 0) {
+			if ((myConn->readBuffered((char *) &c, 1, msWait)) > 0) {
 				temp[i] = c;
 				crcbuf[n++] = c;
 			} else {
@@ -339,7 +340,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 
 		// next scan frequency
 
-		if ((myConn->read((char *) &c, 1, msWait)) > 0) {
+		if ((myConn->readBuffered((char *) &c, 1, msWait)) > 0) {
 			myPacket.setScanFrequency(c);
 		} else {
 			ArLog::log(
@@ -353,7 +354,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 
 		// now read all the readings
 		// PS 12/6/12 - change timeout from 5000 to 200
-		int numRead = myConn->read((char *) &myReadBuf[0],
+		int numRead = myConn->readBuffered((char *) &myReadBuf[0],
 				myPacket.getDataLength(), 200);
 
 		// trap if we failed the read
@@ -372,7 +373,7 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 		// finally get the crc
 		for (i = 0; i < 2; i++)
 		{
-			if ((myConn->read((char *) &c, 1, msWait)) > 0)
+			if ((myConn->readBuffered((char *) &c, 1, msWait)) > 0)
 			{
 				temp[i] = c;
 			}
@@ -458,12 +459,14 @@ ArSZSeriesPacket *ArSZSeriesPacketReceiver::receivePacket(unsigned int msWait,
 			ArLog::log(ArLog::Terse,
 					"%s::receivePacket() CRC error (in = 0x%02x calculated = 0x%02x) ",
 					myName.c_str(), incrc, crc);
+			myConn->ioStatsBadPacket(true);
 			return NULL;
 		}
 
 
 		myPacket.dataToBuf(&myReadBuf[0], (size_t) myPacket.getNumReadings() * 2);
 		myPacket.resetRead();
+		myConn->ioStatsGoodPacket(0);
 		packet = new ArSZSeriesPacket;
 		packet->duplicatePacket(&myPacket);
 
@@ -490,7 +493,7 @@ AREXPORT ArSZSeries::ArSZSeries(int laserNumber, const char *name) :
 	//ArLog::log(ArLog::Normal, "%s: Sucessfully created", getName());
 
 	clear();
-	myRawReadings = new std::list<ArSensorReading *>;
+	myRawReadings = myLaserReadings.getList();
 
 	Aria::addExitCallback(&myAriaExitCB, -10);
 
@@ -559,12 +562,6 @@ AREXPORT ArSZSeries::~ArSZSeries() {
 		myRobot->remLaser(this);
 		myRobot->remSensorInterpTask(&mySensorInterpTask);
 	}
-	if (myRawReadings != NULL) {
-		ArUtil::deleteSet(myRawReadings->begin(), myRawReadings->end());
-		myRawReadings->clear();
-		delete myRawReadings;
-		myRawReadings = NULL;
-	}
 	lockDevice();
 	if (isConnected())
 		disconnect();
@@ -679,7 +676,6 @@ void ArSZSeries::sensorInterp() {
 		myDataMutex.lock();
 
 		//std::list<ArSensorReading *>::reverse_iterator it;
-		ArSensorReading *reading;
 
 		myNumChans = packet->getNumReadings();
 
@@ -705,28 +701,6 @@ void ArSZSeries::sensorInterp() {
 			continue;
 		}
 
-		// If we don't have any sensor readings created at all, make 'em all
-		if (myRawReadings->size() == 0) {
-			for (size_t j = 0; j < eachNumberData; j++) {
-				myRawReadings->push_back(new ArSensorReading);
-			}
-		}
-
-		if (eachNumberData > myRawReadings->size())
-		{
-			ArLog::log(ArLog::Terse,
-					"%s::sensorInterp() Bad data, in theory have %d readings but can only have 751... skipping this packet",
-					getName(), eachNumberData);
-
-			// PS 12/6/12 - unlock and delete before continuing
-
-			delete packet;
-			myDataMutex.unlock();
-			unlockDevice();
-			continue;
-		}
-
-
 		double start;
 		double increment;
 
@@ -740,24 +714,22 @@ void ArSZSeries::sensorInterp() {
 			increment = eachAngularStepWidth;
 		}
 
+		// this only works the beams out again if they changed
+		myLaserReadings.setRays(eachNumberData,
+					ArMath::roundInt(mySensorPose.getX()),
+					ArMath::roundInt(mySensorPose.getY()),
+					start, increment);
+
 		const bool ignore = false;
-		double atDeg = start;
-		std::list<ArSensorReading *>::const_iterator it = myRawReadings->begin();
 		int readingIndex = 0;
 		size_t onReading = 0;
 		for (;
 
 				onReading < eachNumberData;
 
-				atDeg += increment,
-				++it,
 				++readingIndex,
 				++onReading)
 		{
-
-
-			reading = (*it);
-
 			dist = (unsigned int) (((buf[readingIndex * 2] & 0x3f)<< 8) | (buf[(readingIndex * 2) + 1]));
 
 			// note max distance is 16383 mm, if the measurement
@@ -768,10 +740,7 @@ void ArSZSeries::sensorInterp() {
 			readingIndex, buf[(readingIndex *2)+1], buf[readingIndex], dist);
             */
 
-			reading->resetSensorPosition(ArMath::roundInt(mySensorPose.getX()),
-					ArMath::roundInt(mySensorPose.getY()), atDeg);
-			reading->newData(dist, pose, encoderPose, transform, counter, time,
-					ignore, 0); // no reflector yet
+			myLaserReadings.setRange(onReading, dist, ignore, 0); // no reflector yet
 
 			//printf("dist = %d, pose = %d, encoderPose = %d, transform = %d, counter = %d, time = %d, igore = %d",
 			//		dist, pose, encoderPose, transform, counter,
@@ -784,6 +753,8 @@ void ArSZSeries::sensorInterp() {
 		 myScanCounter, onReading);
 */
 
+		myLaserReadings.project(pose, encoderPose, transform, counter, time);
+
 		myDataMutex.unlock();
 
 		/*
@@ -972,7 +943,7 @@ AREXPORT bool ArSZSeries::blockingConnect() {
 		// PS 9/7/11 - just go read 1 byte
 		packet = myReceiver.receivePacket(1000);
 		//char c;
-		//if ((myConn->read((char *) &c, 1, 1000)) > 0)
+		//if ((myConn->readBuffered((char *) &c, 1, 1000)) > 0)
 
 		if (packet != NULL)
 		{
@@ -1113,51 +1084,7 @@ AREXPORT void * ArSZSeries::runThread(void *) {
 }
 
 
-static const unsigned short
-crc_table[256] = { 0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5,
-		0x60c6, 0x70e7, 0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad,
-		0xe1ce, 0xf1ef, 0x1231, 0x0210, 0x3273, 0x2252, 0x52b5, 0x4294,
-		0x72f7, 0x62d6, 0x9339, 0x8318, 0xb37b, 0xa35a, 0xd3bd, 0xc39c,
-		0xf3ff, 0xe3de, 0x2462, 0x3443, 0x0420, 0x1401, 0x64e6, 0x74c7,
-		0x44a4, 0x5485, 0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee, 0xf5cf,
-		0xc5ac, 0xd58d, 0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6,
-		0x5695, 0x46b4, 0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe,
-		0xd79d, 0xc7bc, 0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861,
-		0x2802, 0x3823, 0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969,
-		0xa90a, 0xb92b, 0x5af5, 0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50,
-		0x3a33, 0x2a12, 0xdbfd, 0xcbdc, 0xfbbf, 0xeb9e, 0x9b79, 0x8b58,
-		0xbb3b, 0xab1a, 0x6ca6, 0x7c87, 0x4ce4, 0x5cc5, 0x2c22, 0x3c03,
-		0x0c60, 0x1c41, 0xedae, 0xfd8f, 0xcdec, 0xddcd, 0xad2a, 0xbd0b,
-		0x8d68, 0x9d49, 0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13, 0x2e32,
-		0x1e51, 0x0e70, 0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a,
-		0x9f59, 0x8f78, 0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d,
-		0xf14e, 0xe16f, 0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025,
-		0x7046, 0x6067, 0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c,
-		0xe37f, 0xf35e, 0x02b1, 0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214,
-		0x6277, 0x7256, 0xb5ea, 0xa5cb, 0x95a8, 0x8589, 0xf56e, 0xe54f,
-		0xd52c, 0xc50d, 0x34e2, 0x24c3, 0x14a0, 0x0481, 0x7466, 0x6447,
-		0x5424, 0x4405, 0xa7db, 0xb7fa, 0x8799, 0x97b8, 0xe75f, 0xf77e,
-		0xc71d, 0xd73c, 0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657, 0x7676,
-		0x4615, 0x5634, 0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9,
-		0xb98a, 0xa9ab, 0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1,
-		0x3882, 0x28a3, 0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8,
-		0xabbb, 0xbb9a, 0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0,
-		0x2ab3, 0x3a92, 0xfd2e, 0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b,
-		0x9de8, 0x8dc9, 0x7c26, 0x6c07, 0x5c64, 0x4c45, 0x3ca2, 0x2c83,
-		0x1ce0, 0x0cc1, 0xef1f, 0xff3e, 0xcf5d, 0xdf7c, 0xaf9b, 0xbfba,
-		0x8fd9, 0x9ff8, 0x6e17, 0x7e36, 0x4e55, 0x5e74, 0x2e93, 0x3eb2,
-		0x0ed1, 0x1ef0 };
-
 unsigned short ArSZSeriesPacketReceiver::CRC16(unsigned char *Data, int length) {
-	unsigned short CRC_16 = 0x0000;
-	int i;
-
-	for (i = 0; i < length; i++)
-	{
-		CRC_16 = (unsigned short) ( (CRC_16 << 8) ^ (crc_table[(CRC_16 >> 8) ^ (Data[i])] ) );
-//printf("CRC_16=0x%x\n",CRC_16);
-	}
-
-	return CRC_16;
+	return ArChecksum::crc16CCITT(Data, (size_t) length, 0x0000);
 }
 
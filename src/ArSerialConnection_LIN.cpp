@@ -292,6 +292,7 @@ AREXPORT bool ArSerialConnection::close()
   int ret;
 
   myStatus = STATUS_CLOSED_NORMALLY;
+  clearReadAhead();
   if (myPort == -1)
     return true;
   
@@ -600,6 +601,11 @@ AREXPORT bool ArSerialConnection::isTimeStamping()
   return myTakingTimeStamps;
 }
 
+AREXPORT int ArSerialConnection::getPollFD()
+{
+  return myPort;
+}
+
 
 AREXPORT bool ArSerialConnection::getCTS()
 {
@@ -215,6 +215,7 @@ AREXPORT bool ArSerialConnection::close()
 {
   bool ret;
 
+  clearReadAhead();
   if (myPort == INVALID_HANDLE_VALUE)
     return true;
 
@@ -392,6 +393,12 @@ AREXPORT bool ArSerialConnection::isTimeStamping()
   return false;
 }
 
+/// There is no file descriptor to wait on for a windows serial port
+AREXPORT int ArSerialConnection::getPollFD()
+{
+  return -1;
+}
+
 AREXPORT ArTime ArSerialConnection::getTimeRead(int index)
 {
   ArTime now;
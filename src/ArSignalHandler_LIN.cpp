@@ -40,6 +40,11 @@ void ArSignalHandler::signalCB(int sig)
   ArLog::log(ArLog::Verbose,
 	     "ArSignalHandler::runThread: Received signal '%s' Number %d ",
 	     ourSigMap[sig].c_str(), sig);
+  // the program is likely about to die, so write out anything still
+  // queued by ArLog::setAsync(), without waiting on anything that might
+  // have been held when the signal came
+  if (sig == SigSEGV || sig == SigFPE)
+    ArLog::flushFromSignal();
   for (iter=ourHandlerList.begin(); iter != ourHandlerList.end(); ++iter)
     (*iter)->invoke(sig);
   if (ourHandlerList.begin() == ourHandlerList.end())
@@ -102,14 +102,13 @@ AREXPORT void ArSonarDevice::processReadings()
 
   // delete too-far readings
   myCumulativeBuffer.beginInvalidationSweep();
-  const std::list<ArPoseWithTime>& readingList = myCumulativeBuffer.getBuffer();
   const double rx = myRobot->getX();
   const double ry = myRobot->getY();
   // walk through the list and see if this makes any old readings bad
-  for (auto it = readingList.begin(); it != readingList.end(); ++it)
+  for (auto it = myCumulativeBuffer.getBegin(); it != myCumulativeBuffer.getEnd(); ++it)
   {
-    const double dx = it->getX() - rx;
-    const double dy = it->getY() - ry;
+    const double dx = it.getX() - rx;
+    const double dy = it.getY() - ry;
     if ((dx*dx + dy*dy) > (myFilterFarDist * myFilterFarDist)) 
       myCumulativeBuffer.invalidateReading(it);
   }
@@ -147,12 +146,11 @@ AREXPORT void ArSonarDevice::addReading(double x, double y, bool *wasAdded)
   if (dist2 < myMaxDistToKeepCumulative * myMaxDistToKeepCumulative)
   {
     myCumulativeBuffer.beginInvalidationSweep();
-    const std::list<ArPoseWithTime>& readingList = myCumulativeBuffer.getBuffer();
     // walk through the list and see if this makes any old readings bad
-    for (auto it = readingList.begin(); it != readingList.end(); ++it)
+    for (auto it = myCumulativeBuffer.getBegin(); it != myCumulativeBuffer.getEnd(); ++it)
     {
-      const double dx = it->getX() - x;
-      const double dy = it->getY() - y;
+      const double dx = it.getX() - x;
+      const double dy = it.getY() - y;
       if ((dx*dx + dy*dy) < (myFilterNearDist * myFilterNearDist)) 
         myCumulativeBuffer.invalidateReading(it);
     }
@@ -29,6 +29,7 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 
 #include "Aria/ariaOSDef.h"
 #include "Aria/ArSerialConnection.h"
+#include "Aria/ArDeviceReactor.h"
 #include "Aria/ariaInternal.h"
 #include <time.h>
 #include <assert.h>
@@ -61,7 +62,9 @@ AREXPORT ArSonarMTX::ArSonarMTX (int sonarBoardNum,
 	mySender(NULL),
 	myFirmwareVersion(0),
 	mySensorInterpTask (this, &ArSonarMTX::sensorInterp),
-	myAriaExitCB (this, &ArSonarMTX::disconnect)
+	myAriaExitCB (this, &ArSonarMTX::disconnect),
+	myReactor (NULL),
+	myReactorReadCB (this, &ArSonarMTX::reactorRead)
 {
 
 	mySonarMap.clear();
@@ -331,6 +334,8 @@ AREXPORT bool ArSonarMTX::disconnect ()
 
 	ArLog::log (ArLog::Normal, "%s: Disconnecting", getNameWithBoard());
 
+  if (myReactor != NULL && myConn != NULL)
+    myReactor->remConnection(myConn);
   if(myConn)
     myConn->close();
 
@@ -817,7 +822,7 @@ AREXPORT bool ArSonarMTX::blockingConnect (bool sendTracking, bool recvTracking
 
 				myLastReading.setToNow();
 
-				runAsync();
+				startReading();
 
 				return true;
 
@@ -906,12 +911,64 @@ AREXPORT bool ArSonarMTX::fakeConnect ()
 
 	myLastReading.setToNow();
 
-	runAsync();
+	startReading();
 
 	return true;
 
 }
 
+/**
+   Starts reading packets from the sonar, from the reactor if we have one
+   (falling back to our own thread if it can't read our connection), otherwise
+   from our own thread.
+**/
+void ArSonarMTX::startReading()
+{
+	if (myReactor != NULL) {
+		// the reactor reads whatever's there and calls us, so don't wait
+		// for partial packets
+		myReceiver->setPartialPacketTimeout(0);
+		if (myReactor->addConnection(myConn, &myReactorReadCB, 
+		                             getNameWithBoard()))
+			return;
+		myReceiver->setPartialPacketTimeout(100);
+		ArLog::log (ArLog::Normal,
+		            "%s: Could not be read from %s, using its own thread instead",
+		            getNameWithBoard(), myReactor->getName());
+	}
+	runAsync();
+}
+
+/**
+   Called from the reactor thread when there's new data on our connection
+   (and periodically), does what the loop in runThread() does but only with
+   the packets that have already been read.
+**/
+void ArSonarMTX::reactorRead()
+{
+	ArRobotPacket *packet;
+
+	while (myIsConnected && (packet = myReceiver->receivePacket (0)) != NULL) {
+		myPacketsMutex.lock();
+		myPackets.push_back (packet);
+		myPacketsMutex.unlock();
+		if (myRobot == NULL) // if no robot, then sensorinterp() won't be called as robot cycle task callback, so call it directly
+			sensorInterp();
+	}
+
+	// only disconnect if transducers are on - if they are off we'll get no
+	// packets
+	if (myIsConnected && myTransducersAreOn && checkLostConnection()) {
+		ArLog::log (ArLog::Terse,
+		            "%s::reactorRead()  Lost connection to the MTX sonar because of error.  Nothing received for %g seconds (greater than the timeout of %g).", getNameWithBoard(),
+		            myLastReading.secSince(),
+		            getConnectionTimeoutSeconds() );
+		myIsConnected = false;
+		myReactor->remConnection(myConn);
+		disconnectOnError();
+	}
+}
+
 AREXPORT const char * ArSonarMTX::getName () const
 {
 	return myName.c_str();
@@ -28,14 +28,55 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaUtil.h"
 #include "Aria/ArRobot.h"
 
+#include <string.h>
+#ifndef WIN32
+#include <errno.h>
+#include <time.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/mman.h>
+#endif
+
+/// Sleeps until the monotonic clock reaches @a usec (from ArUtil::getTimeUSec())
+static void syncLoopSleepUntilUSec(long long usec)
+{
+#ifndef WIN32
+  struct timespec ts;
+  ts.tv_sec = (time_t)(usec / 1000000LL);
+  ts.tv_nsec = (long)((usec % 1000000LL) * 1000);
+  // an absolute deadline, so being interrupted doesn't make us sleep long
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+#else
+  const long long left = usec - ArUtil::getTimeUSec();
+  if (left > 0)
+    ArUtil::sleep((unsigned int)((left + 999) / 1000));
+#endif
+}
+
+/// Stores @a val in @a max if it is bigger (only the loop thread stores)
+static void syncLoopStoreMax(std::atomic<long long> &max, long long val)
+{
+  if (val > max.load())
+    max.store(val);
+}
 
 AREXPORT ArSyncLoop::ArSyncLoop() :
   ArASyncTask(),
   myStopRunIfNotConnected(false),
-  myRobot(0)
+  myRobot(0),
+  myRealTime(false),
+  myRealTimePriority(0),
+  myCpuAffinity(-1),
+  myLockMemory(false),
+  myThreadSettingsChanged(false),
+  myPriorityApplied(false),
+  myAffinityApplied(false),
+  myMemoryLocked(false)
 {
   setThreadName("ArRobotSyncLoop");
   myInRun = false;
+  resetStats();
 }
 
 /* AREXPORT ArSyncLoop::~ArSyncLoop()
@@ -52,6 +93,188 @@ AREXPORT void ArSyncLoop::stopRunIfNotConnected(bool stopRun)
   myStopRunIfNotConnected = stopRun;
 }
 
+/**
+   In real-time mode, instead of sleeping for whatever is left of the
+   cycle in whole milliseconds, the loop sleeps until an absolute
+   deadline on the monotonic clock (with clock_nanosleep()), and each
+   deadline is the last one plus the cycle time.  Sleeping late or
+   rounding doesn't push the following cycles back, so the period
+   doesn't drift.  If the tasks run past a deadline the next cycle
+   starts right away and the deadlines start over from there.
+
+   This only matters when the loop does its own timing; when the cycle
+   is chained to the robot's SIPs (ArRobot::isCycleChained()) and the
+   robot is connected the packet handler does the timing.
+
+   On Windows this just sleeps until the deadline in milliseconds.
+**/
+AREXPORT void ArSyncLoop::setRealTime(bool realTime)
+{
+  myRealTime = realTime;
+}
+
+/**
+   The priority (1 to 99 on Linux) is set on the thread that runs the
+   loop, at the start of the next cycle (or when the loop starts).
+   Setting SCHED_FIFO needs root or CAP_SYS_NICE, if it can't be set a
+   warning is logged and the loop carries on at normal priority.
+   Setting 0 puts the thread back to normal scheduling.
+**/
+AREXPORT void ArSyncLoop::setRealTimePriority(int priority)
+{
+  myRealTimePriority = priority;
+  myThreadSettingsChanged = true;
+}
+
+/**
+   The thread that runs the loop is pinned to @a cpu at the start of the
+   next cycle (or when the loop starts).  Setting -1 lets it run on any
+   CPU again.  This is only supported on Linux.
+**/
+AREXPORT void ArSyncLoop::setCpuAffinity(int cpu)
+{
+  myCpuAffinity = cpu;
+  myThreadSettingsChanged = true;
+}
+
+/**
+   If this is set, all of the process's memory (current and future) is
+   locked into RAM with mlockall() at the start of the next cycle (or
+   when the loop starts), so the loop never waits on a page fault.
+   This affects the whole process, not just the loop.
+**/
+AREXPORT void ArSyncLoop::setLockMemory(bool lockMemory)
+{
+  myLockMemory = lockMemory;
+  myThreadSettingsChanged = true;
+}
+
+void ArSyncLoop::applyThreadSettings()
+{
+#ifndef WIN32
+  const int priority = myRealTimePriority;
+  if (priority > 0 || myPriorityApplied)
+  {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = (priority > 0) ? priority : 0;
+    const int ret = pthread_setschedparam(pthread_self(), 
+					  (priority > 0) ? SCHED_FIFO : SCHED_OTHER,
+					  &param);
+    if (ret != 0)
+      ArLog::log(ArLog::Normal, 
+		 "ArSyncLoop: Could not set SCHED_FIFO priority %d: %s", 
+		 priority, strerror(ret));
+    else
+    {
+      ArLog::log(ArLog::Verbose, "ArSyncLoop: Set %s priority %d", 
+		 (priority > 0) ? "SCHED_FIFO" : "normal", priority);
+      myPriorityApplied = (priority > 0);
+    }
+  }
+
+#ifdef __linux__
+  const int cpu = myCpuAffinity;
+  if (cpu >= 0 || myAffinityApplied)
+  {
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    if (cpu >= 0 && cpu < CPU_SETSIZE)
+      CPU_SET((size_t)cpu, &cpus);
+    else
+      for (int i = 0; i < CPU_SETSIZE; i++)
+	CPU_SET((size_t)i, &cpus);
+    const int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+    if (ret != 0)
+      ArLog::log(ArLog::Normal, "ArSyncLoop: Could not pin to CPU %d: %s", 
+		 cpu, strerror(ret));
+    else
+    {
+      ArLog::log(ArLog::Verbose, "ArSyncLoop: Pinned to CPU %d", cpu);
+      myAffinityApplied = (cpu >= 0);
+    }
+  }
+#else
+  if (myCpuAffinity >= 0)
+    ArLog::log(ArLog::Normal, 
+	       "ArSyncLoop: Setting the CPU affinity is not supported here");
+#endif
+
+  if (myLockMemory && !myMemoryLocked)
+  {
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) != 0)
+      ArLog::log(ArLog::Normal, "ArSyncLoop: Could not lock memory: %s", 
+		 strerror(errno));
+    else
+      myMemoryLocked = true;
+  }
+  else if (!myLockMemory && myMemoryLocked)
+  {
+    munlockall();
+    myMemoryLocked = false;
+  }
+#else
+  if (myRealTimePriority > 0 || myCpuAffinity >= 0 || myLockMemory)
+    ArLog::log(ArLog::Normal, 
+      "ArSyncLoop: Real-time priority, CPU affinity and memory locking are not supported on Windows");
+#endif
+}
+
+void ArSyncLoop::addCycleStats(long long periodUSec, long long overrunUSec,
+			       long long wakeLatenessUSec)
+{
+  myNumCycles++;
+  if (periodUSec >= 0 && myRobot != NULL)
+  {
+    long long error = periodUSec - (long long)myRobot->getCycleTime() * 1000;
+    if (error < 0)
+      error = -error;
+    myNumPeriods++;
+    myTotalPeriodErrorUSec += error;
+    syncLoopStoreMax(myMaxPeriodErrorUSec, error);
+  }
+  if (overrunUSec >= 0)
+  {
+    myNumOverruns++;
+    syncLoopStoreMax(myMaxOverrunUSec, overrunUSec);
+  }
+  if (wakeLatenessUSec >= 0)
+    syncLoopStoreMax(myMaxWakeLatenessUSec, wakeLatenessUSec);
+}
+
+AREXPORT double ArSyncLoop::getMeanPeriodErrorUSec() const
+{
+  const unsigned long long numPeriods = myNumPeriods.load();
+  if (numPeriods == 0)
+    return 0;
+  return (double)myTotalPeriodErrorUSec.load() / (double)numPeriods;
+}
+
+AREXPORT void ArSyncLoop::resetStats()
+{
+  myNumCycles = 0;
+  myNumPeriods = 0;
+  myNumOverruns = 0;
+  myMaxOverrunUSec = 0;
+  myMaxPeriodErrorUSec = 0;
+  myTotalPeriodErrorUSec = 0;
+  myMaxWakeLatenessUSec = 0;
+}
+
+AREXPORT void ArSyncLoop::logStats(ArLog::LogLevel level) const
+{
+  ArLog::log(level, 
+	     "ArSyncLoop: %llu cycles (%s, priority %d, cpu %d), %llu overruns (max %.3f ms over)",
+	     getNumCycles(), getRealTime() ? "real-time" : "not real-time",
+	     getRealTimePriority(), getCpuAffinity(), getNumOverruns(),
+	     (double)getMaxOverrunUSec() / 1000.0);
+  ArLog::log(level, 
+	     "ArSyncLoop: period error mean %.3f ms max %.3f ms, latest wakeup %.3f ms", 
+	     getMeanPeriodErrorUSec() / 1000.0,
+	     (double)getMaxPeriodErrorUSec() / 1000.0,
+	     (double)getMaxWakeLatenessUSec() / 1000.0);
+}
+
 AREXPORT void * ArSyncLoop::runThread(void *)
 {
   threadStarted();
@@ -63,6 +286,12 @@ AREXPORT void * ArSyncLoop::runThread(void *)
   ArTime lastLoop;
   bool firstLoop = true;
   bool warned = false;
+  // in microseconds (see ArUtil::getTimeUSec()), for the real-time mode and stats
+  long long cycleStart;
+  long long lastCycleStart = -1;
+  long long cycleEnd = -1;
+  long long cycleUSec;
+  bool realTime = false;
 
   if (!myRobot)
   {
@@ -76,8 +305,13 @@ AREXPORT void * ArSyncLoop::runThread(void *)
     return(0);
   }
 
+  myThreadSettingsChanged = false;
+  applyThreadSettings();
+
   while (myRunning)
   {
+    if (myThreadSettingsChanged.exchange(false))
+      applyThreadSettings();
 
     myRobot->lock();
     if (!firstLoop && !warned && !myRobot->getNoTimeWarningThisCycle() && 
@@ -85,12 +319,10 @@ AREXPORT void * ArSyncLoop::runThread(void *)
 	myRobot->getCycleWarningTime() > 0 && 
 	lastLoop.mSecSince() > (signed int) myRobot->getCycleWarningTime())
     {
-      ArLog::log(ArLog::Normal, 
- "Warning: ArRobot cycle took too long because the loop was waiting for lock.");
-      ArLog::log(ArLog::Normal,
-		 "\tThe cycle took %u ms, (%u ms normal %u ms warning)", 
-		 lastLoop.mSecSince(), myRobot->getCycleTime(), 
-		 myRobot->getCycleWarningTime());
+      ARLOG_THROTTLED(myLockWaitLogThrottle, ArLog::Normal, 
+ "Warning: ArRobot cycle took too long because the loop was waiting for lock. The cycle took %u ms, (%u ms normal %u ms warning)", 
+		      lastLoop.mSecSince(), myRobot->getCycleTime(), 
+		      myRobot->getCycleWarningTime());
     }
     myRobot->setNoTimeWarningThisCycle(false);
     firstLoop = false;
@@ -103,9 +335,21 @@ AREXPORT void * ArSyncLoop::runThread(void *)
                  "ArSyncLoop::runThread() error adding msecs (%i)",
                  myRobot->getCycleTime());
     }
+    cycleUSec = (long long)myRobot->getCycleTime() * 1000;
     myRobot->incCounter();
     myRobot->unlock();
 
+    cycleStart = ArUtil::getTimeUSec();
+    const long long periodUSec = 
+      (lastCycleStart >= 0) ? cycleStart - lastCycleStart : -1;
+    lastCycleStart = cycleStart;
+    // in real-time mode this cycle ends a cycle time after the last one
+    // was supposed to, not after it actually did (unless we just switched)
+    if (!myRealTime || !realTime || cycleEnd < 0)
+      cycleEnd = cycleStart;
+    realTime = myRealTime;
+    cycleEnd += cycleUSec;
+
     // note that all the stuff beyond here should maybe have a lock
     // but it should be okay because its just getting data
     myInRun = true;
@@ -128,14 +372,36 @@ AREXPORT void * ArSyncLoop::runThread(void *)
 	myRobot->getCycleWarningTime() > 0 && 
 	lastLoop.mSecSince() > (signed int) myRobot->getCycleWarningTime())
     {
-      ArLog::log(ArLog::Normal, 
+      ARLOG_THROTTLED(myTasksLogThrottle, ArLog::Normal, 
 	"Warning: ArRobot sync tasks too long at %u ms, (%u ms normal %u ms warning)", 
-		 lastLoop.mSecSince(), myRobot->getCycleTime(), 
-		 myRobot->getCycleWarningTime());
+		      lastLoop.mSecSince(), myRobot->getCycleTime(), 
+		      myRobot->getCycleWarningTime());
       warned = true;
     }
     
 
+    const long long tasksDone = ArUtil::getTimeUSec();
+    long long overrunUSec = -1;
+    long long wakeLatenessUSec = -1;
+    if (myRobot->isCycleChained() && myRobot->isConnected())
+    {
+      // the packet handler is doing the timing, so start the deadlines
+      // over if we go back to doing it
+      cycleEnd = -1;
+    }
+    else if (tasksDone >= cycleEnd)
+    {
+      overrunUSec = tasksDone - cycleEnd;
+      cycleEnd = -1;
+    }
+    else if (realTime)
+    {
+      syncLoopSleepUntilUSec(cycleEnd);
+      wakeLatenessUSec = ArUtil::getTimeUSec() - cycleEnd;
+      timeToSleep = 0;
+    }
+    addCycleStats(periodUSec, overrunUSec, wakeLatenessUSec);
+
     if (timeToSleep > 0)
     {
       ArUtil::sleep((unsigned int)timeToSleep);
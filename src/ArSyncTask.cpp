@@ -26,6 +26,113 @@ Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
 #include "Aria/ariaUtil.h"
 #include "Aria/ArSyncTask.h"
 #include "Aria/ArLog.h"
+#include "Aria/ArASyncTask.h"
+
+#include <stdio.h>
+
+/// The threads that help an ArSyncTask run its concurrent tasks
+/**
+   Each run() wakes all the workers up to take tasks from the task's
+   current group along with the calling thread, and returns once they
+   have all run out of tasks.
+
+   @internal
+**/
+class ArSyncTaskWorkers
+{
+public:
+  ArSyncTaskWorkers(const char *name, unsigned int numWorkers);
+  ~ArSyncTaskWorkers();
+  unsigned int getNumWorkers() const { return (unsigned int)myWorkers.size(); }
+  void run(ArSyncTask *task);
+protected:
+  class Worker : public ArASyncTask
+  {
+  public:
+    Worker(ArSyncTaskWorkers *workers) : myWorkers(workers) {}
+    virtual void *runThread(void *) override 
+      { threadStarted(); myWorkers->work(); threadFinished(); return NULL; }
+  protected:
+    ArSyncTaskWorkers *myWorkers;
+  };
+  void work();
+
+  std::vector<Worker *> myWorkers;
+  std::mutex myMutex;
+  std::condition_variable myStartCond;
+  std::condition_variable myDoneCond;
+  ArSyncTask *myTask;
+  unsigned long myGeneration;
+  size_t myNumBusy;
+  bool myStopping;
+};
+
+ArSyncTaskWorkers::ArSyncTaskWorkers(const char *name, 
+				     unsigned int numWorkers) :
+  myTask(NULL),
+  myGeneration(0),
+  myNumBusy(0),
+  myStopping(false)
+{
+  for (unsigned int i = 0; i < numWorkers; i++)
+  {
+    Worker *worker = new Worker(this);
+    std::string threadName = name;
+    threadName += " worker";
+    worker->setThreadName(threadName.c_str());
+    worker->create(true, false);
+    myWorkers.push_back(worker);
+  }
+}
+
+ArSyncTaskWorkers::~ArSyncTaskWorkers()
+{
+  {
+    std::lock_guard<std::mutex> lock(myMutex);
+    myStopping = true;
+  }
+  myStartCond.notify_all();
+  for (auto it = myWorkers.begin(); it != myWorkers.end(); ++it)
+  {
+    (*it)->join();
+    delete *it;
+  }
+}
+
+void ArSyncTaskWorkers::run(ArSyncTask *task)
+{
+  {
+    std::lock_guard<std::mutex> lock(myMutex);
+    myTask = task;
+    myGeneration++;
+    myNumBusy = myWorkers.size();
+  }
+  myStartCond.notify_all();
+  task->runGroupTasks();
+  std::unique_lock<std::mutex> lock(myMutex);
+  myDoneCond.wait(lock, [this] { return myNumBusy == 0; });
+  myTask = NULL;
+}
+
+void ArSyncTaskWorkers::work()
+{
+  unsigned long seen = 0;
+  std::unique_lock<std::mutex> lock(myMutex);
+  while (true)
+  {
+    myStartCond.wait(lock, [this, &seen] 
+		     { return myStopping || myGeneration != seen; });
+    if (myStopping)
+      return;
+    seen = myGeneration;
+    ArSyncTask *task = myTask;
+    lock.unlock();
+    task->runGroupTasks();
+    lock.lock();
+    if (--myNumBusy == 0)
+      myDoneCond.notify_all();
+  }
+}
 
 /**
    New should never be called to create an ArSyncTask except to create the 
@@ -39,6 +146,14 @@ AREXPORT ArSyncTask::ArSyncTask(const char *name, ArFunctor *functor,
   myFunctor = functor;
   myParent = parent;
   myIsDeleting = false;
+  myRunning = false;
+  myInvokingOtherFunctor = NULL;
+  myPlanDirty = true;
+  myConcurrent = false;
+  myWorkers = NULL;
+  myGroupNext = 0;
+  myGroupEnd = 0;
+  myGroupWarningTime = 0;
   setState(ArTaskState::INIT);
   if (myParent != NULL)
   {
@@ -60,6 +175,8 @@ AREXPORT ArSyncTask::ArSyncTask(const char *name, ArFunctor *functor,
 AREXPORT ArSyncTask::~ArSyncTask()
 {
   myIsDeleting = true;
+  delete myWorkers;
+  myWorkers = NULL;
   if (myParent != NULL && !myParent->isDeleting())
     myParent->remove(this);
   
@@ -188,6 +305,7 @@ AREXPORT void ArSyncTask::addNewBranch(const char *nameOfNew, int position,
 {
   ArSyncTask *proc = new ArSyncTask(nameOfNew, NULL, state, this);
   myMultiMap.insert(std::pair<int, ArSyncTask *>(position, proc));
+  invalidatePlan();
 }
 
 /**
@@ -209,6 +327,7 @@ AREXPORT void ArSyncTask::addNewLeaf(const char *nameOfNew, int position,
 {
   ArSyncTask *proc = new ArSyncTask(nameOfNew, functor, state, this);
   myMultiMap.insert(std::pair<int, ArSyncTask *>(position, proc));
+  invalidatePlan();
 }
 
 AREXPORT void ArSyncTask::remove(ArSyncTask *proc)
@@ -220,6 +339,7 @@ AREXPORT void ArSyncTask::remove(ArSyncTask *proc)
     if ((*it).second == proc)
     {
       myMultiMap.erase(it);
+      invalidatePlan();
       return;
     }
   }
@@ -235,25 +355,169 @@ AREXPORT ArFunctor *ArSyncTask::getFunctor()
   return myFunctor;
 }
 
+void ArSyncTask::invalidatePlan()
+{
+  for (ArSyncTask *task = this; task != NULL; task = task->myParent)
+    task->myPlanDirty = true;
+}
+
+void ArSyncTask::compilePlan()
+{
+  // cleared first, so changes made while compiling aren't lost
+  myPlanDirty = false;
+  myPlan.clear();
+  myPlanDeps.clear();
+  addToPlan(this);
+  myPlanDone = std::vector<std::atomic<bool> >(myPlan.size());
+}
+
+void ArSyncTask::addToPlan(ArSyncTask *task)
+{
+  const size_t index = myPlan.size();
+  PlanEntry entry;
+  entry.myTask = task;
+  entry.myFunctor = task->myFunctor;
+  if (task->myStatePointer != NULL)
+    entry.myState = task->myStatePointer;
+  else
+    entry.myState = &task->myState;
+  entry.myEnd = index + 1;
+  entry.myGroupEnd = 0;
+  entry.myDepsBegin = myPlanDeps.size();
+  entry.myDepsEnd = myPlanDeps.size();
+  myPlan.push_back(entry);
+
+  // concurrent leaves next to each other go in together as a group
+  std::vector<ArSyncTask *> group;
+  for (auto it = task->myMultiMap.rbegin(); it != task->myMultiMap.rend(); ++it)
+  {
+    ArSyncTask *child = (*it).second;
+    if (child->myConcurrent && child->myMultiMap.empty())
+    {
+      group.push_back(child);
+      continue;
+    }
+    addGroupToPlan(group);
+    group.clear();
+    addToPlan(child);
+  }
+  addGroupToPlan(group);
+  myPlan[index].myEnd = myPlan.size();
+}
+
 /**
-   If this node is a leaf it calls the functor for the node, if it is
-   a branch it goes through all of the children in the order of
-   highest position to lowest position and calls run on them.
+   The tasks go in in the order they would normally run, except that a
+   task that depends on others is held back until they're in.  If the
+   dependencies go in a circle the rest go in in their normal order
+   (with a warning), and dependencies on tasks that aren't in the group
+   are ignored.
 **/
-AREXPORT void ArSyncTask::run()
+void ArSyncTask::addGroupToPlan(const std::vector<ArSyncTask *> &group)
 {
-  myRunning = true;
+  if (group.empty())
+    return;
+  const size_t first = myPlan.size();
+  std::vector<bool> added(group.size(), false);
+  size_t numAdded = 0;
+  while (numAdded < group.size())
+  {
+    size_t next = group.size();
+    for (size_t i = 0; i < group.size() && next == group.size(); i++)
+    {
+      if (added[i])
+	continue;
+      bool ready = true;
+      for (auto dep = group[i]->myDependencies.begin(); 
+	   ready && dep != group[i]->myDependencies.end(); ++dep)
+	for (size_t j = 0; j < group.size(); j++)
+	  if (!added[j] && j != i && group[j]->myName == *dep)
+	    ready = false;
+      if (ready)
+	next = i;
+    }
+    if (next == group.size())
+    {
+      for (next = 0; added[next]; next++)
+	;
+      ArLog::log(ArLog::Normal, 
+		 "ArSyncTask: Task '%s' is part of a circle of dependencies, running it anyway",
+		 group[next]->myName.c_str());
+    }
+    added[next] = true;
+    numAdded++;
+    addToPlan(group[next]);
+  }
 
-  const ArTaskState::State state = getState();
+  // now that everything is in, note where the dependencies ended up
+  for (size_t i = first; i < myPlan.size(); i++)
+  {
+    ArSyncTask *task = myPlan[i].myTask;
+    myPlan[i].myDepsBegin = myPlanDeps.size();
+    for (auto dep = task->myDependencies.begin(); 
+	 dep != task->myDependencies.end(); ++dep)
+      for (size_t j = first; j < i; j++)
+	if (myPlan[j].myTask->myName == *dep)
+	  myPlanDeps.push_back(j);
+    myPlan[i].myDepsEnd = myPlanDeps.size();
+  }
+  myPlan[first].myGroupEnd = myPlan.size();
+}
 
-  switch (state) 
+/**
+   Finds the first task from index @a next on in @a oldPlan that is
+   also in the new plan.  Tasks in the old plan may have been deleted,
+   so they're only compared, never used.
+   @return the index of the task in the new plan, or the end of the new
+   plan if there aren't any
+**/
+size_t ArSyncTask::findInPlan(const std::vector<PlanEntry> &oldPlan, 
+			      size_t next)
+{
+  for (; next < oldPlan.size(); next++)
+    for (size_t i = 0; i < myPlan.size(); i++)
+      if (myPlan[i].myTask == oldPlan[next].myTask)
+	return i;
+  return myPlan.size();
+}
+
+/**
+   The task at @a index in the old plan just added or removed tasks
+   (maybe even itself), so this compiles the plan again and finds where
+   to carry on in the new one: right after that task if it's still
+   there, otherwise at the next task after it (and its children) in the
+   old plan that is still there.
+   @return the index in the new plan to carry on from
+**/
+size_t ArSyncTask::replan(size_t index, long long tookUSec)
+{
+  std::vector<PlanEntry> oldPlan;
+  oldPlan.swap(myPlan);
+  compilePlan();
+  
+  for (size_t i = 0; i < myPlan.size(); i++)
+  {
+    if (myPlan[i].myTask == oldPlan[index].myTask)
+    {
+      myPlan[i].myTask->myRunTimes.add(tookUSec);
+      return i + 1;
+    }
+  }
+  return findInPlan(oldPlan, oldPlan[index].myEnd);
+}
+
+/**
+   @return how long the task took to run in microseconds, or -1 if it
+   wasn't run because it isn't running (see getState())
+**/
+long long ArSyncTask::runPlanTask(size_t index, long warningTime)
+{
+  const PlanEntry &entry = myPlan[index];
+  switch (*entry.myState) 
   {
   case ArTaskState::SUSPEND:
   case ArTaskState::SUCCESS:
   case ArTaskState::FAILURE:
-    // The task isn't running so just return  
-    myRunning = true;
-    return;
+    return -1;
   case ArTaskState::INIT:
   case ArTaskState::RESUME:
   case ArTaskState::ACTIVE:
@@ -261,27 +525,187 @@ AREXPORT void ArSyncTask::run()
     break;
   }
 
-  ArTime runTime;
-  if (myFunctor != NULL)
-    myFunctor->invoke();
-  const long took = runTime.mSecSince();
-  assert(took >= 0);
-  long warningTime = 0;
-  if (myNoTimeWarningCB != NULL && !myNoTimeWarningCB->invokeR() && 
-      myFunctor != NULL && myWarningTimeCB != NULL &&
-      myWarningTimeCB->invokeR() > 0 && 
-      (took > (warningTime = (long) myWarningTimeCB->invokeR())) )
-    ArLog::log(ArLog::Normal, 
-	       "Warning: Task '%s' took %ld ms to run (longer than the %ld warning time)",
-	       myName.c_str(), took, warningTime);
-  
+  ArSyncTask *task = entry.myTask;
+  const long long start = ArUtil::getTimeUSec();
+  entry.myFunctor->invoke();
+  const long long tookUSec = ArUtil::getTimeUSec() - start;
   
-  for (auto it = myMultiMap.rbegin(); it != myMultiMap.rend(); ++it)
+  // if the task added or removed tasks it may have deleted itself, so
+  // leave it alone (run() will sort it out)
+  if (myPlanDirty)
+    return tookUSec;
+  task->myRunTimes.add(tookUSec);
+  if (warningTime > 0 && tookUSec > warningTime * 1000LL &&
+      myNoTimeWarningCB != NULL && !myNoTimeWarningCB->invokeR())
+    ArLog::log(ArLog::Normal, 
+	       "Warning: Task '%s' took %lld ms to run (longer than the %ld warning time)",
+	       task->myName.c_str(), tookUSec / 1000, warningTime);
+  return tookUSec;
+}
+
+/**
+   If this node is a leaf it calls the functor for the node, if it is
+   a branch it goes through all of the children in the order of
+   highest position to lowest position and calls run on them.
+
+   This goes through the tree as flattened by compilePlan() (recompiling
+   it first if tasks were added or removed since the last run), calling
+   each task's functor and skipping the tasks (and their children) that
+   aren't running.  Groups of concurrent tasks are run on the worker
+   threads, if there are any.
+**/
+AREXPORT void ArSyncTask::run()
+{
+  myRunning = true;
+  if (myPlanDirty)
+    compilePlan();
+
+  long warningTime = 0;
+  if (myWarningTimeCB != NULL)
+    warningTime = (long) myWarningTimeCB->invokeR();
+
+  size_t i = 0;
+  while (i < myPlan.size())
   {
-    myInvokingOtherFunctor = (*it).second;
-    myInvokingOtherFunctor->run();
+    const PlanEntry &entry = myPlan[i];
+    if (entry.myGroupEnd > i + 1 && myWorkers != NULL)
+    {
+      const size_t groupEnd = entry.myGroupEnd;
+      myInvokingOtherFunctor = entry.myTask->myParent;
+      runGroup(i, groupEnd, warningTime);
+      myInvokingOtherFunctor = NULL;
+      if (myPlanDirty)
+      {
+	std::vector<PlanEntry> oldPlan;
+	oldPlan.swap(myPlan);
+	compilePlan();
+	i = findInPlan(oldPlan, groupEnd);
+      }
+      else
+	i = groupEnd;
+      continue;
+    }
+    switch (*entry.myState) 
+    {
+    case ArTaskState::SUSPEND:
+    case ArTaskState::SUCCESS:
+    case ArTaskState::FAILURE:
+      // The task isn't running so skip it and its children
+      i = entry.myEnd;
+      continue;
+    case ArTaskState::INIT:
+    case ArTaskState::RESUME:
+    case ArTaskState::ACTIVE:
+    default:
+      break;
+    }
+    if (entry.myFunctor == NULL)
+    {
+      i++;
+      continue;
+    }
+
+    myInvokingOtherFunctor = entry.myTask;
+    const long long tookUSec = runPlanTask(i, warningTime);
+    myInvokingOtherFunctor = NULL;
+    if (myPlanDirty)
+      i = replan(i, tookUSec);
+    else
+      i++;
   }
-  myInvokingOtherFunctor = NULL;
+  myRunning = false;
+}
+
+void ArSyncTask::runGroup(size_t first, size_t end, long warningTime)
+{
+  for (size_t i = first; i < end; i++)
+    myPlanDone[i].store(false);
+  myGroupEnd = end;
+  myGroupWarningTime = warningTime;
+  myGroupNext.store(first);
+  myWorkers->run(this);
+}
+
+/**
+   The threads take the tasks in the group in order, so the tasks a
+   task depends on have always been taken (and will finish) by the time
+   it waits for them.
+**/
+void ArSyncTask::runGroupTasks()
+{
+  size_t i;
+  while ((i = myGroupNext.fetch_add(1)) < myGroupEnd)
+  {
+    const PlanEntry &entry = myPlan[i];
+    if (entry.myDepsBegin != entry.myDepsEnd)
+    {
+      std::unique_lock<std::mutex> lock(myGroupMutex);
+      for (size_t d = entry.myDepsBegin; d < entry.myDepsEnd; d++)
+      {
+	const size_t dep = myPlanDeps[d];
+	myGroupCond.wait(lock, [this, dep] { return myPlanDone[dep].load(); });
+      }
+    }
+    runPlanTask(i, myGroupWarningTime);
+    {
+      std::lock_guard<std::mutex> lock(myGroupMutex);
+      myPlanDone[i].store(true);
+    }
+    myGroupCond.notify_all();
+  }
+}
+
+/**
+   Concurrent leaves are only run at the same time if they're next to
+   each other in their parent's list and the node run() is called on
+   has worker threads (see setNumWorkers()).  A leaf's functor has to
+   be safe to call at the same time as the others in its group, and it
+   must not add or remove tasks.
+**/
+AREXPORT void ArSyncTask::setConcurrent(bool concurrent)
+{
+  myConcurrent = concurrent;
+  invalidatePlan();
+}
+
+/**
+   When this task and the task named @a name are in the same group of
+   concurrent tasks, this task won't start until that one is done.
+   Otherwise this has no effect.
+**/
+AREXPORT void ArSyncTask::addDependency(const char *name)
+{
+  myDependencies.push_back(name);
+  invalidatePlan();
+}
+
+AREXPORT void ArSyncTask::remDependency(const char *name)
+{
+  myDependencies.remove(name);
+  invalidatePlan();
+}
+
+/**
+   The workers run the concurrent tasks when run() is called on this
+   node (normally the root), along with the thread that called run().
+   With 0 workers (the default) concurrent tasks are run one at a time
+   like any other.
+**/
+AREXPORT void ArSyncTask::setNumWorkers(unsigned int numWorkers)
+{
+  if (myWorkers != NULL && myWorkers->getNumWorkers() == numWorkers)
+    return;
+  delete myWorkers;
+  myWorkers = NULL;
+  if (numWorkers > 0)
+    myWorkers = new ArSyncTaskWorkers(myName.c_str(), numWorkers);
+}
+
+AREXPORT unsigned int ArSyncTask::getNumWorkers() const
+{
+  if (myWorkers == NULL)
+    return 0;
+  return myWorkers->getNumWorkers();
 }
 
 /**
@@ -329,11 +753,21 @@ AREXPORT ArRetFunctor<bool> *ArSyncTask::getNoTimeWarningCB()
 }
 
 
+AREXPORT void ArSyncTask::resetRunTimes()
+{
+  myRunTimes.reset();
+  for (auto it = myMultiMap.begin(); it != myMultiMap.end(); ++it)
+    (*it).second->resetRunTimes();
+}
+
 /**
    Prints the node... the defaulted depth parameter controls how far over to 
    print the data (how many tabs)... it recurses down all its children.
+   If @a runTimes is true, each task that has a functor also gets how
+   many times it was run and how long that took (min, mean, 99th
+   percentile and max, in microseconds).
 */
-AREXPORT void ArSyncTask::log(int depth)
+AREXPORT void ArSyncTask::log(int depth, bool runTimes)
 {
   int i;
   std::multimap<int, ArSyncTask *>::reverse_iterator it;
@@ -370,9 +804,19 @@ AREXPORT void ArSyncTask::log(int depth)
     str += ", running)";
     break;
   }
+  if (runTimes && myFunctor != NULL)
+  {
+    char buf[256];
+    snprintf(buf, sizeof(buf), 
+	     " %llu runs, min %lld us, mean %.1f us, 99%% <= %lld us, max %lld us",
+	     myRunTimes.getTotalCount(), myRunTimes.getMin(), 
+	     myRunTimes.getMean(), myRunTimes.getPercentile(99), 
+	     myRunTimes.getMax());
+    str += buf;
+  }
   ArLog::log(ArLog::Terse, const_cast<char *>(str.c_str()));
   for (it = myMultiMap.rbegin(); it != myMultiMap.rend(); it++)
-    (*it).second->log(depth + 1);
+    (*it).second->log(depth + 1, runTimes);
   
 }
 
@@ -382,10 +826,9 @@ AREXPORT ArSyncTask *ArSyncTask::getRunning()
 {
   if (!myRunning)
     return NULL;
+  // run() points this right at the task it is invoking
   else if (myInvokingOtherFunctor != NULL)
-    return myInvokingOtherFunctor->getRunning();
-  else if (myFunctor)
-    return this;
+    return myInvokingOtherFunctor;
   else
   {
     ArLog::log(ArLog::Normal, "ArSyncTask::getRunning: Tried to get running, but apparently nothing was running");
@@ -160,6 +160,7 @@ AREXPORT const char *ArTcpConnection::getOpenMessage(int messageNumber)
 AREXPORT bool ArTcpConnection::close()
 {
   myStatus = STATUS_CLOSED_NORMALLY;
+  clearReadAhead();
   return mySocket->close();
 }
 
@@ -170,8 +171,8 @@ AREXPORT int ArTcpConnection::read(const char *data, unsigned int size,
 
   if (getStatus() != STATUS_OPEN) 
   {
-    ArLog::log(ArLog::Terse, 
-	       "ArTcpConnection::read: Attempt to use port that is not open.");
+    ARLOG_THROTTLED(myReadLogThrottle, ArLog::Terse, 
+		    "ArTcpConnection::read: Attempt to use port that is not open.");
     return -1;
   }
 
@@ -193,8 +194,8 @@ AREXPORT int ArTcpConnection::read(const char *data, unsigned int size,
     // if the sockets empty don't read it, but pause some
     if (mySocket->getFD() < 0)
     {
-      ArLog::log(ArLog::Terse, 
-		 "ArTcpConnection::read: Attempt to read port that already closed. (%d)", timeToWait);
+      ARLOG_THROTTLED(myReadLogThrottle, ArLog::Terse, 
+		      "ArTcpConnection::read: Attempt to read port that already closed. (%ld)", timeToWait);
       if (timeToWait > 0)
         ArUtil::sleep(timeToWait);
       return -1;
@@ -232,14 +233,15 @@ AREXPORT int ArTcpConnection::write(const char *data, unsigned int size)
 
   if (getStatus() != STATUS_OPEN) 
   {
-    ArLog::log(ArLog::Terse, 
-	       "ArTcpConnection::write: Attempt to use port that is not open.");
+    ARLOG_THROTTLED(myWriteLogThrottle, ArLog::Terse, 
+		    "ArTcpConnection::write: Attempt to use port that is not open.");
     return -1;
   }
   if ((ret = mySocket->write(data, size)) != -1)
     return ret;
 
-  ArLog::log(ArLog::Terse, "ArTcpConnection::write: Write failed, closing connection.");
+  ARLOG_THROTTLED(myWriteLogThrottle, ArLog::Terse,
+		  "ArTcpConnection::write: Write failed, closing connection.");
   close();
   return -1;
 }
@@ -273,6 +275,13 @@ AREXPORT bool ArTcpConnection::isTimeStamping()
   return false;
 }
 
+AREXPORT int ArTcpConnection::getPollFD()
+{
+  if (myStatus != STATUS_OPEN || mySocket == NULL)
+    return -1;
+  return mySocket->getFD();
+}
+
 AREXPORT ArTime ArTcpConnection::getTimeRead(UNUSED int index)
 {
   return myTimeRead;
@@ -0,0 +1,152 @@
+/*
+Adept MobileRobots Robotics Interface for Applications (ARIA)
+Copyright (C) 2004-2005 ActivMedia Robotics LLC
+Copyright (C) 2006-2010 MobileRobots Inc.
+Copyright (C) 2011-2015 Adept Technology, Inc.
+Copyright (C) 2016-2018 Omron Adept Technologies, Inc.
+
+     This program is free software; you can redistribute it and/or modify
+     it under the terms of the GNU General Public License as published by
+     the Free Software Foundation; either version 2 of the License, or
+     (at your option) any later version.
+
+     This program is distributed in the hope that it will be useful,
+     but WITHOUT ANY WARRANTY; without even the implied warranty of
+     MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+     GNU General Public License for more details.
+
+     You should have received a copy of the GNU General Public License
+     along with this program; if not, write to the Free Software
+     Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+
+*/
+#include "Aria/ArExport.h"
+#include "Aria/ariaOSDef.h"
+#include "Aria/ArTimeHistogram.h"
+
+#include <string>
+#include <stdio.h>
+
+AREXPORT ArTimeHistogram::ArTimeHistogram()
+{
+  reset();
+}
+
+AREXPORT void ArTimeHistogram::reset()
+{
+  for (int i = 0; i < NUM_BUCKETS; i++)
+    myCounts[i].store(0, std::memory_order_relaxed);
+  myTotalCount.store(0, std::memory_order_relaxed);
+  mySum.store(0, std::memory_order_relaxed);
+  myMax.store(0, std::memory_order_relaxed);
+  myMin.store(0, std::memory_order_relaxed);
+}
+
+AREXPORT int ArTimeHistogram::getBucket(long long ms)
+{
+  int bucket = 0;
+  while (ms > 0 && bucket < NUM_BUCKETS - 1)
+  {
+    ms >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+AREXPORT long long ArTimeHistogram::getBucketLow(int bucket)
+{
+  if (bucket <= 0)
+    return 0;
+  if (bucket >= NUM_BUCKETS)
+    bucket = NUM_BUCKETS - 1;
+  return 1LL << (bucket - 1);
+}
+
+AREXPORT long long ArTimeHistogram::getBucketHigh(int bucket)
+{
+  if (bucket >= NUM_BUCKETS - 1)
+    return -1;
+  if (bucket <= 0)
+    return 0;
+  return (1LL << bucket) - 1;
+}
+
+AREXPORT void ArTimeHistogram::add(long long ms)
+{
+  if (ms < 0)
+    ms = 0;
+  myCounts[getBucket(ms)].fetch_add(1, std::memory_order_relaxed);
+  const unsigned long long before = 
+    myTotalCount.fetch_add(1, std::memory_order_relaxed);
+  mySum.fetch_add(ms, std::memory_order_relaxed);
+  // only one thread adds, so these don't need to be a compare and swap
+  if (ms > myMax.load(std::memory_order_relaxed))
+    myMax.store(ms, std::memory_order_relaxed);
+  if (before == 0 || ms < myMin.load(std::memory_order_relaxed))
+    myMin.store(ms, std::memory_order_relaxed);
+}
+
+AREXPORT double ArTimeHistogram::getMean() const
+{
+  const unsigned long long count = getTotalCount();
+  if (count == 0)
+    return 0;
+  return (double) mySum.load(std::memory_order_relaxed) / (double) count;
+}
+
+/**
+   Since the times are only kept by bucket, this is the top of the
+   bucket that the percentile falls in (or the largest time counted, if
+   that is less).
+
+   @param percent the percentile to get, from 0 to 100
+   @return the time in ms, or 0 if nothing has been counted
+**/
+AREXPORT long long ArTimeHistogram::getPercentile(double percent) const
+{
+  const unsigned long long total = getTotalCount();
+  if (total == 0)
+    return 0;
+  const double wanted = (double) total * percent / 100.0;
+  const long long maxTime = getMax();
+  unsigned long long sofar = 0;
+  for (int i = 0; i < NUM_BUCKETS; i++)
+  {
+    sofar += getCount(i);
+    if ((double) sofar >= wanted && sofar > 0)
+    {
+      const long long high = getBucketHigh(i);
+      if (high < 0 || high > maxTime)
+	return maxTime;
+      return high;
+    }
+  }
+  return maxTime;
+}
+
+AREXPORT void ArTimeHistogram::log(const char *name, 
+				   ArLog::LogLevel level) const
+{
+  ArLog::log(level, "%s: %llu counted, mean %.1f ms, 50%% <= %lld ms, 99%% <= %lld ms, max %lld ms",
+	     name, getTotalCount(), getMean(), getPercentile(50), 
+	     getPercentile(99), getMax());
+  std::string buckets;
+  char buf[64];
+  for (int i = 0; i < NUM_BUCKETS; i++)
+  {
+    const unsigned long long count = getCount(i);
+    if (count == 0)
+      continue;
+    if (getBucketHigh(i) < 0)
+      snprintf(buf, sizeof(buf), " %lld+:%llu", getBucketLow(i), count);
+    else if (getBucketHigh(i) == getBucketLow(i))
+      snprintf(buf, sizeof(buf), " %lld:%llu", getBucketLow(i), count);
+    else
+      snprintf(buf, sizeof(buf), " %lld-%lld:%llu", getBucketLow(i), 
+	       getBucketHigh(i), count);
+    buckets += buf;
+  }
+  if (!buckets.empty())
+    ArLog::log(level, "%s: ms:count%s", name, buckets.c_str());
+}
@@ -287,38 +287,44 @@ bool ArUrg::readLine(char *buf, unsigned int size,
   started.setToNow();
 
   buf[0] = '\0';
-  unsigned int onChar = 0;
-  int ret;
+  int found;
+  unsigned int scanned = 0;
 
   myConnMutex.lock();
-  while ((msWait == 0 || started.mSecSince() < (int)msWait) && 
-	 onChar < size)
+  // look for the end of the line in the read-ahead buffer, reading
+  // more in as needed (only the new data gets scanned)
+  while ((found = myConn->scanReadAheadAny("\n\r", scanned)) < 0)
   {
-    if ((ret = myConn->read(&buf[onChar], 1, 0)) > 0)
-    {
-      if (buf[onChar] == '\n' || 
-	  buf[onChar] == '\r')
-      {
-	//buf[onChar+1] = '\0';
-	buf[onChar] = '\0';
-	if (myLogMore)
-	  ArLog::log(ArLog::Normal, "%s: '%s'", getName(), buf);
-	myConnMutex.unlock();
-	return true;
-      }
-      onChar++;
-    }
-    if (ret < 0)
+    scanned = myConn->getReadAheadCount();
+    if (scanned >= size)
+      break;
+    long timeLeft = 10;
+    if (msWait != 0 && (timeLeft = (long)msWait - started.mSecSince()) <= 0)
+      break;
+    if (myConn->fillReadAhead((unsigned int) timeLeft) < 0)
     {
       ArLog::log(ArLog::Normal, "%s: bad ret", getName());
       myConnMutex.unlock();
       return false;
     }
-    if (ret == 0)
-      ArUtil::sleep(1);
   }
+  if (found < 0 || (unsigned int) found >= size)
+  {
+    // throw away a line that's too long for the buffer, but leave a
+    // partial line that's still coming in for the next call
+    if (myConn->getReadAheadCount() >= size)
+      myConn->consumeReadAhead(size);
+    myConnMutex.unlock();
+    return false;
+  }
+
+  memcpy(buf, myConn->getReadAheadData(), (size_t) found);
+  buf[found] = '\0';
+  myConn->consumeReadAhead((unsigned int) found + 1);
+  if (myLogMore)
+    ArLog::log(ArLog::Normal, "%s: '%s'", getName(), buf);
   myConnMutex.unlock();
-  return false;
+  return true;
 }
 
 bool ArUrg::sendCommandAndRecvStatus(
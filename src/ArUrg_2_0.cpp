@@ -34,7 +34,7 @@ AREXPORT ArUrg_2_0::ArUrg_2_0(int laserNumber, const char *name) :
   myAriaExitCB(this, &ArUrg_2_0::disconnect)
 {
   clear();
-  myRawReadings = NULL;
+  myRawReadings = myLaserReadings.getList();
 
   Aria::addExitCallback(&myAriaExitCB, -10);
 
@@ -96,13 +96,6 @@ AREXPORT ArUrg_2_0::~ArUrg_2_0()
     myRobot->remLaser(this);
     myRobot->remSensorInterpTask(&mySensorInterpTask);
   }
-  if (myRawReadings != NULL)
-  {
-    ArUtil::deleteSet(myRawReadings->begin(), myRawReadings->end());
-    myRawReadings->clear(); 
-    delete myRawReadings;
-    myRawReadings = NULL;
-  }
   lockDevice();
   if (isConnected())
     disconnect();
@@ -220,51 +213,35 @@ AREXPORT bool ArUrg_2_0::setParamsBySteps(int startingStep, int endingStep,
     //myClusterMiddleAngle = myClusterCount * 0.3515625 / 2.0;
     myClusterMiddleAngle = myClusterCount * myStepSize / 2.0;
 
-  if (myRawReadings != NULL)
-  {
-    ArUtil::deleteSet(myRawReadings->begin(), myRawReadings->end());
-    myRawReadings->clear();
-    delete myRawReadings;
-    myRawReadings = NULL;
-  }
-
-  myRawReadings = new std::list<ArSensorReading *>;
-  
+  setRays();
 
-  ArSensorReading *reading;
-  int onStep;
-  double angle;
+  myDataMutex.unlock();
+  return true;
+}
 
-  for (onStep = myStartingStep; 
-       onStep < myEndingStep; 
+/// Lays out the raw readings for the steps asked for, from the starting step on
+void ArUrg_2_0::setRays()
+{
+  int numReadings = 0;
+  for (int onStep = myStartingStep; onStep < myEndingStep; 
        onStep += myClusterCount)
+    numReadings++;
+  double start;
+  double increment;
+  if (!myFlipped)
   {
-    /// FLIPPED
-    if (!myFlipped)
-      //angle = ArMath::subAngle(ArMath::subAngle(135, 
-      //                                          onStep * 0.3515625),
-      angle = ArMath::subAngle(ArMath::subAngle(myStepFirst, 
-						onStep * myStepSize),
-			       myClusterMiddleAngle);
-    else
-      //angle = ArMath::addAngle(ArMath::addAngle(-135, 
-      //                                          onStep * 0.3515625), 
-      angle = ArMath::addAngle(ArMath::addAngle(-myStepFirst, 
-						onStep * myStepSize), 
-			       myClusterMiddleAngle);
-			       
-    reading = new ArSensorReading;
-    reading->resetSensorPosition(ArMath::roundInt(mySensorPose.getX()),
-				 ArMath::roundInt(mySensorPose.getY()),
-				 ArMath::addAngle(angle, 
-						  mySensorPose.getTh()));
-    myRawReadings->push_back(reading);
-    //printf("%.1f ", reading->getSensorTh());
+    start = myStepFirst - myStartingStep * myStepSize - myClusterMiddleAngle;
+    increment = -myClusterCount * myStepSize;
   }
-
-
-  myDataMutex.unlock();
-  return true;
+  else
+  {
+    start = -myStepFirst + myStartingStep * myStepSize + myClusterMiddleAngle;
+    increment = myClusterCount * myStepSize;
+  }
+  myLaserReadings.setRays((size_t)numReadings,
+			  ArMath::roundInt(mySensorPose.getX()),
+			  ArMath::roundInt(mySensorPose.getY()),
+			  start + mySensorPose.getTh(), increment);
 }
 
 void ArUrg_2_0::clear()
@@ -372,8 +349,8 @@ bool ArUrg_2_0::readLine(char *buf, unsigned int size,
   started.setToNow();
 
   buf[0] = '\0';
-  unsigned int onChar = 0;
-  int ret;
+  int found;
+  unsigned int scanned = 0;
 
   //long int rawCheckSum = 0;
   unsigned char rawCheckSum = 0;
@@ -382,68 +359,76 @@ bool ArUrg_2_0::readLine(char *buf, unsigned int size,
   unsigned int iMax;
 
   myConnMutex.lock();
-  while ((msWait == 0 || started.mSecSince() < (int)msWait) && 
-	 onChar < size)
+  // look for the end of the line in the read-ahead buffer, reading
+  // more in as needed (only the new data gets scanned)
+  while ((found = myConn->scanReadAheadAny("\n\r", scanned)) < 0)
   {
-    if ((ret = myConn->read(&buf[onChar], 1, 0)) > 0)
+    scanned = myConn->getReadAheadCount();
+    if (scanned >= size)
+      break;
+    long timeLeft = 10;
+    if (msWait != 0 && (timeLeft = (long)msWait - started.mSecSince()) <= 0)
+      break;
+    if (myConn->fillReadAhead((unsigned int) timeLeft) < 0)
     {
-      if (onChar == 0 && firstByte != NULL)
-	firstByte->setToNow();
-      if (buf[onChar] == '\n' || 
-	  buf[onChar] == '\r')
-      {
-	//buf[onChar+1] = '\0';
-	buf[onChar] = '\0';
-	if (!noChecksum && onChar >= 1)
-	{
-	  if (stripLastSemicolon &&
-	      onChar > 2 && buf[onChar - 2] == ';')
-	    iMax = onChar - 2;
-          else
-	    iMax = onChar - 1;
-
-	  // find the checksum 
-	  for (i = 0; i < iMax; i++)
-	    rawCheckSum += (unsigned char) buf[i];
-
-	  // see if it matches onChar - 1, then NULL out onchar -1
-	  checkSum = (char) ((rawCheckSum & 0x3f) + 0x30);
-	  
-	  if ((checkSum) != buf[onChar - 1])
-	  {
-	    ArLog::log(ArLog::Normal, 
-		       "%s: Bad checksum on '%s' it should be %c", 
-		       getName(), buf, checkSum);
-	    myConnMutex.unlock();
-	    return false;
-	  }
-	  // null out the checksum so it doesn't mess up other parsing
-	  buf[onChar - 1] = '\0';
-
-	  if (stripLastSemicolon &&
-	      onChar >= 2 && buf[onChar - 2] == ';')
-	  {
-	    buf[onChar - 2] = '\0';
-	  }
-	}
-	if (myLogMore)
-	  ArLog::log(ArLog::Normal, "%s: '%s'", getName(), buf);
-	myConnMutex.unlock();
-	return true;
-      }
-      onChar++;
+      ArLog::log(ArLog::Normal, "%s: bad ret", getName());
+      myConnMutex.unlock();
+      return false;
     }
-    if (ret < 0)
+  }
+  if (found < 0 || (unsigned int) found >= size)
+  {
+    // throw away a line that's too long for the buffer, but leave a
+    // partial line that's still coming in for the next call
+    if (myConn->getReadAheadCount() >= size)
+      myConn->consumeReadAhead(size);
+    myConnMutex.unlock();
+    return false;
+  }
+
+  const unsigned int onChar = (unsigned int) found;
+  if (firstByte != NULL)
+    *firstByte = myConn->getReadAheadTimeRead();
+  memcpy(buf, myConn->getReadAheadData(), onChar);
+  buf[onChar] = '\0';
+  myConn->consumeReadAhead(onChar + 1);
+
+  if (!noChecksum && onChar >= 1)
+  {
+    if (stripLastSemicolon &&
+	onChar > 2 && buf[onChar - 2] == ';')
+      iMax = onChar - 2;
+    else
+      iMax = onChar - 1;
+
+    // find the checksum 
+    for (i = 0; i < iMax; i++)
+      rawCheckSum += (unsigned char) buf[i];
+
+    // see if it matches onChar - 1, then NULL out onchar -1
+    checkSum = (char) ((rawCheckSum & 0x3f) + 0x30);
+	  
+    if ((checkSum) != buf[onChar - 1])
     {
-      ArLog::log(ArLog::Normal, "%s: bad ret", getName());
+      ArLog::log(ArLog::Normal, 
+		 "%s: Bad checksum on '%s' it should be %c", 
+		 getName(), buf, checkSum);
       myConnMutex.unlock();
       return false;
     }
-    if (ret == 0)
-      ArUtil::sleep(1);
+    // null out the checksum so it doesn't mess up other parsing
+    buf[onChar - 1] = '\0';
+
+    if (stripLastSemicolon &&
+	onChar >= 2 && buf[onChar - 2] == ';')
+    {
+      buf[onChar - 2] = '\0';
+    }
   }
+  if (myLogMore)
+    ArLog::log(ArLog::Normal, "%s: '%s'", getName(), buf);
   myConnMutex.unlock();
-  return false;
+  return true;
 }
 
 bool ArUrg_2_0::sendCommandAndRecvStatus(
@@ -885,9 +870,6 @@ void ArUrg_2_0::sensorInterp()
   unsigned int range;
   //int onStep;
 
-  std::list<ArSensorReading *>::reverse_iterator it;
-  ArSensorReading *sReading;
-  
   unsigned int iMax;
   unsigned int iIncr;
 
@@ -902,11 +884,17 @@ void ArUrg_2_0::sensorInterp()
     iIncr = 2;
   }
 
+  // picks up changes to the sensor position
+  setRays();
+
+  // the ranges go into the readings from the last one back
+  const size_t numReadings = myLaserReadings.getNumReadings();
   bool ignore;
   size_t i = 0;
-  for (it = myRawReadings->rbegin(), i = 0; 
-       it != myRawReadings->rend() && i < iMax; //len - 2; 
-       it++, i += iIncr) //3)
+  size_t onReading = 0;
+  for (i = 0; 
+       onReading < numReadings && i < iMax; //len - 2; 
+       onReading++, i += iIncr) //3)
   {
     ignore = false;
 
@@ -929,10 +917,10 @@ void ArUrg_2_0::sensorInterp()
     if (range < myDMin)
       range = myDMax+1;
 
-    sReading = (*it);
-    sReading->newData(range, pose, encoderPose, transform, counter, 
-		      time, ignore, 0);
+    myLaserReadings.setRange(numReadings - 1 - onReading, range, ignore, 0);
   }
+  myLaserReadings.project(numReadings - onReading, onReading, pose, 
+			  encoderPose, transform, counter, time);
 
   myDataMutex.unlock();
 
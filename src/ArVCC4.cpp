@@ -1483,7 +1483,7 @@ ArBasePacket* ArVCC4::readPacket()
   {
     // if we don't get any bytes, or if we've just exceeded the limit
     // then return null
-    if (myConn->read((char *)&byte,1,1) <= 0 ||
+    if (myConn->readBuffered((char *)&byte,1,1) <= 0 ||
 	num == MAX_RESPONSE_BYTES + 1)
       return NULL;
     else if (byte == ArVCC4Commands::RESPONSE)
@@ -1496,7 +1496,7 @@ ArBasePacket* ArVCC4::readPacket()
   // we got the header character so keep reading bytes for MAX_RESPONSE_BYTES more
   for(num=1;num<=MAX_RESPONSE_BYTES;num++)
   {
-    if (myConn->read((char *)&byte, 1, 1) <= 0)
+    if (myConn->readBuffered((char *)&byte, 1, 1) <= 0)
     {
       // there are no more bytes, so check the last byte for the footer
       if (data[num-1] != ArVCC4Commands::FOOTER)
@@ -376,6 +376,8 @@ AREXPORT void Aria::exit(int exitCode)
     return;
 
   callExitCallbacks();
+  // write out anything still queued by ArLog::setAsync()
+  ArLog::flush();
   ::exit(exitCode);
 }
 
@@ -211,6 +211,38 @@ AREXPORT unsigned int ArUtil::getTime()
 #endif
 }
 
+/**
+   Like getTime() this is only useful for comparing to other values
+   from getTimeUSec() in the same run of a program, but it isn't
+   truncated, and on Linux (with the monotonic clock) it has
+   microsecond resolution, so it can be used to time things that take
+   less than a millisecond.  On Windows QueryPerformanceCounter() is
+   used.
+   @return microsecond time
+*/
+AREXPORT long long ArUtil::getTimeUSec()
+{
+#if defined(_POSIX_TIMERS) && defined(_POSIX_MONOTONIC_CLOCK) && !defined(__MACH__)
+  struct timespec tp;
+  if (clock_gettime(CLOCK_MONOTONIC, &tp) == 0)
+    return (long long)tp.tv_sec * 1000000LL + tp.tv_nsec / 1000;
+ // else fall through to the old unix way as a fallback
+#endif
+#if !defined(_WIN32)
+  struct timeval tv;
+  if (gettimeofday(&tv,NULL) == 0)
+    return (long long)tv.tv_sec * 1000000LL + tv.tv_usec;
+  else return 0;
+#elif defined(_WIN32)
+  LARGE_INTEGER count, freq;
+  if (!QueryPerformanceCounter(&count) || !QueryPerformanceFrequency(&freq) ||
+      freq.QuadPart == 0)
+    return (long long)timeGetTime() * 1000LL;
+  return (long long)(count.QuadPart / freq.QuadPart * 1000000LL + 
+		     count.QuadPart % freq.QuadPart * 1000000LL / freq.QuadPart);
+#endif
+}
+
 /*
    Takes a string and splits it into a list of words. It appends the words
    to the outList. If there is nothing found, it will not touch the outList.
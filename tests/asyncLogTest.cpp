@@ -0,0 +1,193 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+
+// Turns on ArLog::setAsync() logging to a file and has several threads log
+// at once, checking that every message gets written (to the file and the
+// functor) with each thread's messages in order.  Then makes the functor
+// slow and checks that with DropWhenFull logging doesn't wait for it, and
+// that the dropped messages are counted, and that flushFromSignal() writes
+// out the queue without waiting for it.  Finally turns async back off and
+// checks that messages are written before log() returns again.
+
+const int NUM_THREADS = 4;
+const int NUM_MESSAGES = 2000;
+const char *FILE_NAME = "asyncLogTest.log";
+
+std::atomic<int> numDone(0);
+std::atomic<long> numSeen(0);
+int lastSeen[NUM_THREADS];
+long numOutOfOrder = 0;
+bool slow = false;
+
+// called with ArLog's mutex locked, so one at a time
+void seen(const char *message)
+{
+  if (slow)
+    ArUtil::sleep(2);
+  int thread, num;
+  if (sscanf(message, "asyncLogTest thread %d message %d", &thread, &num) != 2)
+    return;
+  numSeen++;
+  if (thread >= 0 && thread < NUM_THREADS)
+  {
+    if (num != lastSeen[thread] + 1)
+      numOutOfOrder++;
+    lastSeen[thread] = num;
+  }
+}
+
+class Logger : public ArASyncTask
+{
+public:
+  Logger(int num) : myNum(num) {}
+  virtual void *runThread(void *) override
+  {
+    for (int i = 0; i < NUM_MESSAGES; i++)
+      ArLog::log(ArLog::Normal, "asyncLogTest thread %d message %d", myNum, i);
+    numDone++;
+    return NULL;
+  }
+  int myNum;
+};
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  ArLog::init(ArLog::File, ArLog::Normal, FILE_NAME, false, false, false);
+  ArGlobalFunctor1<const char *> seenCB(&seen);
+  ArLog::setFunctor(&seenCB);
+  for (int i = 0; i < NUM_THREADS; i++)
+    lastSeen[i] = -1;
+
+  // everything gets through when logging waits for room
+  ArLog::setAsync(true, 256, ArLog::BlockWhenFull);
+  Logger *loggers[NUM_THREADS];
+  for (int i = 0; i < NUM_THREADS; i++)
+  {
+    loggers[i] = new Logger(i);
+    loggers[i]->runAsync();
+  }
+  while (numDone < NUM_THREADS)
+    ArUtil::sleep(10);
+  if (!ArLog::flush())
+  {
+    printf("FAILED: flush timed out\n");
+    failed = true;
+  }
+  printf("blocking: %ld of %d messages seen, %ld out of order, %lu dropped\n",
+	 numSeen.load(), NUM_THREADS * NUM_MESSAGES, numOutOfOrder,
+	 ArLog::getAsyncDropped());
+  if (numSeen != NUM_THREADS * NUM_MESSAGES || numOutOfOrder != 0 ||
+      ArLog::getAsyncDropped() != 0)
+  {
+    printf("FAILED: messages lost or out of order\n");
+    failed = true;
+  }
+
+  // a slow functor (standing in for a slow disk) doesn't slow down logging
+  ArLog::setAsync(true, 256, ArLog::DropWhenFull);
+  numSeen = 0;
+  lastSeen[0] = -1;
+  slow = true;
+  const long long started = ArUtil::getTimeUSec();
+  for (int i = 0; i < NUM_MESSAGES; i++)
+    ArLog::log(ArLog::Normal, "asyncLogTest thread 0 message %d", i);
+  const long long took = ArUtil::getTimeUSec() - started;
+  ArLog::flush(-1);
+  slow = false;
+  printf("dropping: logging %d messages took %.1f ms, %ld seen, %lu dropped\n",
+	 NUM_MESSAGES, (double)took / 1000.0, numSeen.load(), ArLog::getAsyncDropped());
+  // written one at a time it would take NUM_MESSAGES * 2 ms
+  if (took > NUM_MESSAGES * 2000 / 4 || ArLog::getAsyncDropped() == 0 ||
+      numSeen + (long)ArLog::getAsyncDropped() != NUM_MESSAGES)
+  {
+    printf("FAILED: logging waited on the functor or lost count of messages\n");
+    failed = true;
+  }
+
+  // as from a signal handler, the queue is written out right away even
+  // while the writer is stuck in the functor
+  const int numSignal = 30;
+  slow = true;
+  for (int i = 0; i < numSignal; i++)
+    ArLog::log(ArLog::Normal, "asyncLogTest signal message %d", i);
+  ArUtil::sleep(5);
+  const long long signalStarted = ArUtil::getTimeUSec();
+  ArLog::flushFromSignal();
+  const long long signalTook = ArUtil::getTimeUSec() - signalStarted;
+  printf("signal: writing out the queue took %.1f ms\n",
+	 (double)signalTook / 1000.0);
+  if (signalTook > numSignal * 2000 / 3 || ArLog::isAsync())
+  {
+    printf("FAILED: flushFromSignal() waited on the writer or left async on\n");
+    failed = true;
+  }
+  ArLog::flush(-1);
+  slow = false;
+
+  // back to writing each message as it's logged
+  ArLog::setAsync(false);
+  if (ArLog::isAsync())
+  {
+    printf("FAILED: still async\n");
+    failed = true;
+  }
+  numSeen = 0;
+  ArLog::log(ArLog::Normal, "asyncLogTest thread 1 message %d", NUM_MESSAGES);
+  if (numSeen != 1)
+  {
+    printf("FAILED: message wasn't written before log() returned\n");
+    failed = true;
+  }
+
+  ArLog::clearFunctor();
+  ArLog::init(ArLog::StdOut, ArLog::Normal, "", false, false, false);
+  long numLines = 0;
+  bool signalLines[numSignal] = { false };
+  FILE *file = ArUtil::fopen(FILE_NAME, "r");
+  char line[1024];
+  int num;
+  while (file != NULL && fgets(line, sizeof(line), file) != NULL)
+  {
+    if (strncmp(line, "asyncLogTest thread", 19) == 0)
+      numLines++;
+    // these can be in there twice, from the writer and flushFromSignal()
+    else if (sscanf(line, "asyncLogTest signal message %d", &num) == 1 &&
+	     num >= 0 && num < numSignal)
+      signalLines[num] = true;
+  }
+  if (file != NULL)
+    fclose(file);
+  remove(FILE_NAME);
+  const long expectLines = NUM_THREADS * NUM_MESSAGES + NUM_MESSAGES -
+    (long)ArLog::getAsyncDropped() + 1;
+  printf("%ld messages in the file, should be %ld\n", numLines, expectLines);
+  if (numLines != expectLines)
+  {
+    printf("FAILED: file is missing messages\n");
+    failed = true;
+  }
+  for (int i = 0; i < numSignal; i++)
+  {
+    if (!signalLines[i])
+    {
+      printf("FAILED: message %d written by flushFromSignal() isn't in the file\n", i);
+      failed = true;
+      break;
+    }
+  }
+
+  if (failed)
+  {
+    printf("asyncLogTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("asyncLogTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
@@ -0,0 +1,73 @@
+#include "Aria/Aria.h"
+#include "Aria/ArChecksum.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Times the ArChecksum kernels with each implementation this processor
+// supports, and the CRC with slicing-by-8 against a byte at a time, for
+// packet sized and larger buffers.
+//
+// Usage: checksumBenchmark [ms per test]
+
+static volatile unsigned int sink;
+
+template<class Func>
+double megabytesPerSecond(Func func, const unsigned char *data, size_t len,
+                          long msecs)
+{
+  unsigned long long bytes = 0;
+  ArTime started;
+  do
+  {
+    for (int i = 0; i < 1000; i++)
+      sink += func(data, len);
+    bytes += len * 1000;
+  } while (started.mSecSince() < msecs);
+  return (double) bytes / 1000.0 / (double) started.mSecSince();
+}
+
+static unsigned int wordSum(const unsigned char *d, size_t n)
+  { return ArChecksum::wordSumBE(d, n); }
+static unsigned int xorFold(const unsigned char *d, size_t n)
+  { return ArChecksum::xorFold(d, n); }
+static unsigned int crc(const unsigned char *d, size_t n)
+  { return ArChecksum::crc16CCITT(d, n); }
+static unsigned int crcBytewise(const unsigned char *d, size_t n)
+  { return ArChecksum::crc16CCITTBytewise(d, n); }
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  const long msecs = (argc > 1) ? atol(argv[1]) : 200;
+  const size_t lens[] = { 64, 200, 1500, 65536 };
+  std::vector<unsigned char> buf(65536);
+  for (size_t i = 0; i < buf.size(); i++)
+    buf[i] = (unsigned char) rand();
+
+  const ArChecksum::Implementation best = ArChecksum::getImplementation();
+  const ArChecksum::Implementation impls[] = 
+    { ArChecksum::SCALAR, ArChecksum::SSE2, ArChecksum::AVX2 };
+  printf("%-10s %-8s %8s %12s\n", "kernel", "impl", "bytes", "MB/s");
+  for (size_t l = 0; l < sizeof(lens) / sizeof(lens[0]); l++)
+  {
+    for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); n++)
+    {
+      if (!ArChecksum::setImplementation(impls[n]))
+        continue;
+      const char *name = ArChecksum::getImplementationName(impls[n]);
+      printf("%-10s %-8s %8lu %12.1f\n", "wordSum", name, (unsigned long) lens[l],
+             megabytesPerSecond(wordSum, &buf[0], lens[l], msecs));
+      printf("%-10s %-8s %8lu %12.1f\n", "xorFold", name, (unsigned long) lens[l],
+             megabytesPerSecond(xorFold, &buf[0], lens[l], msecs));
+    }
+    printf("%-10s %-8s %8lu %12.1f\n", "crc16", "bytewise", (unsigned long) lens[l],
+           megabytesPerSecond(crcBytewise, &buf[0], lens[l], msecs));
+    printf("%-10s %-8s %8lu %12.1f\n", "crc16", "slice8", (unsigned long) lens[l],
+           megabytesPerSecond(crc, &buf[0], lens[l], msecs));
+  }
+  ArChecksum::setImplementation(best);
+  Aria::exit(0);
+  return 0;
+}
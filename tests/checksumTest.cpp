@@ -0,0 +1,168 @@
+#include "Aria/Aria.h"
+#include "Aria/ArChecksum.h"
+#include "Aria/ArRobotPacket.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+// Checks the ArChecksum kernels against the byte-at-a-time versions that
+// the packet classes and receivers used before (copied here), with every
+// implementation this processor supports, for lots of lengths and
+// alignments of random data.  Also checks the CRCs against the standard
+// check values.
+
+// what ArRobotPacket::calcCheckSum() did
+static uint16_t oldRobotChecksum(const unsigned char *buf, int n)
+{
+  int16_t c = 0;
+  int i = 0;
+  while (n > 1) {
+    c += (int16_t) ((buf[i]<<8) | buf[i+1]);
+    c = (int16_t) (c & 0xffff);
+    n -= 2;
+    i += 2;
+  }
+  if (n > 0) 
+    c = c ^ (int16_t) buf[i];
+  return (uint16_t) c;
+}
+
+// what ArS3SeriesPacketReceiver::CRC16() and ArSZSeriesPacketReceiver::CRC16()
+// did (with the table worked out instead of written out)
+static uint16_t oldCRC16(const unsigned char *data, int length, uint16_t crc)
+{
+  static uint16_t table[256];
+  static bool tableMade = false;
+  if (!tableMade)
+  {
+    for (int b = 0; b < 256; b++)
+    {
+      uint16_t c = (uint16_t) (b << 8);
+      for (int i = 0; i < 8; i++)
+        c = (uint16_t) ((c & 0x8000) ? ((c << 1) ^ 0x1021) : (c << 1));
+      table[b] = c;
+    }
+    tableMade = true;
+  }
+  for (int i = 0; i < length; i++)
+    crc = (uint16_t) ((crc << 8) ^ table[(crc >> 8) ^ data[i]]);
+  return crc;
+}
+
+// what ArLMS2xxPacket::calcCRC() did
+static uint16_t oldLMS2xxCRC(const unsigned char *commData, unsigned int uLen)
+{
+  unsigned short uCrc16;
+  unsigned char abData[2];
+
+  uCrc16 = 0;
+  abData[0] = 0;
+  while (uLen--)
+  {
+    abData[1] = abData[0];
+    abData[0] = *commData++;
+    if (uCrc16 & 0x8000)
+    {
+      uCrc16 = (unsigned short)((uCrc16 & 0x7fff) << 1);
+      uCrc16 ^= 0x8005;
+    }
+    else
+    {
+      uCrc16 <<= 1;
+    }
+    uCrc16 ^= (unsigned short)(abData[0] | (abData[1] << 8));
+  }
+  return uCrc16;
+}
+
+static unsigned char oldXor(const unsigned char *data, size_t len)
+{
+  unsigned char x = 0;
+  for (size_t i = 0; i < len; i++)
+    x ^= data[i];
+  return x;
+}
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  const unsigned char *check = (const unsigned char *) "123456789";
+  if (ArChecksum::crc16CCITT(check, 9, 0xffff) != 0x29b1 ||
+      ArChecksum::crc16CCITT(check, 9, 0) != 0x31c3)
+  {
+    printf("FAILED: CRC of \"123456789\" is 0x%x (0xffff) 0x%x (0)\n",
+           ArChecksum::crc16CCITT(check, 9, 0xffff),
+           ArChecksum::crc16CCITT(check, 9, 0));
+    failed = true;
+  }
+
+  const size_t MAX_LEN = 1100;
+  unsigned char buf[MAX_LEN + 8];
+  srand(1234);
+  for (size_t i = 0; i < sizeof(buf); i++)
+    buf[i] = (unsigned char) rand();
+
+  const ArChecksum::Implementation impls[] = 
+    { ArChecksum::SCALAR, ArChecksum::SSE2, ArChecksum::AVX2 };
+  const ArChecksum::Implementation best = ArChecksum::getImplementation();
+  printf("using %s\n", ArChecksum::getImplementationName(best));
+  for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); n++)
+  {
+    if (!ArChecksum::setImplementation(impls[n]))
+    {
+      printf("%s not supported\n", ArChecksum::getImplementationName(impls[n]));
+      continue;
+    }
+    unsigned long numChecked = 0;
+    for (size_t offset = 0; offset < 8; offset++)
+    {
+      for (size_t len = 0; len <= MAX_LEN; len++)
+      {
+        const unsigned char *data = buf + offset;
+        if (ArChecksum::wordSumBE(data, len) != oldRobotChecksum(data, (int) len) ||
+            ArChecksum::xorFold(data, len) != oldXor(data, len) ||
+            ArChecksum::crc16CCITT(data, len, 0xffff) != oldCRC16(data, (int) len, 0xffff) ||
+            ArChecksum::crc16CCITT(data, len, 0) != oldCRC16(data, (int) len, 0) ||
+            ArChecksum::crc16LMS2xx(data, len) != oldLMS2xxCRC(data, (unsigned int) len))
+        {
+          printf("FAILED: %s differs for %lu bytes at offset %lu\n",
+                 ArChecksum::getImplementationName(impls[n]),
+                 (unsigned long) len, (unsigned long) offset);
+          failed = true;
+        }
+        numChecked++;
+      }
+    }
+    printf("%s: checked %lu buffers\n", ArChecksum::getImplementationName(impls[n]),
+           numChecked);
+  }
+  ArChecksum::setImplementation(best);
+
+  // and through the packet class
+  ArRobotPacket packet;
+  for (int len = 0; len < 150; len++)
+  {
+    packet.empty();
+    packet.setID(0x32);
+    for (int i = 0; i < len; i++)
+      packet.uByteToBuf(buf[i]);
+    packet.finalizePacket();
+    if (!packet.verifyCheckSum())
+    {
+      printf("FAILED: robot packet with %d bytes doesn't verify\n", len);
+      failed = true;
+    }
+    packet.getBuf()[packet.getLength() - 3] ^= 0x10;
+    if (len > 0 && packet.verifyCheckSum())
+    {
+      printf("FAILED: corrupt robot packet with %d bytes verifies\n", len);
+      failed = true;
+    }
+  }
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
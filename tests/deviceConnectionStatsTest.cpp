@@ -0,0 +1,131 @@
+#include "Aria/Aria.h"
+#include "Aria/ArFileDeviceConnection.h"
+#include "Aria/ArRobotPacketReceiver.h"
+
+#include <stdio.h>
+
+// Frames robot packets out of a generated byte stream that has some garbage
+// between packets and some packets with bad checksums, and checks that the
+// connection's I/O statistics count every byte, good packet, bad checksum
+// and resync.  Also checks the bucketing of ArTimeHistogram.
+
+const int NUM_PACKETS = 1000;
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  // histogram buckets: 0, 1, 2-3, 4-7, ...
+  ArTimeHistogram hist;
+  const long long times[] = { 0, 1, 2, 3, 4, 7, 8, 100, 1000000 };
+  const int buckets[] = { 0, 1, 2, 2, 3, 3, 4, 7, ArTimeHistogram::NUM_BUCKETS - 1 };
+  for (size_t i = 0; i < sizeof(times) / sizeof(times[0]); i++)
+  {
+    hist.add(times[i]);
+    const int b = ArTimeHistogram::getBucket(times[i]);
+    if (b != buckets[i] || times[i] < ArTimeHistogram::getBucketLow(b) ||
+        (ArTimeHistogram::getBucketHigh(b) >= 0 && 
+         times[i] > ArTimeHistogram::getBucketHigh(b)))
+    {
+      printf("FAILED: %lld ms went in bucket %d (%lld to %lld)\n", times[i], b,
+             ArTimeHistogram::getBucketLow(b), ArTimeHistogram::getBucketHigh(b));
+      failed = true;
+    }
+  }
+  if (hist.getTotalCount() != 9 || hist.getMax() != 1000000 ||
+      hist.getPercentile(50) != 7 || hist.getPercentile(100) != 1000000)
+  {
+    printf("FAILED: histogram has %llu counted, max %lld, 50%% %lld, 100%% %lld\n",
+           hist.getTotalCount(), hist.getMax(), hist.getPercentile(50), 
+           hist.getPercentile(100));
+    failed = true;
+  }
+  hist.log("test histogram");
+
+  const char *filename = "deviceConnectionStatsTest.dat";
+  FILE *fp = ArUtil::fopen(filename, "wb");
+  if (fp == NULL)
+  {
+    printf("FAILED: could not create %s\n", filename);
+    Aria::exit(1);
+    return 1;
+  }
+  ArRobotPacket packet;
+  unsigned long long numBytes = 0;
+  int numGood = 0;
+  int numBad = 0;
+  int numResyncs = 0;
+  for (int i = 0; i < NUM_PACKETS; i++)
+  {
+    packet.empty();
+    packet.setID(0x32);
+    for (int j = 0; j < 10 + (i % 20); j++)
+      packet.byte2ToBuf((short)(i + j));
+    packet.finalizePacket();
+    // every 50th packet gets its checksum broken
+    if (i % 50 == 49)
+    {
+      packet.getBuf()[packet.getLength() - 1] ^= 0x55;
+      numBad++;
+    }
+    else
+      numGood++;
+    fwrite(packet.getBuf(), 1, packet.getLength(), fp);
+    numBytes += packet.getLength();
+    // some line noise every now and then
+    if (i % 100 == 0)
+    {
+      fwrite("\x01\x02\x03", 1, 3, fp);
+      numBytes += 3;
+      numResyncs++;
+    }
+  }
+  fclose(fp);
+
+  ArFileDeviceConnection conn;
+  if (conn.open(filename, "/dev/null") != 0)
+  {
+    printf("FAILED: could not open %s\n", filename);
+    Aria::exit(1);
+    return 1;
+  }
+  ArRobotPacketReceiver receiver(&conn);
+  int received = 0;
+  while (receiver.receivePacket(0) != NULL)
+    received++;
+  // the last receivePacket() hits the end of the file and fails
+  while (receiver.receivePacket(0) != NULL)
+    received++;
+
+  const ArDeviceConnectionStats *stats = conn.getIOStats();
+  conn.logIOStats();
+  if (received != numGood ||
+      stats->getGoodPackets() != (unsigned long long) numGood ||
+      stats->getBadPackets() != (unsigned long long) numBad ||
+      stats->getChecksumFailures() != (unsigned long long) numBad ||
+      stats->getResyncs() != (unsigned long long) numResyncs ||
+      stats->getBytesSkipped() != 3ULL * (unsigned long long) numResyncs ||
+      stats->getBytesRead() != numBytes ||
+      stats->getReads() != conn.getReadAheadReadCalls() ||
+      stats->getPacketSpan()->getTotalCount() != (unsigned long long) numGood ||
+      stats->getPacketInterval()->getTotalCount() != (unsigned long long) numGood - 1)
+  {
+    printf("FAILED: expected %llu bytes, %d good packets, %d bad and %d resyncs, received %d\n",
+           numBytes, numGood, numBad, numResyncs, received);
+    failed = true;
+  }
+
+  conn.resetIOStats();
+  if (stats->getBytesRead() != 0 || stats->getGoodPackets() != 0 ||
+      stats->getPacketSpan()->getTotalCount() != 0)
+  {
+    printf("FAILED: stats weren't reset\n");
+    failed = true;
+  }
+  conn.close();
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,209 @@
+#include "Aria/Aria.h"
+#include "Aria/ArDeviceReactor.h"
+#include "Aria/ArFileDeviceConnection.h"
+#include "Aria/ArRobotPacketReceiver.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Reads several pipes from one ArDeviceReactor thread.  A writer thread
+// writes numbered robot packets to each pipe in random sized pieces (so
+// packets are often split between reads), and each "device" frames them out
+// of its connection's read-ahead buffer from the reactor callback without
+// ever waiting for partial packets.  Checks that every packet arrives, in
+// order and intact, that the reactor doesn't spin once the writer has
+// hung up, and that a callback can remove other connections.
+
+const int NUM_DEVICES = 4;
+const int NUM_PACKETS = 2000;
+
+// the reactor the first device removes the others from, from its callback
+ArDeviceReactor *removingFrom = NULL;
+
+class Device
+{
+public:
+  Device() : myReadCB(this, &Device::read), myNumPackets(0), myLast(-1),
+             myFailed(false), myWriteFD(-1) {}
+  bool open(int num)
+  {
+    sprintf(myFifoName, "/tmp/deviceReactorTest.%d.%d", (int)getpid(), num);
+    unlink(myFifoName);
+    if (mkfifo(myFifoName, 0600) != 0)
+      return false;
+    // open the write end first (O_RDWR so it doesn't block) so the read
+    // end can be opened without blocking
+    myWriteFD = ::open(myFifoName, O_RDWR);
+    // (and give it somewhere to write, or closing it would close stdout)
+    if (myWriteFD < 0 || myConn.open(myFifoName, "/dev/null") != 0)
+      return false;
+    // a pipe read blocks if there's nothing there, serial and tcp don't
+    fcntl(myConn.getPollFD(), F_SETFL, O_NONBLOCK);
+    myReceiver.setDeviceConnection(&myConn);
+    myReceiver.setPartialPacketTimeout(0);
+    return true;
+  }
+  void close()
+  {
+    myConn.close();
+    unlink(myFifoName);
+  }
+  void read();
+  char myFifoName[128];
+  ArFileDeviceConnection myConn;
+  ArRobotPacketReceiver myReceiver;
+  ArFunctorC<Device> myReadCB;
+  long myNumPackets;
+  long myLast;
+  bool myFailed;
+  int myWriteFD;
+};
+
+Device devices[NUM_DEVICES];
+
+void Device::read()
+{
+  ArRobotPacket *packet;
+  while ((packet = myReceiver.receivePacket(0)) != NULL)
+  {
+    const long num = (long)packet->bufToUByte4();
+    if (num != myLast + 1)
+    {
+      printf("FAILED: %s got packet %ld after %ld\n", myFifoName, num, myLast);
+      myFailed = true;
+    }
+    myLast = num;
+    myNumPackets++;
+  }
+  // the connections after this one in the reactor go while it goes
+  // through them
+  if (removingFrom != NULL && this == &devices[0])
+  {
+    for (int d = 1; d < NUM_DEVICES; d++)
+      removingFrom->remConnection(&devices[d].myConn);
+    removingFrom = NULL;
+  }
+}
+
+class Writer : public ArASyncTask
+{
+public:
+  virtual void *runThread(void *) override
+  {
+    ArRobotPacket packet;
+    for (int i = 0; i < NUM_PACKETS; i++)
+    {
+      for (int d = 0; d < NUM_DEVICES; d++)
+      {
+        packet.empty();
+        packet.setID(0x32);
+        packet.uByte4ToBuf((uint32_t)i);
+        for (int j = 0; j < (i + d) % 30; j++)
+          packet.byteToBuf((char)j);
+        packet.finalizePacket();
+        // write it in a few pieces
+        const char *buf = packet.getBuf();
+        int left = packet.getLength();
+        while (left > 0)
+        {
+          int n = 1 + rand() % 20;
+          if (n > left)
+            n = left;
+          if (::write(devices[d].myWriteFD, buf, (size_t)n) != n)
+            return NULL;
+          buf += n;
+          left -= n;
+        }
+      }
+      if (i % 100 == 0)
+        ArUtil::sleep(1);
+    }
+    return NULL;
+  }
+};
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  ArDeviceReactor reactor("deviceReactorTest");
+  for (int d = 0; d < NUM_DEVICES; d++)
+  {
+    if (!devices[d].open(d) ||
+        !reactor.addConnection(&devices[d].myConn, &devices[d].myReadCB,
+                               devices[d].myFifoName))
+    {
+      printf("FAILED: could not set up device %d\n", d);
+      Aria::exit(1);
+      return 1;
+    }
+  }
+
+  Writer writer;
+  ArTime started;
+  writer.runAsync();
+  writer.join();
+
+  // wait for the reactor to catch up
+  ArTime waiting;
+  bool done = false;
+  while (!done && waiting.mSecSince() < 5000)
+  {
+    done = true;
+    for (int d = 0; d < NUM_DEVICES; d++)
+      if (devices[d].myNumPackets < NUM_PACKETS)
+        done = false;
+    ArUtil::sleep(10);
+  }
+  const long long ms = started.mSecSinceLL();
+
+  for (int d = 0; d < NUM_DEVICES; d++)
+  {
+    printf("%s: %ld packets\n", devices[d].myFifoName, devices[d].myNumPackets);
+    if (devices[d].myFailed || devices[d].myNumPackets != NUM_PACKETS)
+      failed = true;
+  }
+  reactor.log();
+  printf("%d devices, %d packets each, %lld ms, 1 reactor thread\n",
+         NUM_DEVICES, NUM_PACKETS, ms);
+
+  // hang up the writing side, the reactor should stop waiting on those
+  // pipes instead of waking up over and over
+  for (int d = 0; d < NUM_DEVICES; d++)
+    ::close(devices[d].myWriteFD);
+  ArUtil::sleep(100);
+  const unsigned long wakeupsBefore = reactor.getNumWakeups();
+  ArUtil::sleep(500);
+  const unsigned long hangupWakeups = reactor.getNumWakeups() - wakeupsBefore;
+  printf("%lu wakeups in the 500 ms after hanging up\n", hangupWakeups);
+  if (hangupWakeups > 20)
+    failed = true;
+
+  // every tick calls every callback, so the first device's removes the
+  // others at the next one
+  removingFrom = &reactor;
+  waiting.setToNow();
+  while (reactor.getNumConnections() != 1 && waiting.mSecSince() < 2000)
+    ArUtil::sleep(10);
+  printf("%lu connections left after removing the others from a callback\n",
+         (unsigned long)reactor.getNumConnections());
+  if (reactor.getNumConnections() != 1)
+    failed = true;
+
+  for (int d = 0; d < NUM_DEVICES; d++)
+  {
+    reactor.remConnection(&devices[d].myConn);
+    devices[d].close();
+  }
+  if (reactor.getNumConnections() != 0)
+    failed = true;
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
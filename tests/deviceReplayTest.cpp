@@ -0,0 +1,140 @@
+#include "Aria/Aria.h"
+#include "Aria/ArFileDeviceConnection.h"
+#include "Aria/ArReplayDeviceConnection.h"
+#include "Aria/ArRobotPacketReceiver.h"
+
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+// Records robot packets that a writer thread sends through a pipe every
+// 20 ms, then plays the capture back with ArReplayDeviceConnection, once in
+// real time and once as fast as possible.  Checks that every packet comes
+// back intact and in order, that the real time playback takes about as
+// long as the recording did, and that the fast playback doesn't.
+
+const int NUM_PACKETS = 25;
+const int PACKET_INTERVAL = 20;
+
+int writeFD = -1;
+
+class Writer : public ArASyncTask
+{
+public:
+  virtual void *runThread(void *) override
+  {
+    ArRobotPacket packet;
+    for (int i = 0; i < NUM_PACKETS; i++)
+    {
+      packet.empty();
+      packet.setID(0x32);
+      packet.uByte4ToBuf((uint32_t)i);
+      for (int j = 0; j < 20; j++)
+        packet.byte2ToBuf((short)(i * j));
+      packet.finalizePacket();
+      if (::write(writeFD, packet.getBuf(), (size_t)packet.getLength()) != 
+          packet.getLength())
+        return NULL;
+      ArUtil::sleep(PACKET_INTERVAL);
+    }
+    return NULL;
+  }
+};
+
+// receives packets until there are NUM_PACKETS or it has been too long,
+// returns how many arrived in order
+int receive(ArDeviceConnection *conn, long long *ms)
+{
+  ArRobotPacketReceiver receiver(conn);
+  ArTime started;
+  int numPackets = 0;
+  while (numPackets < NUM_PACKETS && started.mSecSince() < 5000)
+  {
+    ArRobotPacket *packet = receiver.receivePacket(50);
+    if (packet == NULL)
+      continue;
+    if ((int)packet->bufToUByte4() != numPackets)
+      break;
+    numPackets++;
+  }
+  *ms = started.mSecSinceLL();
+  return numPackets;
+}
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  char fifoName[128];
+  const char *captureName = "deviceReplayTest.cap";
+  sprintf(fifoName, "/tmp/deviceReplayTest.%d", (int)getpid());
+  unlink(fifoName);
+  ArFileDeviceConnection conn;
+  if (mkfifo(fifoName, 0600) != 0 ||
+      (writeFD = ::open(fifoName, O_RDWR)) < 0 ||
+      conn.open(fifoName, "/dev/null") != 0 ||
+      !conn.startRecording(captureName))
+  {
+    printf("FAILED: could not set up %s and %s\n", fifoName, captureName);
+    Aria::exit(1);
+    return 1;
+  }
+  fcntl(conn.getPollFD(), F_SETFL, O_NONBLOCK);
+
+  Writer writer;
+  writer.runAsync();
+  long long recordMS;
+  const int recorded = receive(&conn, &recordMS);
+  writer.join();
+  conn.stopRecording();
+  const unsigned long long bytesRecorded = conn.getIOStats()->getBytesRead();
+  conn.close();
+  ::close(writeFD);
+  unlink(fifoName);
+  printf("recorded %d packets (%llu bytes) in %lld ms\n", recorded, 
+         bytesRecorded, recordMS);
+  if (recorded != NUM_PACKETS)
+    failed = true;
+
+  ArReplayDeviceConnection replay;
+  if (replay.open(captureName) != 0)
+  {
+    printf("FAILED: could not open %s for replay\n", captureName);
+    Aria::exit(1);
+    return 1;
+  }
+  long long realTimeMS;
+  const int realTimePackets = receive(&replay, &realTimeMS);
+  printf("replayed %d packets (%llu bytes) in real time in %lld ms\n",
+         realTimePackets, replay.getBytesReplayed(), realTimeMS);
+  // (ArUtil::sleep() doesn't sleep exactly PACKET_INTERVAL, so compare
+  // with how long the recording actually took)
+  if (realTimePackets != NUM_PACKETS || 
+      replay.getBytesReplayed() != bytesRecorded ||
+      realTimeMS < recordMS - 2 * PACKET_INTERVAL || 
+      realTimeMS > recordMS + 10 * PACKET_INTERVAL)
+    failed = true;
+
+  replay.setRealTime(false);
+  replay.open();
+  long long fastMS;
+  const int fastPackets = receive(&replay, &fastMS);
+  printf("replayed %d packets (%llu bytes) as fast as possible in %lld ms\n",
+         fastPackets, replay.getBytesReplayed(), fastMS);
+  if (fastPackets != NUM_PACKETS || fastMS > recordMS / 4)
+    failed = true;
+  char c;
+  if (replay.read(&c, 1, 0) != 0 || !replay.isAtEnd())
+  {
+    printf("FAILED: there was more data after the last packet\n");
+    failed = true;
+  }
+  replay.close();
+  unlink(captureName);
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,315 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <list>
+#include <vector>
+
+// Adds random readings to an ArInterpolation and to a copy of how it used
+// to keep them in two lists, with the number of readings changing now and
+// then, and checks getPose() gives the same results, positions and most
+// recent data for times before, between, on and after the readings.  Also
+// checks getPoses() gives the same as getPose() for each time, with the
+// times in and out of order, and prints how long getPose() for each reading
+// of a scan takes, against getPoses() and the old way.
+
+bool failed = false;
+
+ArTime makeTime(long long ms)
+{
+  ArTime t;
+  t.setSecLL((unsigned long long)(ms / 1000));
+  t.setMSecLL((unsigned long long)(ms % 1000));
+  return t;
+}
+
+// ArInterpolation as it was, newest first in two lists
+class OldInterpolation
+{
+public:
+  OldInterpolation(size_t size) : mySize(size), myAllowedMS(-1),
+				  myAllowedPercentage(5000) {}
+  void addReading(ArTime timeOfReading, ArPose position)
+  {
+    if (myTimes.size() >= mySize)
+    {
+      myTimes.pop_back();
+      myPoses.pop_back();
+    }
+    myTimes.push_front(timeOfReading);
+    myPoses.push_front(position);
+  }
+  void setNumberOfReadings(size_t numberOfReadings)
+  {
+    while (myTimes.size() > numberOfReadings)
+    {
+      myTimes.pop_back();
+      myPoses.pop_back();
+    }
+    mySize = numberOfReadings;
+  }
+  int getPose(ArTime timeStamp, ArPose *position, ArPoseWithTime *mostRecent)
+  {
+    std::list<ArTime>::iterator tit;
+    std::list<ArPose>::iterator pit;
+    ArPose thisPose, lastPose, retPose;
+    ArTime thisTime, lastTime;
+    long total, toStamp;
+    double percentage;
+    for (tit = myTimes.begin(), pit = myPoses.begin();
+	 tit != myTimes.end() && pit != myPoses.end(); ++tit, ++pit)
+    {
+      lastTime = thisTime;
+      lastPose = thisPose;
+      thisTime = (*tit);
+      thisPose = (*pit);
+      if (!timeStamp.isAfter(thisTime))
+	break;
+    }
+    if (mostRecent != NULL)
+    {
+      mostRecent->setPose(thisPose);
+      mostRecent->setTime(thisTime);
+    }
+    if (tit == myTimes.end() || pit == myPoses.end())
+      return -2;
+    if ((tit == myTimes.begin() || pit == myPoses.begin()) &&
+	!timeStamp.isAt((*tit)))
+    {
+      thisTime = (*tit);
+      thisPose = (*pit);
+      tit++;
+      pit++;
+      if (tit == myTimes.end() || pit == myPoses.end())
+	return -3;
+      lastTime = (*tit);
+      lastPose = (*pit);
+      total = thisTime.mSecSince(lastTime);
+      if (total == 0)
+	total = 100;
+      toStamp = timeStamp.mSecSince(thisTime);
+      percentage = (double)toStamp/(double)total;
+      if (myAllowedPercentage >= 0 && percentage * 100 > myAllowedPercentage)
+	return -1;
+      if (myAllowedMS >= 0 && abs(toStamp) > myAllowedMS)
+	return -1;
+      retPose.setX(thisPose.getX() +
+		   (thisPose.getX() - lastPose.getX()) * percentage);
+      retPose.setY(thisPose.getY() +
+		   (thisPose.getY() - lastPose.getY()) * percentage);
+      retPose.setTh(ArMath::addAngle(thisPose.getTh(),
+				     ArMath::subAngle(thisPose.getTh(),
+						      lastPose.getTh())
+				     * percentage));
+      *position = retPose;
+      return 0;
+    }
+    total = thisTime.mSecSince(lastTime);
+    toStamp = thisTime.mSecSince(timeStamp);
+    percentage = (double)toStamp/(double)total;
+    if (total == 0)
+      percentage = 0;
+    retPose.setX(thisPose.getX() +
+		 (lastPose.getX() - thisPose.getX()) * percentage);
+    retPose.setY(thisPose.getY() +
+		 (lastPose.getY() - thisPose.getY()) * percentage);
+    retPose.setTh(ArMath::addAngle(thisPose.getTh(),
+				   ArMath::subAngle(lastPose.getTh(),
+						    thisPose.getTh())
+				   * percentage));
+    *position = retPose;
+    return 1;
+  }
+  std::list<ArTime> myTimes;
+  std::list<ArPose> myPoses;
+  size_t mySize;
+  int myAllowedMS;
+  int myAllowedPercentage;
+};
+
+bool samePose(const ArPose &a, const ArPose &b)
+{
+  return fabs(a.getX() - b.getX()) < 1e-9 && fabs(a.getY() - b.getY()) < 1e-9 &&
+    fabs(ArMath::subAngle(a.getTh(), b.getTh())) < 1e-9;
+}
+
+void check(ArInterpolation *interp, OldInterpolation *old, long long ms)
+{
+  const ArTime t = makeTime(ms);
+  ArPose pose, oldPose;
+  ArPoseWithTime recent, oldRecent;
+  const int ret = interp->getPose(t, &pose, &recent);
+  const int oldRet = old->getPose(t, &oldPose, &oldRecent);
+  // with no readings the most recent data is left at when it was made
+  const bool checkRecent = !old->myTimes.empty();
+  if (ret != oldRet || (ret >= 0 && !samePose(pose, oldPose)) ||
+      (checkRecent && (!samePose(recent, oldRecent) ||
+		       recent.getTime().mSecSinceLL(oldRecent.getTime()) != 0)))
+  {
+    printf("FAILED: at %lld ms with %lu readings got %d %.3f %.3f %.3f (most recent %.0f %.0f), should be %d %.3f %.3f %.3f (%.0f %.0f)\n",
+	   ms, (unsigned long)old->myTimes.size(), ret, pose.getX(),
+	   pose.getY(), pose.getTh(), recent.getX(), recent.getY(), oldRet,
+	   oldPose.getX(), oldPose.getY(), oldPose.getTh(), oldRecent.getX(),
+	   oldRecent.getY());
+    failed = true;
+  }
+}
+
+void checkPoses(ArInterpolation *interp, const std::vector<ArTime> &stamps)
+{
+  std::vector<ArPose> poses;
+  std::vector<int> results;
+  const size_t numFound = interp->getPoses(stamps, &poses, &results);
+  size_t shouldFind = 0;
+  for (size_t i = 0; i < stamps.size() && !failed; i++)
+  {
+    ArPose pose;
+    const int ret = interp->getPose(stamps[i], &pose);
+    if (ret >= 0)
+      shouldFind++;
+    if (results[i] != ret || (ret >= 0 && !samePose(poses[i], pose)) ||
+	(ret < 0 && !samePose(poses[i], ArPose())))
+    {
+      printf("FAILED: getPoses() time %lu got %d %.3f %.3f %.3f, getPose() %d %.3f %.3f %.3f\n",
+	     (unsigned long)i, results[i], poses[i].getX(), poses[i].getY(),
+	     poses[i].getTh(), ret, pose.getX(), pose.getY(), pose.getTh());
+      failed = true;
+    }
+  }
+  if (!failed && numFound != shouldFind)
+  {
+    printf("FAILED: getPoses() found %lu, should be %lu\n",
+	   (unsigned long)numFound, (unsigned long)shouldFind);
+    failed = true;
+  }
+}
+
+int main()
+{
+  Aria::init();
+  srand(11);
+
+  const size_t sizes[] = { 1, 2, 3, 10, 100 };
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]) && !failed; s++)
+  {
+    ArInterpolation interp(sizes[s]);
+    OldInterpolation old(sizes[s]);
+    // not so far that the prediction is logged as being far off
+    interp.setAllowedPercentageForPrediction(100);
+    old.myAllowedPercentage = 100;
+    if (s % 2 == 1)
+    {
+      interp.setAllowedMSForPrediction(60);
+      old.myAllowedMS = 60;
+    }
+    long long ms = 100000;
+    ArPose pose(0, 0, 170);
+    for (int n = 0; n < 3000 && !failed; n++)
+    {
+      // sometimes two at the same time
+      ms += rand() % 5 == 0 ? 0 : 1 + rand() % 150;
+      pose.setPose(pose.getX() + rand() % 200 - 100,
+		   pose.getY() + rand() % 200 - 100,
+		   ArMath::addAngle(pose.getTh(), rand() % 60 - 30));
+      interp.addReading(makeTime(ms), pose);
+      old.addReading(makeTime(ms), pose);
+      if (rand() % 200 == 0)
+      {
+	const size_t size = (size_t)(1 + rand() % 120);
+	interp.setNumberOfReadings(size);
+	old.setNumberOfReadings(size);
+      }
+      if (rand() % 500 == 0)
+      {
+	interp.reset();
+	old.myTimes.clear();
+	old.myPoses.clear();
+      }
+      const long long oldest = old.myTimes.empty() ? ms :
+	ms - old.myTimes.back().mSecSinceLL(old.myTimes.front());
+      for (int i = 0; i < 10 && !failed; i++)
+	check(&interp, &old, oldest - 200 + rand() % (int)(ms - oldest + 400));
+      // on the readings themselves
+      for (auto it = old.myTimes.begin(); it != old.myTimes.end() && !failed;
+	   ++it)
+	check(&interp, &old,
+	      ms - it->mSecSinceLL(old.myTimes.front()));
+      if (n % 20 == 0 && !failed)
+      {
+	std::vector<ArTime> stamps;
+	for (int i = 0; i < 200; i++)
+	  stamps.push_back(makeTime(oldest - 200 + i * (ms - oldest + 400) / 200));
+	checkPoses(&interp, stamps);
+	for (size_t i = 0; i < stamps.size(); i++)
+	  stamps[i] = makeTime(oldest - 200 + rand() % (int)(ms - oldest + 400));
+	checkPoses(&interp, stamps);
+      }
+    }
+  }
+
+  // a reading added before the newest replaces the newer ones
+  if (!failed)
+  {
+    ArInterpolation interp(10);
+    for (int i = 1; i <= 5; i++)
+      interp.addReading(makeTime(100000 + i * 100), ArPose(i * 100, 0));
+    interp.addReading(makeTime(100250), ArPose(1000, 0));
+    ArPose pose;
+    if (interp.getPose(makeTime(100250), &pose) != 1 ||
+	!samePose(pose, ArPose(1000, 0)) ||
+	interp.getPose(makeTime(100225), &pose) != 1 ||
+	!samePose(pose, ArPose(600, 0)))
+    {
+      printf("FAILED: a reading back in time didn't replace the newer ones\n");
+      failed = true;
+    }
+  }
+
+  // times for each reading of a scan against the robot's history, for the
+  // latest scan and for one from a few seconds back
+  for (long long back = 0; back <= 5000 && !failed; back += 5000)
+  {
+    const size_t NUM_READINGS = 541;
+    const int NUM_SCANS = 2000;
+    ArInterpolation interp(100);
+    OldInterpolation old(100);
+    for (int i = 0; i < 100; i++)
+    {
+      interp.addReading(makeTime(100000 + i * 100), ArPose(i * 10, i * 5, i));
+      old.addReading(makeTime(100000 + i * 100), ArPose(i * 10, i * 5, i));
+    }
+    std::vector<ArTime> stamps(NUM_READINGS);
+    std::vector<ArPose> poses;
+    for (size_t i = 0; i < NUM_READINGS; i++)
+      stamps[i] = makeTime(100000 + 9800 - back +
+			   (long long)(i * 100 / NUM_READINGS));
+    long long oldUSecs = 0, eachUSecs = 0, batchUSecs = 0;
+    ArPose pose;
+    for (int n = 0; n < NUM_SCANS; n++)
+    {
+      long long started = ArUtil::getTimeUSec();
+      for (size_t i = 0; i < NUM_READINGS; i++)
+	old.getPose(stamps[i], &pose, NULL);
+      oldUSecs += ArUtil::getTimeUSec() - started;
+      started = ArUtil::getTimeUSec();
+      for (size_t i = 0; i < NUM_READINGS; i++)
+	interp.getPose(stamps[i], &pose);
+      eachUSecs += ArUtil::getTimeUSec() - started;
+      started = ArUtil::getTimeUSec();
+      interp.getPoses(stamps, &poses);
+      batchUSecs += ArUtil::getTimeUSec() - started;
+    }
+    printf("poses for a %lu reading scan %lld ms back: getPose() each %.1f usec, getPoses() %.1f usec, the old lists %.1f usec\n",
+	   (unsigned long)NUM_READINGS, back, (double)eachUSecs / NUM_SCANS,
+	   (double)batchUSecs / NUM_SCANS, (double)oldUSecs / NUM_SCANS);
+  }
+
+  if (failed)
+  {
+    printf("interpolationRingTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("interpolationRingTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
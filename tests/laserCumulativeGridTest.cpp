@@ -0,0 +1,204 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+// Feeds made-up scans from a robot driving around a room with posts
+// through ArLaser::laserProcessReadings() (which finds the cumulative
+// readings near each reading with ArRangeBufferGrid), and through a copy
+// of how it used to go through the whole cumulative buffer for each
+// reading, and checks that the cumulative buffers come out the same after
+// every scan.  Prints how long each took.
+
+const int NUM_SCANS = 300;
+const size_t NUM_READINGS = 541;
+const unsigned int MAX_RANGE = 30000;
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser() : ArLaser(1, "test", MAX_RANGE) {}
+  virtual bool blockingConnect() override { return true; }
+  virtual bool asyncConnect() override { return true; }
+  virtual bool disconnect() override { return true; }
+  virtual bool isConnected() override { return true; }
+  virtual bool isTryingToConnect() override { return false; }
+  virtual void *runThread(void *) override { return NULL; }
+  void process(std::list<ArSensorReading *> *readings)
+  {
+    myRawReadings = readings;
+    laserProcessReadings();
+    myRawReadings = NULL;
+  }
+  ArRangeBuffer *getCumulative() { return &myCumulativeBuffer; }
+};
+
+// ArLaser::internalProcessReading() as it was, going through every
+// cumulative reading
+void oldProcessReading(ArRangeBuffer *buffer, double x, double y,
+		       double xTaken, double yTaken, bool onlyClean,
+		       double minDistSquared, double cleanDistSquared)
+{
+  bool addReading = !onlyClean;
+  const ArPose reading(x, y);
+  buffer->beginInvalidationSweep();
+  for (auto cit = buffer->getBegin(); cit != buffer->getEnd(); ++cit)
+  {
+    const ArPose cumReading(cit.getX(), cit.getY());
+    if (addReading && (minDistSquared < .0000001 ||
+	(ArMath::squaredDistanceBetween(x, y, cumReading.getX(),
+					cumReading.getY()) < minDistSquared)))
+      addReading = false;
+    const ArLineSegment line(x, y, xTaken, yTaken);
+    bool found;
+    const ArPose intersection(line.perpendicularPoint(cumReading, &found));
+    if (found &&
+	intersection.squaredFindDistanceTo(cumReading) < cleanDistSquared &&
+	intersection.squaredFindDistanceTo(reading) > 50 * 50)
+      buffer->invalidateReading(cit);
+  }
+  buffer->endInvalidationSweep();
+  if (addReading)
+    buffer->addReading(x, y);
+}
+
+// a 40 m x 30 m room with round posts (300 mm across) every 5 m
+const double ROOM_X = 20000;
+const double ROOM_Y = 15000;
+const double POST_SPACING = 5000;
+const double POST_RADIUS = 150;
+
+bool hitsPost(const ArPose &pose, double dx, double dy, double px, double py,
+	      double *dist)
+{
+  px -= pose.getX();
+  py -= pose.getY();
+  const double along = px * dx + py * dy;
+  const double off2 = px * px + py * py - along * along;
+  if (along <= 0 || off2 >= POST_RADIUS * POST_RADIUS)
+    return false;
+  *dist = along - sqrt(POST_RADIUS * POST_RADIUS - off2);
+  return true;
+}
+
+// distance from pose along th to the walls or a post
+unsigned int rangeTo(const ArPose &pose, double th)
+{
+  const double dx = ArMath::cos(th), dy = ArMath::sin(th);
+  double best = 1e9;
+  if (dx > 1e-9) best = std::min(best, (ROOM_X - pose.getX()) / dx);
+  if (dx < -1e-9) best = std::min(best, (-ROOM_X - pose.getX()) / dx);
+  if (dy > 1e-9) best = std::min(best, (ROOM_Y - pose.getY()) / dy);
+  if (dy < -1e-9) best = std::min(best, (-ROOM_Y - pose.getY()) / dy);
+  for (double px = -ROOM_X + POST_SPACING; px < ROOM_X; px += POST_SPACING)
+  {
+    for (double py = -ROOM_Y + POST_SPACING; py < ROOM_Y; py += POST_SPACING)
+    {
+      double dist;
+      if (hitsPost(pose, dx, dy, px, py, &dist) && dist < best)
+	best = dist;
+    }
+  }
+  return (unsigned int)best;
+}
+
+// keeps the robot away from the walls and posts
+bool blocked(const ArPose &pose)
+{
+  if (fabs(pose.getX()) > ROOM_X - 1000 || fabs(pose.getY()) > ROOM_Y - 1000)
+    return true;
+  const double px = POST_SPACING * floor(pose.getX() / POST_SPACING + .5);
+  const double py = POST_SPACING * floor(pose.getY() / POST_SPACING + .5);
+  return pose.findDistanceTo(ArPose(px, py)) < 1000;
+}
+
+int main()
+{
+  Aria::init();
+  srand(3);
+  bool failed = false;
+
+  TestLaser laser;
+  laser.setMinDistBetweenCumulative(200);
+  laser.setMinDistBetweenCurrent(0);
+  laser.setCumulativeCleanDist(75);
+  laser.setCumulativeCleanInterval(0);
+  laser.setCumulativeBufferSize(3000);
+  laser.setMaxRange(MAX_RANGE);
+  ArRangeBuffer old(3000);
+
+  std::vector<ArSensorReading> readings(NUM_READINGS);
+  std::list<ArSensorReading *> readingList;
+  for (size_t i = 0; i < NUM_READINGS; i++)
+  {
+    readings[i].resetSensorPosition(0, 0, -135 + (double)i * 0.5);
+    readingList.push_back(&readings[i]);
+  }
+
+  long long newUSecs = 0, oldUSecs = 0;
+  ArPose pose(-2500, -2500, 0);
+  for (int scan = 0; scan < NUM_SCANS && !failed; scan++)
+  {
+    // drive around, turning now and then
+    pose.setTh(pose.getTh() + (rand() % 21 - 10));
+    ArPose next(pose.getX() + 50 * ArMath::cos(pose.getTh()),
+		pose.getY() + 50 * ArMath::sin(pose.getTh()), pose.getTh());
+    if (blocked(next))
+      next.setTh(next.getTh() + 150);
+    else
+      pose = next;
+    pose.setTh(next.getTh());
+    ArTransform trans(pose);
+    for (size_t i = 0; i < NUM_READINGS; i++)
+    {
+      unsigned int range = rangeTo(pose, pose.getTh() + readings[i].getSensorTh());
+      // some noise, people walking by, and now and then nothing seen
+      range += (unsigned int)(rand() % 20);
+      if (rand() % 50 == 0)
+	range = range / 2;
+      if (rand() % 100 == 0)
+	range = MAX_RANGE + 1;
+      readings[i].newData(range, pose, pose, trans, (unsigned int)scan,
+			  ArTime());
+    }
+
+    long long started = ArUtil::getTimeUSec();
+    laser.lockDevice();
+    laser.process(&readingList);
+    laser.unlockDevice();
+    newUSecs += ArUtil::getTimeUSec() - started;
+
+    started = ArUtil::getTimeUSec();
+    for (size_t i = 0; i < NUM_READINGS; i++)
+      oldProcessReading(&old, readings[i].getX(), readings[i].getY(),
+			pose.getX(), pose.getY(),
+			readings[i].getRange() > MAX_RANGE, 200 * 200, 75 * 75);
+    oldUSecs += ArUtil::getTimeUSec() - started;
+
+    const ArRangeBuffer *cumulative = laser.getCumulative();
+    bool same = cumulative->getCurrentSize() == old.getCurrentSize();
+    for (size_t i = 0; same && i < old.getCurrentSize(); i++)
+      same = cumulative->getX(i) == old.getX(i) &&
+	cumulative->getY(i) == old.getY(i);
+    if (!same)
+    {
+      printf("FAILED: cumulative readings differ after scan %d (%lu, should be %lu)\n",
+	     scan, cumulative->getCurrentSize(), old.getCurrentSize());
+      failed = true;
+    }
+  }
+  printf("%d scans, %lu cumulative readings at the end\n", NUM_SCANS,
+	 old.getCurrentSize());
+  printf("with the grid: %.2f ms a scan, going through every reading: %.2f ms a scan\n",
+	 (double)newUSecs / NUM_SCANS / 1000.0, (double)oldUSecs / NUM_SCANS / 1000.0);
+
+  if (failed)
+  {
+    printf("laserCumulativeGridTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("laserCumulativeGridTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
@@ -0,0 +1,229 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Runs made-up scans through an ArLaserFilter (filtering as soon as the
+// base laser has each scan, with setProcessImmediately()) and through a
+// copy of how it used to check each reading against each of its
+// neighbors, with different angle spreads and factors, and checks the
+// same readings are ignored.  Also does it with the readings out of
+// order, and prints how long each took with each angle spread.
+
+const unsigned int MAX_RANGE = 30000;
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser() : ArLaser(1, "test", MAX_RANGE)
+  {
+    // the filter copies these
+    setCurrentDrawingData(
+	    new ArDrawingData("polyDots", ArColor(0, 0, 255), 80, 75), true);
+    setCumulativeDrawingData(
+	    new ArDrawingData("polyDots", ArColor(125, 125, 125), 100, 60),
+	    true);
+  }
+  virtual bool blockingConnect() override { return true; }
+  virtual bool asyncConnect() override { return true; }
+  virtual bool disconnect() override { return true; }
+  virtual bool isConnected() override { return true; }
+  virtual bool isTryingToConnect() override { return false; }
+  virtual void *runThread(void *) override { return NULL; }
+  void process(std::list<ArSensorReading *> *readings)
+  {
+    myRawReadings = readings;
+    laserProcessReadings();
+  }
+};
+
+struct Settings
+{
+  double angleToCheck;
+  double allFactor;
+  double anyFactor;
+  double anyMinRange;
+  double lessThanAngle;
+  double greaterThanAngle;
+};
+
+class TestFilter : public ArLaserFilter
+{
+public:
+  TestFilter(ArLaser *laser) : ArLaserFilter(laser) {}
+  void set(const Settings &s)
+  {
+    myAngleToCheck = s.angleToCheck;
+    myAllFactor = s.allFactor;
+    myAnyFactor = s.anyFactor;
+    myAnyMinRange = s.anyMinRange;
+    myAnyMinRangeLessThanAngle = s.lessThanAngle;
+    myAnyMinRangeGreaterThanAngle = s.greaterThanAngle;
+  }
+};
+
+bool checkRanges(unsigned int thisReading, unsigned int otherReading,
+		 double factor)
+{
+  if (thisReading == otherReading || factor <= 0)
+    return true;
+  return !((factor >= 1 && thisReading > otherReading * factor) ||
+	   (factor < 1 && thisReading < otherReading * factor));
+}
+
+bool minRangeAngle(const Settings &s, double th)
+{
+  return th < s.lessThanAngle || th > s.greaterThanAngle;
+}
+
+// ArLaserFilter::processReadings() as it was, going through the
+// neighbors of each reading
+void oldFilter(const Settings &s, const std::vector<unsigned int> &ranges,
+	       const std::vector<double> &angles, std::vector<bool> *ignore)
+{
+  const int numReadings = (int)ranges.size();
+  ignore->assign(ranges.size(), false);
+  for (int i = 0; i < numReadings; i++)
+  {
+    const unsigned int range = ranges[(size_t)i];
+    const double th = angles[(size_t)i];
+    if (s.anyMinRange >= 0 && range < s.anyMinRange && minRangeAngle(s, th))
+    {
+      (*ignore)[(size_t)i] = true;
+      continue;
+    }
+    bool goodAll = true;
+    bool goodAny = s.anyFactor <= 0;
+    bool goodMinRange = true;
+    for (int dir = -1; dir <= 1; dir += 2)
+    {
+      for (int j = i + dir;
+	   j >= 0 && j < numReadings &&
+	     fabs(ArMath::subAngle(angles[(size_t)j], th)) <= s.angleToCheck;
+	   j += dir)
+      {
+	const unsigned int other = ranges[(size_t)j];
+	if (s.allFactor > 0 && !checkRanges(range, other, s.allFactor))
+	  goodAll = false;
+	if (s.anyFactor > 0 && checkRanges(range, other, s.anyFactor))
+	  goodAny = true;
+	if (s.anyMinRange > 0 && minRangeAngle(s, th) && other <= s.anyMinRange)
+	  goodMinRange = false;
+      }
+    }
+    (*ignore)[(size_t)i] = !goodAll || !goodAny || !goodMinRange;
+  }
+}
+
+int main()
+{
+  Aria::init();
+  srand(9);
+  bool failed = false;
+
+  const Settings settings[] = {
+    { 1, 2, -1, -1, -180, 180 },
+    { 1, -1, 1.2, -1, -180, 180 },
+    { 1, 0.8, 0.5, -1, -180, 180 },
+    { 0.5, 1.5, 1.5, 400, -60, 60 },
+    { 3, 1.1, -1, 300, -180, 180 },
+    { 10, 3, 1.05, 500, -90, 90 },
+    { 30, 1, 1, -1, -180, 180 },
+    { 0.1, 2, 2, -1, -180, 180 },
+  };
+  const size_t NUM_READINGS = 541;
+
+  for (int shuffled = 0; shuffled < 2 && !failed; shuffled++)
+  {
+    for (size_t n = 0; n < sizeof(settings) / sizeof(settings[0]) && !failed;
+	 n++)
+    {
+      TestLaser laser;
+      TestFilter filter(&laser);
+      filter.setProcessImmediately(true);
+      filter.set(settings[n]);
+
+      std::vector<ArSensorReading> readings(NUM_READINGS);
+      std::list<ArSensorReading *> readingList;
+      std::vector<double> angles(NUM_READINGS);
+      for (size_t i = 0; i < NUM_READINGS; i++)
+      {
+	// out of order, the readings go back and forth
+	angles[i] = shuffled ? ((i % 2) ? 135 - (double)i * 0.25 :
+				-135 + (double)i * 0.25) :
+	  -135 + (double)i * 0.5;
+	readings[i].resetSensorPosition(0, 0, angles[i]);
+	readingList.push_back(&readings[i]);
+      }
+
+      long long newUSecs = 0, oldUSecs = 0;
+      const int NUM_SCANS = 200;
+      for (int scan = 0; scan < NUM_SCANS && !failed; scan++)
+      {
+	// walls with some posts, people and noise in front of them
+	std::vector<unsigned int> ranges(NUM_READINGS);
+	unsigned int wall = 3000;
+	for (size_t i = 0; i < NUM_READINGS; i++)
+	{
+	  if (rand() % 40 == 0)
+	    wall = (unsigned int)(300 + rand() % 8000);
+	  ranges[i] = wall + (unsigned int)(rand() % 40);
+	  if (rand() % 15 == 0)
+	    ranges[i] = (unsigned int)(rand() % 10000);
+	  readings[i].newData(ranges[i], ArPose(), ArPose(), ArTransform(),
+			      (unsigned int)scan, ArTime());
+	}
+
+	long long started = ArUtil::getTimeUSec();
+	laser.lockDevice();
+	laser.process(&readingList);
+	laser.unlockDevice();
+	newUSecs += ArUtil::getTimeUSec() - started;
+
+	std::vector<bool> ignore;
+	started = ArUtil::getTimeUSec();
+	oldFilter(settings[n], ranges, angles, &ignore);
+	oldUSecs += ArUtil::getTimeUSec() - started;
+
+	filter.lockDevice();
+	const std::list<ArSensorReading *> *filtered = filter.getRawReadings();
+	size_t i = 0;
+	for (auto it = filtered->begin(); it != filtered->end() && !failed;
+	     ++it, i++)
+	{
+	  if ((*it)->getRange() != ranges[i] ||
+	      (*it)->getIgnoreThisReading() != ignore[i])
+	  {
+	    printf("FAILED: reading %lu (%.2f deg, %u mm) with settings %lu%s is %s, should be %s\n",
+		   (unsigned long)i, angles[i], ranges[i], (unsigned long)n,
+		   shuffled ? " out of order" : "",
+		   (*it)->getIgnoreThisReading() ? "ignored" : "kept",
+		   ignore[i] ? "ignored" : "kept");
+	    failed = true;
+	  }
+	}
+	if (!failed && i != NUM_READINGS)
+	{
+	  printf("FAILED: filter has %lu readings, should be %lu\n",
+		 (unsigned long)i, (unsigned long)NUM_READINGS);
+	  failed = true;
+	}
+	filter.unlockDevice();
+      }
+      if (!shuffled)
+	printf("angle spread %5.1f: processing a scan through the laser and filter %.1f usec, the old filter alone %.1f usec\n",
+	       settings[n].angleToCheck, (double)newUSecs / NUM_SCANS,
+	       (double)oldUSecs / NUM_SCANS);
+    }
+  }
+
+  if (failed)
+  {
+    printf("laserFilterTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("laserFilterTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
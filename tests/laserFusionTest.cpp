@@ -0,0 +1,247 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Runs made-up scans of a room from two lasers, one facing forward and
+// one back, through ArLaserFusion, and checks that every reading the
+// lasers have is within the merge distance of one in the fused buffers,
+// that no two fused readings are that close, and that each fused reading
+// is one of the lasers'.  Then moves the robot with ArRobot::moveTo() and
+// checks the fused readings move with the lasers', and that a laser that
+// isn't connected is left out.
+
+const unsigned int MAX_RANGE = 8000;
+const size_t NUM_READINGS = 541;
+const double MERGE_DIST = 60;
+bool failed = false;
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser(int number) : ArLaser(number, "test", MAX_RANGE), myConnected(true)
+  {
+    setCurrentBufferSize(NUM_READINGS);
+    setMinDistBetweenCurrent(0);
+    setMinDistBetweenCumulative(10);
+    setCumulativeCleanDist(0);
+    setCumulativeBufferSize(5000);
+  }
+  virtual bool blockingConnect() override { return true; }
+  virtual bool asyncConnect() override { return true; }
+  virtual bool disconnect() override { return true; }
+  virtual bool isConnected() override { return myConnected; }
+  virtual bool isTryingToConnect() override { return false; }
+  virtual void *runThread(void *) override { return NULL; }
+  void process(std::list<ArSensorReading *> *readings)
+  {
+    myRawReadings = readings;
+    laserProcessReadings();
+  }
+  bool myConnected;
+};
+
+// how far a beam from x, y at th goes before it hits the walls of a
+// 6 m square room with a post in it
+unsigned int rangeTo(double x, double y, double th)
+{
+  const double dx = ArMath::cos(th), dy = ArMath::sin(th);
+  double dist = 1e9;
+  if (dx > 1e-9) dist = std::min(dist, (3000 - x) / dx);
+  if (dx < -1e-9) dist = std::min(dist, (-3000 - x) / dx);
+  if (dy > 1e-9) dist = std::min(dist, (3000 - y) / dy);
+  if (dy < -1e-9) dist = std::min(dist, (-3000 - y) / dy);
+  // the post, a circle at 0, 1500
+  const double px = 0 - x, py = 1500 - y;
+  const double along = px * dx + py * dy;
+  const double perpSquared = px * px + py * py - along * along;
+  if (along > 0 && perpSquared < 200 * 200)
+    dist = std::min(dist, along - sqrt(200 * 200 - perpSquared));
+  return (unsigned int)dist;
+}
+
+void scan(TestLaser *laser, std::vector<ArSensorReading> *readings,
+	  std::list<ArSensorReading *> *list, const ArPose &sensor,
+	  ArRobot *robot, unsigned int counter)
+{
+  const ArPose pose = robot->getPose();
+  const ArTransform trans(pose);
+  readings->resize(NUM_READINGS);
+  list->clear();
+  for (size_t i = 0; i < NUM_READINGS; i++)
+  {
+    ArSensorReading &reading = (*readings)[i];
+    const double th = ArMath::addAngle(sensor.getTh(),
+				       -135 + (double)i * 0.5);
+    reading.resetSensorPosition(sensor.getX(), sensor.getY(), th);
+    const ArPose global = trans.doTransform(sensor);
+    unsigned int range = rangeTo(global.getX(), global.getY(),
+				 ArMath::addAngle(pose.getTh(), th));
+    range += (unsigned int)(rand() % 20);
+    reading.newData(range, pose, robot->getEncoderPose(), trans, counter,
+		    ArTime());
+    list->push_back(&reading);
+  }
+  laser->lockDevice();
+  laser->process(list);
+  laser->unlockDevice();
+}
+
+bool anyWithin(const std::vector<ArPose> &poses, double x, double y,
+	       double distSquared, size_t skip = (size_t)-1)
+{
+  for (size_t i = 0; i < poses.size(); i++)
+    if (i != skip &&
+	ArMath::squaredDistanceBetween(x, y, poses[i].getX(),
+				       poses[i].getY()) < distSquared)
+      return true;
+  return false;
+}
+
+void addPoses(const ArRangeBuffer &buffer, std::vector<ArPose> *poses)
+{
+  for (size_t i = 0; i < buffer.getCurrentSize(); i++)
+    poses->push_back(ArPose(buffer.getX(i), buffer.getY(i)));
+}
+
+void check(const char *after, const char *which,
+	   const std::vector<ArPose> &lasers, const ArRangeBuffer &buffer)
+{
+  std::vector<ArPose> fused;
+  addPoses(buffer, &fused);
+  for (size_t i = 0; i < lasers.size() && !failed; i++)
+  {
+    if (!anyWithin(fused, lasers[i].getX(), lasers[i].getY(),
+		   MERGE_DIST * MERGE_DIST))
+    {
+      printf("FAILED: after %s laser %s reading %.0f %.0f isn't near a fused one\n",
+	     after, which, lasers[i].getX(), lasers[i].getY());
+      failed = true;
+    }
+  }
+  for (size_t i = 0; i < fused.size() && !failed; i++)
+  {
+    if (!anyWithin(lasers, fused[i].getX(), fused[i].getY(), 1e-6))
+    {
+      printf("FAILED: after %s fused %s reading %.0f %.0f isn't one of the lasers'\n",
+	     after, which, fused[i].getX(), fused[i].getY());
+      failed = true;
+    }
+    else if (anyWithin(fused, fused[i].getX(), fused[i].getY(),
+		       MERGE_DIST * MERGE_DIST, i))
+    {
+      printf("FAILED: after %s fused %s reading %.0f %.0f has another within the merge distance\n",
+	     after, which, fused[i].getX(), fused[i].getY());
+      failed = true;
+    }
+  }
+}
+
+void checkAll(const char *after, TestLaser **lasers, size_t numLasers,
+	      ArLaserFusion *fusion)
+{
+  std::vector<ArPose> current, cumulative;
+  for (size_t i = 0; i < numLasers; i++)
+  {
+    if (!lasers[i]->isConnected())
+      continue;
+    addPoses(lasers[i]->getCurrentRangeBuffer(), &current);
+  }
+  // the cumulative readings stay after a laser is disconnected
+  for (size_t i = 0; i < numLasers; i++)
+    addPoses(lasers[i]->getCumulativeRangeBuffer(), &cumulative);
+  fusion->lockDevice();
+  check(after, "current", current, fusion->getCurrentRangeBuffer());
+  check(after, "cumulative", cumulative, fusion->getCumulativeRangeBuffer());
+  if (!failed &&
+      fusion->getCurrentRangeBuffer().getCurrentSize() +
+      fusion->getNumCurrentMerged() != current.size())
+  {
+    printf("FAILED: after %s %lu fused and %lu merged current readings, from %lu\n",
+	   after, fusion->getCurrentRangeBuffer().getCurrentSize(),
+	   fusion->getNumCurrentMerged(), current.size());
+    failed = true;
+  }
+  fusion->unlockDevice();
+}
+
+int main()
+{
+  Aria::init();
+  srand(3);
+
+  ArRobot robot;
+  TestLaser laser1(1), laser2(2);
+  TestLaser *lasers[2] = { &laser1, &laser2 };
+  const ArPose sensors[2] = { ArPose(200, 0, 0), ArPose(-200, 0, 180) };
+  std::vector<ArSensorReading> readings[2];
+  std::list<ArSensorReading *> lists[2];
+  for (int i = 0; i < 2; i++)
+  {
+    lasers[i]->setSensorPosition(sensors[i]);
+    robot.addLaser(lasers[i], i + 1, false);
+  }
+  ArLaserFusion fusion(MERGE_DIST);
+  robot.addRangeDevice(&fusion);
+
+  robot.lock();
+  size_t numLaserReadings = 0, numFused = 0;
+  for (unsigned int n = 0; n < 20 && !failed; n++)
+  {
+    for (int i = 0; i < 2; i++)
+      scan(lasers[i], &readings[i], &lists[i], sensors[i], &robot, n);
+    fusion.processReadings();
+    checkAll("a scan", lasers, 2, &fusion);
+    numLaserReadings += lasers[0]->getCurrentRangeBuffer().getCurrentSize() +
+      lasers[1]->getCurrentRangeBuffer().getCurrentSize();
+    numFused += fusion.getCurrentRangeBuffer().getCurrentSize();
+    if (fusion.getNumScans() != 2)
+    {
+      printf("FAILED: %lu scans merged, should be 2\n", fusion.getNumScans());
+      failed = true;
+    }
+  }
+  printf("%lu current readings from the lasers, %lu fused\n",
+	 numLaserReadings, numFused);
+
+  // moving the robot moves the fused readings from the scans the lasers
+  // already had, as it moves the lasers' buffers
+  if (!failed)
+  {
+    robot.moveTo(ArPose(1000, 500, 30));
+    fusion.processReadings();
+    checkAll("moveTo", lasers, 2, &fusion);
+  }
+  // and new scans line up with those
+  if (!failed)
+  {
+    scan(lasers[0], &readings[0], &lists[0], sensors[0], &robot, 100);
+    fusion.processReadings();
+    checkAll("a scan after moveTo", lasers, 2, &fusion);
+  }
+
+  // a laser that isn't connected is left out
+  if (!failed)
+  {
+    lasers[1]->myConnected = false;
+    fusion.processReadings();
+    if (fusion.getNumScans() != 1)
+    {
+      printf("FAILED: %lu scans merged with a laser disconnected, should be 1\n",
+	     fusion.getNumScans());
+      failed = true;
+    }
+    checkAll("disconnecting a laser", lasers, 2, &fusion);
+  }
+  robot.unlock();
+
+  if (failed)
+  {
+    printf("laserFusionTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("laserFusionTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
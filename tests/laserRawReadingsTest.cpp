@@ -0,0 +1,162 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Projects made-up scans through ArLaserRawReadings and through
+// ArSensorReading::resetSensorPosition() and newData() the way the laser
+// drivers used to, for flipped and unflipped lasers of the sizes the
+// drivers have, and checks the readings come out exactly the same.  Also
+// checks that setRays() only works the beams out again when something
+// changed, that projecting part of the readings leaves the rest alone,
+// and times both ways.
+
+bool failed = false;
+
+bool sameReading(const ArSensorReading &a, const ArSensorReading &b)
+{
+  return a.getRange() == b.getRange() && a.getX() == b.getX() &&
+    a.getY() == b.getY() && a.getPose().getTh() == b.getPose().getTh() &&
+    a.getLocalX() == b.getLocalX() && a.getLocalY() == b.getLocalY() &&
+    a.getSensorX() == b.getSensorX() && a.getSensorY() == b.getSensorY() &&
+    a.getSensorTh() == b.getSensorTh() &&
+    a.getSensorDX() == b.getSensorDX() && a.getSensorDY() == b.getSensorDY() &&
+    a.getIgnoreThisReading() == b.getIgnoreThisReading() &&
+    a.getExtraInt() == b.getExtraInt() &&
+    a.getCounterTaken() == b.getCounterTaken() &&
+    a.getPoseTaken().getX() == b.getPoseTaken().getX() &&
+    a.getEncoderPoseTaken().getX() == b.getEncoderPoseTaken().getX();
+}
+
+int main()
+{
+  Aria::init();
+  srand(5);
+
+  // readings, angle between readings, and where the first one points
+  const size_t sizes[] = { 381, 540, 541, 751, 1081 };
+  const double increments[] = { .5, .5, .5, .36, .25 };
+  long long newUSecs = 0, oldUSecs = 0;
+  int numScans = 0;
+
+  for (size_t z = 0; z < sizeof(sizes) / sizeof(sizes[0]) && !failed; z++)
+  {
+    ArLaserRawReadings raw;
+    std::vector<ArSensorReading> old(sizes[z]);
+    for (int flipped = 0; flipped < 2 && !failed; flipped++)
+    {
+      const ArPose sensor(rand() % 400 - 200, rand() % 200 - 100,
+			  (flipped ? 180 : 0) + rand() % 10 - 5);
+      const double half = increments[z] * (double)(sizes[z] - 1) / 2;
+      const double start = flipped ? sensor.getTh() + half :
+	sensor.getTh() - half;
+      const double increment = flipped ? -increments[z] : increments[z];
+      if (!raw.setRays(sizes[z], sensor.getX(), sensor.getY(), start,
+		       increment))
+      {
+	printf("FAILED: setRays() didn't work out new beams\n");
+	failed = true;
+      }
+
+      for (int scan = 0; scan < 50 && !failed; scan++, numScans++)
+      {
+	if (raw.setRays(sizes[z], sensor.getX(), sensor.getY(), start,
+			increment))
+	{
+	  printf("FAILED: setRays() worked out the same beams again\n");
+	  failed = true;
+	}
+	const ArPose pose(rand() % 20000 - 10000, rand() % 20000 - 10000,
+			  rand() % 360 - 180);
+	const ArPose encoderPose(pose.getX() + 10, pose.getY(), pose.getTh());
+	const ArTransform trans(pose);
+	std::vector<unsigned int> ranges(sizes[z]);
+	for (size_t i = 0; i < sizes[z]; i++)
+	  ranges[i] = (unsigned int)(rand() % 30000);
+	const ArTime now;
+
+	// each way goes first every other scan, so neither gets the ranges
+	// into the cache for the other
+	for (int way = 0; way < 2; way++)
+	{
+	  const long long started = ArUtil::getTimeUSec();
+	  if ((way + scan) % 2 == 0)
+	  {
+	    for (size_t i = 0; i < sizes[z]; i++)
+	      raw.setRange(i, ranges[i], ranges[i] < 100, (int)(i % 4));
+	    raw.project(pose, encoderPose, trans, (unsigned int)scan, now);
+	    newUSecs += ArUtil::getTimeUSec() - started;
+	  }
+	  else
+	  {
+	    for (size_t i = 0; i < sizes[z]; i++)
+	    {
+	      old[i].resetSensorPosition(
+		      sensor.getX(), sensor.getY(),
+		      ArMath::fixAngle(start + increment * (double)i));
+	      old[i].newData(ranges[i], pose, encoderPose, trans,
+			     (unsigned int)scan, now, ranges[i] < 100, 
+			     (int)(i % 4));
+	    }
+	    oldUSecs += ArUtil::getTimeUSec() - started;
+	  }
+	}
+
+	std::list<ArSensorReading *> *list = raw.getList();
+	size_t i = 0;
+	for (auto it = list->begin(); it != list->end() && !failed; ++it, i++)
+	{
+	  if (*it != raw.getReading(i) || !sameReading(**it, old[i]))
+	  {
+	    printf("FAILED: reading %lu of %lu differs (%g %g, should be %g %g)\n",
+		   (unsigned long)i, (unsigned long)sizes[z], (*it)->getX(),
+		   (*it)->getY(), old[i].getX(), old[i].getY());
+	    failed = true;
+	  }
+	}
+	if (!failed && i != sizes[z])
+	{
+	  printf("FAILED: the list has %lu readings, should be %lu\n",
+		 (unsigned long)i, (unsigned long)sizes[z]);
+	  failed = true;
+	}
+      }
+
+      // projecting part of the readings (as the simulator sends them)
+      // leaves the others as they were
+      const ArPose pose(100, 200, 30);
+      const ArTransform trans(pose);
+      const ArSensorReading before = *raw.getReading(0);
+      for (size_t i = 0; i < sizes[z]; i++)
+	raw.setRange(i, 5000);
+      raw.project(sizes[z] / 2, sizes[z], pose, pose, trans, 0, ArTime());
+      if (!sameReading(*raw.getReading(0), before) ||
+	  raw.getReading(sizes[z] - 1)->getRange() != 5000)
+      {
+	printf("FAILED: projecting half the readings changed the wrong ones\n");
+	failed = true;
+      }
+
+      // the beams are worked out again after invalidate()
+      raw.invalidate();
+      if (!raw.setRays(sizes[z], sensor.getX(), sensor.getY(), start,
+		       increment))
+      {
+	printf("FAILED: setRays() didn't work out the beams after invalidate()\n");
+	failed = true;
+      }
+    }
+  }
+  printf("%d scans, through ArLaserRawReadings: %.1f usec a scan, one reading at a time: %.1f usec a scan\n",
+	 numScans, (double)newUSecs / numScans, (double)oldUSecs / numScans);
+
+  if (failed)
+  {
+    printf("laserRawReadingsTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("laserRawReadingsTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
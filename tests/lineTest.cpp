@@ -137,6 +137,18 @@ int main()
   testIntersection(&xLineSeg, &yLine, 100, 0, "xLineSeg and yLine");
   testIntersection(&yLineSeg, &xLine, 100, 0, "yLineSeg and xLine");
   testIntersection(&xLineSeg, &yLineSeg, 100, 0, "xLineSeg and yLineSeg");
+
+  // and ones that don't go through the origin
+  ArLine upLine(0, 1000, 1000, 2000);
+  ArLine downLine(0, 3000, 1000, 2000);
+  ArLineSegment upLineSeg(-500, 500, 1500, 2500);
+  ArLineSegment downLineSeg(-500, 3500, 1500, 1500);
+  testIntersection(&upLine, &downLine, 1000, 2000, "upLine and downLine");
+  testIntersection(&upLineSeg, &downLine, 1000, 2000, 
+		   "upLineSeg and downLine");
+  testIntersection(&upLineSeg, &downLineSeg, 1000, 2000, 
+		   "upLineSeg and downLineSeg");
+  testIntersection(&upLineSeg, &yLine, 100, 1100, "upLineSeg and yLine");
   
 
   // test the perp on all the segments
@@ -150,6 +162,12 @@ int main()
   
   testPerp(&xLineSeg, ArPose(1000, 0), ArPose(1000, 0), "xLineSeg point on line");
 
+  testPerp(&upLineSeg, ArPose(1000, 1000), ArPose(500, 1500), 
+	   "upLineSeg middle");
+  testPerp(&upLineSeg, ArPose(0, 3000), ArPose(1000, 2000), 
+	   "upLineSeg middle on the other side");
+  testNotPerp(&upLineSeg, ArPose(3000, 2000), "upLineSeg beyond the end");
+
   printf("All tests completed successfully\n");
 
   return 0;
@@ -0,0 +1,406 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+// Checks ArLocalCostmap: that a ray marks the cell it ends in and clears
+// the ones it passes through, that hits decay, and that recentering the
+// grid keeps the cells still on it and clears the rest (against a map of
+// the cells kept the simple way).  Then checks closestInBox() against
+// going through every cell, with the robot in different places, and runs
+// made-up laser scans of a room into it through processReadings(), and
+// checks that checkRangeDevicesCurrentBox() still checks the range devices
+// that don't go into it.
+
+const unsigned int MAX_RANGE = 8000;
+const size_t NUM_READINGS = 541;
+const double CELL_SIZE = 50;
+const double SIZE = 4000;
+bool failed = false;
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser() : ArLaser(1, "test", MAX_RANGE)
+  {
+    setCurrentBufferSize(NUM_READINGS);
+  }
+  virtual bool blockingConnect() override { return true; }
+  virtual bool asyncConnect() override { return true; }
+  virtual bool disconnect() override { return true; }
+  virtual bool isConnected() override { return true; }
+  virtual bool isTryingToConnect() override { return false; }
+  virtual void *runThread(void *) override { return NULL; }
+  void process(std::list<ArSensorReading *> *readings)
+  {
+    myRawReadings = readings;
+    laserProcessReadings();
+  }
+};
+
+class TestDevice : public ArRangeDevice
+{
+public:
+  TestDevice(bool locationDependent = false) : 
+    ArRangeDevice(10, 0, "other", MAX_RANGE, 0, 0, 0, locationDependent) {}
+  void add(const ArPose &pose) 
+    { myCurrentBuffer.addReading(pose.getX(), pose.getY()); }
+};
+
+void expect(bool ok, const char *what, double x, double y)
+{
+  if (!ok && !failed)
+  {
+    printf("FAILED: %s at %.0f %.0f\n", what, x, y);
+    failed = true;
+  }
+}
+
+int cellIndex(double v) { return (int)floor(v / CELL_SIZE); }
+
+void checkRays(ArLocalCostmap *costmap)
+{
+  costmap->recenter(0, 0);
+  costmap->addRay(0, 0, 1000, 20);
+  expect(costmap->isObstacle(1010, 20), "a hit isn't an obstacle", 1010, 20);
+  for (double x = 0; x < 950; x += 10)
+    expect(costmap->getCost(x, x / 50) == 0, "a cleared cell has a cost",
+	   x, x / 50);
+  // two rays through it clear it with the default costs
+  costmap->addRay(0, 0, 1500, 30);
+  expect(costmap->isObstacle(1010, 20), "one ray through a hit cleared it",
+	 1010, 20);
+  costmap->addRay(0, 0, 1500, 30);
+  expect(costmap->getCost(1010, 20) == 0, "two rays through a hit left it",
+	 1010, 20);
+  // a miss only clears
+  costmap->addRay(0, 0, -1000, -1000, false);
+  expect(costmap->getCost(-1010, -1010) == 0, "a miss is an obstacle",
+	 -1010, -1010);
+  // a ray from off the grid to off the grid still clears across it
+  costmap->addRay(-5000, 300, -900, 300);
+  expect(costmap->isObstacle(-900, 300), "a hit isn't an obstacle", -900, 300);
+  costmap->addRay(-5000, 300, 5000, 300);
+  costmap->addRay(5000, 300, -5000, 300);
+  expect(costmap->getCost(-900, 300) == 0,
+	 "rays from off the grid didn't clear", -900, 300);
+  // a reading off the grid isn't put on the edge
+  costmap->addRay(0, -500, 0, -3000);
+  expect(costmap->getCost(0, -1990) == 0, "a hit off the grid is on the edge",
+	 0, -1990);
+
+  costmap->setDecayMSecs(100);
+  costmap->addRay(0, 0, 600, 600);
+  expect(costmap->isObstacle(600, 600), "a hit isn't an obstacle", 600, 600);
+  ArUtil::sleep(200);
+  expect(!costmap->isObstacle(600, 600), "a hit didn't decay", 600, 600);
+  costmap->setDecayMSecs(0);
+  costmap->clearCurrentReadings();
+}
+
+void checkRecenter(ArLocalCostmap *costmap)
+{
+  const int numCells = (int)(SIZE / CELL_SIZE);
+  std::map<std::pair<int, int>, bool> hits;
+  double centerX = 0, centerY = 0;
+  costmap->recenter(centerX, centerY);
+  for (int n = 0; n < 500 && !failed; n++)
+  {
+    if (n % 10 == 0)
+    {
+      // mostly small moves, sometimes one off the grid
+      const double jump = (n % 70 == 0) ? 6000 : 600;
+      centerX += (rand() % 2001 - 1000) / 1000.0 * jump;
+      centerY += (rand() % 2001 - 1000) / 1000.0 * jump;
+      costmap->recenter(centerX, centerY);
+      const int originX = cellIndex(centerX) - numCells / 2;
+      const int originY = cellIndex(centerY) - numCells / 2;
+      for (auto it = hits.begin(); it != hits.end(); )
+      {
+	if (it->first.first < originX || it->first.first >= originX + numCells ||
+	    it->first.second < originY || it->first.second >= originY + numCells)
+	  it = hits.erase(it);
+	else
+	  ++it;
+      }
+    }
+    // a ray that doesn't go anywhere only hits the cell it is in
+    const double x = centerX + (rand() % 4001 - 2000);
+    const double y = centerY + (rand() % 4001 - 2000);
+    costmap->addRay(x, y, x, y);
+    const int ix = cellIndex(x), iy = cellIndex(y);
+    if (costmap->isObstacle(x, y))
+      hits[std::make_pair(ix, iy)] = true;
+
+    for (int iy2 = cellIndex(centerY) - numCells;
+	 iy2 < cellIndex(centerY) + numCells && !failed; iy2++)
+    {
+      for (int ix2 = cellIndex(centerX) - numCells;
+	   ix2 < cellIndex(centerX) + numCells && !failed; ix2++)
+      {
+	const double cx = (ix2 + 0.5) * CELL_SIZE, cy = (iy2 + 0.5) * CELL_SIZE;
+	const bool hit = hits.count(std::make_pair(ix2, iy2)) != 0;
+	if (costmap->isObstacle(cx, cy) != hit)
+	  expect(false, hit ? "a hit went missing after recentering" :
+		 "a cell is an obstacle that wasn't hit (or was cleared)",
+		 cx, cy);
+      }
+    }
+  }
+  costmap->clearCurrentReadings();
+}
+
+// whether the corners are all on one side of low to high along an axis
+bool separated(const ArPose *corners, bool alongX, double low, double high)
+{
+  double min = HUGE_VAL, max = -HUGE_VAL;
+  for (int i = 0; i < 4; i++)
+  {
+    const double v = alongX ? corners[i].getX() : corners[i].getY();
+    min = std::min(min, v);
+    max = std::max(max, v);
+  }
+  return max < low || min > high;
+}
+
+// the point nearest the robot of the closest obstacle cell any part of
+// the box is in, going through every cell
+double closestBruteForce(ArLocalCostmap *costmap, const ArPose &robotPose,
+			 double x1, double y1, double x2, double y2,
+			 ArPose *readingPos)
+{
+  const ArTransform trans(robotPose);
+  ArPose box[4] = { ArPose(x1, y1), ArPose(x2, y1), ArPose(x2, y2), 
+		    ArPose(x1, y2) };
+  for (int i = 0; i < 4; i++)
+    box[i] = trans.doTransform(box[i]);
+  double closest = costmap->getMaxRange();
+  for (int iy = cellIndex(robotPose.getY() - SIZE);
+       iy < cellIndex(robotPose.getY() + SIZE); iy++)
+  {
+    for (int ix = cellIndex(robotPose.getX() - SIZE);
+	 ix < cellIndex(robotPose.getX() + SIZE); ix++)
+    {
+      const double left = ix * CELL_SIZE, bottom = iy * CELL_SIZE;
+      if (!costmap->isObstacle(left + CELL_SIZE / 2, bottom + CELL_SIZE / 2))
+	continue;
+      // the cell and the box overlap if neither's axes separate them
+      ArPose cell[4] = { ArPose(left, bottom), 
+			 ArPose(left + CELL_SIZE, bottom),
+			 ArPose(left + CELL_SIZE, bottom + CELL_SIZE), 
+			 ArPose(left, bottom + CELL_SIZE) };
+      if (separated(box, true, left, left + CELL_SIZE) ||
+	  separated(box, false, bottom, bottom + CELL_SIZE))
+	continue;
+      for (int i = 0; i < 4; i++)
+	cell[i] = trans.doInvTransform(cell[i]);
+      if (separated(cell, true, std::min(x1, x2), std::max(x1, x2)) ||
+	  separated(cell, false, std::min(y1, y2), std::max(y1, y2)))
+	continue;
+      const ArPose nearest(
+	      std::max(left, std::min(left + CELL_SIZE, robotPose.getX())),
+	      std::max(bottom, std::min(bottom + CELL_SIZE, robotPose.getY())));
+      const double dist = sqrt(ArMath::squaredDistanceBetween(
+	      nearest.getX(), nearest.getY(), 
+	      robotPose.getX(), robotPose.getY()));
+      if (dist < closest)
+      {
+	closest = dist;
+	*readingPos = trans.doInvTransform(nearest);
+      }
+    }
+  }
+  return closest;
+}
+
+void checkClosest(ArRobot *robot, ArLocalCostmap *costmap)
+{
+  long long usecs = 0, bruteUSecs = 0;
+  int numChecks = 0;
+  for (int n = 0; n < 20 && !failed; n++)
+  {
+    const ArPose pose(rand() % 4000 - 2000, rand() % 4000 - 2000,
+		      rand() % 360 - 180);
+    robot->moveTo(pose);
+    costmap->recenter(pose.getX(), pose.getY());
+    for (int i = 0; i < 300; i++)
+    {
+      const double x = pose.getX() + (rand() % 4001 - 2000);
+      const double y = pose.getY() + (rand() % 4001 - 2000);
+      costmap->addRay(x, y, x, y);
+    }
+    for (int i = 0; i < 50 && !failed; i++)
+    {
+      // boxes like the limiting actions use, off the front or back
+      const double x1 = (rand() % 2000 - 1000) + 0.37;
+      const double x2 = x1 + (rand() % 1500) + 0.21;
+      const double y1 = -(rand() % 800) - 0.13;
+      const double y2 = (rand() % 800) + 0.29;
+      ArPose pos, brutePos;
+      long long started = ArUtil::getTimeUSec();
+      const double dist = costmap->closestInBox(x1, y1, x2, y2, &pos);
+      usecs += ArUtil::getTimeUSec() - started;
+      started = ArUtil::getTimeUSec();
+      const double bruteDist = closestBruteForce(costmap, pose, x1, y1, x2, y2,
+						 &brutePos);
+      bruteUSecs += ArUtil::getTimeUSec() - started;
+      numChecks++;
+      if (fabs(dist - bruteDist) > 1e-6 ||
+	  (dist < costmap->getMaxRange() &&
+	   pos.findDistanceTo(brutePos) > 1e-6))
+      {
+	printf("FAILED: closest in box %.2f %.2f %.2f %.2f from %.0f %.0f %.0f is %.1f at %.1f %.1f, should be %.1f at %.1f %.1f\n",
+	       x1, y1, x2, y2, pose.getX(), pose.getY(), pose.getTh(),
+	       dist, pos.getX(), pos.getY(), bruteDist, brutePos.getX(),
+	       brutePos.getY());
+	failed = true;
+      }
+    }
+    costmap->clearCurrentReadings();
+  }
+  printf("closestInBox %.1f usec, going through every cell %.1f usec\n",
+	 (double)usecs / numChecks, (double)bruteUSecs / numChecks);
+}
+
+// how far a beam from x, y at th goes before it hits the walls of a
+// 3 m square room
+unsigned int rangeTo(double x, double y, double th)
+{
+  const double dx = ArMath::cos(th), dy = ArMath::sin(th);
+  double dist = 1e9;
+  if (dx > 1e-9) dist = std::min(dist, (1500 - x) / dx);
+  if (dx < -1e-9) dist = std::min(dist, (-1500 - x) / dx);
+  if (dy > 1e-9) dist = std::min(dist, (1500 - y) / dy);
+  if (dy < -1e-9) dist = std::min(dist, (-1500 - y) / dy);
+  return (unsigned int)dist;
+}
+
+void checkLaser(ArRobot *robot, ArLocalCostmap *costmap)
+{
+  TestLaser laser;
+  laser.setSensorPosition(ArPose(100, 0, 0));
+  robot->addLaser(&laser, 1, false);
+  robot->addRangeDevice(costmap);
+  robot->moveTo(ArPose(-500, 200, 20));
+
+  std::vector<ArSensorReading> readings(NUM_READINGS);
+  std::list<ArSensorReading *> list;
+  const ArPose pose = robot->getPose();
+  const ArTransform trans(pose);
+  const ArPose sensor = trans.doTransform(laser.getSensorPosition());
+  for (size_t i = 0; i < NUM_READINGS; i++)
+  {
+    ArSensorReading &reading = readings[i];
+    const double th = -135 + (double)i * 0.5;
+    reading.resetSensorPosition(100, 0, th);
+    reading.newData(rangeTo(sensor.getX(), sensor.getY(),
+			    ArMath::addAngle(pose.getTh(), th)),
+		    pose, robot->getEncoderPose(), trans, 1, ArTime());
+    list.push_back(&reading);
+  }
+  laser.lockDevice();
+  laser.process(&list);
+  laser.unlockDevice();
+  costmap->processReadings();
+
+  costmap->lockDevice();
+  for (size_t i = 0; i < NUM_READINGS; i++)
+    expect(costmap->isObstacle(readings[i].getX(), readings[i].getY()),
+	   "a laser reading isn't an obstacle", readings[i].getX(),
+	   readings[i].getY());
+  expect(!costmap->isObstacle(pose.getX() + 500, pose.getY()),
+	 "in front of the laser is an obstacle", pose.getX() + 500,
+	 pose.getY());
+  expect(costmap->getCurrentRangeBuffer().getCurrentSize() > 0,
+	 "no obstacles in the current buffer", 0, 0);
+  // everything in the current buffer is an obstacle cell center
+  const ArRangeBuffer &buffer = costmap->getCurrentRangeBuffer();
+  for (size_t i = 0; i < buffer.getCurrentSize(); i++)
+    expect(costmap->isObstacle(buffer.getX(i), buffer.getY(i)),
+	   "a current reading isn't an obstacle", buffer.getX(i),
+	   buffer.getY(i));
+  // straight ahead the wall at x = 1500 is about this far
+  const double ahead = costmap->closestInBox(0, -100, 5000, 100);
+  const double wall = (1500 - pose.getX()) / ArMath::cos(pose.getTh());
+  expect(fabs(ahead - wall) < 3 * CELL_SIZE, "the wall ahead is off",
+	 ahead, wall);
+  costmap->unlockDevice();
+
+  // the costmap stands in for the laser, but not for other range devices
+  TestDevice other;
+  robot->addRangeDevice(&other);
+  robot->addRangeDevice(&laser);
+  expect(costmap->coversDevice(&laser) && !costmap->coversDevice(&other),
+	 "the costmap covers the wrong devices", 0, 0);
+  other.add(trans.doTransform(ArPose(700, 0)));
+  const ArRangeDevice *device = NULL;
+  ArPose otherPos;
+  const double otherDist = costmap->checkRangeDevicesCurrentBox(
+	  0, -100, 5000, 100, &otherPos, &device);
+  expect(device == &other && fabs(otherDist - 700) < 1e-6,
+	 "a range device the costmap doesn't cover wasn't checked",
+	 otherPos.getX(), otherPos.getY());
+  robot->remRangeDevice(&other);
+  TestDevice forbidden(true);
+  robot->addRangeDevice(&forbidden);
+  forbidden.add(trans.doTransform(ArPose(700, 0)));
+  costmap->checkRangeDevicesCurrentBox(0, -100, 5000, 100, &otherPos,
+				       &device, false);
+  expect(device == costmap, "a location dependent device was checked",
+	 otherPos.getX(), otherPos.getY());
+  robot->remRangeDevice(&forbidden);
+  robot->remRangeDevice(&laser);
+  // with nothing there it says so the way the robot does
+  device = costmap;
+  const double nothing = costmap->checkRangeDevicesCurrentBox(
+	  -400, -100, -200, 100, &otherPos, &device);
+  expect(nothing == 32000 && device == NULL,
+	 "an empty box isn't 32000 away with no device", nothing, 0);
+
+  // the same scan again isn't put in again
+  costmap->processReadings();
+  expect(costmap->isObstacle(readings[0].getX(), readings[0].getY()),
+	 "a laser reading went away", readings[0].getX(), readings[0].getY());
+
+  // and moving the robot starts the grid over
+  robot->moveTo(ArPose(0, 0, 0));
+  expect(costmap->getCurrentRangeBuffer().getCurrentSize() == 0 &&
+	 !costmap->isObstacle(readings[0].getX(), readings[0].getY()),
+	 "moveTo didn't clear the grid", 0, 0);
+  robot->remRangeDevice(costmap);
+  robot->remLaser(&laser);
+}
+
+int main()
+{
+  Aria::init();
+  srand(5);
+
+  ArRobot robot;
+  ArLocalCostmap costmap(CELL_SIZE, SIZE);
+  costmap.setDecayMSecs(0);
+  costmap.setUseSonar(false);
+  costmap.setRobot(&robot);
+
+  robot.lock();
+  checkRays(&costmap);
+  if (!failed)
+    checkRecenter(&costmap);
+  if (!failed)
+    checkClosest(&robot, &costmap);
+  if (!failed)
+    checkLaser(&robot, &costmap);
+  robot.unlock();
+
+  if (failed)
+  {
+    printf("localCostmapTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("localCostmapTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
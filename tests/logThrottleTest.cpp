@@ -0,0 +1,146 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <string>
+
+// Logs through ArLogThrottle as fast as it can and checks that messages
+// come out no more often than the interval, that messages held back by the
+// interval are never formatted, that repeats of the same text are left out
+// until the repeat time is up and then counted, and that with several
+// threads logging at once every call is either logged or counted.
+
+std::atomic<long> numLogged(0);
+std::string lastLogged;
+std::atomic<long> numFormatted(0);
+
+void logged(const char *message)
+{
+  if (strncmp(message, "logThrottleTest", 15) != 0)
+    return;
+  numLogged++;
+  lastLogged = message;
+}
+
+int formatted(int n)
+{
+  numFormatted++;
+  return n;
+}
+
+ArLogThrottle threadsThrottle(50);
+std::atomic<long> numThreadCalls(0);
+std::atomic<int> numDone(0);
+
+class Logger : public ArASyncTask
+{
+public:
+  virtual void *runThread(void *) override
+  {
+    ArTime started;
+    while (started.mSecSince() < 300)
+    {
+      numThreadCalls++;
+      ARLOG_THROTTLED(threadsThrottle, ArLog::Normal,
+		      "logThrottleTest thread %d", formatted(0));
+    }
+    numDone++;
+    return NULL;
+  }
+};
+
+int main()
+{
+  Aria::init();
+  ArLog::init(ArLog::None, ArLog::Normal, "", false, false, false);
+  ArGlobalFunctor1<const char *> loggedCB(&logged);
+  ArLog::setFunctor(&loggedCB);
+  bool failed = false;
+
+  // different text every call, held back by the interval
+  ArLogThrottle throttle(100);
+  long calls = 0;
+  ArTime started;
+  while (started.mSecSince() < 350)
+  {
+    calls++;
+    ARLOG_THROTTLED(throttle, ArLog::Normal, "logThrottleTest interval %d",
+		    formatted((int)calls));
+    ArUtil::sleep(1);
+  }
+  printf("interval: %ld calls, %ld logged, %ld formatted, %llu skipped, last '%s'\n",
+	 calls, numLogged.load(), numFormatted.load(),
+	 throttle.getTotalSkipped(), lastLogged.c_str());
+  if (numLogged < 3 || numLogged > 5 || numFormatted != numLogged ||
+      numLogged + (long)throttle.getTotalSkipped() != calls ||
+      strstr(lastLogged.c_str(), "more not logged") == NULL)
+  {
+    printf("FAILED: interval didn't hold messages back right\n");
+    failed = true;
+  }
+
+  // the same text every call, held back as repeats
+  numLogged = 0;
+  numFormatted = 0;
+  ArLogThrottle repeats(0, 200);
+  for (int i = 0; i < 1000; i++)
+    ARLOG_THROTTLED(repeats, ArLog::Normal, "logThrottleTest repeat %d",
+		    formatted(1));
+  const long loggedBefore = numLogged;
+  const unsigned long skippedBefore = repeats.getNumSkipped();
+  ArUtil::sleep(250);
+  ARLOG_THROTTLED(repeats, ArLog::Normal, "logThrottleTest repeat %d",
+		  formatted(1));
+  printf("repeats: %ld logged then %ld, %lu skipped, last '%s'\n",
+	 loggedBefore, numLogged.load(), skippedBefore, lastLogged.c_str());
+  if (loggedBefore != 1 || numLogged != 2 || skippedBefore != 999 ||
+      repeats.getNumSkipped() != 0 ||
+      strstr(lastLogged.c_str(), "repeated 999 times") == NULL)
+  {
+    printf("FAILED: repeats weren't left out and counted\n");
+    failed = true;
+  }
+
+  // a throttle just for one line
+  numLogged = 0;
+  for (int i = 0; i < 1000; i++)
+    ARLOG_EVERY(10000, ArLog::Normal, "logThrottleTest every %d", i);
+  printf("every: %ld logged\n", numLogged.load());
+  if (numLogged != 1)
+  {
+    printf("FAILED: ARLOG_EVERY logged more than once\n");
+    failed = true;
+  }
+
+  // threads all logging at once
+  numLogged = 0;
+  numFormatted = 0;
+  const int numThreads = 4;
+  Logger loggers[numThreads];
+  for (int i = 0; i < numThreads; i++)
+    loggers[i].runAsync();
+  while (numDone < numThreads)
+    ArUtil::sleep(10);
+  printf("threads: %ld calls, %ld logged, %ld formatted, %llu skipped\n",
+	 numThreadCalls.load(), numLogged.load(), numFormatted.load(),
+	 threadsThrottle.getTotalSkipped());
+  // only one check() every 50 ms formats it, and the same text is only
+  // logged once
+  if (numLogged != 1 || numFormatted < 4 || numFormatted > 8 ||
+      numLogged + (long)threadsThrottle.getTotalSkipped() != numThreadCalls)
+  {
+    printf("FAILED: calls from threads weren't all logged or counted\n");
+    failed = true;
+  }
+
+  ArLog::clearFunctor();
+  if (failed)
+  {
+    printf("logThrottleTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("logThrottleTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
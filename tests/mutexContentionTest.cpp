@@ -0,0 +1,140 @@
+#include "Aria/Aria.h"
+#include "Aria/ArMutexStats.h"
+
+#include <stdio.h>
+#include <atomic>
+
+// Turns on ArMutex contention statistics and has threads fight over one
+// mutex (holding it for a millisecond each time) while another mutex is
+// only ever locked by one thread.  Checks that every lock is counted, that
+// only the shared mutex counts contended locks and waiting time, that a
+// recursive lock counts once, and that the shared mutex comes out hottest.
+// Then times lock() and unlock() with the statistics off and on.
+
+const int NUM_THREADS = 4;
+const int NUM_LOCKS = 50;
+
+ArMutex shared;
+std::atomic<int> numDone(0);
+
+class Locker : public ArASyncTask
+{
+public:
+  virtual void *runThread(void *) override
+  {
+    for (int i = 0; i < NUM_LOCKS; i++)
+    {
+      shared.lock();
+      ArUtil::sleep(1);
+      shared.unlock();
+    }
+    numDone++;
+    return NULL;
+  }
+};
+
+double timeLocks(ArMutex *mutex, int num)
+{
+  const long long started = ArUtil::getTimeUSec();
+  for (int i = 0; i < num; i++)
+  {
+    mutex->lock();
+    mutex->unlock();
+  }
+  return (double)(ArUtil::getTimeUSec() - started) * 1000.0 / num;
+}
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  shared.setLogName("mutexContentionTest::shared");
+  ArMutex alone;
+  alone.setLogName("mutexContentionTest::alone");
+  ArMutex::setContentionStats(true);
+
+  Locker lockers[NUM_THREADS];
+  for (int i = 0; i < NUM_THREADS; i++)
+  {
+    lockers[i].setThreadName("locker");
+    lockers[i].runAsync();
+  }
+  for (int i = 0; i < NUM_LOCKS; i++)
+  {
+    alone.lock();
+    // recursive, shouldn't count again
+    alone.lock();
+    alone.unlock();
+    alone.unlock();
+  }
+  while (numDone < NUM_THREADS)
+    ArUtil::sleep(10);
+  ArMutex::setContentionStats(false);
+
+  const ArMutexStats *sharedStats =
+    ArMutexStats::find("mutexContentionTest::shared");
+  const ArMutexStats *aloneStats =
+    ArMutexStats::find("mutexContentionTest::alone");
+  if (sharedStats == NULL || aloneStats == NULL)
+  {
+    printf("FAILED: no statistics for the mutexes\n");
+    Aria::exit(1);
+  }
+  sharedStats->log();
+  aloneStats->log();
+
+  if (sharedStats->getLocks() != NUM_THREADS * NUM_LOCKS ||
+      sharedStats->getContendedLocks() == 0 ||
+      sharedStats->getTotalWaitUSec() <= 0 ||
+      sharedStats->getMaxWaitUSec() < 1000 ||
+      sharedStats->getHoldTimes()->getTotalCount() !=
+      NUM_THREADS * NUM_LOCKS ||
+      sharedStats->getHoldTimes()->getMin() < 1000 ||
+      strcmp(sharedStats->getLastHolder(), "locker") != 0)
+  {
+    printf("FAILED: shared mutex statistics are wrong\n");
+    failed = true;
+  }
+  if (aloneStats->getLocks() != NUM_LOCKS ||
+      aloneStats->getContendedLocks() != 0 ||
+      aloneStats->getTotalWaitUSec() != 0 ||
+      aloneStats->getHoldTimes()->getTotalCount() != NUM_LOCKS)
+  {
+    printf("FAILED: uncontended mutex statistics are wrong\n");
+    failed = true;
+  }
+  std::vector<const ArMutexStats *> hottest = ArMutexStats::getHottest(1);
+  if (hottest.size() != 1 || hottest[0] != sharedStats)
+  {
+    printf("FAILED: shared mutex isn't the hottest\n");
+    failed = true;
+  }
+  ArMutexStats::logHottest(5);
+
+  // nothing more is counted with the statistics off
+  shared.lock();
+  shared.unlock();
+  if (sharedStats->getLocks() != NUM_THREADS * NUM_LOCKS)
+  {
+    printf("FAILED: lock counted with the statistics off\n");
+    failed = true;
+  }
+
+  const int num = 1000000;
+  ArMutex timed;
+  timed.setLogName("mutexContentionTest::timed");
+  printf("lock and unlock, statistics off: %.1f ns\n", timeLocks(&timed, num));
+  ArMutex::setContentionStats(true);
+  printf("lock and unlock, statistics on: %.1f ns\n", timeLocks(&timed, num));
+  ArMutex::setContentionStats(false);
+
+  if (failed)
+  {
+    printf("mutexContentionTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("mutexContentionTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
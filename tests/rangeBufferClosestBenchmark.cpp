@@ -0,0 +1,241 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+
+// Times ArRangeBuffer::getClosestPolar() and getClosestBox() with each
+// implementation this processor supports, against a copy of how they used
+// to go through the readings (atan2 and sqrt for every reading), for
+// buffers the size of a sonar buffer, a laser scan, a cumulative laser
+// buffer and a large cumulative buffer.  Also checks that every
+// implementation gives the same answers as the old way, including for
+// readings right on the edges of the slice.
+//
+// Usage: rangeBufferClosestBenchmark [ms per test]
+
+static volatile double sink;
+bool failed = false;
+
+// getClosestPolar() as it was
+double oldClosestPolar(const ArRangeBuffer &buffer, double startAngle,
+		       double endAngle, const ArPose &startPos,
+		       unsigned int maxRange, double *angle)
+{
+  double closest = 0;
+  bool foundOne = false;
+  double closeTh = 0;
+  double dist = 0;
+  startAngle = ArMath::fixAngle(startAngle);
+  endAngle = ArMath::fixAngle(endAngle);
+  for (auto it = buffer.getBegin(); it != buffer.getEnd(); ++it)
+  {
+    const ArPose reading(it.getX(), it.getY());
+    const double th = ArMath::subAngle(startPos.findAngleTo(reading),
+				       startPos.getTh());
+    if (ArMath::angleBetween(th, startAngle, endAngle))
+    {
+      if (!foundOne || (dist = reading.findDistanceTo(startPos)) < closest)
+      {
+	closeTh = th;
+	if (!foundOne)
+	  closest = reading.findDistanceTo(startPos);
+	else
+	  closest = dist;
+	foundOne = true;
+      }
+    }
+  }
+  if (!foundOne)
+    return maxRange;
+  if (angle != NULL)
+    *angle = closeTh;
+  if (closest > maxRange)
+    return maxRange;
+  return closest;
+}
+
+// getClosestBox() as it was
+double oldClosestBox(const ArRangeBuffer &buffer, double x1, double y1,
+		     double x2, double y2, const ArPose &startPos,
+		     unsigned int maxRange, ArPose *readingPos)
+{
+  double closest = maxRange;
+  ArPose closestPos;
+  ArTransform trans(startPos, ArPose(0, 0, 0));
+  if (x1 >= x2)
+    std::swap(x1, x2);
+  if (y1 >= y2)
+    std::swap(y1, y2);
+  for (auto it = buffer.getBegin(); it != buffer.getEnd(); ++it)
+  {
+    const ArPose pose = trans.doTransform(ArPose(it.getX(), it.getY()));
+    if (pose.getX() >= x1 && pose.getX() <= x2 &&
+	pose.getY() >= y1 && pose.getY() <= y2)
+    {
+      const double dist = pose.findDistanceTo(ArPose(0, 0, 0));
+      if (dist < closest)
+      {
+	closest = dist;
+	closestPos = pose;
+      }
+    }
+  }
+  if (readingPos != NULL)
+    *readingPos = closestPos;
+  if (closest > maxRange)
+    return maxRange;
+  return closest;
+}
+
+struct Query
+{
+  ArPose pos;
+  double startAngle, endAngle;
+  double x1, y1, x2, y2;
+};
+
+// readings around the robot like a laser would see, some of them right on
+// the edges of the slices the queries look in
+void fillBuffer(ArRangeBuffer *buffer, size_t size, const ArPose &robot)
+{
+  buffer->setCapacity(size);
+  // past the capacity, so the readings wrap around the ring
+  for (size_t i = 0; i < size + size / 3; i++)
+  {
+    const double th = robot.getTh() + (double)(rand() % 360) +
+      ((rand() % 4 == 0) ? 0 : (double)(rand() % 1000) / 1000.0);
+    const double range = 300 + rand() % 8000;
+    buffer->addReading(robot.getX() + range * ArMath::cos(th),
+		       robot.getY() + range * ArMath::sin(th));
+  }
+}
+
+bool sameAnswers(const ArRangeBuffer &buffer, const Query &q)
+{
+  double oldAngle = 0, angle = 0;
+  const double oldPolar = oldClosestPolar(buffer, q.startAngle, q.endAngle,
+					  q.pos, 10000, &oldAngle);
+  const double polar = buffer.getClosestPolar(q.startAngle, q.endAngle, q.pos,
+					      10000, &angle);
+  ArPose oldPos, pos;
+  const double oldBox = oldClosestBox(buffer, q.x1, q.y1, q.x2, q.y2, q.pos,
+				      10000, &oldPos);
+  const double box = buffer.getClosestBox(q.x1, q.y1, q.x2, q.y2, q.pos,
+					  10000, &pos);
+  return polar == oldPolar && (oldPolar >= 10000 || angle == oldAngle) &&
+    box == oldBox && pos.getX() == oldPos.getX() &&
+    pos.getY() == oldPos.getY() && pos.getTh() == oldPos.getTh();
+}
+
+template<class Func>
+double usecsPerCall(Func func, long msecs)
+{
+  long long calls = 0;
+  ArTime started;
+  do
+  {
+    for (int i = 0; i < 100; i++)
+      sink += func();
+    calls += 100;
+  } while (started.mSecSince() < msecs);
+  return (double)started.mSecSince() * 1000.0 / (double)calls;
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  srand(7);
+  const long msecs = (argc > 1) ? atol(argv[1]) : 200;
+  const size_t sizes[] = { 64, 541, 3000, 20000 };
+  const ArRangeBuffer::Implementation best = ArRangeBuffer::getImplementation();
+  const ArRangeBuffer::Implementation impls[] =
+    { ArRangeBuffer::SCALAR, ArRangeBuffer::SSE2, ArRangeBuffer::AVX2 };
+
+  printf("%-7s %-8s %8s %12s\n", "query", "impl", "readings", "usec/call");
+  for (size_t z = 0; z < sizeof(sizes) / sizeof(sizes[0]); z++)
+  {
+    const ArPose robot(rand() % 10000, rand() % 10000, rand() % 360 - 180);
+    ArRangeBuffer buffer(sizes[z]);
+    fillBuffer(&buffer, sizes[z], robot);
+
+    // slices in front, to the sides, behind (and wider than half way
+    // around), and boxes in front and around the robot
+    std::vector<Query> queries;
+    for (int i = 0; i < 200; i++)
+    {
+      Query q;
+      q.pos = robot;
+      q.startAngle = rand() % 360 - 180;
+      q.endAngle = q.startAngle + ((i % 3 == 0) ? 20 : rand() % 360);
+      q.x1 = (i % 2 == 0) ? 0 : -3000;
+      q.x2 = 3000;
+      q.y1 = -(rand() % 2000);
+      q.y2 = rand() % 2000;
+      queries.push_back(q);
+    }
+
+    for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); n++)
+    {
+      if (!ArRangeBuffer::setImplementation(impls[n]))
+	continue;
+      for (size_t i = 0; i < queries.size(); i++)
+      {
+	if (!sameAnswers(buffer, queries[i]))
+	{
+	  printf("FAILED: %s gives different answers than the old way with %lu readings\n",
+		 ArRangeBuffer::getImplementationName(impls[n]),
+		 (unsigned long)sizes[z]);
+	  failed = true;
+	  break;
+	}
+      }
+    }
+
+    size_t next = 0;
+    printf("%-7s %-8s %8lu %12.2f\n", "polar", "old", (unsigned long)sizes[z],
+	   usecsPerCall([&]() {
+	       const Query &q = queries[next++ % queries.size()];
+	       return oldClosestPolar(buffer, q.startAngle, q.endAngle, q.pos,
+				      10000, NULL); }, msecs));
+    for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); n++)
+    {
+      if (!ArRangeBuffer::setImplementation(impls[n]))
+	continue;
+      printf("%-7s %-8s %8lu %12.2f\n", "polar",
+	     ArRangeBuffer::getImplementationName(impls[n]),
+	     (unsigned long)sizes[z],
+	     usecsPerCall([&]() {
+		 const Query &q = queries[next++ % queries.size()];
+		 return buffer.getClosestPolar(q.startAngle, q.endAngle, q.pos,
+					       10000); }, msecs));
+    }
+    printf("%-7s %-8s %8lu %12.2f\n", "box", "old", (unsigned long)sizes[z],
+	   usecsPerCall([&]() {
+	       const Query &q = queries[next++ % queries.size()];
+	       return oldClosestBox(buffer, q.x1, q.y1, q.x2, q.y2, q.pos,
+				    10000, NULL); }, msecs));
+    for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); n++)
+    {
+      if (!ArRangeBuffer::setImplementation(impls[n]))
+	continue;
+      printf("%-7s %-8s %8lu %12.2f\n", "box",
+	     ArRangeBuffer::getImplementationName(impls[n]),
+	     (unsigned long)sizes[z],
+	     usecsPerCall([&]() {
+		 const Query &q = queries[next++ % queries.size()];
+		 return buffer.getClosestBox(q.x1, q.y1, q.x2, q.y2, q.pos,
+					     10000); }, msecs));
+    }
+  }
+  ArRangeBuffer::setImplementation(best);
+
+  if (failed)
+  {
+    printf("rangeBufferClosestBenchmark FAILED\n");
+    Aria::exit(1);
+  }
+  printf("rangeBufferClosestBenchmark passed\n");
+  Aria::exit(0);
+  return 0;
+}
@@ -0,0 +1,325 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <list>
+
+// Does random adds, conditional adds, invalidation sweeps, redos, capacity
+// changes and transforms on an ArRangeBuffer and on a std::list kept the
+// way ArRangeBuffer used to keep its readings (newest first), and checks
+// after each that the buffer has the same readings in the same order, and
+// that getClosestPolar() and getClosestBox() give the same answers as
+// searching the list, with each implementation the processor supports.
+// Also checks getSpans(), invalidating through getBuffer() iterators, and
+// changing readings through getBufferPtr(), that those changes are seen as
+// soon as the buffer is read, and that only looking through it leaves the
+// change count alone.
+
+std::list<ArPose> model;
+size_t modelCapacity = 0;
+int numChecks = 0;
+bool failed = false;
+
+double randCoord()
+{
+  return (double)(rand() % 20001 - 10000);
+}
+
+void modelAdd(double x, double y)
+{
+  if (modelCapacity == 0)
+    return;
+  if (model.size() == modelCapacity)
+    model.pop_back();
+  model.push_front(ArPose(x, y));
+}
+
+double modelClosestPolar(double startAngle, double endAngle,
+			 const ArPose &startPos, unsigned int maxRange,
+			 double *angle)
+{
+  double closest = 0;
+  bool foundOne = false;
+  startAngle = ArMath::fixAngle(startAngle);
+  endAngle = ArMath::fixAngle(endAngle);
+  for (auto it = model.begin(); it != model.end(); ++it)
+  {
+    const double th = ArMath::subAngle(startPos.findAngleTo(*it),
+				       startPos.getTh());
+    const double dist = it->findDistanceTo(startPos);
+    if (ArMath::angleBetween(th, startAngle, endAngle) &&
+	(!foundOne || dist < closest))
+    {
+      closest = dist;
+      *angle = th;
+      foundOne = true;
+    }
+  }
+  if (!foundOne || closest > maxRange)
+    return maxRange;
+  return closest;
+}
+
+double modelClosestBox(double x1, double y1, double x2, double y2,
+		       const ArPose &startPos, unsigned int maxRange)
+{
+  double closest = maxRange;
+  ArTransform trans(startPos, ArPose(0, 0, 0));
+  for (auto it = model.begin(); it != model.end(); ++it)
+  {
+    const ArPose pose = trans.doTransform(*it);
+    if (pose.getX() >= x1 && pose.getX() <= x2 &&
+	pose.getY() >= y1 && pose.getY() <= y2)
+    {
+      const double dist = pose.findDistanceTo(ArPose(0, 0, 0));
+      if (dist < closest)
+	closest = dist;
+    }
+  }
+  return closest;
+}
+
+void check(const ArRangeBuffer &buffer, const char *after)
+{
+  numChecks++;
+  bool same = buffer.getCurrentSize() == model.size();
+  auto mit = model.begin();
+  for (auto it = buffer.getBegin(); same && it != buffer.getEnd(); ++it, ++mit)
+    same = it.getX() == mit->getX() && it.getY() == mit->getY() &&
+      it->getX() == mit->getX();
+  // the spans hold the same readings, oldest first
+  ArRangeBuffer::Span spans[2];
+  const size_t numSpans = buffer.getSpans(spans);
+  size_t inSpans = 0;
+  auto rit = model.rbegin();
+  for (size_t s = 0; same && s < numSpans; s++)
+    for (size_t i = 0; same && i < spans[s].size; i++, ++rit, inSpans++)
+      same = spans[s].x[i] == rit->getX() && spans[s].y[i] == rit->getY();
+  if (!same || inSpans != model.size())
+  {
+    printf("FAILED: readings differ after %s (%lu readings, should be %lu)\n",
+	   after, buffer.getCurrentSize(), model.size());
+    failed = true;
+    return;
+  }
+
+  const ArPose pos(randCoord(), randCoord(), rand() % 360 - 180);
+  const double start = rand() % 360 - 180;
+  const double end = start + rand() % 360;
+  double modelAngle = 0;
+  const double modelPolar = modelClosestPolar(start, end, pos, 30000,
+					      &modelAngle);
+  const double modelBox = modelClosestBox(-5000, -2000, 5000, 2000, pos, 30000);
+  const ArRangeBuffer::Implementation impls[] =
+    { ArRangeBuffer::SCALAR, ArRangeBuffer::SSE2, ArRangeBuffer::AVX2 };
+  const ArRangeBuffer::Implementation best = ArRangeBuffer::getImplementation();
+  for (size_t n = 0; n < sizeof(impls) / sizeof(impls[0]); n++)
+  {
+    if (!ArRangeBuffer::setImplementation(impls[n]))
+      continue;
+    double angle = 0;
+    const double polar = buffer.getClosestPolar(start, end, pos, 30000, &angle);
+    const double box = buffer.getClosestBox(-5000, -2000, 5000, 2000, pos, 30000);
+    if (polar != modelPolar || (polar < 30000 && angle != modelAngle) ||
+	box != modelBox)
+    {
+      printf("FAILED: closest readings differ after %s with %s (polar %g %g, box %g %g)\n",
+	     after, ArRangeBuffer::getImplementationName(impls[n]), polar,
+	     modelPolar, box, modelBox);
+      failed = true;
+    }
+  }
+  ArRangeBuffer::setImplementation(best);
+}
+
+int main()
+{
+  Aria::init();
+  srand(1);
+
+  modelCapacity = 50;
+  ArRangeBuffer buffer(modelCapacity);
+  check(buffer, "nothing");
+
+  for (int round = 0; round < 3000 && !failed; round++)
+  {
+    const int op = rand() % 100;
+    if (op < 50)
+    {
+      const double x = randCoord(), y = randCoord();
+      buffer.addReading(x, y);
+      modelAdd(x, y);
+      check(buffer, "addReading");
+    }
+    else if (op < 65)
+    {
+      // near an existing reading about half the time
+      double x = randCoord(), y = randCoord();
+      if (!model.empty() && rand() % 2 == 0)
+      {
+	auto it = model.begin();
+	std::advance(it, (size_t)rand() % model.size());
+	x = it->getX() + 1;
+	y = it->getY();
+      }
+      bool wasAdded;
+      buffer.addReadingConditional(x, y, 100 * 100, &wasAdded);
+      bool near = false;
+      for (auto it = model.begin(); it != model.end() && !near; ++it)
+	near = it->squaredFindDistanceTo(ArPose(x, y)) < 100 * 100;
+      if (!near)
+	modelAdd(x, y);
+      if (wasAdded == near)
+      {
+	printf("FAILED: addReadingConditional wasAdded wrong\n");
+	failed = true;
+      }
+      check(buffer, "addReadingConditional");
+    }
+    else if (op < 80)
+    {
+      // drop the readings on one side of a random line
+      const double limit = randCoord();
+      buffer.beginInvalidationSweep();
+      for (auto it = buffer.getBegin(); it != buffer.getEnd(); ++it)
+	if (it.getX() > limit)
+	  buffer.invalidateReading(it);
+      buffer.endInvalidationSweep();
+      model.remove_if([limit](const ArPose &p) { return p.getX() > limit; });
+      check(buffer, "invalidation sweep");
+    }
+    else if (op < 88)
+    {
+      // redo with fewer or more readings than there are
+      const size_t num = (size_t)(rand() % 70);
+      std::list<ArPose> redone;
+      buffer.beginRedoBuffer();
+      auto mit = model.begin();
+      for (size_t i = 0; i < num; i++)
+      {
+	const double x = randCoord(), y = randCoord();
+	buffer.redoReading(x, y);
+	if (mit != model.end())
+	{
+	  *mit = ArPose(x, y);
+	  ++mit;
+	}
+	else
+	  redone.push_front(ArPose(x, y));
+      }
+      buffer.endRedoBuffer();
+      if (mit != model.end())
+	model.erase(mit, model.end());
+      else
+	for (auto it = redone.rbegin(); it != redone.rend(); ++it)
+	  modelAdd(it->getX(), it->getY());
+      check(buffer, "redo");
+    }
+    else if (op < 93)
+    {
+      modelCapacity = (size_t)(rand() % 80);
+      buffer.setCapacity(modelCapacity);
+      while (model.size() > modelCapacity)
+	model.pop_back();
+      check(buffer, "setCapacity");
+    }
+    else if (op < 96)
+    {
+      const ArTransform trans(ArPose(randCoord(), randCoord(), 30),
+			      ArPose(0, 0, 0));
+      buffer.applyTransform(trans);
+      for (auto it = model.begin(); it != model.end(); ++it)
+	*it = trans.doTransform(*it);
+      check(buffer, "applyTransform");
+    }
+    else if (op < 98)
+    {
+      // the old way, invalidating through getBuffer()
+      buffer.beginInvalidationSweep();
+      const std::list<ArPoseWithTime> &list = buffer.getBuffer();
+      for (auto it = list.begin(); it != list.end(); ++it)
+	if (it->getY() < 0)
+	  buffer.invalidateReading(it);
+      buffer.endInvalidationSweep();
+      model.remove_if([](const ArPose &p) { return p.getY() < 0; });
+      check(buffer, "invalidation sweep through getBuffer()");
+    }
+    else
+    {
+      buffer.clear();
+      model.clear();
+      check(buffer, "clear");
+    }
+  }
+
+  // only looking through getBufferPtr() doesn't change anything, once
+  // the buffer has been read again
+  unsigned long changeCount = buffer.getChangeCount();
+  std::list<ArPoseWithTime> *list = buffer.getBufferPtr();
+  buffer.getBufferPtrsPtr();
+  buffer.getCurrentSize();
+  if (buffer.getChangeCount() != changeCount)
+  {
+    printf("FAILED: getBufferPtr() without changes changed the change count\n");
+    failed = true;
+  }
+  buffer.addReading(3, 4);
+  modelAdd(3, 4);
+  if (buffer.getChangeCount() != changeCount + 1)
+  {
+    printf("FAILED: taking back an unchanged list changed the change count\n");
+    failed = true;
+  }
+  check(buffer, "looking through getBufferPtr()");
+
+  // changes through getBufferPtr() are seen as soon as the buffer is
+  // read, and the change count says so even before then
+  changeCount = buffer.getChangeCount();
+  list = buffer.getBufferPtr();
+  for (auto it = list->begin(); it != list->end(); ++it)
+    it->setX(it->getX() + 1);
+  list->pop_back();
+  for (auto it = model.begin(); it != model.end(); ++it)
+    it->setX(it->getX() + 1);
+  if (!model.empty())
+    model.pop_back();
+  if (buffer.getChangeCount() == changeCount)
+  {
+    printf("FAILED: changes through getBufferPtr() didn't change the change count\n");
+    failed = true;
+  }
+  check(buffer, "changes through getBufferPtr()");
+  if (buffer.getChangeCount() == changeCount)
+  {
+    printf("FAILED: taking back changes through getBufferPtr() didn't change the change count\n");
+    failed = true;
+  }
+
+  // and through getBufferPtrsPtr(), by the closest reading checks too
+  std::list<ArPoseWithTime *> *ptrs = buffer.getBufferPtrsPtr();
+  if (!ptrs->empty())
+  {
+    ptrs->front()->setX(0);
+    ptrs->front()->setY(0);
+    model.front() = ArPose(0, 0);
+    if (buffer.getClosestBox(-1, -1, 1, 1, ArPose(0, 0, 0), 30000) != 0)
+    {
+      printf("FAILED: getClosestBox() didn't see a change through getBufferPtrsPtr()\n");
+      failed = true;
+    }
+  }
+  check(buffer, "changes through getBufferPtrsPtr()");
+  buffer.addReading(1, 2);
+  modelAdd(1, 2);
+  check(buffer, "adding after changes through getBufferPtr()");
+
+  printf("%d checks\n", numChecks);
+  if (failed)
+  {
+    printf("rangeBufferRingTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("rangeBufferRingTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
@@ -0,0 +1,175 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+
+// Runs made-up scans through ArLaser::laserProcessReadings() from the
+// main thread while reader threads go through the scans from
+// ArRangeDevice::getLatestScan(), and checks that every reading in a scan
+// came from the same scan, that a scan doesn't change while a reader has
+// it, and that scans never go backwards.  Then holds the laser locked, as
+// the thread reading a laser would, and checks that a scan can still be
+// gotten without waiting for it.
+
+const int NUM_READERS = 3;
+const int NUM_SCANS = 20000;
+const size_t NUM_READINGS = 541;
+
+std::atomic<bool> done(false);
+
+class TestLaser : public ArLaser
+{
+public:
+  TestLaser() : ArLaser(1, "test", 30000) {}
+  virtual bool blockingConnect() override { return true; }
+  virtual bool asyncConnect() override { return true; }
+  virtual bool disconnect() override { return true; }
+  virtual bool isConnected() override { return true; }
+  virtual bool isTryingToConnect() override { return false; }
+  virtual void *runThread(void *) override { return NULL; }
+  void process(std::list<ArSensorReading *> *readings)
+  {
+    myRawReadings = readings;
+    laserProcessReadings();
+    myRawReadings = NULL;
+  }
+};
+
+// scan n has every reading n + 1000 mm out, taken at counter n
+bool wholeScan(const ArRangeScan &scan)
+{
+  const unsigned int counter = scan.getReading(0).getCounterTaken();
+  for (size_t i = 0; i < scan.getNumReadings(); i++)
+    if (scan.getReading(i).getCounterTaken() != counter ||
+	scan.getReading(i).getRange() != counter + 1000)
+      return false;
+  return scan.getNumReadings() == NUM_READINGS;
+}
+
+class Reader : public ArASyncTask
+{
+public:
+  Reader(ArRangeDevice *device) :
+    myDevice(device), myNumReads(0), myNumTorn(0), myNumChanged(0),
+    myNumBackwards(0) {}
+  virtual void *runThread(void *) override
+  {
+    unsigned long lastCount = 0;
+    while (!done)
+    {
+      std::shared_ptr<const ArRangeScan> scan = myDevice->getLatestScan();
+      if (!scan)
+	continue;
+      myNumReads++;
+      if (!wholeScan(*scan))
+	myNumTorn++;
+      if (scan->getCount() < lastCount)
+	myNumBackwards++;
+      lastCount = scan->getCount();
+      // hold on to it for a while, it shouldn't change
+      const unsigned int range = scan->getReading(NUM_READINGS / 2).getRange();
+      ArUtil::sleep(1);
+      if (scan->getReading(NUM_READINGS / 2).getRange() != range ||
+	  !wholeScan(*scan))
+	myNumChanged++;
+    }
+    return NULL;
+  }
+  ArRangeDevice *myDevice;
+  std::atomic<long> myNumReads;
+  long myNumTorn;
+  long myNumChanged;
+  long myNumBackwards;
+};
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  TestLaser laser;
+  if (laser.getLatestScan())
+  {
+    printf("FAILED: got a scan before there were any\n");
+    failed = true;
+  }
+
+  std::vector<ArSensorReading> readings(NUM_READINGS);
+  std::list<ArSensorReading *> readingList;
+  for (size_t i = 0; i < NUM_READINGS; i++)
+  {
+    readings[i].resetSensorPosition(0, 0, -135 + (double)i * 0.5);
+    readingList.push_back(&readings[i]);
+  }
+
+  Reader *readers[NUM_READERS];
+  for (int i = 0; i < NUM_READERS; i++)
+  {
+    readers[i] = new Reader(&laser);
+    readers[i]->runAsync();
+  }
+
+  const ArPose pose(1000, 2000, 30);
+  const ArTransform trans(pose);
+  for (int n = 0; n < NUM_SCANS; n++)
+  {
+    for (size_t i = 0; i < NUM_READINGS; i++)
+      readings[i].newData((unsigned int)n + 1000, pose, pose, trans,
+			  (unsigned int)n, ArTime());
+    laser.lockDevice();
+    laser.process(&readingList);
+    laser.unlockDevice();
+  }
+  std::shared_ptr<const ArRangeScan> last = laser.getLatestScan();
+  if (!last || last->getCount() != (unsigned long)NUM_SCANS ||
+      last->getReading(0).getCounterTaken() != (unsigned int)NUM_SCANS - 1 ||
+      last->getPoseTaken().getX() != pose.getX())
+  {
+    printf("FAILED: the last scan isn't the last one processed\n");
+    failed = true;
+  }
+
+  done = true;
+  for (int i = 0; i < NUM_READERS; i++)
+  {
+    readers[i]->stopRunning();
+    while (readers[i]->getRunning())
+      ArUtil::sleep(1);
+    printf("reader %d: %ld scans, %ld torn, %ld changed, %ld went backwards\n",
+	   i, readers[i]->myNumReads.load(), readers[i]->myNumTorn,
+	   readers[i]->myNumChanged, readers[i]->myNumBackwards);
+    if (readers[i]->myNumReads == 0 || readers[i]->myNumTorn != 0 ||
+	readers[i]->myNumChanged != 0 || readers[i]->myNumBackwards != 0)
+      failed = true;
+    delete readers[i];
+  }
+
+  // a scan from another thread doesn't wait for the laser to be unlocked
+  laser.lockDevice();
+  done = false;
+  Reader reader(&laser);
+  reader.runAsync();
+  ArTime started;
+  while (reader.myNumReads == 0 && started.mSecSince() < 1000)
+    ArUtil::sleep(1);
+  done = true;
+  laser.unlockDevice();
+  reader.stopRunning();
+  while (reader.getRunning())
+    ArUtil::sleep(1);
+  if (reader.myNumReads == 0)
+  {
+    printf("FAILED: getting the scan waited for the laser to be unlocked\n");
+    failed = true;
+  }
+
+  if (failed)
+  {
+    printf("rangeScanTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("rangeScanTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
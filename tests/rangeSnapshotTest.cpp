@@ -0,0 +1,220 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <chrono>
+
+// Fills two range devices with random current readings (including some
+// on the exact edges of the cells and angle buckets ArRangeSnapshot uses)
+// and checks that ArRobot::checkRangeDevicesCurrentPolar() and
+// ArRobot::checkRangeDevicesCurrentBox() give exactly the same answers
+// from the range snapshot as they do asking each device.  Then times the
+// queries an action cycle makes both ways.
+
+class TestRangeDevice : public ArRangeDevice
+{
+public:
+  TestRangeDevice(const char *name, unsigned int maxRange) :
+    ArRangeDevice(2000, 0, name, maxRange)
+    { setMinDistBetweenCurrent(0); }
+};
+
+double randomIn(double low, double high)
+{
+  return low + (high - low) * rand() / (double)RAND_MAX;
+}
+
+void fill(ArRobot *robot, TestRangeDevice *device, int numReadings)
+{
+  const ArPose pose = robot->getPose();
+  device->lockDevice();
+  device->clearCurrentReadings();
+  for (int i = 0; i < numReadings; i++)
+  {
+    double x, y;
+    switch (i % 4)
+    {
+    case 0:
+      // right on the grid lines
+      x = ArRangeSnapshot::GRID_CELL_SIZE * (rand() % 41 - 20);
+      y = ArRangeSnapshot::GRID_CELL_SIZE * (rand() % 41 - 20);
+      break;
+    case 1:
+    {
+      // right on a whole degree
+      const double th = rand() % 360 - 180;
+      const double dist = randomIn(100, 6000);
+      x = dist * ArMath::cos(th);
+      y = dist * ArMath::sin(th);
+      break;
+    }
+    default:
+      x = randomIn(-6000, 6000);
+      y = randomIn(-6000, 6000);
+    }
+    // readings are global, so put them around the robot
+    ArPose global = ArTransform(ArPose(0, 0, 0), pose).doTransform(
+	    ArPose(x, y));
+    device->addReading(global.getX(), global.getY());
+    // and a few at exactly the same distance
+    if (i % 50 == 0)
+    {
+      global = ArTransform(ArPose(0, 0, 0), pose).doTransform(ArPose(-x, y));
+      device->addReading(global.getX(), global.getY());
+    }
+  }
+  device->unlockDevice();
+}
+
+int main()
+{
+  Aria::init();
+  srand(12345);
+  bool failed = false;
+
+  ArRobot robot;
+  TestRangeDevice near("near", 3000);
+  TestRangeDevice far("far", 5000);
+  near.setRobot(&robot);
+  far.setRobot(&robot);
+  robot.addRangeDevice(&near);
+  robot.addRangeDevice(&far);
+
+  int numChecks = 0;
+  for (int round = 0; round < 20 && !failed; round++)
+  {
+    robot.moveTo(ArPose(randomIn(-5000, 5000), randomIn(-5000, 5000),
+			randomIn(-180, 180)), false);
+    fill(&robot, &near, 300);
+    fill(&robot, &far, 300);
+
+    for (int i = 0; i < 500 && !failed; i++)
+    {
+      double start, end;
+      if (i % 3 == 0)
+      {
+	start = rand() % 400 - 200;
+	end = rand() % 400 - 200;
+      }
+      else
+      {
+	start = randomIn(-200, 200);
+	end = randomIn(-200, 200);
+      }
+      const bool locationDependent = (i % 7 != 0);
+
+      double snapAngle = 1234, angle = 1234;
+      const ArRangeDevice *snapDevice = NULL, *device = NULL;
+      robot.setRangeSnapshot(true);
+      const double snapDist = robot.checkRangeDevicesCurrentPolar(
+	      start, end, &snapAngle, &snapDevice, locationDependent);
+      robot.setRangeSnapshot(false);
+      const double dist = robot.checkRangeDevicesCurrentPolar(
+	      start, end, &angle, &device, locationDependent);
+      numChecks++;
+      // the angle is only set when a reading's found
+      if (snapDist != dist || snapDevice != device ||
+	  (device != NULL && dist < device->getMaxRange() && 
+	   snapAngle != angle))
+      {
+	printf("FAILED: polar %g to %g gave %.17g at %.17g from %s, should be %.17g at %.17g from %s\n",
+	       start, end, snapDist, snapAngle,
+	       snapDevice != NULL ? snapDevice->getName() : "none",
+	       dist, angle, device != NULL ? device->getName() : "none");
+	failed = true;
+      }
+
+      double x1, y1, x2, y2;
+      if (i % 3 == 0)
+      {
+	x1 = ArRangeSnapshot::GRID_CELL_SIZE * (rand() % 41 - 20);
+	y1 = ArRangeSnapshot::GRID_CELL_SIZE * (rand() % 41 - 20);
+	x2 = ArRangeSnapshot::GRID_CELL_SIZE * (rand() % 41 - 20);
+	y2 = ArRangeSnapshot::GRID_CELL_SIZE * (rand() % 41 - 20);
+      }
+      else
+      {
+	x1 = randomIn(-6000, 6000);
+	y1 = randomIn(-6000, 6000);
+	x2 = randomIn(-6000, 6000);
+	y2 = randomIn(-6000, 6000);
+      }
+      ArPose snapPos(1, 2, 3), pos(1, 2, 3);
+      snapDevice = device = NULL;
+      robot.setRangeSnapshot(true);
+      const double snapBox = robot.checkRangeDevicesCurrentBox(
+	      x1, y1, x2, y2, &snapPos, &snapDevice, locationDependent);
+      robot.setRangeSnapshot(false);
+      const double box = robot.checkRangeDevicesCurrentBox(
+	      x1, y1, x2, y2, &pos, &device, locationDependent);
+      numChecks++;
+      if (snapBox != box || snapPos.getX() != pos.getX() ||
+	  snapPos.getY() != pos.getY() || snapDevice != device)
+      {
+	printf("FAILED: box %g,%g %g,%g gave %.17g at %.17g,%.17g from %s, should be %.17g at %.17g,%.17g from %s\n",
+	       x1, y1, x2, y2, snapBox, snapPos.getX(), snapPos.getY(),
+	       snapDevice != NULL ? snapDevice->getName() : "none",
+	       box, pos.getX(), pos.getY(),
+	       device != NULL ? device->getName() : "none");
+	failed = true;
+      }
+    }
+  }
+
+  // the snapshot has to notice new readings and the robot moving
+  robot.setRangeSnapshot(true);
+  robot.checkRangeDevicesCurrentBox(0, -1000, 6000, 1000);
+  const unsigned long builds = robot.getRangeSnapshotBuilds();
+  robot.checkRangeDevicesCurrentBox(0, -1000, 6000, 1000);
+  robot.checkRangeDevicesCurrentPolar(-30, 30);
+  if (robot.getRangeSnapshotBuilds() != builds)
+  {
+    printf("FAILED: snapshot was rebuilt with nothing changed\n");
+    failed = true;
+  }
+  near.lockDevice();
+  near.addReading(robot.getX() + 10, robot.getY() + 10);
+  near.unlockDevice();
+  robot.checkRangeDevicesCurrentPolar(-30, 30);
+  robot.moveTo(ArPose(0, 0, 0), false);
+  robot.checkRangeDevicesCurrentPolar(-30, 30);
+  if (robot.getRangeSnapshotBuilds() != builds + 2)
+  {
+    printf("FAILED: snapshot built %lu times for a new reading and a move, should be 2\n",
+	   robot.getRangeSnapshotBuilds() - builds);
+    failed = true;
+  }
+
+  // time a cycle's worth of action queries (a few polar slices and eight
+  // boxes) both ways, with new readings each cycle
+  const int cycles = 200;
+  for (int snapshot = 0; snapshot < 2; snapshot++)
+  {
+    robot.setRangeSnapshot(snapshot == 1);
+    long long usecs = 0;
+    for (int cycle = 0; cycle < cycles; cycle++)
+    {
+      fill(&robot, &near, 300);
+      fill(&robot, &far, 300);
+      const auto started = std::chrono::steady_clock::now();
+      for (int i = 0; i < 4; i++)
+	robot.checkRangeDevicesCurrentPolar(-30 - i * 10, 30 + i * 10);
+      for (int i = 0; i < 8; i++)
+	robot.checkRangeDevicesCurrentBox(0, -300 - i * 20, 500 + i * 200,
+					  300 + i * 20);
+      usecs += std::chrono::duration_cast<std::chrono::microseconds>(
+	      std::chrono::steady_clock::now() - started).count();
+    }
+    printf("%s: %lld usecs a cycle\n",
+	   snapshot == 1 ? "snapshot" : "each device", usecs / cycles);
+  }
+
+  if (failed)
+  {
+    printf("rangeSnapshotTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("rangeSnapshotTest passed (%d checks)\n", numChecks);
+  Aria::exit(0);
+  return 0;
+}
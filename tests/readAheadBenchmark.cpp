@@ -0,0 +1,152 @@
+#include "Aria/Aria.h"
+#include "Aria/ArFileDeviceConnection.h"
+#include "Aria/ArRobotPacketReceiver.h"
+
+#include <stdio.h>
+#include <string.h>
+
+// Counts how many read() calls (i.e. read system calls, plus a select() for
+// each one that waits) it takes to frame robot packets out of a byte stream.
+//
+// Usage: readAheadBenchmark [capturefile]
+//
+// The capture file is just the raw bytes received from a robot (e.g. saved
+// by tests/serialDump).  If no file is given, a stream of 5000 SIP-sized
+// packets (with some garbage between them) is generated in
+// readAheadBenchmark.dat and used instead.
+//
+// The stream is replayed through ArFileDeviceConnection twice: once with the
+// byte-at-a-time framing that ArRobotPacketReceiver used to do (one read per
+// header byte and one for the rest of the packet), and once through
+// ArRobotPacketReceiver, which frames packets out of the connection's
+// read-ahead buffer.
+
+class CountingFileConnection : public ArFileDeviceConnection
+{
+public:
+  CountingFileConnection() : myReadCalls(0) {}
+  virtual int read(const char *data, unsigned int size, unsigned int msWait = 0) override
+  {
+    myReadCalls++;
+    return ArFileDeviceConnection::read(data, size, msWait);
+  }
+  unsigned long long myReadCalls;
+};
+
+const char *generateCapture()
+{
+  const char *filename = "readAheadBenchmark.dat";
+  FILE *fp = ArUtil::fopen(filename, "wb");
+  if (fp == NULL)
+  {
+    ArLog::log(ArLog::Terse, "readAheadBenchmark: could not create %s", filename);
+    return NULL;
+  }
+  ArRobotPacket packet;
+  for (int i = 0; i < 5000; i++)
+  {
+    packet.empty();
+    packet.setID(0x32);
+    for (int j = 0; j < 20 + (i % 20); j++)
+      packet.byte2ToBuf((short)(i + j));
+    packet.finalizePacket();
+    fwrite(packet.getBuf(), 1, packet.getLength(), fp);
+    // some line noise every now and then
+    if (i % 100 == 0)
+      fwrite("\x01\x02\xfa\x03", 1, 4, fp);
+  }
+  fclose(fp);
+  return filename;
+}
+
+// What ArRobotPacketReceiver used to do: one read() per header byte, then one
+// read() for the rest of the packet.
+long legacyFraming(CountingFileConnection *conn)
+{
+  long numPackets = 0;
+  unsigned char c;
+  char buf[256];
+  while (true)
+  {
+    if (conn->read((char *)&c, 1, 0) <= 0)
+      break;
+    if (c != 0xfa)
+      continue;
+    if (conn->read((char *)&c, 1, 0) <= 0)
+      break;
+    if (c != 0xfb)
+      continue;
+    if (conn->read((char *)&c, 1, 0) <= 0)
+      break;
+    int count = 0;
+    int n = 0;
+    while (count < c && (n = conn->read(buf + count, (unsigned int)(c - count), 0)) > 0)
+      count += n;
+    if (count < c)
+      break;
+    numPackets++;
+  }
+  return numPackets;
+}
+
+long readAheadFraming(CountingFileConnection *conn)
+{
+  long numPackets = 0;
+  ArRobotPacketReceiver receiver(conn);
+  // receivePacket(0) also gives up (returning NULL) if the clock ticks
+  // over while it is skipping garbage, so only stop once it comes back
+  // empty a few times in a row
+  int empty = 0;
+  while (empty < 3)
+  {
+    if (receiver.receivePacket(0) != NULL)
+    {
+      numPackets++;
+      empty = 0;
+    }
+    else
+      empty++;
+  }
+  return numPackets;
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  const char *filename = (argc > 1) ? argv[1] : generateCapture();
+  if (filename == NULL)
+    return 1;
+
+  CountingFileConnection legacyConn;
+  if (legacyConn.open(filename) != 0)
+    return 2;
+  ArTime legacyTime;
+  const long legacyPackets = legacyFraming(&legacyConn);
+  const long long legacyMS = legacyTime.mSecSinceLL();
+
+  CountingFileConnection readAheadConn;
+  if (readAheadConn.open(filename) != 0)
+    return 2;
+  ArTime readAheadTime;
+  const long readAheadPackets = readAheadFraming(&readAheadConn);
+  const long long readAheadMS = readAheadTime.mSecSinceLL();
+
+  printf("%-12s %10s %12s %14s %8s\n", "framing", "packets", "read calls", "reads/packet", "ms");
+  printf("%-12s %10ld %12llu %14.2f %8lld\n", "byte", legacyPackets,
+         legacyConn.myReadCalls,
+         legacyPackets > 0 ? (double)legacyConn.myReadCalls / (double)legacyPackets : 0.0,
+         legacyMS);
+  printf("%-12s %10ld %12llu %14.2f %8lld\n", "read-ahead", readAheadPackets,
+         readAheadConn.myReadCalls,
+         readAheadPackets > 0 ? (double)readAheadConn.myReadCalls / (double)readAheadPackets : 0.0,
+         readAheadMS);
+
+  if (readAheadPackets < legacyPackets)
+  {
+    printf("FAILED: read-ahead framing lost %ld packets\n", legacyPackets - readAheadPackets);
+    Aria::exit(1);
+    return 1;
+  }
+  Aria::exit(0);
+  return 0;
+}
@@ -0,0 +1,94 @@
+#include "Aria/Aria.h"
+#include "Aria/ArRobotPacketRing.h"
+
+#include <stdio.h>
+#include <atomic>
+
+// Pushes numbered packets through ArRobotPacketRing from one thread while
+// another thread pops them, checking that none are lost, reordered or
+// corrupted, that the pending SIP count matches what's in the ring, and that
+// pushes into a full ring are counted as overflows.
+
+const unsigned int NUM_PACKETS = 200000;
+
+class Producer : public ArASyncTask
+{
+public:
+  Producer(ArRobotPacketRing *ring) : myRing(ring), myNumDropped(0), myDone(false) {}
+  virtual void *runThread(void *) override
+  {
+    ArRobotPacket packet;
+    for (unsigned int i = 0; i < NUM_PACKETS; i++)
+    {
+      packet.empty();
+      // every third packet is a SIP
+      packet.setID((i % 3 == 0) ? 0x32 : 0x20);
+      packet.uByte4ToBuf(i);
+      packet.finalizePacket();
+      // keep trying until the consumer makes room, so every packet
+      // eventually goes through (each failed try counts as an overflow)
+      while (!myRing->push(&packet))
+      {
+        myNumDropped++;
+        ArThread::yieldProcessor();
+      }
+    }
+    myDone = true;
+    return NULL;
+  }
+  ArRobotPacketRing *myRing;
+  unsigned long myNumDropped;
+  std::atomic<bool> myDone;
+};
+
+int main()
+{
+  Aria::init();
+  ArRobotPacketRing ring(64);
+  Producer producer(&ring);
+
+  producer.runAsync();
+  unsigned long numPopped = 0;
+  long last = -1;
+  bool failed = false;
+  ArTime started;
+  while (!producer.myDone || ring.front() != NULL)
+  {
+    ArRobotPacket *packet = ring.front();
+    if (packet == NULL)
+    {
+      ArThread::yieldProcessor();
+      continue;
+    }
+    if (ring.getNumPendingSips() < (ArRobotPacketRing::isSip(packet) ? 1 : 0))
+    {
+      printf("FAILED: pending SIP count %d with a SIP at the front\n", ring.getNumPendingSips());
+      failed = true;
+    }
+    packet->resetRead();
+    const long num = (long) packet->bufToUByte4();
+    if (!packet->verifyCheckSum() || num != last + 1)
+    {
+      printf("FAILED: got packet %ld after %ld (checksum %s)\n", num, last,
+             packet->verifyCheckSum() ? "good" : "bad");
+      failed = true;
+    }
+    last = num;
+    ring.pop();
+    numPopped++;
+  }
+  producer.stopRunning();
+
+  printf("pushed %u, popped %lu, full %lu times (ring says %lu), max depth %lu, pending SIPs %d, %ld ms\n",
+         NUM_PACKETS, numPopped, producer.myNumDropped, ring.getNumOverflows(),
+         (unsigned long) ring.getMaxDepth(), ring.getNumPendingSips(),
+         started.mSecSince());
+  if (numPopped != NUM_PACKETS ||
+      producer.myNumDropped != ring.getNumOverflows() ||
+      ring.getNumPendingSips() != 0)
+    failed = true;
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,99 @@
+#include "Aria/Aria.h"
+#include "Aria/ArFileDeviceConnection.h"
+#include "Aria/ArRobotPacketSender.h"
+
+#include <stdio.h>
+#include <string>
+
+// Sends the same sequence of commands through ArRobotPacketSender twice,
+// once normally and once batched, and checks that the batched version writes
+// exactly the same bytes in the same order, but with only one write().
+
+class RecordingConnection : public ArFileDeviceConnection
+{
+public:
+  RecordingConnection() : myWriteCalls(0) {}
+  virtual int write(const char *data, unsigned int size) override
+  {
+    myWriteCalls++;
+    myWritten.append(data, size);
+    return (int)size;
+  }
+  unsigned long myWriteCalls;
+  std::string myWritten;
+};
+
+void sendCycle(ArRobotPacketSender *sender)
+{
+  sender->comInt(ArCommands::SETV, 750);
+  sender->comInt(ArCommands::SETA, 300);
+  sender->comInt(ArCommands::SETA, -300);
+  sender->comInt(ArCommands::VEL, 200);
+  sender->comInt(ArCommands::SETRV, 100);
+  sender->comInt(ArCommands::SETRA, 50);
+  sender->comInt(ArCommands::RVEL, -15);
+  sender->com2Bytes(ArCommands::SETRVDIR, 1, 2);
+  sender->comStr(ArCommands::SAY, "hi");
+  sender->com(ArCommands::PULSE);
+}
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  RecordingConnection plainConn;
+  plainConn.open("/dev/null", "/dev/null");
+  ArRobotPacketSender plainSender(&plainConn);
+  sendCycle(&plainSender);
+
+  RecordingConnection batchConn;
+  batchConn.open("/dev/null", "/dev/null");
+  ArRobotPacketSender batchSender(&batchConn);
+  batchSender.startBatch();
+  sendCycle(&batchSender);
+  if (batchConn.myWriteCalls != 0)
+  {
+    printf("FAILED: %lu writes before the batch was flushed\n", batchConn.myWriteCalls);
+    failed = true;
+  }
+  if (!batchSender.flushBatch())
+  {
+    printf("FAILED: flushBatch() failed\n");
+    failed = true;
+  }
+  // an empty batch shouldn't write anything
+  batchSender.startBatch();
+  batchSender.flushBatch();
+
+  printf("unbatched: %lu writes, %lu bytes; batched: %lu writes, %lu bytes (%lu commands in %lu batches)\n",
+         plainConn.myWriteCalls, (unsigned long)plainConn.myWritten.size(),
+         batchConn.myWriteCalls, (unsigned long)batchConn.myWritten.size(),
+         batchSender.getNumBatchedCommands(), batchSender.getNumBatchesFlushed());
+  if (batchConn.myWriteCalls != 1 || batchSender.getNumBatchesFlushed() != 1 ||
+      batchSender.getNumBatchedCommands() != plainConn.myWriteCalls)
+    failed = true;
+  if (batchConn.myWritten != plainConn.myWritten)
+  {
+    printf("FAILED: batched bytes differ from unbatched bytes\n");
+    failed = true;
+  }
+  // both count every command they wrote, batched or not
+  if (plainSender.getNumPacketsWritten() != plainConn.myWriteCalls ||
+      batchSender.getNumPacketsWritten() != plainConn.myWriteCalls)
+  {
+    printf("FAILED: %lu and %lu packets written, should be %lu\n",
+           plainSender.getNumPacketsWritten(), batchSender.getNumPacketsWritten(),
+           plainConn.myWriteCalls);
+    failed = true;
+  }
+
+  // after flushing, commands are written as they are sent again
+  batchSender.com(ArCommands::PULSE);
+  if (batchConn.myWriteCalls != 2)
+    failed = true;
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,118 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <atomic>
+
+// Moves an (unconnected) ArRobot over and over from the main thread while
+// reader threads take state snapshots, and checks that every snapshot has
+// a pose that was really published (x, y and th all from the same move)
+// and that snapshots never go backwards.  Then holds the robot locked for
+// a while, as a long robot cycle would, and checks that a snapshot can
+// still be taken without waiting for it.
+
+const int NUM_READERS = 3;
+const int NUM_MOVES = 200000;
+
+std::atomic<bool> done(false);
+
+class Reader : public ArASyncTask
+{
+public:
+  Reader(ArRobot *robot) :
+    myRobot(robot), myNumReads(0), myNumTorn(0), myNumBackwards(0) {}
+  virtual void *runThread(void *) override
+  {
+    unsigned long lastCount = 0;
+    while (!done)
+    {
+      const ArRobotState state = myRobot->getStateSnapshot();
+      myNumReads++;
+      // every move puts the robot at (n, 2n, n % 90)
+      const double n = state.getX();
+      if (state.getY() != 2 * n ||
+	  state.getTh() != ArMath::fixAngle((double)((long)n % 90)))
+	myNumTorn++;
+      if (state.getCount() < lastCount)
+	myNumBackwards++;
+      lastCount = state.getCount();
+    }
+    return NULL;
+  }
+  ArRobot *myRobot;
+  std::atomic<long> myNumReads;
+  long myNumTorn;
+  long myNumBackwards;
+};
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  ArRobot robot;
+  Reader *readers[NUM_READERS];
+  for (int i = 0; i < NUM_READERS; i++)
+  {
+    readers[i] = new Reader(&robot);
+    readers[i]->runAsync();
+  }
+
+  const unsigned long countBefore = robot.getStateSnapshot().getCount();
+  for (int n = 0; n < NUM_MOVES; n++)
+  {
+    robot.lock();
+    robot.moveTo(ArPose(n, 2 * n, n % 90), false);
+    robot.unlock();
+  }
+  const ArRobotState last = robot.getStateSnapshot();
+  if (last.getX() != NUM_MOVES - 1 ||
+      last.getCount() - countBefore != (unsigned long)NUM_MOVES)
+  {
+    printf("FAILED: last snapshot is at %g after %lu publishes, should be at %d after %d\n",
+	   last.getX(), last.getCount() - countBefore, NUM_MOVES - 1,
+	   NUM_MOVES);
+    failed = true;
+  }
+
+  done = true;
+  for (int i = 0; i < NUM_READERS; i++)
+  {
+    readers[i]->stopRunning();
+    while (readers[i]->getRunning())
+      ArUtil::sleep(1);
+    printf("reader %d: %ld snapshots, %ld torn, %ld went backwards\n", i,
+	   readers[i]->myNumReads.load(), readers[i]->myNumTorn,
+	   readers[i]->myNumBackwards);
+    if (readers[i]->myNumTorn != 0 || readers[i]->myNumBackwards != 0)
+      failed = true;
+    delete readers[i];
+  }
+
+  // a snapshot from another thread doesn't wait for the robot to be unlocked
+  robot.lock();
+  done = false;
+  Reader reader(&robot);
+  reader.runAsync();
+  ArTime started;
+  while (reader.myNumReads == 0 && started.mSecSince() < 1000)
+    ArUtil::sleep(1);
+  done = true;
+  robot.unlock();
+  reader.stopRunning();
+  while (reader.getRunning())
+    ArUtil::sleep(1);
+  if (reader.myNumReads == 0)
+  {
+    printf("FAILED: snapshot waited for the robot to be unlocked\n");
+    failed = true;
+  }
+
+  if (failed)
+  {
+    printf("robotStateSnapshotTest FAILED\n");
+    Aria::exit(1);
+  }
+  printf("robotStateSnapshotTest passed\n");
+  Aria::exit(0);
+  return 0;
+}
@@ -0,0 +1,129 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <atomic>
+
+// Adds sensor interp tasks that each sleep for a while to an (unconnected)
+// ArRobot, marks some of them concurrent, and runs the robot's cycle with and
+// without worker threads.  Checks that the concurrent ones overlap when
+// there are workers, that a task waits for the one it depends on (even
+// though its position says it runs first), that a suspended task is skipped
+// without holding up the ones that depend on it, and that the ordinary task
+// after them (and the action handler) only runs once they're all done.
+
+const unsigned int TASK_MS = 20;
+const int NUM_CONCURRENT = 4;
+
+std::atomic<int> running(0);
+std::atomic<int> maxRunning(0);
+std::atomic<int> numDone(0);
+
+class SlowTask
+{
+public:
+  SlowTask() : myCB(this, &SlowTask::run), myDone(false), myDependsOn(NULL),
+               myDependencyFailed(false) {}
+  void run()
+  {
+    if (myDependsOn != NULL && !myDependsOn->myDone)
+      myDependencyFailed = true;
+    const int now = ++running;
+    int max = maxRunning;
+    while (now > max && !maxRunning.compare_exchange_weak(max, now))
+      ;
+    ArUtil::sleep(TASK_MS);
+    --running;
+    myDone = true;
+    numDone++;
+  }
+  ArFunctorC<SlowTask> myCB;
+  std::atomic<bool> myDone;
+  SlowTask *myDependsOn;
+  bool myDependencyFailed;
+};
+
+class AfterTask
+{
+public:
+  AfterTask() : myCB(this, &AfterTask::run), myNumDoneBefore(0) {}
+  void run() { myNumDoneBefore = numDone; }
+  ArFunctorC<AfterTask> myCB;
+  int myNumDoneBefore;
+};
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  ArRobot robot;
+  SlowTask tasks[NUM_CONCURRENT];
+  AfterTask after;
+  char name[32];
+  for (int i = 0; i < NUM_CONCURRENT; i++)
+  {
+    sprintf(name, "slow %d", i);
+    robot.addSensorInterpTask(name, 80 - i, &tasks[i].myCB);
+    robot.setSensorInterpTaskConcurrent(name);
+  }
+  robot.addSensorInterpTask("after", 40, &after.myCB);
+  // slow 0 is positioned to run first, but has to wait for slow 2
+  tasks[0].myDependsOn = &tasks[2];
+  robot.addSensorInterpTaskDependency("slow 0", "slow 2");
+
+  for (unsigned int numThreads = 0; numThreads <= 3; numThreads += 3)
+  {
+    robot.setSensorInterpThreads(numThreads);
+    for (int i = 0; i < NUM_CONCURRENT; i++)
+    {
+      tasks[i].myDone = false;
+      tasks[i].myDependencyFailed = false;
+    }
+    numDone = 0;
+    maxRunning = 0;
+    const long long start = ArUtil::getTimeUSec();
+    robot.loopOnce();
+    const long long took = ArUtil::getTimeUSec() - start;
+    printf("%u threads: %d tasks of %u ms took %.1f ms, at most %d at once\n",
+           robot.getSensorInterpThreads(), NUM_CONCURRENT, TASK_MS,
+           (double)took / 1000.0, maxRunning.load());
+    if (after.myNumDoneBefore != NUM_CONCURRENT)
+    {
+      printf("FAILED: the task after the concurrent ones ran after %d of them\n",
+             after.myNumDoneBefore);
+      failed = true;
+    }
+    if (tasks[0].myDependencyFailed)
+    {
+      printf("FAILED: slow 0 ran before slow 2\n");
+      failed = true;
+    }
+    if (numThreads == 0 && maxRunning != 1)
+      failed = true;
+    // slow 0 waits for slow 2, so only 3 can run at once
+    if (numThreads > 0 && (maxRunning < 2 ||
+                           took >= (long long)(NUM_CONCURRENT * TASK_MS * 1000)))
+    {
+      printf("FAILED: the concurrent tasks didn't overlap\n");
+      failed = true;
+    }
+  }
+
+  // suspending slow 2 shouldn't hold up slow 0
+  ArSyncTask *slow2 = robot.getSyncTaskRoot()->findNonRecursive("Sensor Interp")->findNonRecursive("slow 2");
+  slow2->setState(ArTaskState::SUSPEND);
+  numDone = 0;
+  tasks[0].myDependsOn = NULL;
+  robot.loopOnce();
+  if (numDone != NUM_CONCURRENT - 1 || after.myNumDoneBefore != NUM_CONCURRENT - 1)
+  {
+    printf("FAILED: %d tasks ran with one suspended\n", numDone.load());
+    failed = true;
+  }
+  robot.logAllTasks(true);
+
+  robot.setSensorInterpThreads(0);
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,93 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <atomic>
+
+// Runs an unconnected ArRobot's cycle (so the sync loop does its own timing)
+// for a couple of seconds with the normal millisecond sleeps, then again in
+// real-time mode (absolute deadlines, and SCHED_FIFO if we're allowed), while
+// another thread keeps the CPU busy, and prints how far the cycle periods
+// were from the cycle time each way.  Checks that the real-time cycle holds
+// its period to under a millisecond on average.
+//
+// Usage: syncLoopRealTimeTest [cycleTimeMS] [seconds]
+
+class Spinner : public ArASyncTask
+{
+public:
+  Spinner() : mySpins(0) {}
+  virtual void *runThread(void *) override
+  {
+    while (getRunning())
+      mySpins++;
+    return NULL;
+  }
+  std::atomic<unsigned long long> mySpins;
+};
+
+class CycleWork
+{
+public:
+  CycleWork() : myCB(this, &CycleWork::work), myTotal(0) {}
+  // a little work every cycle, so the cycle isn't just sleeping
+  void work()
+  {
+    for (int i = 0; i < 100000; i++)
+      myTotal += (unsigned long long)i;
+  }
+  ArFunctorC<CycleWork> myCB;
+  unsigned long long myTotal;
+};
+
+void runCycles(ArRobot *robot, unsigned int seconds)
+{
+  robot->resetCycleStats();
+  ArUtil::sleep(seconds * 1000);
+  robot->lock();
+  robot->logCycleStats(ArLog::Terse);
+  robot->unlock();
+}
+
+int main(int argc, char **argv)
+{
+  Aria::init();
+  const unsigned int cycleTime = (argc > 1) ? (unsigned int)atoi(argv[1]) : 100;
+  const unsigned int seconds = (argc > 2) ? (unsigned int)atoi(argv[2]) : 2;
+  bool failed = false;
+
+  ArRobot robot;
+  CycleWork work;
+  robot.setCycleTime(cycleTime);
+  robot.addUserTask("work", 50, &work.myCB);
+
+  Spinner spinner;
+  spinner.runAsync();
+
+  robot.runAsync(false);
+  runCycles(&robot, seconds);
+  const double normalError = robot.getSyncLoop()->getMeanPeriodErrorUSec();
+
+  robot.setCycleRealTime(true, 10);
+  // let it pick up the new settings
+  ArUtil::sleep(cycleTime * 3);
+  runCycles(&robot, seconds);
+  const ArSyncLoop *loop = robot.getSyncLoop();
+  const double realTimeError = loop->getMeanPeriodErrorUSec();
+
+  robot.stopRunning();
+  spinner.stopRunning();
+  spinner.join();
+
+  printf("%u ms cycle: mean period error %.3f ms normally, %.3f ms real-time (max %.3f ms, %llu cycles, %llu overruns)\n",
+         cycleTime, normalError / 1000.0, realTimeError / 1000.0,
+         (double)loop->getMaxPeriodErrorUSec() / 1000.0,
+         loop->getNumCycles(), loop->getNumOverruns());
+  if (loop->getNumCycles() < seconds * 1000 / cycleTime / 2 ||
+      realTimeError >= 1000.0)
+    failed = true;
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+#include "Aria/Aria.h"
+
+#include <stdio.h>
+#include <string>
+
+// Builds an ArSyncTask tree and checks that run() calls the tasks in
+// position order (highest first, parents before children), skips suspended
+// branches and their children, copes with tasks adding and removing tasks
+// (including themselves) in the middle of a run, and keeps run times for
+// each task.  Then times running a tree of 50 tasks.
+
+std::string order;
+
+class Task
+{
+public:
+  Task(char c) : myCB(this, &Task::run), myChar(c), myNumRuns(0) {}
+  virtual ~Task() {}
+  virtual void run() { order += myChar; myNumRuns++; }
+  ArFunctorC<Task> myCB;
+  char myChar;
+  int myNumRuns;
+};
+
+// removes the task it's given (which may be itself) when it runs
+class Remover : public Task
+{
+public:
+  Remover(char c) : Task(c), myToRemove(NULL) {}
+  virtual void run() override
+  {
+    Task::run();
+    if (myToRemove != NULL)
+    {
+      delete myToRemove;
+      myToRemove = NULL;
+    }
+  }
+  ArSyncTask *myToRemove;
+};
+
+// adds a leaf to the branch it's given when it runs
+class Adder : public Task
+{
+public:
+  Adder(char c, Task *toAdd) : Task(c), myBranch(NULL), myToAdd(toAdd) {}
+  virtual void run() override
+  {
+    Task::run();
+    if (myBranch != NULL)
+    {
+      myBranch->addNewLeaf("added", 1, &myToAdd->myCB);
+      myBranch = NULL;
+    }
+  }
+  ArSyncTask *myBranch;
+  Task *myToAdd;
+};
+
+bool check(const char *what, const std::string &expected)
+{
+  if (order != expected)
+  {
+    printf("FAILED: %s ran '%s', should be '%s'\n", what, order.c_str(),
+           expected.c_str());
+    order.clear();
+    return false;
+  }
+  order.clear();
+  return true;
+}
+
+int main()
+{
+  Aria::init();
+  bool failed = false;
+
+  Task a('a'), b('b'), c('c'), d('d'), e('e'), f('f');
+  ArSyncTask root("root");
+  root.addNewBranch("one", 90);
+  root.addNewBranch("two", 50);
+  root.addNewLeaf("f", 10, &f.myCB);
+  ArSyncTask *one = root.findNonRecursive("one");
+  ArSyncTask *two = root.findNonRecursive("two");
+  one->addNewLeaf("b", 20, &b.myCB);
+  one->addNewLeaf("a", 80, &a.myCB);
+  two->addNewLeaf("c", 60, &c.myCB);
+  two->addNewLeaf("d", 40, &d.myCB);
+  two->addNewLeaf("e", 20, &e.myCB);
+
+  root.run();
+  failed |= !check("first run", "abcdef");
+
+  two->setState(ArTaskState::SUSPEND);
+  one->findNonRecursive("a")->setState(ArTaskState::SUCCESS);
+  root.run();
+  failed |= !check("suspended", "bf");
+  two->setState(ArTaskState::ACTIVE);
+  one->findNonRecursive("a")->setState(ArTaskState::ACTIVE);
+
+  // r removes d partway through the run, d shouldn't run
+  Remover remover('r');
+  one->addNewLeaf("r", 10, &remover.myCB);
+  remover.myToRemove = two->findNonRecursive("d");
+  root.run();
+  failed |= !check("removing a later task", "abrcef");
+
+  // r removes itself, everything else should still run once
+  remover.myToRemove = one->findNonRecursive("r");
+  root.run();
+  failed |= !check("removing itself", "abrcef");
+  root.run();
+  failed |= !check("after removing itself", "abcef");
+
+  // x adds d to the end of its own branch, which should run this cycle
+  Adder adder('x', &d);
+  two->addNewLeaf("x", 70, &adder.myCB);
+  adder.myBranch = two;
+  root.run();
+  failed |= !check("adding", "abxcedf");
+
+  if (one->findNonRecursive("a")->getRunTimes()->getTotalCount() != 5 ||
+      two->findNonRecursive("c")->getRunTimes()->getTotalCount() != 5 ||
+      root.findNonRecursive("f")->getRunTimes()->getTotalCount() != 6)
+  {
+    printf("FAILED: run times counted %llu %llu %llu times\n",
+           one->findNonRecursive("a")->getRunTimes()->getTotalCount(),
+           two->findNonRecursive("c")->getRunTimes()->getTotalCount(),
+           root.findNonRecursive("f")->getRunTimes()->getTotalCount());
+    failed = true;
+  }
+  root.log(0, true);
+  root.resetRunTimes();
+  if (one->findNonRecursive("a")->getRunTimes()->getTotalCount() != 0)
+    failed = true;
+
+  // time the dispatch over a bigger tree
+  ArSyncTask bigRoot("big");
+  Task *tasks[50];
+  char name[32];
+  for (int i = 0; i < 5; i++)
+  {
+    sprintf(name, "branch %d", i);
+    bigRoot.addNewBranch(name, i * 10);
+    ArSyncTask *branch = bigRoot.findNonRecursive(name);
+    for (int j = 0; j < 10; j++)
+    {
+      tasks[i * 10 + j] = new Task('.');
+      sprintf(name, "task %d", i * 10 + j);
+      branch->addNewLeaf(name, j, &tasks[i * 10 + j]->myCB);
+    }
+  }
+  const int numRuns = 20000;
+  const long long start = ArUtil::getTimeUSec();
+  for (int i = 0; i < numRuns; i++)
+  {
+    bigRoot.run();
+    order.clear();
+  }
+  const long long took = ArUtil::getTimeUSec() - start;
+  printf("%d runs of 50 tasks in 5 branches: %.3f us per run\n", numRuns,
+         (double)took / numRuns);
+  if (tasks[0]->myNumRuns != numRuns || tasks[49]->myNumRuns != numRuns)
+    failed = true;
+  for (int i = 0; i < 50; i++)
+    delete tasks[i];
+
+  printf("%s\n", failed ? "FAILED" : "passed");
+  Aria::exit(failed ? 1 : 0);
+  return failed ? 1 : 0;
+}